@@ -0,0 +1,7 @@
+#ifndef _APICREDENTIALS_
+#define _APICREDENTIALS_
+
+// Token exigido no cabeçalho "Authorization: Bearer <token>" da API local
+const char *apiToken = "YOUR_API_TOKEN";
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef _BOARDPROFILE_
+#define _BOARDPROFILE_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+
+#include "hydraulicPumpController.h"
+
+// GPIOs 6 a 11 são da flash SPI, 34 a 39 são apenas de entrada e 20, 24 e 28 a 31 não existem no ESP32
+constexpr bool isOutputGpio(uint8_t pin) {
+   return pin <= 33 && !(pin >= 6 && pin <= 11) && pin != 20 && pin != 24 && !(pin >= 28 && pin <= 31);
+}
+
+constexpr bool isSameCode(const char *first, const char *second) {
+   return *first == *second && (*first == '\0' || isSameCode(first + 1, second + 1));
+}
+
+template <uint8_t... Pins>
+struct OutputPins {
+   static constexpr uint8_t count = sizeof...(Pins);
+   static constexpr uint8_t gpio[count] = {Pins...};
+
+   static constexpr bool areUnique() {
+      for (uint8_t first = 0; first < count; first++)
+         for (uint8_t second = first + 1; second < count; second++)
+            if (gpio[first] == gpio[second])
+               return false;
+      return true;
+   }
+
+   static_assert(count > 0, "A placa precisa de ao menos uma saída");
+   static_assert((isOutputGpio(Pins) && ...), "GPIO inválido para saída (flash SPI, apenas entrada ou inexistente)");
+   static_assert(areUnique(), "GPIO de saída repetido");
+};
+
+struct PumpProfile {
+   const char *pumperCode;
+   uint8_t output;          // Índice em Outputs
+   uint32_t pulseDuration;  // Em ms, usado até a configuração ser carregada
+   uint8_t priority;        // No sequenciador, maior valor é atendido primeiro
+};
+
+// Valida em tempo de compilação a ligação das bombas às saídas de um perfil
+template <typename Profile>
+struct BoardLayout {
+   using Outputs = typename Profile::Outputs;
+
+   static constexpr uint8_t outputCount = Outputs::count;
+   static constexpr uint8_t pumpCount = sizeof(Profile::pumps) / sizeof(PumpProfile);
+
+   static constexpr uint8_t gpio(size_t pump) {
+      return Outputs::gpio[Profile::pumps[pump].output];
+   }
+
+   static constexpr bool isValid() {
+      for (uint8_t pump = 0; pump < pumpCount; pump++) {
+         if (Profile::pumps[pump].output >= outputCount || Profile::pumps[pump].pulseDuration == 0)
+            return false;
+
+         for (uint8_t other = pump + 1; other < pumpCount; other++)
+            if (Profile::pumps[pump].output == Profile::pumps[other].output || isSameCode(Profile::pumps[pump].pumperCode, Profile::pumps[other].pumperCode))
+               return false;
+      }
+      return true;
+   }
+
+   static_assert(pumpCount > 0 && pumpCount <= outputCount, "Número de bombas incompatível com as saídas da placa");
+   static_assert(pumpCount <= 9, "As rotas das bombas usam um único dígito");
+   static_assert(isValid(), "Bomba em saída inexistente ou repetida, código repetido ou pulso nulo");
+};
+
+// Gera o array de bombas e as prioridades do sequenciador a partir do perfil
+template <typename Profile, typename Sequence = std::make_index_sequence<BoardLayout<Profile>::pumpCount>>
+struct PumpBank;
+
+template <typename Profile, size_t... Index>
+struct PumpBank<Profile, std::index_sequence<Index...>> {
+   HydraulicPumpController pumps[sizeof...(Index)] = {
+       HydraulicPumpController(Profile::pumps[Index].pumperCode, BoardLayout<Profile>::gpio(Index), Profile::pumps[Index].pulseDuration)...};
+   const uint8_t priorities[sizeof...(Index)] = {Profile::pumps[Index].priority...};
+};
+
+// Rotas de consulta de cada bomba (/timers1, /pulse1, /timers2...) e da API local,
+// indexada a partir de zero como no protocolo do WebSocket (/pumps/0/schedule, /pumps/0/pulse...)
+template <size_t Index>
+struct PumpRoute {
+   static constexpr char timers[] = {'/', 't', 'i', 'm', 'e', 'r', 's', char('1' + Index), '\0'};
+   static constexpr char pulse[] = {'/', 'p', 'u', 'l', 's', 'e', char('1' + Index), '\0'};
+   static constexpr char schedulePut[] = {'/', 'p', 'u', 'm', 'p', 's', '/', char('0' + Index), '/', 's', 'c', 'h', 'e', 'd', 'u', 'l', 'e', '\0'};
+   static constexpr char pulsePut[] = {'/', 'p', 'u', 'm', 'p', 's', '/', char('0' + Index), '/', 'p', 'u', 'l', 's', 'e', '\0'};
+};
+
+struct TomatoesProfile {
+   using Outputs = OutputPins<21, 19, 18, 5>;
+   static constexpr PumpProfile pumps[] = {
+       {"#01", 1, 60000, 1},
+       {"#02", 2, 900000, 0},
+   };
+};
+
+struct HydroponicProfile {
+   using Outputs = OutputPins<21, 19, 18, 5>;
+   static constexpr PumpProfile pumps[] = {
+       {"#03", 1, 900000, 1},
+       {"#04", 2, 900000, 0},
+   };
+};
+
+// Selecionado pelo env do PlatformIO (-D BOARD_PROFILE=...)
+#ifndef BOARD_PROFILE
+#error "Perfil da placa não definido, compile por um dos envs do platformio.ini"
+#endif
+
+using ActiveBoard = BoardLayout<BOARD_PROFILE>;
+using ActivePumpBank = PumpBank<BOARD_PROFILE>;
+
+#endif
@@ -2,6 +2,9 @@
 #define _MONGODBATLAS_
 
 const char *serverName = "YOUR_SERVER_NAME_HERE";
+const char *findUrl = "YOUR_FIND_URL_HERE";
+const char *insertManyUrl = "YOUR_INSERT_MANY_URL_HERE";
+const char *updateOneUrl = "YOUR_UPDATE_ONE_URL_HERE";
 const char *apiKey = "YOUR_API_KEY_HERE";
 
 const char *root_ca = "YOUR_ROOT_CA_HERE"
@@ -24,7 +24,7 @@
 //     mdns_handle_system_event(NULL, event);
 // }
 
-MDNSResponder::MDNSResponder() :results(NULL) {}
+MDNSResponder::MDNSResponder() :results(NULL), _browse(NULL), _browseLock(xSemaphoreCreateMutex()) {}
 MDNSResponder::~MDNSResponder() {
     end();
 }
@@ -45,6 +45,18 @@ bool MDNSResponder::begin(const String& hostName){
 }
 
 void MDNSResponder::end() {
+    xSemaphoreTake(_browseLock, portMAX_DELAY);
+    if(_browse){
+        mdns_query_async_delete(_browse);
+        _browse = NULL;
+    }
+    _browseCache.clear();
+    xSemaphoreGive(_browseLock);
+    if(results){
+        mdns_query_results_free(results);
+        results = NULL;
+    }
+    _resultIndex.clear();
     mdns_free();
 }
 
@@ -168,6 +180,7 @@ int MDNSResponder::queryService(char *service, char *proto) {
         mdns_query_results_free(results);
         results = NULL;
     }
+    _resultIndex.clear();
 
     char srv[strlen(service)+2];
     char prt[strlen(proto)+2];
@@ -192,26 +205,25 @@ int MDNSResponder::queryService(char *service, char *proto) {
         return 0;
     }
 
+    _indexResults();
+    return _resultIndex.size();
+}
+
+// Indexa a lista encadeada uma única vez para que os acessores sejam O(1)
+void MDNSResponder::_indexResults(){
+    _resultIndex.clear();
     mdns_result_t * r = results;
-    int i = 0;
     while(r){
-        i++;
+        _resultIndex.push_back(r);
         r = r->next;
     }
-    return i;
 }
 
 mdns_result_t * MDNSResponder::_getResult(int idx){
-    mdns_result_t * result = results;
-    int i = 0;
-    while(result){
-        if(i == idx){
-            break;
-        }
-        i++;
-        result = result->next;
+    if(idx < 0 || idx >= (int)_resultIndex.size()){
+        return NULL;
     }
-    return result;
+    return _resultIndex[idx];
 }
 
 mdns_txt_item_t * MDNSResponder::_getResultTxt(int idx, int txtIdx){
@@ -325,4 +337,120 @@ String MDNSResponder::txtKey(int idx, int txtIdx) {
         : resultTxt->key;
 }
 
+bool MDNSResponder::browseService(const char *service, const char *proto, uint32_t timeout) {
+    if(!service || !service[0] || !proto || !proto[0]){
+        log_e("Bad Parameters");
+        return false;
+    }
+    char srv[strlen(service)+2];
+    char prt[strlen(proto)+2];
+    if (service[0] == '_') {
+        sprintf(srv, "%s", service);
+    } else {
+        sprintf(srv, "_%s", service);
+    }
+    if (proto[0] == '_') {
+        sprintf(prt, "%s", proto);
+    } else {
+        sprintf(prt, "_%s", proto);
+    }
+
+    xSemaphoreTake(_browseLock, portMAX_DELAY);
+    if(!_browse){
+        _browse = mdns_query_async_new(NULL, srv, prt, MDNS_TYPE_PTR, timeout, 20, NULL);
+    }
+    bool started = _browse != NULL;
+    xSemaphoreGive(_browseLock);
+
+    if(!started){
+        log_e("Browse Failed");
+    }
+    return started;
+}
+
+// Não bloqueia: incorpora as respostas da busca em andamento ao cache e remove entradas expiradas
+int MDNSResponder::updateBrowse() {
+    mdns_result_t * browseResults = NULL;
+
+    xSemaphoreTake(_browseLock, portMAX_DELAY);
+    if(_browse && mdns_query_async_get_results(_browse, 0, &browseResults)){
+        mdns_query_async_delete(_browse);
+        _browse = NULL;
+
+        uint32_t now = millis();
+        mdns_result_t * r = browseResults;
+        while(r){
+            String instance = r->instance_name ? r->instance_name : "";
+            String hostname = r->hostname ? r->hostname : "";
+
+            MDNSBrowseResult * entry = NULL;
+            for(MDNSBrowseResult &cached : _browseCache){
+                if(cached.instance == instance && cached.hostname == hostname){
+                    entry = &cached;
+                    break;
+                }
+            }
+            if(!entry){
+                _browseCache.push_back(MDNSBrowseResult());
+                entry = &_browseCache.back();
+                entry->instance = instance;
+                entry->hostname = hostname;
+            }
+
+            entry->port = r->port;
+            entry->expires = now + r->ttl * 1000;
+            entry->ip = IPAddress();
+            mdns_ip_addr_t * addr = r->addr;
+            while(addr){
+                if(addr->addr.type == MDNS_IP_PROTOCOL_V4){
+                    entry->ip = IPAddress(addr->addr.u_addr.ip4.addr);
+                    break;
+                }
+                addr = addr->next;
+            }
+            entry->txt.clear();
+            for(size_t i = 0; i < r->txt_count; i++){
+                entry->txt.push_back(std::make_pair(String(r->txt[i].key), String(r->txt[i].value ? r->txt[i].value : "")));
+            }
+
+            r = r->next;
+        }
+        mdns_query_results_free(browseResults);
+    }
+
+    _expireBrowseCache();
+    int count = _browseCache.size();
+    xSemaphoreGive(_browseLock);
+
+    return count;
+}
+
+bool MDNSResponder::isBrowsing() {
+    xSemaphoreTake(_browseLock, portMAX_DELAY);
+    bool browsing = _browse != NULL;
+    xSemaphoreGive(_browseLock);
+
+    return browsing;
+}
+
+std::vector<MDNSBrowseResult> MDNSResponder::browseResults() {
+    xSemaphoreTake(_browseLock, portMAX_DELAY);
+    std::vector<MDNSBrowseResult> copy = _browseCache;
+    xSemaphoreGive(_browseLock);
+
+    return copy;
+}
+
+// Chamado com _browseLock tomado
+void MDNSResponder::_expireBrowseCache() {
+    uint32_t now = millis();
+    for(size_t i = 0; i < _browseCache.size();){
+        if((int32_t)(_browseCache[i].expires - now) <= 0){
+            _browseCache.erase(_browseCache.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
 MDNSResponder MDNS;
\ No newline at end of file
@@ -1,15 +1,28 @@
 #ifndef ESP32MDNS_H
 #define ESP32MDNS_H
 
+#include <vector>
+
 #include "Arduino.h"
 #include "IPv6Address.h"
 #include "mdns.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 // this should be defined at build time
 #ifndef ARDUINO_VARIANT
 #define ARDUINO_VARIANT "esp32"
 #endif
 
+struct MDNSBrowseResult {
+   String instance;
+   String hostname;
+   IPAddress ip;
+   uint16_t port;
+   std::vector<std::pair<String, String>> txt;
+   uint32_t expires;  // millis() em que a entrada deixa de ser válida
+};
+
 class MDNSResponder {
   public:
    MDNSResponder();
@@ -76,9 +89,25 @@ class MDNSResponder {
    String txt(int idx, int txtIdx);
    String txtKey(int idx, int txtIdx);
 
+   bool browseService(const char *service, const char *proto, uint32_t timeout = 3000);
+   bool browseService(String service, String proto, uint32_t timeout = 3000) {
+      return browseService(service.c_str(), proto.c_str(), timeout);
+   }
+   // A busca é usada por mais de uma task (o /boards no async_tcp e o cache do site): o estado
+   // da busca fica protegido por _browseLock e browseResults() retorna uma cópia
+   int updateBrowse();
+   bool isBrowsing();
+   std::vector<MDNSBrowseResult> browseResults();
+
   private:
    String _hostname;
    mdns_result_t *results;
+   std::vector<mdns_result_t *> _resultIndex;
+   mdns_search_once_t *_browse;
+   std::vector<MDNSBrowseResult> _browseCache;
+   SemaphoreHandle_t _browseLock;
+   void _indexResults();
+   void _expireBrowseCache();
    mdns_result_t *_getResult(int idx);
    mdns_txt_item_t *_getResultTxt(int idx, int txtIdx);
 };
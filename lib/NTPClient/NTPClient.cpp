@@ -83,6 +83,9 @@ bool NTPClient::forceUpdate() {
       timeout++;
    } while (cb == 0);
 
+   bool wasTimeSet = this->isTimeSet();
+   unsigned long estimatedEpoc = this->getEpochTime() - this->_timeOffset;
+
    this->_lastUpdate = xTaskGetTickCount() * portTICK_PERIOD_MS - (10 * (timeout + 1));  // Account for delay in reading the time
 
    this->_udp->read(this->_packetBuffer, NTP_PACKET_SIZE);
@@ -93,6 +96,9 @@ bool NTPClient::forceUpdate() {
    // this is NTP time (seconds since Jan 1 1900):
    unsigned long secsSince1900 = highWord << 16 | lowWord;
 
+   if (wasTimeSet)
+      this->_lastOffset = (long)(secsSince1900 - SEVENZYYEARS) - (long)estimatedEpoc;
+
    this->_currentEpoc = secsSince1900 - SEVENZYYEARS;
 
    return true;  // return true after successful update
@@ -117,6 +123,10 @@ unsigned long NTPClient::getEpochTime() const {
           ((xTaskGetTickCount() * portTICK_PERIOD_MS - this->_lastUpdate) / 1000);  // Time since last update
 }
 
+long NTPClient::getLastOffset() const {
+   return this->_lastOffset;
+}
+
 int NTPClient::getDay() const {
    return (((this->getEpochTime() / 86400L) + 4) % 7);  // 0 is Sunday
 }
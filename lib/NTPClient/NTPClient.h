@@ -22,7 +22,8 @@ class NTPClient {
    unsigned long _updateInterval = 60000;  // In ms
 
    unsigned long _currentEpoc = 0;  // In s
-   unsigned long _lastUpdate = 0;   // In ms
+   uint32_t _lastUpdate = 0;        // In ms, same width as the tick count so elapsed time wraps correctly
+   long _lastOffset = 0;            // In s
 
    byte _packetBuffer[NTP_PACKET_SIZE];
 
@@ -87,6 +88,11 @@ class NTPClient {
    int getMinutes() const;
    int getSeconds() const;
 
+   /**
+    * @return difference in seconds between the server time and the local estimate at the last update
+    */
+   long getLastOffset() const;
+
    /**
     * Changes the time offset. Useful for changing timezones dynamically
     */
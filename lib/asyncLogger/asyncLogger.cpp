@@ -0,0 +1,213 @@
+#include "asyncLogger.h"
+
+#include <stdarg.h>
+
+AsyncLogger::AsyncLogger(LogLevel level, uint32_t rateLimit)
+    : rateLimit(rateLimit) {
+   for (uint32_t index = 0; index < LOG_BUFFER_RECORDS; index++)
+      slots[index].sequence.store(index, std::memory_order_relaxed);
+
+   for (uint8_t module = 0; module < LOG_MODULES; module++) {
+      levels[module].store(level, std::memory_order_relaxed);
+      windowStart[module].store(0, std::memory_order_relaxed);
+      windowCount[module].store(0, std::memory_order_relaxed);
+      suppressed[module].store(0, std::memory_order_relaxed);
+   }
+}
+
+void AsyncLogger::setTask(TaskHandle_t task) {
+   this->task = task;
+}
+
+void AsyncLogger::setLevel(LogModule module, LogLevel level) {
+   if (module < LOG_MODULES)
+      levels[module].store(level, std::memory_order_relaxed);
+}
+
+LogLevel AsyncLogger::getLevel(LogModule module) {
+   return module < LOG_MODULES ? (LogLevel)levels[module].load(std::memory_order_relaxed) : LOG_ERROR;
+}
+
+bool AsyncLogger::isEnabled(LogModule module, LogLevel level) {
+   return module < LOG_MODULES && level <= levels[module].load(std::memory_order_relaxed);
+}
+
+// Destinos só podem ser registrados antes de setTask(): depois disso a task de entrega percorre a
+// lista sem sincronização
+bool AsyncLogger::addSink(LogLevel level, LogSink sink) {
+   uint8_t count = sinkCount.load();
+
+   if (task != NULL || count >= LOG_MAX_SINKS)
+      return false;
+
+   sinks[count] = sink;
+   sinkLevels[count] = level;
+   sinkCount.store(count + 1);
+
+   return true;
+}
+
+bool AsyncLogger::log(LogModule module, LogLevel level, const char *format, ...) {
+   if (!isEnabled(module, level) || !isAllowed(module))
+      return false;
+
+   va_list arguments;
+   va_start(arguments, format);
+   bool queued = enqueue(module, level, format, arguments);
+   va_end(arguments);
+
+   return queued;
+}
+
+// Janela fixa por módulo. Sob concorrência o limite é aproximado: registros que chegam enquanto a
+// janela é reaberta podem passar a mais.
+bool AsyncLogger::isAllowed(LogModule module) {
+   if (rateLimit == 0)
+      return true;
+
+   uint32_t now = millis();
+   uint32_t start = windowStart[module].load(std::memory_order_relaxed);
+
+   if (now - start >= LOG_RATE_WINDOW && windowStart[module].compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+      windowCount[module].store(0, std::memory_order_relaxed);
+
+      uint32_t skipped = suppressed[module].exchange(0, std::memory_order_relaxed);
+      if (skipped > 0)
+         enqueueFormat(module, LOG_WARN, "%lu records suppressed by the rate limit", (unsigned long)skipped);
+   }
+
+   if (windowCount[module].fetch_add(1, std::memory_order_relaxed) < rateLimit)
+      return true;
+
+   suppressed[module].fetch_add(1, std::memory_order_relaxed);
+   limited.fetch_add(1, std::memory_order_relaxed);
+   return false;
+}
+
+bool AsyncLogger::enqueueFormat(LogModule module, LogLevel level, const char *format, ...) {
+   va_list arguments;
+   va_start(arguments, format);
+   bool queued = enqueue(module, level, format, arguments);
+   va_end(arguments);
+
+   return queued;
+}
+
+bool AsyncLogger::enqueue(LogModule module, LogLevel level, const char *format, va_list arguments) {
+   // Fila limitada de Vyukov: o número de sequência do slot diz se ele pode ser reservado
+   uint32_t position = head.load(std::memory_order_relaxed);
+   Slot *slot;
+
+   while (true) {
+      slot = &slots[position & (LOG_BUFFER_RECORDS - 1)];
+      int32_t difference = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+
+      if (difference == 0) {
+         if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            break;
+      } else if (difference < 0) {
+         dropped.fetch_add(1, std::memory_order_relaxed);
+         return false;
+      } else {
+         position = head.load(std::memory_order_relaxed);
+      }
+   }
+
+   slot->record.timestamp = millis();
+   slot->record.level = level;
+   slot->record.module = module;
+
+   int length = vsnprintf(slot->record.message, LOG_MAX_MESSAGE, format, arguments);
+
+   if (length >= LOG_MAX_MESSAGE)
+      truncated.fetch_add(1, std::memory_order_relaxed);
+
+   slot->sequence.store(position + 1, std::memory_order_release);
+
+   // tail lido antes de head para que a diferença nunca fique negativa
+   uint32_t oldest = tail.load(std::memory_order_relaxed);
+   uint32_t used = head.load(std::memory_order_relaxed) - oldest;
+   uint32_t previous = maxUsed.load(std::memory_order_relaxed);
+   while (used > previous && !maxUsed.compare_exchange_weak(previous, used, std::memory_order_relaxed)) {
+   }
+
+   // Acorda a entrega antes do prazo quando metade do buffer estiver ocupada
+   if (task != NULL && used >= LOG_BUFFER_RECORDS / 2)
+      xTaskNotifyGive(task);
+
+   return true;
+}
+
+// Chamado apenas pela task de entrega; retorna quantos registros foram entregues
+size_t AsyncLogger::drain() {
+   char line[LOG_MAX_LINE];
+   LogRecord record;
+   size_t count = 0;
+
+   while (true) {
+      uint32_t position = tail.load(std::memory_order_relaxed);
+      Slot &slot = slots[position & (LOG_BUFFER_RECORDS - 1)];
+
+      // Slot ainda livre ou sendo escrito
+      if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (position + 1)) < 0)
+         break;
+
+      record = slot.record;
+      slot.sequence.store(position + LOG_BUFFER_RECORDS, std::memory_order_release);
+      tail.store(position + 1, std::memory_order_relaxed);
+
+      format(record, line, sizeof(line));
+
+      uint8_t sinkTotal = sinkCount.load();
+      for (uint8_t index = 0; index < sinkTotal; index++)
+         if (record.level <= sinkLevels[index])
+            sinks[index](record, line);
+
+      written.fetch_add(1, std::memory_order_relaxed);
+      count++;
+   }
+
+   return count;
+}
+
+// Aguarda a task de entrega esvaziar o buffer, por exemplo antes de dormir ou reiniciar
+bool AsyncLogger::waitDrained(uint32_t timeout) {
+   uint32_t start = millis();
+
+   while (tail.load() != head.load()) {
+      if (millis() - start >= timeout)
+         return false;
+      if (task != NULL)
+         xTaskNotifyGive(task);
+      vTaskDelay(pdMS_TO_TICKS(10));
+   }
+
+   return true;
+}
+
+LoggerStats AsyncLogger::getStats() {
+   LoggerStats stats;
+
+   stats.written = written.load();
+   stats.dropped = dropped.load();
+   stats.truncated = truncated.load();
+   stats.limited = limited.load();
+   stats.maxUsed = maxUsed.load();
+
+   return stats;
+}
+
+size_t AsyncLogger::format(const LogRecord &record, char *line, size_t size) {
+   static const char levelNames[] = {'E', 'W', 'I', 'D'};
+
+   int length = snprintf(line, size, "[%8lu][%c][%s] %s\n", (unsigned long)record.timestamp, levelNames[record.level & 3],
+                         getModuleName(record.module), record.message);
+
+   return length < 0 ? 0 : min((size_t)length, size - 1);
+}
+
+const char *AsyncLogger::getModuleName(LogModule module) {
+   static const char *names[] = {"system", "network", "config", "pumps", "web", "telemetry"};
+
+   return module < LOG_MODULES ? names[module] : "unknown";
+}
@@ -0,0 +1,119 @@
+#ifndef _ASYNCLOGGER_
+#define _ASYNCLOGGER_
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include <atomic>
+#include <functional>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define LOG_MAX_MESSAGE 120
+#define LOG_BUFFER_RECORDS 32  // Potência de 2
+#define LOG_MAX_SINKS 3
+#define LOG_MAX_LINE (LOG_MAX_MESSAGE + 32)
+#define LOG_RATE_WINDOW 1000  // Em ms, janela do limite de registros por módulo
+
+static_assert((LOG_BUFFER_RECORDS & (LOG_BUFFER_RECORDS - 1)) == 0, "LOG_BUFFER_RECORDS precisa ser potência de 2");
+
+enum LogLevel : uint8_t {
+   LOG_ERROR = 0,
+   LOG_WARN = 1,
+   LOG_INFO = 2,
+   LOG_DEBUG = 3,
+};
+
+enum LogModule : uint8_t {
+   LOG_SYSTEM = 0,
+   LOG_NETWORK = 1,
+   LOG_CONFIG = 2,
+   LOG_PUMPS = 3,
+   LOG_WEB = 4,
+   LOG_TELEMETRY = 5,
+   LOG_MODULES = 6,
+};
+
+struct LogRecord {
+   uint32_t timestamp;  // Em ms desde o boot
+   LogLevel level;
+   LogModule module;
+   char message[LOG_MAX_MESSAGE];
+};
+
+struct LoggerStats {
+   uint32_t written = 0;    // Registros entregues aos destinos
+   uint32_t dropped = 0;    // Descartados com o buffer cheio, no lugar de bloquear quem escreve
+   uint32_t truncated = 0;  // Mensagens maiores que LOG_MAX_MESSAGE
+   uint32_t limited = 0;    // Descartados pelo limite de registros por módulo
+   uint32_t maxUsed = 0;    // Maior ocupação do buffer, em registros
+};
+
+typedef std::function<void(const LogRecord &record, const char *line)> LogSink;
+
+// Quem escreve só formata a mensagem em um slot do buffer circular, reservado com
+// compare-and-swap, e nunca espera pela serial, pela flash ou pela rede. Uma task de baixa
+// prioridade entrega os registros aos destinos. Não deve ser usado em ISRs.
+//
+// Cada módulo registra no máximo rateLimit registros por LOG_RATE_WINDOW (0 desliga o limite), para
+// que um erro repetido em laço não ocupe o buffer e a flash. Os excedentes são descartados e, na
+// janela seguinte, um aviso informa quantos foram suprimidos.
+class AsyncLogger {
+  public:
+   AsyncLogger(LogLevel level, uint32_t rateLimit = 0);
+
+   void setTask(TaskHandle_t task);
+
+   void setLevel(LogModule module, LogLevel level);
+   LogLevel getLevel(LogModule module);
+   bool isEnabled(LogModule module, LogLevel level);
+
+   bool addSink(LogLevel level, LogSink sink);
+
+   bool log(LogModule module, LogLevel level, const char *format, ...) __attribute__((format(printf, 4, 5)));
+
+   size_t drain();
+   bool waitDrained(uint32_t timeout);
+
+   LoggerStats getStats();
+
+   static size_t format(const LogRecord &record, char *line, size_t size);
+   static const char *getModuleName(LogModule module);
+
+  private:
+   struct Slot {
+      std::atomic<uint32_t> sequence;  // Indica se o slot está livre, sendo escrito ou pronto
+      LogRecord record;
+   };
+
+   Slot slots[LOG_BUFFER_RECORDS];
+   std::atomic<uint32_t> head{0};
+   std::atomic<uint32_t> tail{0};  // Só a task de entrega avança
+
+   std::atomic<uint8_t> levels[LOG_MODULES];
+
+   const uint32_t rateLimit;
+   std::atomic<uint32_t> windowStart[LOG_MODULES];
+   std::atomic<uint32_t> windowCount[LOG_MODULES];
+   std::atomic<uint32_t> suppressed[LOG_MODULES];
+
+   LogSink sinks[LOG_MAX_SINKS];
+   LogLevel sinkLevels[LOG_MAX_SINKS];
+   std::atomic<uint8_t> sinkCount{0};
+
+   std::atomic<uint32_t> written{0};
+   std::atomic<uint32_t> dropped{0};
+   std::atomic<uint32_t> truncated{0};
+   std::atomic<uint32_t> limited{0};
+   std::atomic<uint32_t> maxUsed{0};
+
+   TaskHandle_t task = NULL;
+
+   bool isAllowed(LogModule module);
+
+   bool enqueue(LogModule module, LogLevel level, const char *format, va_list arguments);
+   bool enqueueFormat(LogModule module, LogLevel level, const char *format, ...) __attribute__((format(printf, 4, 5)));
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "controlProtocol.h"
+
+#include <string.h>
+
+void ControlAssembler::reset() {
+   size = 0;
+   overflowed = false;
+}
+
+// Ao exceder o limite a mensagem inteira é descartada, mas continua marcada até o próximo reset
+bool ControlAssembler::append(const uint8_t *data, size_t length) {
+   if (overflowed || length > CONTROL_MAX_MESSAGE - size) {
+      overflowed = true;
+      size = 0;
+      return false;
+   }
+
+   memcpy(buffer + size, data, length);
+   size += length;
+
+   return true;
+}
+
+const uint8_t *ControlAssembler::getData() const {
+   return buffer;
+}
+
+size_t ControlAssembler::getSize() const {
+   return size;
+}
+
+bool ControlAssembler::isOverflowed() const {
+   return overflowed;
+}
+
+ControlReader::ControlReader(const uint8_t *data, size_t length)
+    : data(data),
+      length(length) {
+}
+
+// Retorna false ao fim da mensagem ou quando o próximo comando está incompleto
+bool ControlReader::next(ControlCommand &command) {
+   if (position >= length)
+      return false;
+
+   if (length - position < CONTROL_HEADER_SIZE || length - position - CONTROL_HEADER_SIZE < data[position + 3]) {
+      truncated = true;
+      position = length;
+      return false;
+   }
+
+   command.opcode = data[position];
+   command.sequence = data[position + 1] | (data[position + 2] << 8);
+   command.length = data[position + 3];
+   command.payload = data + position + CONTROL_HEADER_SIZE;
+
+   position += CONTROL_HEADER_SIZE + command.length;
+
+   return true;
+}
+
+bool ControlReader::isTruncated() const {
+   return truncated;
+}
+
+bool ControlReader::readPump(const ControlCommand &command, uint8_t &pump) {
+   if (command.length != 1)
+      return false;
+
+   pump = command.payload[0];
+   return true;
+}
+
+bool ControlReader::readPulse(const ControlCommand &command, uint8_t &pump, uint32_t &pulseDuration) {
+   if (command.length != 5)
+      return false;
+
+   pump = command.payload[0];
+   pulseDuration = command.payload[1] | (command.payload[2] << 8) | (command.payload[3] << 16) | ((uint32_t)command.payload[4] << 24);
+   return pulseDuration > 0;
+}
+
+// seconds deve comportar CONTROL_MAX_TIMES horários
+bool ControlReader::readSchedule(const ControlCommand &command, uint8_t &pump, uint32_t *seconds, size_t &count) {
+   if (command.length < 1 || (command.length - 1) % 3 != 0)
+      return false;
+
+   pump = command.payload[0];
+
+   count = (command.length - 1) / 3;
+   for (size_t index = 0; index < count; index++) {
+      const uint8_t *time = command.payload + 1 + index * 3;
+      seconds[index] = time[0] | (time[1] << 8) | (time[2] << 16);
+
+      if (seconds[index] >= 86400)
+         return false;
+   }
+
+   return true;
+}
+
+bool ControlAckWriter::add(const ControlCommand &command, ControlStatus status) {
+   return add(command.opcode, command.sequence, status);
+}
+
+bool ControlAckWriter::add(uint8_t opcode, uint16_t sequence, ControlStatus status) {
+   if (size + CONTROL_ACK_SIZE > sizeof(buffer))
+      return false;
+
+   buffer[size++] = opcode | CONTROL_ACK;
+   buffer[size++] = sequence & 0xFF;
+   buffer[size++] = sequence >> 8;
+   buffer[size++] = status;
+
+   return true;
+}
+
+const uint8_t *ControlAckWriter::getData() const {
+   return buffer;
+}
+
+size_t ControlAckWriter::getSize() const {
+   return size;
+}
@@ -0,0 +1,105 @@
+#ifndef _CONTROLPROTOCOL_
+#define _CONTROLPROTOCOL_
+
+// Sem dependências do Arduino para que o parser também compile no host
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONTROL_MAX_MESSAGE 512  // Em bytes, mensagem remontada a partir dos fragmentos
+#define CONTROL_HEADER_SIZE 4    // opcode, sequência (16 bits LE) e tamanho do payload
+#define CONTROL_ACK_SIZE 4       // opcode | CONTROL_ACK, sequência e status
+#define CONTROL_MAX_COMMANDS (CONTROL_MAX_MESSAGE / CONTROL_HEADER_SIZE)
+#define CONTROL_ACK 0x80
+#define CONTROL_MAX_TIMES 84  // Horários que cabem no payload de 255 bytes de CONTROL_SET_SCHEDULE
+
+/*
+Mensagem binária: um ou mais comandos concatenados
+   [opcode][sequência LSB][sequência MSB][tamanho][payload...]
+
+Opcode                Payload
+--------------------------------------------------------------------------
+CONTROL_STATES        -
+CONTROL_START         bomba
+CONTROL_STOP          bomba
+CONTROL_SET_PULSE     bomba, duração em ms (32 bits LE)
+CONTROL_SET_SCHEDULE  bomba, horários em segundos do dia (24 bits LE cada)
+
+Cada comando recebe um ACK [opcode | 0x80][sequência LSB][sequência MSB][status],
+todos os ACKs da mensagem são enviados juntos em uma única resposta.
+*/
+
+enum ControlOpcode : uint8_t {
+   CONTROL_STATES = 0x01,
+   CONTROL_START = 0x02,
+   CONTROL_STOP = 0x03,
+   CONTROL_SET_PULSE = 0x04,
+   CONTROL_SET_SCHEDULE = 0x05,
+};
+
+enum ControlStatus : uint8_t {
+   CONTROL_OK = 0,
+   CONTROL_UNKNOWN = 1,       // Opcode desconhecido
+   CONTROL_MALFORMED = 2,     // Payload com tamanho ou valores inválidos
+   CONTROL_INVALID_PUMP = 3,
+   CONTROL_REJECTED = 4,      // Comando válido que não pôde ser executado agora
+   CONTROL_OVERFLOW = 5,      // Mensagem maior que CONTROL_MAX_MESSAGE
+};
+
+struct ControlCommand {
+   uint8_t opcode;
+   uint16_t sequence;
+   uint8_t length;
+   const uint8_t *payload;
+};
+
+// Remonta uma mensagem fragmentada em um buffer de tamanho fixo
+class ControlAssembler {
+  public:
+   void reset();
+
+   bool append(const uint8_t *data, size_t length);
+
+   const uint8_t *getData() const;
+   size_t getSize() const;
+   bool isOverflowed() const;
+
+  private:
+   uint8_t buffer[CONTROL_MAX_MESSAGE];
+   size_t size = 0;
+   bool overflowed = false;
+};
+
+// Percorre os comandos de uma mensagem completa sem copiar os payloads
+class ControlReader {
+  public:
+   ControlReader(const uint8_t *data, size_t length);
+
+   bool next(ControlCommand &command);
+
+   bool isTruncated() const;
+
+   static bool readPump(const ControlCommand &command, uint8_t &pump);
+   static bool readPulse(const ControlCommand &command, uint8_t &pump, uint32_t &pulseDuration);
+   static bool readSchedule(const ControlCommand &command, uint8_t &pump, uint32_t *seconds, size_t &count);
+
+  private:
+   const uint8_t *data;
+   size_t length;
+   size_t position = 0;
+   bool truncated = false;
+};
+
+class ControlAckWriter {
+  public:
+   bool add(const ControlCommand &command, ControlStatus status);
+   bool add(uint8_t opcode, uint16_t sequence, ControlStatus status);
+
+   const uint8_t *getData() const;
+   size_t getSize() const;
+
+  private:
+   uint8_t buffer[CONTROL_MAX_COMMANDS * CONTROL_ACK_SIZE];
+   size_t size = 0;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "crashLog.h"
+
+RTC_NOINIT_ATTR static CrashLogState crash;
+
+CrashLog::CrashLog(uint32_t flushInterval)
+    : flushInterval(flushInterval) {
+}
+
+bool CrashLog::begin(bool recover) {
+   bool valid = recover && crash.magic == CRASH_LOG_MAGIC && crash.length <= CRASH_LOG_BUFFER && crash.checksum == ~crash.length;
+
+   mutex = xSemaphoreCreateMutex();
+
+   if (!valid) {
+      crash.magic = CRASH_LOG_MAGIC;
+      crash.length = 0;
+      crash.checksum = ~crash.length;
+   }
+
+   // Linhas recuperadas ficam pendentes até a primeira gravação
+   stats.recovered = valid ? crash.length : 0;
+   pendingSince = millis();
+
+   return valid && crash.length > 0;
+}
+
+bool CrashLog::append(const char *line) {
+   size_t length = strlen(line);
+   bool appended = false;
+
+   if (mutex == NULL || !xSemaphoreTake(mutex, portMAX_DELAY))
+      return false;
+
+   if (crash.length + length > CRASH_LOG_BUFFER && !failing)
+      write();
+
+   if (crash.length + length <= CRASH_LOG_BUFFER) {
+      if (crash.length == 0)
+         pendingSince = millis();
+
+      // length só avança depois da cópia: um reset no meio dela perde apenas esta linha
+      memcpy(crash.data + crash.length, line, length);
+      crash.length += length;
+      crash.checksum = ~crash.length;
+      appended = true;
+   } else {
+      stats.dropped++;
+   }
+
+   xSemaphoreGive(mutex);
+   return appended;
+}
+
+void CrashLog::setWriter(CrashLogWriter writer) {
+   if (mutex == NULL || !xSemaphoreTake(mutex, portMAX_DELAY))
+      return;
+
+   this->writer = writer;
+
+   xSemaphoreGive(mutex);
+}
+
+// Chamado antes de reiniciar ou dormir, depois de esvaziar o buffer do log
+bool CrashLog::flush() {
+   bool written;
+
+   if (mutex == NULL || !xSemaphoreTake(mutex, portMAX_DELAY))
+      return false;
+
+   written = write();
+
+   xSemaphoreGive(mutex);
+   return written;
+}
+
+bool CrashLog::flushIfDue() {
+   bool written = false;
+
+   if (mutex == NULL || !xSemaphoreTake(mutex, portMAX_DELAY))
+      return false;
+
+   // Depois de uma falha a flash só é tentada de novo no prazo, mesmo com o buffer cheio
+   bool half = crash.length >= CRASH_LOG_BUFFER / 2 && !failing;
+
+   if (half || (crash.length > 0 && millis() - pendingSince >= flushInterval))
+      written = write();
+
+   xSemaphoreGive(mutex);
+   return written;
+}
+
+size_t CrashLog::getPending() {
+   size_t pending = 0;
+
+   if (mutex != NULL && xSemaphoreTake(mutex, portMAX_DELAY)) {
+      pending = crash.length;
+      xSemaphoreGive(mutex);
+   }
+
+   return pending;
+}
+
+CrashLogStats CrashLog::getStats() {
+   CrashLogStats copy;
+
+   if (mutex != NULL && xSemaphoreTake(mutex, portMAX_DELAY)) {
+      copy = stats;
+      xSemaphoreGive(mutex);
+   }
+
+   return copy;
+}
+
+// Chamado com o mutex; sem writer (flash ainda não montada) as linhas continuam pendentes
+bool CrashLog::write() {
+   if (crash.length == 0)
+      return true;
+
+   if (!writer)
+      return false;
+
+   failing = !writer(crash.data, crash.length);
+   if (failing) {
+      stats.failures++;
+      pendingSince = millis();
+      return false;
+   }
+
+   stats.flushes++;
+   stats.flushed += crash.length;
+
+   crash.length = 0;
+   crash.checksum = ~crash.length;
+
+   return true;
+}
@@ -0,0 +1,68 @@
+#ifndef _CRASHLOG_
+#define _CRASHLOG_
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define CRASH_LOG_MAGIC 0x43524C47
+#define CRASH_LOG_BUFFER 2048  // Em bytes, cabe na RTC slow memory com o DeepSleepScheduler e o PumpJournal
+
+// Mantido na RTC slow memory sem inicialização: as linhas ainda não gravadas na flash sobrevivem a
+// panic, watchdog, ESP.restart() e deep sleep, mas não a uma queda de energia
+struct CrashLogState {
+   uint32_t magic;
+   uint32_t length;    // Bytes válidos em data, atualizado depois de cada linha copiada
+   uint32_t checksum;  // ~length
+   char data[CRASH_LOG_BUFFER];
+};
+
+struct CrashLogStats {
+   uint32_t recovered = 0;  // Em bytes, linhas anteriores ao reset encontradas no boot
+   uint32_t flushes = 0;
+   uint32_t flushed = 0;   // Em bytes
+   uint32_t failures = 0;  // Gravações que falharam, as linhas continuam pendentes
+   uint32_t dropped = 0;   // Linhas descartadas com o buffer cheio e a flash indisponível
+};
+
+// Grava um lote de linhas; retorna false se nada foi gravado
+typedef std::function<bool(const char *data, size_t length)> CrashLogWriter;
+
+// Acumula os avisos e erros do log na memória RTC e os grava na flash em lote: a cada linha custa
+// só uma cópia na RAM, e o arquivo é aberto uma vez por lote. Como o buffer sobrevive ao reset, as
+// linhas que antecedem um panic são gravadas no boot seguinte, assim que o writer for definido.
+class CrashLog {
+  public:
+   CrashLog(uint32_t flushInterval);
+
+   // Com recover falso (ex.: power-on), o conteúdo da memória RTC é descartado sem ser avaliado
+   bool begin(bool recover);
+
+   // Chamado pela task de entrega do log. Com o buffer cheio, grava o lote antes de copiar a linha.
+   bool append(const char *line);
+
+   void setWriter(CrashLogWriter writer);
+
+   bool flush();
+   bool flushIfDue();  // Metade do buffer ocupada ou flushInterval desde a linha pendente mais antiga
+
+   size_t getPending();
+   CrashLogStats getStats();
+
+  private:
+   const uint32_t flushInterval;
+
+   CrashLogWriter writer;
+   SemaphoreHandle_t mutex = NULL;
+   uint32_t pendingSince = 0;
+   bool failing = false;
+   CrashLogStats stats;
+
+   bool write();
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "deepSleepScheduler.h"
+
+// A RTC slow memory tem 8 KB, divididos com o diário de acionamentos
+static_assert(sizeof(DeepSleepState) <= 4096, "O estado do deep sleep não cabe na RTC slow memory");
+
+RTC_DATA_ATTR static DeepSleepState state;
+
+DeepSleepScheduler::DeepSleepScheduler(uint32_t syncEvery, uint32_t maxSleep)
+    : syncEvery(syncEvery),
+      maxSleep(maxSleep) {
+}
+
+bool DeepSleepScheduler::resume() {
+   timerWake = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && isValid();
+
+   if (!timerWake)
+      return false;
+
+   // O esp_timer recomeça do zero a cada boot, então o relógio avança exatamente o tempo planejado
+   state.clock += state.plannedSleep;
+   state.clockBoot = 0;
+   state.wakeCount++;
+
+   if (syncEvery > 0 && state.wakeCount % syncEvery == 0)
+      return false;
+
+   fastPath = true;
+   return true;
+}
+
+void DeepSleepScheduler::synchronize(uint32_t epoch) {
+   uint64_t actual = (uint64_t)epoch * 1000;
+
+   if (!isValid()) {
+      state = DeepSleepState();
+      state.magic = DEEP_SLEEP_MAGIC;
+   } else if (timerWake && state.lastSync > 0 && state.sleptSinceSync > 60000) {
+      // O erro acumulado vem apenas dos períodos de sono, medidos pelo oscilador RTC
+      int64_t error = (int64_t)actual - (int64_t)now();
+      int64_t drift = state.driftPpm + error * 1000000 / (int64_t)state.sleptSinceSync;
+
+      state.driftPpm = constrain(drift, -DEEP_SLEEP_DRIFT_LIMIT, DEEP_SLEEP_DRIFT_LIMIT);
+   }
+
+   setClock(actual);
+   state.lastSync = actual;
+   state.sleptSinceSync = 0;
+}
+
+void DeepSleepScheduler::store(uint8_t index, uint8_t gpioPin, uint32_t pulseDuration, const DriveSchedule &schedule) {
+   if (index >= DEEP_SLEEP_MAX_PUMPS)
+      return;
+
+   DeepSleepPump &pump = state.pumps[index];
+
+   // Preserva um pulso em andamento caso a sincronização ocorra no meio dele
+   if (pump.gpioPin != gpioPin) {
+      pump.pulseEnd = 0;
+      pump.lastStart = 0;
+   }
+
+   pump.gpioPin = gpioPin;
+   pump.pulseDuration = pulseDuration;
+   pump.latitude = schedule.getLatitude();
+   pump.longitude = schedule.getLongitude();
+   pump.utcOffset = schedule.getUtcOffset();
+
+   // addRule limita a agenda a SCHEDULE_MAX_RULES, a mesma capacidade guardada aqui
+   pump.ruleCount = 0;
+   for (const ScheduleRule &rule : schedule.getRules())
+      pump.rules[pump.ruleCount++] = rule;
+
+   if (index >= state.pumpCount)
+      state.pumpCount = index + 1;
+}
+
+void DeepSleepScheduler::sleep() {
+   runDue();
+
+   uint64_t planned = getNextWake();
+   uint64_t requested = planned * 1000000 / (1000000 + state.driftPpm);
+
+   state.clock = now();
+   state.clockBoot = 0;
+   state.plannedSleep = planned;
+   state.sleptSinceSync += planned;
+
+   // Mantém o nível das saídas acionadas durante o deep sleep
+   gpio_deep_sleep_hold_en();
+
+   esp_sleep_enable_timer_wakeup(requested * 1000);
+   esp_deep_sleep_start();
+}
+
+int32_t DeepSleepScheduler::getDriftPpm() {
+   return state.driftPpm;
+}
+
+uint32_t DeepSleepScheduler::getLastWakeToGpio() {
+   return state.lastWakeToGpio;
+}
+
+uint32_t DeepSleepScheduler::getMaxWakeToGpio() {
+   return state.maxWakeToGpio;
+}
+
+uint32_t DeepSleepScheduler::getWakeCount() {
+   return state.wakeCount;
+}
+
+bool DeepSleepScheduler::isValid() {
+   return state.magic == DEEP_SLEEP_MAGIC;
+}
+
+uint64_t DeepSleepScheduler::now() {
+   return state.clock + (esp_timer_get_time() - state.clockBoot) / 1000;
+}
+
+void DeepSleepScheduler::setClock(uint64_t clock) {
+   state.clock = clock;
+   state.clockBoot = esp_timer_get_time();
+}
+
+void DeepSleepScheduler::runDue() {
+   uint64_t current = now();
+   uint32_t second = current / 1000;
+
+   for (uint8_t index = 0; index < state.pumpCount; index++) {
+      DeepSleepPump &pump = state.pumps[index];
+      gpio_num_t pin = (gpio_num_t)pump.gpioPin;
+
+      if (pump.pulseEnd != 0 && current + 50 >= pump.pulseEnd) {
+         gpio_hold_dis(pin);
+         gpio_set_level(pin, 0);
+         pump.pulseEnd = 0;
+      }
+
+      if (pump.pulseEnd != 0 || pump.ruleCount == 0 || current - pump.lastStart < DEEP_SLEEP_DUE_WINDOW * 1000)
+         continue;
+
+      DriveSchedule schedule;
+      load(pump, schedule);
+
+      // Algum horário nos últimos DEEP_SLEEP_DUE_WINDOW segundos, inclusive antes da meia-noite
+      if (schedule.countEventsBetween(second - (DEEP_SLEEP_DUE_WINDOW - 1), second) > 0) {
+         gpio_hold_dis(pin);
+         gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+         gpio_set_level(pin, 1);
+         gpio_hold_en(pin);
+
+         // Tempo desde o início da aplicação até a saída ser acionada
+         if (fastPath) {
+            state.lastWakeToGpio = esp_timer_get_time();
+            if (state.lastWakeToGpio > state.maxWakeToGpio)
+               state.maxWakeToGpio = state.lastWakeToGpio;
+         }
+
+         pump.pulseEnd = current + pump.pulseDuration;
+         pump.lastStart = current;
+      }
+   }
+}
+
+uint64_t DeepSleepScheduler::getNextWake() {
+   uint64_t current = now();
+   uint32_t second = current / 1000;
+   uint64_t next = maxSleep;
+
+   for (uint8_t index = 0; index < state.pumpCount; index++) {
+      DeepSleepPump &pump = state.pumps[index];
+
+      if (pump.pulseEnd != 0) {
+         next = min(next, pump.pulseEnd > current ? pump.pulseEnd - current : (uint64_t)0);
+         continue;
+      }
+
+      if (pump.ruleCount == 0)
+         continue;
+
+      DriveSchedule schedule;
+      load(pump, schedule);
+
+      // Próximo horário depois do segundo atual, ou a meia-noite quando o dia não tem mais nenhum
+      uint64_t ahead = schedule.getSecondsToNext(second + 1) + 1;
+
+      next = min(next, ahead * 1000 - current % 1000);
+   }
+
+   return max(next, (uint64_t)10);
+}
+
+void DeepSleepScheduler::load(const DeepSleepPump &pump, DriveSchedule &schedule) {
+   schedule.setLocation(pump.latitude, pump.longitude, pump.utcOffset);
+
+   for (uint8_t index = 0; index < pump.ruleCount; index++)
+      schedule.addRule(pump.rules[index]);
+}
@@ -0,0 +1,83 @@
+#ifndef _DEEPSLEEPSCHEDULER_
+#define _DEEPSLEEPSCHEDULER_
+
+#include <Arduino.h>
+
+#include "driveSchedule.h"
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#define DEEP_SLEEP_MAGIC 0x44534C51  // Muda junto com o layout de DeepSleepState
+#define DEEP_SLEEP_MAX_PUMPS 4
+#define DEEP_SLEEP_DUE_WINDOW 60    // Em s, tolerância para considerar um horário como devido
+#define DEEP_SLEEP_DRIFT_LIMIT 60000  // Em ppm, o oscilador RC interno varia até ~5%
+
+// Guarda as regras e não os horários do dia: a cada despertar o índice do dia é compilado de novo,
+// então regras de dias da semana, do nascer/pôr do sol e com mais horários que caberiam na RTC
+// continuam valendo durante semanas sem sincronização
+struct DeepSleepPump {
+   uint8_t gpioPin;
+   uint8_t ruleCount;
+   uint32_t pulseDuration;  // Em ms
+   uint64_t pulseEnd;       // Em ms (epoch local), 0 quando parada
+   uint64_t lastStart;      // Em ms (epoch local)
+   float latitude;
+   float longitude;
+   int32_t utcOffset;
+   ScheduleRule rules[SCHEDULE_MAX_RULES];
+};
+
+// Estado mantido na RTC slow memory entre os ciclos de deep sleep
+struct DeepSleepState {
+   uint32_t magic;
+   uint32_t wakeCount;
+   uint64_t clock;            // Em ms (epoch local) no instante em que o relógio foi ajustado
+   uint64_t clockBoot;        // Em us, esp_timer_get_time() no instante do ajuste
+   uint64_t lastSync;         // Em ms (epoch local) da última sincronização NTP
+   uint64_t plannedSleep;     // Em ms de tempo real, já descontada a deriva do oscilador RTC
+   uint64_t sleptSinceSync;   // Em ms
+   int32_t driftPpm;
+   uint32_t lastWakeToGpio;   // Em us
+   uint32_t maxWakeToGpio;    // Em us
+   uint8_t pumpCount;
+   DeepSleepPump pumps[DEEP_SLEEP_MAX_PUMPS];
+};
+
+// Executa a agenda das bombas em deep sleep: acorda em cada horário (ou fim de pulso),
+// aciona as saídas mantendo o nível com gpio_hold e volta a dormir. A cada syncEvery
+// despertares o setup() completo roda para sincronizar NTP e configuração da nuvem.
+class DeepSleepScheduler {
+  public:
+   DeepSleepScheduler(uint32_t syncEvery, uint32_t maxSleep);
+
+   bool resume();
+
+   void synchronize(uint32_t epoch);
+
+   void store(uint8_t index, uint8_t gpioPin, uint32_t pulseDuration, const DriveSchedule &schedule);
+
+   void sleep();
+
+   int32_t getDriftPpm();
+   uint32_t getLastWakeToGpio();
+   uint32_t getMaxWakeToGpio();
+   uint32_t getWakeCount();
+
+  private:
+   const uint32_t syncEvery;
+   const uint32_t maxSleep;
+
+   bool timerWake = false;
+   bool fastPath = false;
+
+   bool isValid();
+   uint64_t now();
+   void setClock(uint64_t clock);
+   void runDue();
+   uint64_t getNextWake();
+
+   static void load(const DeepSleepPump &pump, DriveSchedule &schedule);
+};
+
+#endif
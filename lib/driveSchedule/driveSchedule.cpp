@@ -0,0 +1,351 @@
+#include "driveSchedule.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+void DriveSchedule::clear() {
+   rules.clear();
+   events.clear();
+   compiledDay = UINT32_MAX;
+   cursor = 0;
+   lastDrive = 0;
+   truncated = false;
+}
+
+const std::vector<ScheduleRule> &DriveSchedule::getRules() const {
+   return rules;
+}
+
+bool DriveSchedule::addRule(const ScheduleRule &rule) {
+   if (rules.size() >= SCHEDULE_MAX_RULES || (rule.weekdays & SCHEDULE_EVERY_DAY) == 0)
+      return false;
+
+   rules.push_back(rule);
+   compiledDay = UINT32_MAX;
+
+   return true;
+}
+
+void DriveSchedule::setLocation(float latitude, float longitude, int32_t utcOffset) {
+   this->latitude = latitude;
+   this->longitude = longitude;
+   this->utcOffset = utcOffset;
+   compiledDay = UINT32_MAX;
+}
+
+float DriveSchedule::getLatitude() const {
+   return latitude;
+}
+
+float DriveSchedule::getLongitude() const {
+   return longitude;
+}
+
+int32_t DriveSchedule::getUtcOffset() const {
+   return utcOffset;
+}
+
+// Compila o índice do dia e posiciona no primeiro horário ainda não alcançado
+void DriveSchedule::compile(uint32_t localEpoch) {
+   build(localEpoch / 86400);
+   cursor = std::lower_bound(events.begin(), events.end(), localEpoch % 86400) - events.begin();
+}
+
+// Herda o progresso da agenda substituída: um horário já disparado por ela no mesmo dia não dispara
+// de novo quando a nova agenda é compilada ainda dentro do mesmo segundo
+void DriveSchedule::continueFrom(const DriveSchedule &previous) {
+   lastDrive = previous.lastDrive;
+
+   if (lastDrive == 0 || compiledDay != lastDrive / 86400)
+      return;
+
+   size_t fired = std::upper_bound(events.begin(), events.end(), lastDrive % 86400) - events.begin();
+   cursor = std::max(cursor, fired);
+}
+
+// Gera os horários do dia (contado em dias desde 01/01/1970 no horário local)
+void DriveSchedule::build(uint32_t dayNumber) {
+   uint8_t weekday = 1 << ((dayNumber + 4) % 7);  // 01/01/1970 foi uma quinta-feira
+   int32_t sunrise = -1, sunset = -1;
+
+   events.clear();
+   truncated = false;
+
+   for (const ScheduleRule &rule : rules) {
+      if (!(rule.weekdays & weekday))
+         continue;
+
+      int32_t first = rule.start;
+
+      if (rule.anchor != ANCHOR_CLOCK) {
+         int32_t &sun = rule.anchor == ANCHOR_SUNRISE ? sunrise : sunset;
+         if (sun < 0)
+            sun = getSunEvent(dayNumber, latitude, longitude, utcOffset, rule.anchor == ANCHOR_SUNRISE);
+         if (sun < 0)
+            continue;  // Sol da meia-noite ou noite polar
+
+         first += sun;
+      }
+
+      if (first < 0 || first >= 86400)
+         continue;
+
+      int32_t last = rule.interval > 0 && rule.end >= first ? std::min(rule.end, (int32_t)86399) : first;
+
+      for (int32_t second = first; second <= last; second += rule.interval > 0 ? rule.interval : 1) {
+         if (events.size() >= SCHEDULE_MAX_EVENTS) {
+            truncated = true;
+            break;
+         }
+
+         events.push_back(second);
+      }
+   }
+
+   std::sort(events.begin(), events.end());
+   events.erase(std::unique(events.begin(), events.end()), events.end());
+
+   compiledDay = dayNumber;
+   cursor = 0;
+}
+
+// Deve ser chamado periodicamente: retorna true uma única vez para cada horário alcançado. Quando
+// informados, lateness recebe o atraso em segundos do horário disparado e missed é somado aos
+// horários descartados.
+bool DriveSchedule::isDue(uint32_t localEpoch, uint32_t *lateness, uint32_t *missed) {
+   uint32_t second = localEpoch % 86400;
+
+   prepare(localEpoch);
+
+   // Horários que passaram além da janela de atraso (ex.: ajuste do NTP) são descartados
+   while (cursor < events.size() && events[cursor] + SCHEDULE_LATE_WINDOW < second) {
+      cursor++;
+      if (missed != NULL)
+         (*missed)++;
+   }
+
+   if (cursor < events.size() && events[cursor] <= second) {
+      if (lateness != NULL)
+         *lateness = second - events[cursor];
+
+      lastDrive = compiledDay * 86400 + events[cursor];
+      cursor++;
+      return true;
+   }
+
+   return false;
+}
+
+// Retorna -1 caso não exista nenhuma regra. Sem horários restantes no dia, retorna o tempo até
+// a meia-noite, quando o índice do dia seguinte é compilado.
+int32_t DriveSchedule::getSecondsToNext(uint32_t localEpoch) {
+   uint32_t second = localEpoch % 86400;
+
+   if (rules.empty())
+      return -1;
+
+   prepare(localEpoch);
+
+   if (cursor >= events.size())
+      return 86400 - second;
+
+   return events[cursor] > second ? events[cursor] - second : 0;
+}
+
+// Conta os horários no intervalo fechado [fromEpoch, toEpoch], que pode atravessar a meia-noite.
+// O índice termina compilado para toEpoch.
+size_t DriveSchedule::countEventsBetween(uint32_t fromEpoch, uint32_t toEpoch) {
+   size_t total = 0;
+
+   for (uint32_t day = fromEpoch / 86400; fromEpoch <= toEpoch && day <= toEpoch / 86400; day++) {
+      build(day);
+
+      uint32_t first = day == fromEpoch / 86400 ? fromEpoch % 86400 : 0;
+      uint32_t last = day == toEpoch / 86400 ? toEpoch % 86400 : 86399;
+
+      total += std::upper_bound(events.begin(), events.end(), last) - std::lower_bound(events.begin(), events.end(), first);
+   }
+
+   compile(toEpoch);
+
+   return total;
+}
+
+const std::vector<uint32_t> &DriveSchedule::getEvents() const {
+   return events;
+}
+
+size_t DriveSchedule::getRuleCount() const {
+   return rules.size();
+}
+
+bool DriveSchedule::isTruncated() const {
+   return truncated;
+}
+
+// Aceita "HH:MM" ou "HH:MM:SS", retorna -1 caso seja inválido
+int32_t DriveSchedule::parseTime(const char *time) {
+   int hours, minutes, seconds = 0;
+
+   if (time == NULL || sscanf(time, "%d:%d:%d", &hours, &minutes, &seconds) < 2)
+      return -1;
+
+   if (hours < 0 || hours > 23 || minutes < 0 || minutes > 59 || seconds < 0 || seconds > 59)
+      return -1;
+
+   return hours * 3600 + minutes * 60 + seconds;
+}
+
+static const char *weekdayNames[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+int8_t DriveSchedule::parseWeekday(const char *day) {
+   for (int8_t index = 0; day != NULL && index < 7; index++)
+      if (strncmp(day, weekdayNames[index], 3) == 0)
+         return index;
+
+   return -1;
+}
+
+const char *DriveSchedule::formatWeekday(uint8_t weekday) {
+   return weekday < 7 ? weekdayNames[weekday] : NULL;
+}
+
+// time deve comportar "HH:MM:SS"
+void DriveSchedule::formatTime(uint32_t second, char *time) {
+   snprintf(time, 9, "%02u:%02u:%02u", (unsigned)(second / 3600) % 24, (unsigned)(second / 60) % 60, (unsigned)second % 60);
+}
+
+// Equação do nascer do sol (precisão de cerca de um minuto), retorna o segundo do dia local
+// ou -1 quando o sol não nasce ou não se põe nesse dia
+int32_t DriveSchedule::getSunEvent(uint32_t dayNumber, float latitude, float longitude, int32_t utcOffset, bool rising) {
+   const double rad = M_PI / 180.0;
+
+   double days = (double)dayNumber - 10957.0 - longitude / 360.0;  // Dias desde 01/01/2000
+   double anomaly = fmod(357.5291 + 0.98560028 * days, 360.0);
+   double center = 1.9148 * sin(anomaly * rad) + 0.02 * sin(2 * anomaly * rad) + 0.0003 * sin(3 * anomaly * rad);
+   double ecliptic = fmod(anomaly + center + 180.0 + 102.9372, 360.0);
+   double transit = days + 0.0053 * sin(anomaly * rad) - 0.0069 * sin(2 * ecliptic * rad);
+   double declination = asin(sin(ecliptic * rad) * sin(23.4397 * rad));
+   double hourAngle = (sin(-0.833 * rad) - sin(latitude * rad) * sin(declination)) / (cos(latitude * rad) * cos(declination));
+
+   if (hourAngle < -1.0 || hourAngle > 1.0)
+      return -1;
+
+   hourAngle = acos(hourAngle) / rad / 360.0;
+
+   // Os dias são contados a partir do meio-dia UTC, por isso o ajuste de meio dia
+   double event = (rising ? transit - hourAngle : transit + hourAngle) + 0.5;
+   int32_t second = (int32_t)lround((event - floor(event)) * 86400.0) + utcOffset;
+
+   return ((second % 86400) + 86400) % 86400;
+}
+
+void DriveSchedule::prepare(uint32_t localEpoch) {
+   uint32_t day = localEpoch / 86400;
+   uint32_t second = localEpoch % 86400;
+
+   if (day != compiledDay) {
+      compile(localEpoch);
+   } else if (cursor > 0 && events[cursor - 1] > second) {
+      // O relógio voltou: reposiciona para não pular os horários que ainda não chegaram
+      cursor = std::lower_bound(events.begin(), events.end(), second) - events.begin();
+   }
+}
+
+void ScheduleRuleBuilder::reset() {
+   *this = ScheduleRuleBuilder();
+}
+
+// Chaves desconhecidas são ignoradas, valores inválidos retornam false
+bool ScheduleRuleBuilder::setText(const char *key, const char *value) {
+   if (strcmp(key, "days") == 0) {
+      if (strcmp(value, "weekdays") == 0)
+         weekdays = SCHEDULE_WEEKDAYS;
+      else if (strcmp(value, "weekends") == 0)
+         weekdays = SCHEDULE_WEEKENDS;
+      else if (strcmp(value, "daily") == 0)
+         weekdays = SCHEDULE_EVERY_DAY;
+      else
+         return false;
+   } else if (strcmp(key, "at") == 0 || strcmp(key, "from") == 0 || strcmp(key, "time") == 0) {
+      start = DriveSchedule::parseTime(value);
+      return start >= 0;
+   } else if (strcmp(key, "to") == 0) {
+      end = DriveSchedule::parseTime(value);
+      return end >= 0;
+   } else if (strcmp(key, "anchor") == 0) {
+      if (strcmp(value, "sunrise") == 0)
+         anchor = ANCHOR_SUNRISE;
+      else if (strcmp(value, "sunset") == 0)
+         anchor = ANCHOR_SUNSET;
+      else if (strcmp(value, "clock") == 0)
+         anchor = ANCHOR_CLOCK;
+      else
+         return false;
+   }
+
+   return true;
+}
+
+bool ScheduleRuleBuilder::setNumber(const char *key, long value) {
+   if (strcmp(key, "every") == 0) {
+      if (value <= 0 || value >= 86400)
+         return false;
+      interval = value;
+   } else if (strcmp(key, "offset") == 0) {
+      if (value <= -86400 || value >= 86400)
+         return false;
+      offset = value;
+   }
+
+   return true;
+}
+
+bool ScheduleRuleBuilder::setFlag(const char *key, bool value) {
+   if (strcmp(key, "state") == 0)
+      enabled = value;
+
+   return true;
+}
+
+void ScheduleRuleBuilder::clearDays() {
+   weekdays = 0;
+}
+
+bool ScheduleRuleBuilder::addDay(const char *day) {
+   int8_t weekday = DriveSchedule::parseWeekday(day);
+
+   if (weekday < 0)
+      return false;
+
+   weekdays |= 1 << weekday;
+   return true;
+}
+
+bool ScheduleRuleBuilder::isEnabled() const {
+   return enabled;
+}
+
+bool ScheduleRuleBuilder::build(ScheduleRule &rule) const {
+   rule = ScheduleRule();
+   rule.weekdays = weekdays;
+   rule.anchor = anchor;
+
+   if (anchor == ANCHOR_CLOCK) {
+      if (start < 0)
+         return false;
+      rule.start = start;
+   } else {
+      rule.start = offset;
+   }
+
+   if (interval > 0) {
+      rule.interval = interval;
+      rule.end = end >= 0 ? end : 86399;
+   }
+
+   return (weekdays & SCHEDULE_EVERY_DAY) != 0;
+}
@@ -0,0 +1,110 @@
+#ifndef _DRIVESCHEDULE_
+#define _DRIVESCHEDULE_
+
+// Sem dependências do Arduino para que o compilador de regras também compile no host
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#define SCHEDULE_MAX_RULES 32
+#define SCHEDULE_MAX_EVENTS 288  // Por dia, equivale a um acionamento a cada 5 minutos
+#define SCHEDULE_LATE_WINDOW 5   // Em segundos, atraso máximo aceito para disparar um horário
+#define SCHEDULE_EVERY_DAY 0x7F  // Bit 0 é domingo
+#define SCHEDULE_WEEKDAYS 0x3E
+#define SCHEDULE_WEEKENDS 0x41
+
+enum ScheduleAnchor : uint8_t {
+   ANCHOR_CLOCK = 0,
+   ANCHOR_SUNRISE = 1,
+   ANCHOR_SUNSET = 2,
+};
+
+// Ex.: "a cada 15 min entre 06:00 e 18:00 nos dias úteis" ou "30 min após o nascer do sol"
+struct ScheduleRule {
+   uint8_t weekdays = SCHEDULE_EVERY_DAY;
+   ScheduleAnchor anchor = ANCHOR_CLOCK;
+   int32_t start = 0;      // Segundos do dia, ou deslocamento em relação ao nascer/pôr do sol
+   int32_t end = -1;       // Segundos do dia, -1 para um único acionamento
+   uint32_t interval = 0;  // Em segundos, 0 para um único acionamento
+};
+
+// Monta uma regra a partir dos campos do JSON recebidos em qualquer ordem:
+// days ("weekdays", "weekends", "daily" ou lista de "sun".."sat"), at/from, to, every (s),
+// anchor ("clock", "sunrise", "sunset"), offset (s) e state
+class ScheduleRuleBuilder {
+  public:
+   void reset();
+
+   bool setText(const char *key, const char *value);
+   bool setNumber(const char *key, long value);
+   bool setFlag(const char *key, bool value);
+
+   void clearDays();
+   bool addDay(const char *day);
+
+   bool isEnabled() const;
+
+   bool build(ScheduleRule &rule) const;
+
+  private:
+   uint8_t weekdays = SCHEDULE_EVERY_DAY;
+   ScheduleAnchor anchor = ANCHOR_CLOCK;
+   int32_t start = -1;
+   int32_t end = -1;
+   int32_t offset = 0;
+   int32_t interval = -1;
+   bool enabled = true;
+};
+
+// Compila as regras de recorrência em um índice ordenado com os horários do dia, de forma
+// que a verificação a cada tick custe O(1) independente da quantidade de regras
+class DriveSchedule {
+  public:
+   void clear();
+
+   const std::vector<ScheduleRule> &getRules() const;
+   bool addRule(const ScheduleRule &rule);
+
+   void setLocation(float latitude, float longitude, int32_t utcOffset);
+   float getLatitude() const;
+   float getLongitude() const;
+   int32_t getUtcOffset() const;
+
+   void compile(uint32_t localEpoch);
+   void continueFrom(const DriveSchedule &previous);
+
+   bool isDue(uint32_t localEpoch, uint32_t *lateness = NULL, uint32_t *missed = NULL);
+
+   int32_t getSecondsToNext(uint32_t localEpoch);
+
+   size_t countEventsBetween(uint32_t fromEpoch, uint32_t toEpoch);
+
+   const std::vector<uint32_t> &getEvents() const;
+   size_t getRuleCount() const;
+   bool isTruncated() const;
+
+   static int32_t parseTime(const char *time);
+   static void formatTime(uint32_t second, char *time);
+   static const char *formatWeekday(uint8_t weekday);
+   static int8_t parseWeekday(const char *day);
+   static int32_t getSunEvent(uint32_t dayNumber, float latitude, float longitude, int32_t utcOffset, bool rising);
+
+  private:
+   std::vector<ScheduleRule> rules;
+   std::vector<uint32_t> events;  // Segundos do dia, ordenados e sem repetição
+
+   float latitude = 0;
+   float longitude = 0;
+   int32_t utcOffset = 0;
+
+   uint32_t compiledDay = UINT32_MAX;
+   size_t cursor = 0;  // Próximo horário ainda não disparado
+   uint32_t lastDrive = 0;  // Epoch local do último horário disparado
+   bool truncated = false;
+
+   void build(uint32_t dayNumber);
+   void prepare(uint32_t localEpoch);
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "eventStream.h"
+
+EventStream::EventStream(const char *url, size_t maxClients, uint32_t interval, uint32_t maxBacklog)
+    : source(url),
+      maxClients(maxClients),
+      maxBacklog(maxBacklog),
+      interval(interval) {
+   mutex = xSemaphoreCreateMutex();
+
+   for (Slot &slot : slots) {
+      slot.data[0] = '\0';
+      slot.sent[0] = '\0';
+   }
+}
+
+EventStream::~EventStream() {
+   vSemaphoreDelete(mutex);
+}
+
+void EventStream::begin(AsyncWebServer &server) {
+   // O filtro faz as conexões acima do limite caírem na rota de recusa registrada logo depois
+   source.setFilter([this](AsyncWebServerRequest *request) {
+      return source.count() < maxClients;
+   });
+   source.onConnect([this](AsyncEventSourceClient *client) {
+      onConnect(client);
+   });
+   server.addHandler(&source);
+
+   server.on(source.url(), HTTP_GET, [this](AsyncWebServerRequest *request) {
+      if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+         stats.rejected++;
+         xSemaphoreGive(mutex);
+      }
+
+      AsyncWebServerResponse *response = request->beginResponse(503, "text/plain", "Too many event clients");
+      response->addHeader("Retry-After", String(interval / 1000 + 30));
+      request->send(response);
+   });
+}
+
+// Guarda o valor para o próximo envio; retorna false quando ele não mudou
+bool EventStream::publish(EventTopic topic, const char *data) {
+   bool changed = false;
+
+   if (topic >= EVENT_TOPICS || data == NULL)
+      return false;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      Slot &slot = slots[topic];
+      stats.published++;
+
+      // Compara com o valor que ainda vai sair ou, se não houver, com o último enviado
+      if (strncmp(data, slot.dirty ? slot.data : slot.sent, EVENT_STREAM_MAX_DATA - 1) == 0) {
+         stats.unchanged++;
+      } else {
+         if (slot.dirty)
+            stats.coalesced++;
+         strlcpy(slot.data, data, EVENT_STREAM_MAX_DATA);
+         slot.dirty = strcmp(slot.data, slot.sent) != 0;
+         changed = true;
+      }
+
+      xSemaphoreGive(mutex);
+   }
+
+   return changed;
+}
+
+// Envia os tópicos que mudaram desde o último envio e retorna o tempo em ms até o próximo
+uint32_t EventStream::flush() {
+   uint32_t elapsed = millis() - lastFlush;
+
+   if (elapsed < interval)
+      return interval - elapsed;
+
+   lastFlush = millis();
+
+   if (source.count() == 0)
+      return interval;
+
+   // Enquanto os clientes não esvaziam a fila os valores continuam sendo agrupados
+   uint32_t backlog = source.avgPacketsWaiting();
+   if (backlog >= maxBacklog) {
+      if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+         stats.deferred++;
+         stats.backlog = backlog;
+         stats.maxBacklog = max(stats.maxBacklog, backlog);
+         xSemaphoreGive(mutex);
+      }
+      return interval;
+   }
+
+   char data[EVENT_STREAM_MAX_DATA];
+   uint32_t sent = 0;
+
+   for (uint8_t topic = 0; topic < EVENT_TOPICS; topic++) {
+      bool dirty = false;
+
+      if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+         Slot &slot = slots[topic];
+         if (slot.dirty) {
+            strlcpy(data, slot.data, sizeof(data));
+            strlcpy(slot.sent, slot.data, sizeof(slot.sent));
+            slot.dirty = false;
+            dirty = true;
+         }
+         xSemaphoreGive(mutex);
+      }
+
+      // Enviado fora do mutex para não bloquear quem publica durante a escrita no socket
+      if (dirty) {
+         source.send(data, getName((EventTopic)topic), ++lastId);
+         sent++;
+      }
+   }
+
+   backlog = source.avgPacketsWaiting();
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      stats.flushes++;
+      stats.sent += sent;
+      stats.backlog = backlog;
+      stats.maxBacklog = max(stats.maxBacklog, backlog);
+      xSemaphoreGive(mutex);
+   }
+
+   return interval;
+}
+
+// Um painel recém-conectado recebe o último valor de cada tópico de uma vez
+void EventStream::onConnect(AsyncEventSourceClient *client) {
+   char data[EVENT_STREAM_MAX_DATA];
+
+   for (uint8_t topic = 0; topic < EVENT_TOPICS; topic++) {
+      data[0] = '\0';
+
+      if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+         strlcpy(data, slots[topic].dirty ? slots[topic].data : slots[topic].sent, sizeof(data));
+         xSemaphoreGive(mutex);
+      }
+
+      if (data[0] != '\0')
+         client->send(data, getName((EventTopic)topic), lastId);
+   }
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      stats.connects++;
+      stats.maxBacklog = max(stats.maxBacklog, (uint32_t)client->packetsWaiting());
+      xSemaphoreGive(mutex);
+   }
+}
+
+void EventStream::setInterval(uint32_t newInterval) {
+   interval = newInterval;
+}
+
+uint32_t EventStream::getInterval() {
+   return interval;
+}
+
+size_t EventStream::getClientCount() {
+   return source.count();
+}
+
+EventStreamStats EventStream::getStats() {
+   EventStreamStats copy;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      copy = stats;
+      xSemaphoreGive(mutex);
+   }
+
+   return copy;
+}
+
+const char *EventStream::getName(EventTopic topic) {
+   static const char *names[] = {"time", "rssi", "pumps", "ntp", "config"};
+
+   return topic < EVENT_TOPICS ? names[topic] : "message";
+}
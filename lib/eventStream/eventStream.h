@@ -0,0 +1,80 @@
+#ifndef _EVENTSTREAM_
+#define _EVENTSTREAM_
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define EVENT_STREAM_MAX_DATA 192
+
+enum EventTopic : uint8_t {
+   EVENT_TIME = 0,
+   EVENT_RSSI = 1,
+   EVENT_PUMPS = 2,
+   EVENT_NTP = 3,
+   EVENT_CONFIG = 4,
+   EVENT_TOPICS = 5,
+};
+
+struct EventStreamStats {
+   uint32_t published = 0;   // Valores recebidos das tasks
+   uint32_t unchanged = 0;   // Descartados por serem iguais ao último enviado
+   uint32_t coalesced = 0;   // Sobrescritos antes de serem enviados
+   uint32_t sent = 0;        // Eventos enviados, cada um para todos os clientes
+   uint32_t flushes = 0;
+   uint32_t deferred = 0;    // Envios adiados porque os clientes não esvaziaram a fila
+   uint32_t connects = 0;
+   uint32_t rejected = 0;    // Conexões recusadas pelo limite de clientes
+   uint32_t backlog = 0;     // Mensagens na fila de cada cliente no último envio (média)
+   uint32_t maxBacklog = 0;
+};
+
+// Stream Server-Sent Events para os painéis: cada tópico guarda só o valor mais recente, que
+// sai no máximo uma vez por intervalo e apenas quando mudou. O custo depende da taxa de
+// mudança e não de quantos painéis estão abertos ou de quão rápido eles consultariam.
+class EventStream {
+  public:
+   EventStream(const char *url, size_t maxClients, uint32_t interval, uint32_t maxBacklog);
+
+   ~EventStream();
+
+   void begin(AsyncWebServer &server);
+
+   bool publish(EventTopic topic, const char *data);
+
+   uint32_t flush();
+
+   void setInterval(uint32_t newInterval);
+   uint32_t getInterval();
+
+   size_t getClientCount();
+
+   EventStreamStats getStats();
+
+  private:
+   struct Slot {
+      char data[EVENT_STREAM_MAX_DATA];
+      char sent[EVENT_STREAM_MAX_DATA];
+      bool dirty = false;
+   };
+
+   AsyncEventSource source;
+   const size_t maxClients;
+   const uint32_t maxBacklog;
+   uint32_t interval;
+
+   Slot slots[EVENT_TOPICS];
+   uint32_t lastId = 0;
+   uint32_t lastFlush = 0;
+
+   EventStreamStats stats;
+   SemaphoreHandle_t mutex;
+
+   void onConnect(AsyncEventSourceClient *client);
+
+   static const char *getName(EventTopic topic);
+};
+
+#endif
@@ -1,34 +1,139 @@
 #include "freeRTOSTimerController.h"
 
-FreeRTOSTimer::FreeRTOSTimer(const char *name, TickType_t period, UBaseType_t auto_reload, void *pvTimerID, TimerCallbackFunction_t callback) {
-   timer = xTimerCreate(name, period / portTICK_PERIOD_MS, auto_reload, pvTimerID, callback);
+FreeRTOSTimerStats FreeRTOSTimer::globalStats;
+portMUX_TYPE FreeRTOSTimer::statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+FreeRTOSTimer::FreeRTOSTimer(const char *name, TickType_t period, UBaseType_t auto_reload, void *pvTimerID, TimerCallbackFunction_t callback, StaticTimer_t *buffer) {
+   this->period = period / portTICK_PERIOD_MS;
+   timer = xTimerCreateStatic(name, this->period, auto_reload, pvTimerID, callback, buffer != NULL ? buffer : &storage);
 }
 
 FreeRTOSTimer::~FreeRTOSTimer() {
-   if (xTimerIsTimerActive(timer)) {
-      xTimerStop(timer, 0);
+   sendCommand([this](TickType_t blockTime) { return xTimerDelete(timer, blockTime); });
+}
+
+bool FreeRTOSTimer::start() {
+   // O período alterado com o timer parado só é aplicado aqui, pois xTimerChangePeriod também inicia o timer
+   if (periodPending) {
+      periodPending = false;
+      return sendCommand([this](TickType_t blockTime) { return xTimerChangePeriod(timer, period, blockTime); });
    }
-   xTimerDelete(timer, 0);
+
+   return sendCommand([this](TickType_t blockTime) { return xTimerStart(timer, blockTime); });
+}
+
+bool FreeRTOSTimer::stop() {
+   // Sem checar xTimerIsTimerActive: o estado pode estar defasado em relação aos comandos já enfileirados
+   return sendCommand([this](TickType_t blockTime) { return xTimerStop(timer, blockTime); });
+}
+
+bool FreeRTOSTimer::reset() {
+   return sendCommand([this](TickType_t blockTime) { return xTimerReset(timer, blockTime); });
+}
+
+bool FreeRTOSTimer::changePeriod(TickType_t newPeriod) {
+   period = newPeriod / portTICK_PERIOD_MS;
+
+   if (!isActive()) {
+      periodPending = true;
+      return true;
+   }
+
+   periodPending = false;
+   return sendCommand([this](TickType_t blockTime) { return xTimerChangePeriod(timer, period, blockTime); });
+}
+
+bool FreeRTOSTimer::startFromISR(BaseType_t *pxHigherPriorityTaskWoken) {
+   if (periodPending) {
+      periodPending = false;
+      return sendCommandFromISR(xTimerChangePeriodFromISR(timer, period, pxHigherPriorityTaskWoken));
+   }
+
+   return sendCommandFromISR(xTimerStartFromISR(timer, pxHigherPriorityTaskWoken));
+}
+
+bool FreeRTOSTimer::stopFromISR(BaseType_t *pxHigherPriorityTaskWoken) {
+   return sendCommandFromISR(xTimerStopFromISR(timer, pxHigherPriorityTaskWoken));
+}
+
+bool FreeRTOSTimer::resetFromISR(BaseType_t *pxHigherPriorityTaskWoken) {
+   return sendCommandFromISR(xTimerResetFromISR(timer, pxHigherPriorityTaskWoken));
 }
 
-void FreeRTOSTimer::start() {
-   if (!xTimerIsTimerActive(timer))
-      xTimerStart(timer, 0);
+bool FreeRTOSTimer::changePeriodFromISR(TickType_t newPeriod, BaseType_t *pxHigherPriorityTaskWoken) {
+   period = newPeriod / portTICK_PERIOD_MS;
+   periodPending = false;
+
+   return sendCommandFromISR(xTimerChangePeriodFromISR(timer, period, pxHigherPriorityTaskWoken));
 }
 
-void FreeRTOSTimer::stop() {
-   if (xTimerIsTimerActive(timer))
-      xTimerStop(timer, 0);
+bool FreeRTOSTimer::isActive() {
+   return xTimerIsTimerActive(timer) != pdFALSE;
 }
 
-void FreeRTOSTimer::reset() {
-   if (xTimerIsTimerActive(timer))
-      xTimerReset(timer, 0);
+FreeRTOSTimerStats FreeRTOSTimer::getStats() {
+   FreeRTOSTimerStats copy;
+
+   portENTER_CRITICAL(&statsMux);
+   copy = stats;
+   portEXIT_CRITICAL(&statsMux);
+
+   return copy;
 }
 
-void FreeRTOSTimer::changePeriod(TickType_t newPeriod) {
-   if (xTimerIsTimerActive(timer)) {
-      xTimerStop(timer, 0);
+FreeRTOSTimerStats FreeRTOSTimer::getGlobalStats() {
+   FreeRTOSTimerStats copy;
+
+   portENTER_CRITICAL(&statsMux);
+   copy = globalStats;
+   portEXIT_CRITICAL(&statsMux);
+
+   return copy;
+}
+
+template <typename Command>
+bool FreeRTOSTimer::sendCommand(Command command) {
+   if (timer == NULL) {
+      account(0, false);
+      return false;
+   }
+
+   // Dentro do próprio timer service não se pode bloquear esperando pela fila que ele consome
+   bool daemon = xTaskGetCurrentTaskHandle() == xTimerGetTimerDaemonTaskHandle();
+   TickType_t blockTime = daemon ? 0 : pdMS_TO_TICKS(TIMER_COMMAND_TIMEOUT);
+
+   uint32_t retries = 0;
+   bool success = command(blockTime) == pdPASS;
+
+   while (!success && retries < TIMER_COMMAND_RETRIES) {
+      retries++;
+      if (!daemon)
+         vTaskDelay(1);
+      success = command(blockTime) == pdPASS;
    }
-   xTimerChangePeriod(timer, newPeriod / portTICK_PERIOD_MS, portMAX_DELAY);
-}
\ No newline at end of file
+
+   account(retries, success);
+
+   return success;
+}
+
+bool FreeRTOSTimer::sendCommandFromISR(BaseType_t result) {
+   bool success = result == pdPASS;
+
+   account(0, success);
+
+   return success;
+}
+
+void FreeRTOSTimer::account(uint32_t retries, bool success) {
+   portENTER_CRITICAL_SAFE(&statsMux);
+   stats.commands++;
+   stats.retries += retries;
+   globalStats.commands++;
+   globalStats.retries += retries;
+   if (!success) {
+      stats.failures++;
+      globalStats.failures++;
+   }
+   portEXIT_CRITICAL_SAFE(&statsMux);
+}
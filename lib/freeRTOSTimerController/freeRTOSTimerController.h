@@ -4,22 +4,62 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/timers.h"
 
+#define TIMER_COMMAND_TIMEOUT 10  // Em ms, espera por espaço na fila do timer service
+#define TIMER_COMMAND_RETRIES 3
+
+struct FreeRTOSTimerStats {
+   uint32_t commands = 0;
+   uint32_t retries = 0;
+   uint32_t failures = 0;
+};
+
 class FreeRTOSTimer {
   public:
-   FreeRTOSTimer(const char *name, TickType_t period, UBaseType_t auto_reload, void *pvTimerID, TimerCallbackFunction_t callback);
+   // Sem buffer o timer usa o armazenamento estático do próprio objeto
+   FreeRTOSTimer(const char *name, TickType_t period, UBaseType_t auto_reload, void *pvTimerID, TimerCallbackFunction_t callback, StaticTimer_t *buffer = NULL);
 
    ~FreeRTOSTimer();
 
-   void start();
+   bool start();
+
+   bool stop();
+
+   bool reset();
+
+   bool changePeriod(TickType_t newPeriod);
+
+   bool startFromISR(BaseType_t *pxHigherPriorityTaskWoken);
+
+   bool stopFromISR(BaseType_t *pxHigherPriorityTaskWoken);
 
-   void stop();
+   bool resetFromISR(BaseType_t *pxHigherPriorityTaskWoken);
 
-   void reset();
+   bool changePeriodFromISR(TickType_t newPeriod, BaseType_t *pxHigherPriorityTaskWoken);
 
-   void changePeriod(TickType_t newPeriod);
+   bool isActive();
+
+   FreeRTOSTimerStats getStats();
+
+   static FreeRTOSTimerStats getGlobalStats();
 
   private:
    TimerHandle_t timer;
+   StaticTimer_t storage;
+
+   TickType_t period;
+   bool periodPending = false;
+
+   FreeRTOSTimerStats stats;
+
+   static FreeRTOSTimerStats globalStats;
+   static portMUX_TYPE statsMux;
+
+   template <typename Command>
+   bool sendCommand(Command command);
+
+   bool sendCommandFromISR(BaseType_t result);
+
+   void account(uint32_t retries, bool success);
 };
 
-#endif
\ No newline at end of file
+#endif
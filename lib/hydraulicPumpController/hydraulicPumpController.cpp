@@ -1,60 +1,306 @@
 #include "hydraulicPumpController.h"
 
 HydraulicPumpController::HydraulicPumpController(const char *pumperCode, uint8_t gpioPin, TickType_t pulseDuration)
-    : gpioPin(gpioPin),
-      jsonData(MAX_SIZE_DOCUMENT),
-      timer("PumpTimer", pulseDuration, pdFALSE, (void *)this, &HydraulicPumpController::pumpControlCallback) {
+    : gpioPin(gpioPin) {
    this->pumperCode = pumperCode;
    this->pulseDuration = pulseDuration;
+   scheduleMutex = xSemaphoreCreateMutex();
    pinMode(gpioPin, OUTPUT);
 
    // Caso o Esp32 reinicie enquanto um timer estiver ativo
    if (digitalRead(gpioPin) == HIGH)
       digitalWrite(gpioPin, LOW);
+
+   // O fim do pulso é tratado pelo esp_timer (timer de hardware de 64 bits) e não pelo timer service do FreeRTOS.
+   // A esp_timer task está acima de todas as tasks do firmware, o que mantém o atraso abaixo de 1 ms
+   // (test_pulse_timing); o despacho pela ISR exigiria um sdkconfig próprio e um callback sem o LEDC.
+   esp_timer_create_args_t timerArgs = {};
+   timerArgs.callback = &HydraulicPumpController::pumpControlCallback;
+   timerArgs.arg = (void *)this;
+   timerArgs.dispatch_method = ESP_TIMER_TASK;
+   timerArgs.name = "PumpTimer";
+
+   if (esp_timer_create(&timerArgs, &pulseTimer) != ESP_OK)
+      pulseTimer = NULL;
 }
 
 bool HydraulicPumpController::getPumpState() {
    return pumpState;
 }
 
-void HydraulicPumpController::startPump() {
+bool HydraulicPumpController::startPump() {
+   portENTER_CRITICAL(&mux);
+   if (pumpState) {
+      portEXIT_CRITICAL(&mux);
+      return true;
+   }
+
    pumpState = true;
-   digitalWrite(gpioPin, HIGH);
-   timer.start();
+   pulseOverridden = nextPulseDuration != 0;
+   pulseLength = (int64_t)(pulseOverridden ? nextPulseDuration : pulseDuration) * 1000;
+   nextPulseDuration = 0;
+   pulseStart = esp_timer_get_time();
+   portEXIT_CRITICAL(&mux);
+
+   setOutput(true);
+
+   // Sem o timer ativo nada desligaria a bomba, então a saída não pode ficar acionada
+   if (pulseTimer == NULL || esp_timer_start_once(pulseTimer, pulseLength) != ESP_OK) {
+      portENTER_CRITICAL(&mux);
+      pumpState = false;
+      stats.failures++;
+      portEXIT_CRITICAL(&mux);
+
+      setOutput(false);
+      return false;
+   }
+
+   return true;
 }
 
 void HydraulicPumpController::stopPump() {
-   timer.stop();
-   digitalWrite(gpioPin, LOW);
-   pumpState = false;
+   if (pulseTimer != NULL)
+      esp_timer_stop(pulseTimer);
+
+   finishPulse();
+}
+
+PulseStats HydraulicPumpController::getPulseStats() {
+   PulseStats copy;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
 }
 
+// Em ms, 0 com a bomba parada
+uint32_t HydraulicPumpController::getPulseRemaining() {
+   uint32_t remaining = 0;
+
+   portENTER_CRITICAL(&mux);
+   if (pumpState) {
+      int64_t left = pulseLength - (esp_timer_get_time() - pulseStart);
+      remaining = left > 0 ? left / 1000 : 0;
+   }
+   portEXIT_CRITICAL(&mux);
+
+   return remaining;
+}
+
+void HydraulicPumpController::finishPulse() {
+   bool finished = false;
+
+   portENTER_CRITICAL(&mux);
+   if (pumpState) {
+      pumpState = false;
+      finished = true;
+
+      // Compara a duração real do pulso com a solicitada
+      int64_t measured = esp_timer_get_time() - pulseStart;
+      int32_t error = measured - pulseLength;
+
+      stats.pulses++;
+      stats.lastRequested = pulseLength;
+      stats.lastMeasured = measured;
+      stats.lastError = error;
+      if ((uint32_t)abs(error) > stats.maxError)
+         stats.maxError = abs(error);
+   }
+   portEXIT_CRITICAL(&mux);
+
+   if (finished)
+      setOutput(false);
+}
+
+bool HydraulicPumpController::enableSoftStart(uint8_t channel, uint32_t rampUp, uint32_t rampDown, RampCurve curve) {
+   static bool fadeInstalled = false;
+
+   ledc_timer_config_t timerConfig = {};
+   timerConfig.speed_mode = LEDC_HIGH_SPEED_MODE;
+   timerConfig.duty_resolution = SOFT_START_RESOLUTION;
+   timerConfig.timer_num = LEDC_TIMER_0;
+   timerConfig.freq_hz = SOFT_START_FREQUENCY;
+   timerConfig.clk_cfg = LEDC_AUTO_CLK;
+
+   ledc_channel_config_t channelConfig = {};
+   channelConfig.gpio_num = gpioPin;
+   channelConfig.speed_mode = LEDC_HIGH_SPEED_MODE;
+   channelConfig.channel = (ledc_channel_t)channel;
+   channelConfig.timer_sel = LEDC_TIMER_0;
+   channelConfig.duty = 0;
+
+   if (ledc_timer_config(&timerConfig) != ESP_OK || ledc_channel_config(&channelConfig) != ESP_OK)
+      return false;
+
+   if (!fadeInstalled)
+      fadeInstalled = ledc_fade_func_install(0) == ESP_OK;
+
+   esp_timer_create_args_t timerArgs = {};
+   timerArgs.callback = &HydraulicPumpController::rampCallback;
+   timerArgs.arg = (void *)this;
+   timerArgs.dispatch_method = ESP_TIMER_TASK;
+   timerArgs.name = "RampTimer";
+
+   if (!fadeInstalled || esp_timer_create(&timerArgs, &rampTimer) != ESP_OK)
+      return false;
+
+   // Tabela da curva pré-calculada: cada segmento é percorrido pelo fade de hardware do LEDC
+   const uint32_t maxDuty = (1 << SOFT_START_RESOLUTION) - 1;
+
+   for (uint8_t step = 0; step <= SOFT_START_SEGMENTS; step++) {
+      float x = (float)step / SOFT_START_SEGMENTS;
+      float y = x;
+
+      if (curve == RAMP_EASE_IN)
+         y = x * x;
+      else if (curve == RAMP_S_CURVE)
+         y = x * x * (3 - 2 * x);
+
+      rampTable[step] = y * maxDuty;
+   }
+
+   ledcChannel = channel;
+   rampUpSegment = max(rampUp / SOFT_START_SEGMENTS, (uint32_t)1);
+   rampDownSegment = max(rampDown / SOFT_START_SEGMENTS, (uint32_t)1);
+   softStart = true;
+
+   return true;
+}
+
+bool HydraulicPumpController::getOutputState() {
+   if (softStart)
+      return ledc_get_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ledcChannel) > 0;
+
+   return pumpState;
+}
+
+void HydraulicPumpController::setOutput(bool state) {
+   if (!softStart) {
+      gpio_set_level((gpio_num_t)gpioPin, state);
+      return;
+   }
+
+   esp_timer_stop(rampTimer);
+
+   // Continua a rampa a partir do duty atual caso a anterior não tenha terminado
+   uint32_t duty = ledc_get_duty(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ledcChannel);
+   uint8_t step = 0;
+
+   while (step < SOFT_START_SEGMENTS && rampTable[step + 1] <= duty)
+      step++;
+
+   rampRising = state;
+   rampStep = state ? step : min((uint8_t)(step + 1), (uint8_t)SOFT_START_SEGMENTS);
+
+   stepRamp();
+}
+
+void HydraulicPumpController::stepRamp() {
+   bool done = rampRising ? rampStep >= SOFT_START_SEGMENTS : rampStep == 0;
+
+   if (done)
+      return;
+
+   rampStep += rampRising ? 1 : -1;
+   uint32_t segment = rampRising ? rampUpSegment : rampDownSegment;
+
+   ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ledcChannel, rampTable[rampStep], segment);
+   ledc_fade_start(LEDC_HIGH_SPEED_MODE, (ledc_channel_t)ledcChannel, LEDC_FADE_NO_WAIT);
+
+   esp_timer_start_once(rampTimer, (uint64_t)segment * 1000);
+}
+
+void HydraulicPumpController::rampCallback(void *arg) {
+   HydraulicPumpController *controller = (HydraulicPumpController *)arg;
+
+   controller->stepRamp();
+}
+
+// Horários do dia atual já compilados a partir das regras da agenda
 std::set<String> HydraulicPumpController::getDriveTimes() {
+   std::set<String> driveTimes;
+   char formatted[9];
+
+   xSemaphoreTake(scheduleMutex, portMAX_DELAY);
+   for (uint32_t second : schedule.getEvents()) {
+      DriveSchedule::formatTime(second, formatted);
+      driveTimes.insert(formatted);
+   }
+   xSemaphoreGive(scheduleMutex);
+
    return driveTimes;
 }
 
-std::set<String> *HydraulicPumpController::getDriveTimesPointer() {
-   return &driveTimes;
+DriveSchedule HydraulicPumpController::getSchedule() {
+   xSemaphoreTake(scheduleMutex, portMAX_DELAY);
+   DriveSchedule copy = schedule;
+   xSemaphoreGive(scheduleMutex);
+
+   return copy;
 }
 
-DynamicJsonDocument HydraulicPumpController::getJsonData() {
-   return jsonData;
+// Troca a agenda inteira de uma vez para que a task de acionamento nunca veja uma agenda parcial
+void HydraulicPumpController::setSchedule(DriveSchedule &newSchedule) {
+   xSemaphoreTake(scheduleMutex, portMAX_DELAY);
+   newSchedule.continueFrom(schedule);
+   std::swap(schedule, newSchedule);
+   xSemaphoreGive(scheduleMutex);
 }
 
-DynamicJsonDocument *HydraulicPumpController::getJsonDataPointer() {
-   return &jsonData;
+bool HydraulicPumpController::isDriveDue(uint32_t localEpoch, uint32_t *lateness, uint32_t *missed) {
+   xSemaphoreTake(scheduleMutex, portMAX_DELAY);
+   bool due = schedule.isDue(localEpoch, lateness, missed);
+   xSemaphoreGive(scheduleMutex);
+
+   return due;
 }
 
-void HydraulicPumpController::pumpControlCallback(TimerHandle_t xTimer) {
-   HydraulicPumpController *controller = (HydraulicPumpController *)pvTimerGetTimerID(xTimer);
+// Retorna -1 caso não exista nenhum horário de acionamento
+int32_t HydraulicPumpController::getSecondsToNextDrive(uint32_t localEpoch) {
+   xSemaphoreTake(scheduleMutex, portMAX_DELAY);
+   int32_t next = schedule.getSecondsToNext(localEpoch);
+   xSemaphoreGive(scheduleMutex);
 
-   controller->stopPump();
+   return next;
+}
+
+void HydraulicPumpController::pumpControlCallback(void *arg) {
+   HydraulicPumpController *controller = (HydraulicPumpController *)arg;
+
+   controller->finishPulse();
 }
 
 TickType_t HydraulicPumpController::getPulseDuration() {
    return pulseDuration;
 }
 
+// A nova duração vale imediatamente, inclusive para um pulso em andamento. Reaplicar o mesmo valor
+// (ex.: a cada atualização da configuração) não mexe no timer, e um pulso iniciado com a duração de
+// setNextPulseDuration (retomada após um reset, ajuste dos sensores) mantém a própria duração.
 void HydraulicPumpController::setPulseDuration(TickType_t newPulseDuration) {
+   portENTER_CRITICAL(&mux);
+   bool rearm = newPulseDuration != pulseDuration && pumpState && !pulseOverridden;
    pulseDuration = newPulseDuration;
+   portEXIT_CRITICAL(&mux);
+
+   if (!rearm || pulseTimer == NULL)
+      return;
+
+   esp_timer_stop(pulseTimer);
+
+   portENTER_CRITICAL(&mux);
+   pulseLength = (int64_t)newPulseDuration * 1000;
+   int64_t remaining = pulseStart + pulseLength - esp_timer_get_time();
+   portEXIT_CRITICAL(&mux);
+
+   if (remaining <= 0 || esp_timer_start_once(pulseTimer, remaining) != ESP_OK)
+      finishPulse();
+}
+
+void HydraulicPumpController::setNextPulseDuration(TickType_t newPulseDuration) {
+   portENTER_CRITICAL(&mux);
+   nextPulseDuration = newPulseDuration;
+   portEXIT_CRITICAL(&mux);
 }
@@ -2,47 +2,96 @@
 #define _PUMP_
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 
 #include <set>
 
-#include "freeRTOSTimerController.h"
+#include "driveSchedule.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define SOFT_START_SEGMENTS 8
+#define SOFT_START_RESOLUTION LEDC_TIMER_13_BIT
+#define SOFT_START_FREQUENCY 5000
+
+enum RampCurve : uint8_t {
+   RAMP_LINEAR = 0,
+   RAMP_EASE_IN = 1,
+   RAMP_S_CURVE = 2,
+};
 
-#define MAX_SIZE_DOCUMENT 4096
+struct PulseStats {
+   uint32_t pulses = 0;
+   uint32_t failures = 0;
+   uint32_t lastRequested = 0;  // Em us
+   uint32_t lastMeasured = 0;   // Em us
+   int32_t lastError = 0;       // Em us, medido - solicitado
+   uint32_t maxError = 0;       // Em us, em módulo
+};
 
 class HydraulicPumpController {
   public:
    const char *pumperCode;
    const uint8_t gpioPin;
 
-   TickType_t *pulseDurationPointer = &pulseDuration;
-
    HydraulicPumpController(const char *pumperCode, uint8_t gpioPin, TickType_t pulseDuration);
 
    bool getPumpState();
+   bool getOutputState();
 
-   void startPump();
+   bool startPump();
    void stopPump();
 
+   PulseStats getPulseStats();
+   uint32_t getPulseRemaining();
+
+   bool enableSoftStart(uint8_t channel, uint32_t rampUp, uint32_t rampDown, RampCurve curve = RAMP_S_CURVE);
+
    std::set<String> getDriveTimes();
-   std::set<String> *getDriveTimesPointer();
 
-   DynamicJsonDocument getJsonData();
-   DynamicJsonDocument *getJsonDataPointer();
+   DriveSchedule getSchedule();
+   void setSchedule(DriveSchedule &newSchedule);
+   bool isDriveDue(uint32_t localEpoch, uint32_t *lateness = NULL, uint32_t *missed = NULL);
+   int32_t getSecondsToNextDrive(uint32_t localEpoch);
 
    TickType_t getPulseDuration();
    void setPulseDuration(TickType_t);
+   void setNextPulseDuration(TickType_t);
 
   private:
-   std::set<String> driveTimes;
-   DynamicJsonDocument jsonData;
-   FreeRTOSTimer timer;
+   DriveSchedule schedule;
+   SemaphoreHandle_t scheduleMutex;
+
+   esp_timer_handle_t pulseTimer = NULL;
+   int64_t pulseStart = 0;   // Em us
+   int64_t pulseLength = 0;  // Em us
 
    TickType_t pulseDuration;
+   TickType_t nextPulseDuration = 0;  // Vale apenas para o próximo acionamento, 0 para usar pulseDuration
+   bool pulseOverridden = false;      // O pulso em andamento usa nextPulseDuration
 
    bool pumpState = false;
 
-   static void pumpControlCallback(TimerHandle_t xTimer);
+   PulseStats stats;
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+   bool softStart = false;
+   uint8_t ledcChannel = 0;
+   uint32_t rampUpSegment = 0;    // Em ms
+   uint32_t rampDownSegment = 0;  // Em ms
+   uint16_t rampTable[SOFT_START_SEGMENTS + 1];
+   uint8_t rampStep = 0;
+   bool rampRising = false;
+   esp_timer_handle_t rampTimer = NULL;
+
+   void finishPulse();
+   void setOutput(bool state);
+   void stepRamp();
+
+   static void pumpControlCallback(void *arg);
+   static void rampCallback(void *arg);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,129 @@
+#include "jsonPool.h"
+
+#include "memoryPlacement.h"
+
+uint8_t *JsonPool::large = NULL;
+uint8_t *JsonPool::small = NULL;
+uint32_t JsonPool::largeUsed = 0;
+uint32_t JsonPool::smallUsed = 0;
+JsonPoolStats JsonPool::stats;
+portMUX_TYPE JsonPool::mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Deve ser chamado no início do setup, enquanto o heap ainda é contíguo. Nas placas com
+// PSRAM os blocos ficam nela, já que os documentos são montados poucas vezes por minuto.
+bool JsonPool::begin() {
+   if (large == NULL)
+      large = (uint8_t *)MemoryPlacement::allocate(JSON_POOL_LARGE_SIZE * JSON_POOL_LARGE_BLOCKS, MEMORY_COLD);
+   if (small == NULL)
+      small = (uint8_t *)MemoryPlacement::allocate(JSON_POOL_SMALL_SIZE * JSON_POOL_SMALL_BLOCKS, MEMORY_COLD);
+
+   return large != NULL && small != NULL;
+}
+
+// O menor bloco que comporta o pedido; sem bloco livre o documento ainda é criado no heap
+void *JsonPool::allocate(size_t size) {
+   void *pointer = NULL;
+
+   portENTER_CRITICAL(&mux);
+   stats.allocations++;
+   if (size <= JSON_POOL_SMALL_SIZE)
+      pointer = take(small, smallUsed, JSON_POOL_SMALL_BLOCKS, JSON_POOL_SMALL_SIZE, stats.smallInUse, stats.maxSmallInUse);
+   if (pointer == NULL && size <= JSON_POOL_LARGE_SIZE)
+      pointer = take(large, largeUsed, JSON_POOL_LARGE_BLOCKS, JSON_POOL_LARGE_SIZE, stats.largeInUse, stats.maxLargeInUse);
+   if (pointer == NULL)
+      stats.fallbacks++;
+   portEXIT_CRITICAL(&mux);
+
+   if (pointer == NULL) {
+      pointer = MemoryPlacement::allocate(size, MEMORY_COLD);
+      if (pointer == NULL) {
+         portENTER_CRITICAL(&mux);
+         stats.failures++;
+         portEXIT_CRITICAL(&mux);
+      }
+   }
+
+   return pointer;
+}
+
+void JsonPool::deallocate(void *pointer) {
+   bool pooled;
+
+   if (pointer == NULL)
+      return;
+
+   portENTER_CRITICAL(&mux);
+   pooled = give(small, smallUsed, JSON_POOL_SMALL_BLOCKS, JSON_POOL_SMALL_SIZE, stats.smallInUse, pointer) ||
+            give(large, largeUsed, JSON_POOL_LARGE_BLOCKS, JSON_POOL_LARGE_SIZE, stats.largeInUse, pointer);
+   portEXIT_CRITICAL(&mux);
+
+   if (!pooled)
+      MemoryPlacement::release(pointer);
+}
+
+// Usado pelo shrinkToFit: dentro do bloco nada muda, fora dele o conteúdo é copiado. Os documentos
+// que não couberam no pool seguem na região em que foram alocados por allocate().
+void *JsonPool::reallocate(void *pointer, size_t size) {
+   size_t blockSize = getBlockSize(pointer);
+
+   if (blockSize == 0)
+      return MemoryPlacement::reallocate(pointer, size, MEMORY_COLD);
+
+   if (size <= blockSize)
+      return pointer;
+
+   void *resized = allocate(size);
+   if (resized != NULL) {
+      memcpy(resized, pointer, blockSize);
+      deallocate(pointer);
+   }
+
+   return resized;
+}
+
+JsonPoolStats JsonPool::getStats() {
+   portENTER_CRITICAL(&mux);
+   JsonPoolStats copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
+
+void *JsonPool::take(uint8_t *blocks, uint32_t &used, uint8_t count, size_t size, uint8_t &inUse, uint8_t &maxInUse) {
+   if (blocks == NULL)
+      return NULL;
+
+   for (uint8_t index = 0; index < count; index++) {
+      if (!(used & (1UL << index))) {
+         used |= 1UL << index;
+         inUse++;
+         maxInUse = max(maxInUse, inUse);
+         return blocks + index * size;
+      }
+   }
+
+   return NULL;
+}
+
+bool JsonPool::give(uint8_t *blocks, uint32_t &used, uint8_t count, size_t size, uint8_t &inUse, void *pointer) {
+   uint8_t *address = (uint8_t *)pointer;
+
+   if (blocks == NULL || address < blocks || address >= blocks + count * size)
+      return false;
+
+   used &= ~(1UL << ((address - blocks) / size));
+   inUse--;
+
+   return true;
+}
+
+size_t JsonPool::getBlockSize(void *pointer) {
+   uint8_t *address = (uint8_t *)pointer;
+
+   if (small != NULL && address >= small && address < small + JSON_POOL_SMALL_SIZE * JSON_POOL_SMALL_BLOCKS)
+      return JSON_POOL_SMALL_SIZE;
+   if (large != NULL && address >= large && address < large + JSON_POOL_LARGE_SIZE * JSON_POOL_LARGE_BLOCKS)
+      return JSON_POOL_LARGE_SIZE;
+
+   return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef _JSONPOOL_
+#define _JSONPOOL_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "freertos/FreeRTOS.h"
+
+// Blocos reservados no boot, antes que o heap fragmente. Os grandes atendem as configurações
+// e o /metrics, os pequenos os documentos curtos enviados a cada segundo.
+#define JSON_POOL_LARGE_SIZE 6144
+#define JSON_POOL_LARGE_BLOCKS 2
+#define JSON_POOL_SMALL_SIZE 1024
+#define JSON_POOL_SMALL_BLOCKS 4
+
+struct JsonPoolStats {
+   uint32_t allocations = 0;
+   uint32_t fallbacks = 0;  // Pedidos maiores que o bloco ou com o pool cheio, atendidos pelo heap
+   uint32_t failures = 0;
+   uint8_t largeInUse = 0;
+   uint8_t smallInUse = 0;
+   uint8_t maxLargeInUse = 0;
+   uint8_t maxSmallInUse = 0;
+};
+
+// Pool de blocos de tamanho fixo para os documentos do ArduinoJson: alocar e liberar um
+// documento não muda o heap, então ciclos de atualização ao longo de semanas não o fragmentam
+class JsonPool {
+  public:
+   static bool begin();
+
+   static void *allocate(size_t size);
+   static void deallocate(void *pointer);
+   static void *reallocate(void *pointer, size_t size);
+
+   static JsonPoolStats getStats();
+
+  private:
+   static uint8_t *large;
+   static uint8_t *small;
+   static uint32_t largeUsed;  // Um bit por bloco
+   static uint32_t smallUsed;
+
+   static JsonPoolStats stats;
+   static portMUX_TYPE mux;
+
+   static void *take(uint8_t *blocks, uint32_t &used, uint8_t count, size_t size, uint8_t &inUse, uint8_t &maxInUse);
+   static bool give(uint8_t *blocks, uint32_t &used, uint8_t count, size_t size, uint8_t &inUse, void *pointer);
+   static size_t getBlockSize(void *pointer);
+};
+
+static_assert(JSON_POOL_LARGE_BLOCKS <= 32 && JSON_POOL_SMALL_BLOCKS <= 32, "Cada grupo do pool usa uma máscara de 32 bits");
+
+struct JsonPoolAllocator {
+   void *allocate(size_t size) {
+      return JsonPool::allocate(size);
+   }
+
+   void deallocate(void *pointer) {
+      JsonPool::deallocate(pointer);
+   }
+
+   void *reallocate(void *pointer, size_t size) {
+      return JsonPool::reallocate(pointer, size);
+   }
+};
+
+typedef BasicJsonDocument<JsonPoolAllocator> PooledJsonDocument;
+
+#endif
@@ -0,0 +1,225 @@
+#include "jsonStreamParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void JsonStreamParser::begin(JsonStreamCallback callback, void *context) {
+   this->callback = callback;
+   this->context = context;
+   state = EXPECT_VALUE;
+   stringIsKey = false;
+   failed = false;
+   depth = 0;
+   tokenLength = 0;
+}
+
+// Retorna false no primeiro erro, a partir daí todos os pedaços seguintes são ignorados
+bool JsonStreamParser::feed(const uint8_t *data, size_t length) {
+   for (size_t index = 0; index < length && !failed; index++)
+      failed = !process((char)data[index]);
+
+   return !failed;
+}
+
+// Deve ser chamado após o último pedaço: confirma que o documento está completo
+bool JsonStreamParser::finish() {
+   if (!failed && state == IN_LITERAL)
+      failed = !endLiteral();
+
+   return !failed && state == DONE;
+}
+
+bool JsonStreamParser::isFailed() const {
+   return failed;
+}
+
+bool JsonStreamParser::process(char character) {
+   bool whitespace = character == ' ' || character == '\t' || character == '\r' || character == '\n';
+
+   switch (state) {
+      case EXPECT_VALUE:
+         return whitespace || startValue(character);
+
+      case EXPECT_VALUE_OR_END:
+         if (whitespace)
+            return true;
+         return character == ']' ? endContainer(character) : startValue(character);
+
+      case EXPECT_KEY:
+      case EXPECT_KEY_OR_END:
+         if (whitespace)
+            return true;
+         if (character == '}' && state == EXPECT_KEY_OR_END)
+            return endContainer(character);
+         if (character != '"')
+            return false;
+
+         stringIsKey = true;
+         tokenLength = 0;
+         state = IN_STRING;
+         return true;
+
+      case EXPECT_COLON:
+         if (whitespace)
+            return true;
+         if (character != ':')
+            return false;
+
+         state = EXPECT_VALUE;
+         return true;
+
+      case EXPECT_COMMA_OR_END:
+         if (whitespace)
+            return true;
+         if (character == '}' || character == ']')
+            return endContainer(character);
+         if (character != ',')
+            return false;
+
+         state = stack[depth - 1] == '{' ? EXPECT_KEY : EXPECT_VALUE;
+         return true;
+
+      case IN_STRING:
+         if (character == '\\') {
+            state = IN_ESCAPE;
+            return true;
+         }
+         if (character != '"')
+            return (uint8_t)character >= 0x20 && append(character);
+
+         token[tokenLength] = '\0';
+
+         if (stringIsKey) {
+            memcpy(keys[depth - 1], token, tokenLength + 1);
+            state = EXPECT_COLON;
+            return true;
+         }
+
+         if (!emit(JSON_STREAM_STRING, token))
+            return false;
+         afterValue();
+         return true;
+
+      case IN_ESCAPE:
+         state = IN_STRING;
+
+         // \u não é suportado: as chaves e valores esperados são ASCII
+         switch (character) {
+            case '"':
+            case '\\':
+            case '/':
+               return append(character);
+            case 'n':
+               return append('\n');
+            case 't':
+               return append('\t');
+            case 'r':
+               return append('\r');
+            default:
+               return false;
+         }
+
+      case IN_LITERAL:
+         if ((character >= '0' && character <= '9') || (character >= 'a' && character <= 'z') || character == '.' || character == '-' || character == '+' || character == 'E')
+            return append(character);
+
+         // O caractere que encerrou o literal pertence ao próximo estado
+         return endLiteral() && process(character);
+
+      case DONE:
+         return whitespace;
+   }
+
+   return false;
+}
+
+bool JsonStreamParser::startValue(char character) {
+   if (character == '{' || character == '[') {
+      if (depth >= JSON_STREAM_MAX_DEPTH)
+         return false;
+
+      const char *key = currentKey();
+      stack[depth++] = character;
+      keys[depth - 1][0] = '\0';
+      state = character == '{' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+
+      return callback(context, character == '{' ? JSON_STREAM_OBJECT_START : JSON_STREAM_ARRAY_START, key, NULL, depth);
+   }
+
+   tokenLength = 0;
+
+   if (character == '"') {
+      stringIsKey = false;
+      state = IN_STRING;
+      return true;
+   }
+
+   if (character == '-' || (character >= '0' && character <= '9') || character == 't' || character == 'f' || character == 'n') {
+      state = IN_LITERAL;
+      return append(character);
+   }
+
+   return false;
+}
+
+bool JsonStreamParser::endContainer(char character) {
+   if (depth == 0 || stack[depth - 1] != (character == '}' ? '{' : '['))
+      return false;
+
+   depth--;
+
+   if (!callback(context, character == '}' ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END, currentKey(), NULL, depth))
+      return false;
+
+   afterValue();
+   return true;
+}
+
+bool JsonStreamParser::endLiteral() {
+   token[tokenLength] = '\0';
+
+   JsonStreamEvent event;
+
+   if (strcmp(token, "true") == 0 || strcmp(token, "false") == 0) {
+      event = JSON_STREAM_BOOLEAN;
+   } else if (strcmp(token, "null") == 0) {
+      event = JSON_STREAM_NULL;
+   } else {
+      char *end;
+      strtod(token, &end);
+      if (end == token || *end != '\0')
+         return false;
+      event = JSON_STREAM_NUMBER;
+   }
+
+   if (!emit(event, token))
+      return false;
+
+   afterValue();
+   return true;
+}
+
+bool JsonStreamParser::append(char character) {
+   if (tokenLength >= JSON_STREAM_MAX_TOKEN - 1)
+      return false;
+
+   token[tokenLength++] = character;
+   return true;
+}
+
+bool JsonStreamParser::emit(JsonStreamEvent event, const char *value) {
+   return callback(context, event, currentKey(), value, depth);
+}
+
+void JsonStreamParser::afterValue() {
+   state = depth == 0 ? DONE : EXPECT_COMMA_OR_END;
+}
+
+// Dentro de objetos é a chave do membro atual, dentro de arrays a chave do próprio array
+const char *JsonStreamParser::currentKey() const {
+   for (uint8_t level = depth; level > 0; level--)
+      if (stack[level - 1] == '{')
+         return keys[level - 1];
+
+   return "";
+}
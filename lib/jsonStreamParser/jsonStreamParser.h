@@ -0,0 +1,76 @@
+#ifndef _JSONSTREAMPARSER_
+#define _JSONSTREAMPARSER_
+
+// Sem dependências do Arduino para que o parser também compile no host
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_STREAM_MAX_DEPTH 5
+#define JSON_STREAM_MAX_TOKEN 32  // Maior chave ou valor aceito, incluindo o terminador
+
+enum JsonStreamEvent : uint8_t {
+   JSON_STREAM_OBJECT_START = 0,
+   JSON_STREAM_OBJECT_END = 1,
+   JSON_STREAM_ARRAY_START = 2,
+   JSON_STREAM_ARRAY_END = 3,
+   JSON_STREAM_STRING = 4,
+   JSON_STREAM_NUMBER = 5,
+   JSON_STREAM_BOOLEAN = 6,
+   JSON_STREAM_NULL = 7,
+};
+
+// key é a chave do membro (ou do array que contém o elemento), depth o número de containers abertos.
+// Retornar false interrompe o parse.
+typedef bool (*JsonStreamCallback)(void *context, JsonStreamEvent event, const char *key, const char *value, uint8_t depth);
+
+// Parser JSON incremental: recebe o documento em pedaços de qualquer tamanho e emite eventos
+// sem montar o documento em memória, usando apenas buffers de tamanho fixo
+class JsonStreamParser {
+  public:
+   void begin(JsonStreamCallback callback, void *context);
+
+   bool feed(const uint8_t *data, size_t length);
+
+   bool finish();
+
+   bool isFailed() const;
+
+  private:
+   enum State : uint8_t {
+      EXPECT_VALUE,
+      EXPECT_VALUE_OR_END,
+      EXPECT_KEY,
+      EXPECT_KEY_OR_END,
+      EXPECT_COLON,
+      EXPECT_COMMA_OR_END,
+      IN_STRING,
+      IN_ESCAPE,
+      IN_LITERAL,
+      DONE,
+   };
+
+   JsonStreamCallback callback = NULL;
+   void *context = NULL;
+
+   State state = EXPECT_VALUE;
+   bool stringIsKey = false;
+   bool failed = false;
+
+   char stack[JSON_STREAM_MAX_DEPTH];
+   char keys[JSON_STREAM_MAX_DEPTH][JSON_STREAM_MAX_TOKEN];
+   uint8_t depth = 0;
+
+   char token[JSON_STREAM_MAX_TOKEN];
+   uint8_t tokenLength = 0;
+
+   bool process(char character);
+   bool startValue(char character);
+   bool endContainer(char character);
+   bool endLiteral();
+   bool append(char character);
+   bool emit(JsonStreamEvent event, const char *value);
+   void afterValue();
+   const char *currentKey() const;
+};
+
+#endif
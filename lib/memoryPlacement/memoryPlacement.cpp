@@ -0,0 +1,94 @@
+#include "memoryPlacement.h"
+
+PlacementStats MemoryPlacement::stats;
+portMUX_TYPE MemoryPlacement::mux = portMUX_INITIALIZER_UNLOCKED;
+
+void *MemoryPlacement::allocate(size_t size, MemoryClass memoryClass) {
+   MemoryRegion region = REGION_INTERNAL;
+   bool fallback = false;
+   void *pointer = NULL;
+
+   if (memoryClass == MEMORY_COLD && hasPsram()) {
+      pointer = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+      region = REGION_PSRAM;
+      fallback = pointer == NULL;
+   }
+
+   if (pointer == NULL) {
+      uint32_t caps = memoryClass == MEMORY_DMA ? MALLOC_CAP_DMA | MALLOC_CAP_8BIT : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+      pointer = heap_caps_malloc(size, caps);
+      region = REGION_INTERNAL;
+   }
+
+   portENTER_CRITICAL(&mux);
+   stats.allocations++;
+   if (fallback)
+      stats.fallbacks++;
+   if (pointer != NULL)
+      stats.placed[region] += size;
+   else
+      stats.failures++;
+   portEXIT_CRITICAL(&mux);
+
+   return pointer;
+}
+
+// Como o realloc, mas na região da classe: o bloco pode mudar de região e, sem espaço, o original
+// continua válido
+void *MemoryPlacement::reallocate(void *pointer, size_t size, MemoryClass memoryClass) {
+   MemoryRegion region = REGION_INTERNAL;
+   void *resized = NULL;
+
+   if (pointer == NULL)
+      return allocate(size, memoryClass);
+
+   if (memoryClass == MEMORY_COLD && hasPsram()) {
+      resized = heap_caps_realloc(pointer, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+      region = REGION_PSRAM;
+   }
+
+   if (resized == NULL) {
+      uint32_t caps = memoryClass == MEMORY_DMA ? MALLOC_CAP_DMA | MALLOC_CAP_8BIT : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+      resized = heap_caps_realloc(pointer, size, caps);
+      region = REGION_INTERNAL;
+   }
+
+   portENTER_CRITICAL(&mux);
+   stats.allocations++;
+   if (resized != NULL)
+      stats.placed[region] += size;
+   else
+      stats.failures++;
+   portEXIT_CRITICAL(&mux);
+
+   return resized;
+}
+
+void MemoryPlacement::release(void *pointer) {
+   heap_caps_free(pointer);
+}
+
+// Placas sem PSRAM, ou com PSRAM que falhou na inicialização, não têm essa região no heap
+bool MemoryPlacement::hasPsram() {
+   return heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+}
+
+RegionInfo MemoryPlacement::getRegion(MemoryRegion region) {
+   uint32_t caps = region == REGION_PSRAM ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+   RegionInfo info;
+
+   info.total = heap_caps_get_total_size(caps);
+   info.free = heap_caps_get_free_size(caps);
+   info.minFree = heap_caps_get_minimum_free_size(caps);
+   info.largestBlock = heap_caps_get_largest_free_block(caps);
+
+   return info;
+}
+
+PlacementStats MemoryPlacement::getStats() {
+   portENTER_CRITICAL(&mux);
+   PlacementStats copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
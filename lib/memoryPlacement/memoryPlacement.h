@@ -0,0 +1,67 @@
+#ifndef _MEMORYPLACEMENT_
+#define _MEMORYPLACEMENT_
+
+#include <Arduino.h>
+
+#include <new>
+
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+enum MemoryClass : uint8_t {
+   MEMORY_HOT = 0,   // Acessado por timers e ISRs ou a cada tick: sempre na RAM interna
+   MEMORY_DMA = 1,   // Lido por periféricos: RAM interna com capacidade de DMA
+   MEMORY_COLD = 2,  // Grande e acessado poucas vezes: PSRAM quando existir
+};
+
+enum MemoryRegion : uint8_t {
+   REGION_INTERNAL = 0,
+   REGION_PSRAM = 1,
+   REGION_COUNT = 2,
+};
+
+struct RegionInfo {
+   size_t total = 0;
+   size_t free = 0;
+   size_t minFree = 0;
+   size_t largestBlock = 0;
+};
+
+struct PlacementStats {
+   uint32_t placed[REGION_COUNT] = {};  // Bytes colocados por esta camada em cada região
+   uint32_t allocations = 0;
+   uint32_t fallbacks = 0;  // Pedidos MEMORY_COLD atendidos pela RAM interna
+   uint32_t failures = 0;
+};
+
+// Decide em qual região cada buffer fica, liberando a RAM interna para o WiFi e o TLS nas
+// placas com PSRAM (WROVER). Sem PSRAM tudo vai para a RAM interna, sem mudar o comportamento.
+// A memória é redimensionada com reallocate() e liberada com release() ou free().
+class MemoryPlacement {
+  public:
+   static void *allocate(size_t size, MemoryClass memoryClass);
+   static void *reallocate(void *pointer, size_t size, MemoryClass memoryClass);
+   static void release(void *pointer);
+
+   template <typename T>
+   static T *construct(size_t count, MemoryClass memoryClass) {
+      T *objects = (T *)allocate(count * sizeof(T), memoryClass);
+
+      for (size_t index = 0; objects != NULL && index < count; index++)
+         new (&objects[index]) T();
+
+      return objects;
+   }
+
+   static bool hasPsram();
+
+   static RegionInfo getRegion(MemoryRegion region);
+
+   static PlacementStats getStats();
+
+  private:
+   static PlacementStats stats;
+   static portMUX_TYPE mux;
+};
+
+#endif
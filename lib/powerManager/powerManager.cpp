@@ -0,0 +1,99 @@
+#include "powerManager.h"
+
+PowerManager::PowerManager(bool lowPower, uint32_t maxSleep) {
+   config.lowPower = lowPower;
+   config.maxSleep = maxSleep;
+}
+
+// Fora do modo de baixo consumo o WiFi e a CPU ficam no padrão do core
+void PowerManager::begin(AsyncLogger &logger) {
+   if (!config.lowPower)
+      return;
+
+   WiFi.setSleep(WIFI_PS_MAX_MODEM);
+
+#if CONFIG_PM_ENABLE
+   esp_pm_config_esp32_t pmConfig = {};
+   pmConfig.max_freq_mhz = config.maxFrequency;
+   pmConfig.min_freq_mhz = config.minFrequency;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+   pmConfig.light_sleep_enable = true;
+#endif
+
+   esp_err_t err = esp_pm_configure(&pmConfig);
+   if (err != ESP_OK)
+      logger.log(LOG_SYSTEM, LOG_ERROR, "Failed configuring power management: %d", err);
+
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+   stats.lightSleep = err == ESP_OK;
+#endif
+#else
+   // Sem o gerenciador de energia do IDF a única escala possível é a frequência fixa
+   setCpuFrequencyMhz(config.minFrequency);
+   logger.log(LOG_SYSTEM, LOG_WARN, "Power management disabled in sdkconfig, no light sleep: modem sleep and %d MHz CPU only",
+              config.minFrequency);
+#endif
+
+   stats.cpuFrequency = getCpuFrequencyMhz();
+}
+
+// Chamado pela task das bombas ao acordar, fecha o período bloqueado medido desde o último recordDelay()
+void PowerManager::recordWake() {
+   int64_t now = esp_timer_get_time();
+
+   portENTER_CRITICAL(&mux);
+   if (asleepSince >= 0)
+      stats.asleepTime += now - asleepSince;
+   asleepSince = -1;
+   awakeSince = now;
+   portEXIT_CRITICAL(&mux);
+}
+
+// Chamado pela task das bombas antes de bloquear. Contabiliza o tempo acordada medido e os
+// períodos pedidos em que ela fica bloqueada além da verificação fina.
+void PowerManager::recordDelay(uint32_t taskDelay, uint32_t pollDelay) {
+   int64_t now = esp_timer_get_time();
+
+   portENTER_CRITICAL(&mux);
+   if (awakeSince >= 0)
+      stats.awakeTime += now - awakeSince;
+   awakeSince = -1;
+   asleepSince = now;
+
+   uint64_t total = stats.awakeTime + stats.asleepTime;
+   if (total > 0)
+      stats.dutyCycle = stats.awakeTime * 1000 / total;
+
+   if (taskDelay > pollDelay) {
+      stats.blockedTime += taskDelay;
+      stats.wakeups++;
+   } else {
+      stats.pollingTime += taskDelay;
+   }
+   portEXIT_CRITICAL(&mux);
+}
+
+void PowerManager::recordPumpStart(uint64_t expectedWake) {
+   int64_t now = esp_timer_get_time();
+   uint32_t latency = now > (int64_t)expectedWake ? now - expectedWake : 0;
+
+   portENTER_CRITICAL(&mux);
+   stats.lastWakeLatency = latency;
+   if (latency > stats.maxWakeLatency)
+      stats.maxWakeLatency = latency;
+   portEXIT_CRITICAL(&mux);
+}
+
+bool PowerManager::isLowPower() {
+   return config.lowPower;
+}
+
+PowerStats PowerManager::getStats() {
+   PowerStats copy;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
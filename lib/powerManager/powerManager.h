@@ -0,0 +1,63 @@
+#ifndef _POWERMANAGER_
+#define _POWERMANAGER_
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "asyncLogger.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+struct PowerConfig {
+   bool lowPower = false;
+   uint32_t maxSleep = 60000;  // Em ms, limita o tempo sem checar o horário (responsividade)
+   int maxFrequency = 240;     // Em MHz
+   int minFrequency = 80;      // Em MHz, o mínimo que mantém o WiFi
+};
+
+struct PowerStats {
+   bool lightSleep = false;    // Light sleep automático configurado (exige um sdkconfig com CONFIG_PM_ENABLE)
+   uint32_t cpuFrequency = 0;  // Em MHz, máxima quando a frequência é dinâmica
+   uint64_t pollingTime = 0;   // Em ms, a task das bombas esperando na verificação fina
+   uint64_t blockedTime = 0;   // Em ms, a task das bombas bloqueada até o próximo horário
+   uint32_t wakeups = 0;
+   uint64_t awakeTime = 0;     // Em us, medido: a task das bombas rodando entre acordar e bloquear
+   uint64_t asleepTime = 0;    // Em us, medido: a task das bombas bloqueada
+   uint16_t dutyCycle = 0;     // Em milésimos, awakeTime sobre o tempo total medido
+   uint32_t lastWakeLatency = 0;  // Em us
+   uint32_t maxWakeLatency = 0;   // Em us
+};
+
+// Modo de baixo consumo: modem sleep no WiFi e a task das bombas bloqueada até o próximo horário.
+// O light sleep automático no idle tickless e a escala dinâmica de frequência só existem com
+// CONFIG_PM_ENABLE e CONFIG_FREERTOS_USE_TICKLESS_IDLE, desligados no core Arduino pré-compilado:
+// nesse caso a CPU fica fixa em minFrequency e lightSleep permanece false. Os tempos registrados
+// são da task, não medições do consumo: o ciclo de trabalho medido (dutyCycle) é a fração do
+// tempo em que a task das bombas fica acordada.
+class PowerManager {
+  public:
+   PowerManager(bool lowPower, uint32_t maxSleep);
+
+   void begin(AsyncLogger &logger);
+
+   void recordWake();
+   void recordDelay(uint32_t taskDelay, uint32_t pollDelay);
+
+   void recordPumpStart(uint64_t expectedWake);
+
+   bool isLowPower();
+
+   PowerStats getStats();
+
+  private:
+   PowerConfig config;
+   PowerStats stats;
+
+   int64_t awakeSince = -1;  // Em us, -1 com a task bloqueada
+   int64_t asleepSince = -1;
+
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif
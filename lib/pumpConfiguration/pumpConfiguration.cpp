@@ -0,0 +1,135 @@
+#include "pumpConfiguration.h"
+
+// Localização usada quando o documento não traz latitude e longitude
+PumpConfiguration::PumpConfiguration(float latitude, float longitude, int32_t utcOffset)
+    : latitude(latitude),
+      longitude(longitude),
+      utcOffset(utcOffset) {
+}
+
+// Monta a agenda do documento e a compila para o dia de localEpoch. A compilação acontece aqui e
+// na virada do dia, nunca no tick de acionamento.
+void PumpConfiguration::read(JsonVariantConst document, uint32_t localEpoch) {
+   schedule.clear();
+   schedule.setLocation(document["latitude"] | latitude, document["longitude"] | longitude, utcOffset);
+   ignoredRules = 0;
+
+   // Formato original: lista de horários fixos
+   for (JsonObjectConst object : document["driveTimes"].as<JsonArrayConst>()) {
+      ScheduleRule rule;
+      rule.start = DriveSchedule::parseTime(object["time"]);
+
+      if (object["state"] && rule.start >= 0)
+         schedule.addRule(rule);
+   }
+
+   ScheduleRuleBuilder builder;
+
+   for (JsonObjectConst object : document["rules"].as<JsonArrayConst>()) {
+      ScheduleRule rule;
+      bool valid = readRule(object, builder);
+
+      if (!builder.isEnabled())
+         continue;
+
+      if (!valid || !builder.build(rule) || !schedule.addRule(rule))
+         ignoredRules++;
+   }
+
+   schedule.compile(localEpoch);
+   ruleCount = schedule.getRuleCount();
+   truncated = schedule.isTruncated();
+
+   // Ausente, inválido ou 0: como na API local, não é uma duração de pulso
+   pulseDuration = document["pulseDuration"] | (uint32_t)0;
+}
+
+// Troca a agenda da bomba pela lida. Sem pulseDuration no documento a bomba mantém a duração em
+// uso; setPulseDuration reprograma o timer caso ela esteja acionada.
+void PumpConfiguration::apply(HydraulicPumpController &pump) {
+   pump.setSchedule(schedule);
+
+   if (pulseDuration > 0)
+      pump.setPulseDuration(pulseDuration);
+}
+
+size_t PumpConfiguration::getRuleCount() const {
+   return ruleCount;
+}
+
+// Regras inválidas ou recusadas pela agenda cheia
+size_t PumpConfiguration::getIgnoredRules() const {
+   return ignoredRules;
+}
+
+bool PumpConfiguration::isTruncated() const {
+   return truncated;
+}
+
+uint32_t PumpConfiguration::getPulseDuration() const {
+   return pulseDuration;
+}
+
+// Campos do documento lidos por read(), usados como filtro do ArduinoJson
+void PumpConfiguration::setFields(JsonObject fields) {
+   fields["pulseDuration"] = true;
+   fields["driveTimes"] = true;
+   fields["rules"] = true;
+   fields["latitude"] = true;
+   fields["longitude"] = true;
+}
+
+// Regras no formato {"days": "weekdays", "from": "06:00", "to": "18:00", "every": 900}
+// ou {"anchor": "sunrise", "offset": 1800}, com os mesmos campos aceitos pela API local
+bool PumpConfiguration::readRule(JsonObjectConst object, ScheduleRuleBuilder &builder) {
+   builder.reset();
+
+   for (JsonPairConst pair : object) {
+      const char *key = pair.key().c_str();
+      JsonVariantConst value = pair.value();
+      bool valid = true;
+
+      if (value.is<JsonArrayConst>()) {
+         builder.clearDays();
+         for (JsonVariantConst day : value.as<JsonArrayConst>())
+            valid = valid && builder.addDay(day.as<const char *>());
+      } else if (value.is<const char *>()) {
+         valid = builder.setText(key, value.as<const char *>());
+      } else if (value.is<bool>()) {
+         valid = builder.setFlag(key, value.as<bool>());
+      } else if (value.is<long>()) {
+         valid = builder.setNumber(key, value.as<long>());
+      }
+
+      if (!valid)
+         return false;
+   }
+
+   return true;
+}
+
+// Escreve a regra no formato lido por readRule
+void PumpConfiguration::writeRule(const ScheduleRule &rule, JsonObject object) {
+   char time[9];
+
+   if ((rule.weekdays & SCHEDULE_EVERY_DAY) != SCHEDULE_EVERY_DAY) {
+      JsonArray days = object.createNestedArray("days");
+      for (uint8_t weekday = 0; weekday < 7; weekday++)
+         if (rule.weekdays & (1 << weekday))
+            days.add(DriveSchedule::formatWeekday(weekday));
+   }
+
+   if (rule.anchor == ANCHOR_CLOCK) {
+      DriveSchedule::formatTime(rule.start, time);
+      object[rule.interval > 0 ? "from" : "at"] = time;
+   } else {
+      object["anchor"] = rule.anchor == ANCHOR_SUNRISE ? "sunrise" : "sunset";
+      object["offset"] = rule.start;
+   }
+
+   if (rule.interval > 0) {
+      DriveSchedule::formatTime(rule.end, time);
+      object["every"] = rule.interval;
+      object["to"] = time;
+   }
+}
@@ -0,0 +1,41 @@
+#ifndef _PUMPCONFIGURATION_
+#define _PUMPCONFIGURATION_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "driveSchedule.h"
+#include "hydraulicPumpController.h"
+
+// Configuração de uma bomba no formato do documento do MongoDB Atlas e do cache local do site:
+// {"pulseDuration": 60000, "driveTimes": [...], "rules": [...], "latitude": ..., "longitude": ...}
+class PumpConfiguration {
+  public:
+   PumpConfiguration(float latitude, float longitude, int32_t utcOffset);
+
+   void read(JsonVariantConst document, uint32_t localEpoch);
+
+   void apply(HydraulicPumpController &pump);
+
+   size_t getRuleCount() const;
+   size_t getIgnoredRules() const;
+   bool isTruncated() const;
+   uint32_t getPulseDuration() const;
+
+   static void setFields(JsonObject fields);
+   static bool readRule(JsonObjectConst object, ScheduleRuleBuilder &builder);
+   static void writeRule(const ScheduleRule &rule, JsonObject object);
+
+  private:
+   const float latitude;
+   const float longitude;
+   const int32_t utcOffset;
+
+   DriveSchedule schedule;
+   size_t ruleCount = 0;
+   size_t ignoredRules = 0;
+   bool truncated = false;
+   uint32_t pulseDuration = 0;  // Em ms, 0 quando o documento não traz a duração
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "pumpJournal.h"
+
+#include <sys/time.h>
+
+RTC_NOINIT_ATTR static PumpJournalState journal;
+
+PumpJournal::PumpJournal(size_t count, uint32_t minResume)
+    : count(min(count, (size_t)PUMP_JOURNAL_MAX_PUMPS)),
+      minResume(minResume) {
+   memset(&previous, 0, sizeof(previous));
+}
+
+// Com recover falso (ex.: power-on), o conteúdo da memória RTC é descartado sem ser avaliado
+bool PumpJournal::begin(bool recover) {
+   bool valid = recover && journal.magic == PUMP_JOURNAL_MAGIC && journal.checksum == checksum(&journal, offsetof(PumpJournalState, checksum));
+
+   if (valid) {
+      previous = journal;
+
+      // Um reset no meio de uma escrita invalida apenas a bomba afetada
+      for (size_t index = 0; index < count; index++) {
+         if (!isSealed(previous.pumps[index])) {
+            memset(&previous.pumps[index], 0, sizeof(PumpJournalEntry));
+            stats.discarded++;
+         }
+      }
+   }
+
+   memset(&journal, 0, sizeof(journal));
+   journal.magic = PUMP_JOURNAL_MAGIC;
+
+   // Preserva o último acionamento para que o próximo reset ainda saiba o que já foi executado
+   for (size_t index = 0; index < count; index++) {
+      journal.pumps[index].lastStart = previous.pumps[index].lastStart;
+      seal(journal.pumps[index]);
+   }
+   sealHeader(journal);
+
+   stats.recovered = valid;
+   return valid;
+}
+
+void PumpJournal::recordStart(size_t index, uint32_t pulseLength, uint32_t localEpoch) {
+   if (index >= count)
+      return;
+
+   uint64_t start = now();
+
+   portENTER_CRITICAL(&mux);
+   PumpJournalEntry &entry = journal.pumps[index];
+   entry.pulseStart = start;
+   entry.pulseLength = pulseLength;
+   entry.lastStart = localEpoch;
+   seal(entry);
+   stats.writes++;
+   portEXIT_CRITICAL(&mux);
+}
+
+// O fim natural do pulso não precisa ser registrado: o tempo restante é calculado pelo relógio
+void PumpJournal::recordStop(size_t index) {
+   if (index >= count)
+      return;
+
+   portENTER_CRITICAL(&mux);
+   journal.pumps[index].pulseLength = 0;
+   seal(journal.pumps[index]);
+   stats.writes++;
+   portEXIT_CRITICAL(&mux);
+}
+
+void PumpJournal::recordAlive(uint32_t localEpoch) {
+   portENTER_CRITICAL(&mux);
+   journal.lastSeen = localEpoch;
+   sealHeader(journal);
+   stats.writes++;
+   portEXIT_CRITICAL(&mux);
+}
+
+// Em ms, o tempo que faltava ao pulso interrompido pelo reset. Retorna 0 caso o pulso já tenha
+// terminado ou o restante seja menor que minResume. Vale uma única vez por bomba.
+uint32_t PumpJournal::takeResumePulse(size_t index) {
+   if (index >= count || resumed[index])
+      return 0;
+
+   const PumpJournalEntry &entry = previous.pumps[index];
+   uint64_t clock = now();
+
+   if (entry.pulseLength == 0 || clock < entry.pulseStart)
+      return 0;
+
+   uint64_t elapsed = (clock - entry.pulseStart) / 1000;
+   if (elapsed >= entry.pulseLength || entry.pulseLength - elapsed < minResume)
+      return 0;
+
+   uint32_t remaining = entry.pulseLength - elapsed;
+
+   resumed[index] = true;
+   stats.resumed++;
+   stats.resumedTime += remaining;
+
+   return remaining;
+}
+
+// Início da janela em que horários perdidos devem ser compensados, 0 quando não há o que compensar.
+// A janela começa na última passagem da task antes do reset, mas nunca antes do último acionamento
+// registrado nem mais de window segundos antes de localEpoch.
+uint32_t PumpJournal::getCatchUpStart(size_t index, uint32_t localEpoch, uint32_t window) {
+   if (index >= count || resumed[index] || previous.lastSeen == 0 || previous.lastSeen >= localEpoch)
+      return 0;
+
+   uint32_t start = previous.lastSeen + 1;
+
+   if (previous.pumps[index].lastStart >= start)
+      start = previous.pumps[index].lastStart + 1;
+
+   if (localEpoch > window && start < localEpoch - window)
+      start = localEpoch - window;
+
+   return start <= localEpoch ? start : 0;
+}
+
+void PumpJournal::recordCatchUp() {
+   portENTER_CRITICAL(&mux);
+   stats.caughtUp++;
+   portEXIT_CRITICAL(&mux);
+}
+
+PumpJournalStats PumpJournal::getStats() {
+   PumpJournalStats copy;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
+
+// O relógio do sistema é derivado do timer RTC, que não é zerado por resets da CPU
+uint64_t PumpJournal::now() {
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+
+   return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// FNV-1a
+uint32_t PumpJournal::checksum(const void *data, size_t length) {
+   const uint8_t *bytes = (const uint8_t *)data;
+   uint32_t hash = 2166136261;
+
+   for (size_t index = 0; index < length; index++) {
+      hash ^= bytes[index];
+      hash *= 16777619;
+   }
+
+   return hash;
+}
+
+void PumpJournal::seal(PumpJournalEntry &entry) {
+   entry.checksum = checksum(&entry, offsetof(PumpJournalEntry, checksum));
+}
+
+bool PumpJournal::isSealed(const PumpJournalEntry &entry) {
+   return entry.checksum == checksum(&entry, offsetof(PumpJournalEntry, checksum));
+}
+
+void PumpJournal::sealHeader(PumpJournalState &state) {
+   state.checksum = checksum(&state, offsetof(PumpJournalState, checksum));
+}
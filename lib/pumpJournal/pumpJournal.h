@@ -0,0 +1,79 @@
+#ifndef _PUMPJOURNAL_
+#define _PUMPJOURNAL_
+
+#include <Arduino.h>
+
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+
+#define PUMP_JOURNAL_MAGIC 0x504A524E
+#define PUMP_JOURNAL_MAX_PUMPS 8
+
+enum CatchUpPolicy : uint8_t {
+   CATCH_UP_NONE = 0,  // Horários perdidos durante o reset são descartados
+   CATCH_UP_ONCE = 1,  // Um único acionamento, mesmo que vários horários tenham sido perdidos
+};
+
+struct PumpJournalEntry {
+   uint64_t pulseStart;   // Em us do relógio do sistema, que continua contando após um reset
+   uint32_t pulseLength;  // Em ms, 0 quando parada
+   uint32_t lastStart;    // Epoch local do último acionamento, 0 quando desconhecido
+   uint32_t checksum;
+};
+
+// Mantido na RTC slow memory sem inicialização: sobrevive a panic, watchdog e ESP.restart(),
+// mas não a uma queda de energia, quando a bomba também para
+struct PumpJournalState {
+   uint32_t magic;
+   uint32_t lastSeen;  // Epoch local da última passagem da task das bombas
+   uint32_t checksum;
+   PumpJournalEntry pumps[PUMP_JOURNAL_MAX_PUMPS];
+};
+
+struct PumpJournalStats {
+   bool recovered = false;    // O diário anterior ao reset estava íntegro
+   uint32_t discarded = 0;    // Registros com checksum inválido no boot
+   uint32_t resumed = 0;      // Pulsos interrompidos retomados
+   uint32_t resumedTime = 0;  // Em ms, soma do tempo restante retomado
+   uint32_t caughtUp = 0;     // Horários perdidos compensados
+   uint32_t writes = 0;
+};
+
+// Registra o início de cada pulso e a última passagem da task das bombas na memória RTC. Cada
+// escrita custa apenas algumas palavras de RAM, sem desgaste da flash. No boot, o estado anterior
+// ao reset é copiado para que os pulsos interrompidos sejam retomados e os horários perdidos
+// compensados.
+class PumpJournal {
+  public:
+   PumpJournal(size_t count, uint32_t minResume);
+
+   bool begin(bool recover);
+
+   void recordStart(size_t index, uint32_t pulseLength, uint32_t localEpoch);
+   void recordStop(size_t index);
+   void recordAlive(uint32_t localEpoch);
+
+   uint32_t takeResumePulse(size_t index);
+   uint32_t getCatchUpStart(size_t index, uint32_t localEpoch, uint32_t window);
+   void recordCatchUp();
+
+   PumpJournalStats getStats();
+
+  private:
+   const size_t count;
+   const uint32_t minResume;
+
+   PumpJournalState previous;  // Cópia do diário no boot
+   bool resumed[PUMP_JOURNAL_MAX_PUMPS] = {};
+
+   PumpJournalStats stats;
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+   static uint64_t now();
+   static uint32_t checksum(const void *data, size_t length);
+   static void seal(PumpJournalEntry &entry);
+   static bool isSealed(const PumpJournalEntry &entry);
+   static void sealHeader(PumpJournalState &state);
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "pumpScheduler.h"
+
+#include <algorithm>
+
+PumpScheduler::PumpScheduler(HydraulicPumpController *pumps, size_t count, uint32_t pollDelay, uint32_t maxDelay)
+    : pumps(pumps),
+      count(count),
+      pollDelay(pollDelay),
+      maxDelay(maxDelay) {
+   heap.reserve(count);
+   lastDrive.assign(count, 0);
+}
+
+// A task informada é notificada quando a agenda muda para executar process() antes do prazo
+void PumpScheduler::setTask(TaskHandle_t task) {
+   this->task = task;
+}
+
+void PumpScheduler::onDue(std::function<void(size_t, int64_t)> callback) {
+   dueCallback = callback;
+}
+
+// Chamado após alterar a agenda de qualquer bomba ou ajustar o relógio
+void PumpScheduler::reschedule() {
+   rebuild = true;
+
+   if (task != NULL)
+      xTaskNotifyGive(task);
+}
+
+// Atende as bombas cujo prazo venceu e retorna o tempo em ms até o próximo prazo.
+// Cada verificação custa O(log n) e a task fica bloqueada entre os prazos.
+uint32_t PumpScheduler::process(uint32_t localEpoch) {
+   int64_t now = esp_timer_get_time();
+
+   if (rebuild.exchange(false)) {
+      heap.clear();
+      for (size_t index = 0; index < count; index++)
+         heap.push_back({now, (uint8_t)index});
+      std::make_heap(heap.begin(), heap.end(), isLater);
+
+      portENTER_CRITICAL(&mux);
+      stats.rebuilds++;
+      portEXIT_CRITICAL(&mux);
+   }
+
+   while (!heap.empty() && heap.front().due <= now) {
+      std::pop_heap(heap.begin(), heap.end(), isLater);
+      Event event = heap.back();
+      heap.pop_back();
+
+      uint32_t lateness = 0, missed = 0;
+      bool due = pumps[event.index].isDriveDue(localEpoch, &lateness, &missed);
+
+      // O mesmo horário disparado de novo indica que o relógio voltou depois do acionamento
+      bool duplicate = due && localEpoch - lateness <= lastDrive[event.index];
+      if (due)
+         lastDrive[event.index] = localEpoch - lateness;
+
+      portENTER_CRITICAL(&mux);
+      stats.checks++;
+      stats.missed += missed;
+      if (due) {
+         stats.drives++;
+         stats.latency[min(lateness, (uint32_t)SCHEDULER_LATENCY_BUCKETS - 1)]++;
+      }
+      if (duplicate)
+         stats.duplicates++;
+      if (now - event.due > stats.maxLateness)
+         stats.maxLateness = now - event.due;
+      portEXIT_CRITICAL(&mux);
+
+      if (due && dueCallback)
+         dueCallback(event.index, event.due);
+
+      heap.push_back({now + (int64_t)getNextCheck(event.index, localEpoch) * 1000, event.index});
+      std::push_heap(heap.begin(), heap.end(), isLater);
+   }
+
+   if (heap.empty())
+      return maxDelay;
+
+   return (uint32_t)max((int64_t)0, (heap.front().due - now) / 1000);
+}
+
+PumpSchedulerStats PumpScheduler::getStats() {
+   PumpSchedulerStats copy;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
+
+// Dorme até um segundo antes do próximo horário e volta à verificação fina a partir daí
+uint32_t PumpScheduler::getNextCheck(size_t index, uint32_t localEpoch) {
+   int32_t secondsToNextDrive = pumps[index].getSecondsToNextDrive(localEpoch);
+
+   if (secondsToNextDrive < 0)
+      return maxDelay;
+   if (secondsToNextDrive > 1)
+      return min((uint32_t)(secondsToNextDrive - 1) * 1000, maxDelay);
+
+   return pollDelay;
+}
+
+bool PumpScheduler::isLater(const Event &first, const Event &second) {
+   return first.due > second.due;
+}
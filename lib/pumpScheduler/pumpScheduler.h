@@ -0,0 +1,69 @@
+#ifndef _PUMPSCHEDULER_
+#define _PUMPSCHEDULER_
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "hydraulicPumpController.h"
+
+#define SCHEDULER_LATENCY_BUCKETS (SCHEDULE_LATE_WINDOW + 1)
+
+struct PumpSchedulerStats {
+   uint32_t checks = 0;       // Verificações de agenda feitas
+   uint32_t drives = 0;       // Horários alcançados
+   uint32_t missed = 0;       // Horários descartados por passarem da janela de atraso
+   uint32_t duplicates = 0;   // Horários disparados mais de uma vez (ex.: relógio voltou)
+   uint32_t rebuilds = 0;
+   uint32_t maxLateness = 0;  // Em us, maior atraso entre o prazo do heap e a verificação
+   uint32_t latency[SCHEDULER_LATENCY_BUCKETS] = {};  // Disparos por atraso em segundos em relação ao horário
+};
+
+// Mantém em um min-heap o próximo instante em que a agenda de cada bomba precisa ser verificada,
+// permitindo que uma única task atenda todas as bombas dormindo até o evento mais próximo
+class PumpScheduler {
+  public:
+   PumpScheduler(HydraulicPumpController *pumps, size_t count, uint32_t pollDelay, uint32_t maxDelay);
+
+   void setTask(TaskHandle_t task);
+
+   void onDue(std::function<void(size_t, int64_t)> callback);
+
+   void reschedule();
+
+   uint32_t process(uint32_t localEpoch);
+
+   PumpSchedulerStats getStats();
+
+  private:
+   struct Event {
+      int64_t due;  // Em us, base do esp_timer
+      uint8_t index;
+   };
+
+   HydraulicPumpController *pumps;
+   const size_t count;
+   const uint32_t pollDelay;  // Em ms, verificação fina perto do horário
+   const uint32_t maxDelay;   // Em ms, limita o tempo sem verificar o horário
+
+   std::vector<Event> heap;
+   std::vector<uint32_t> lastDrive;  // Epoch local do último horário disparado de cada bomba
+   std::atomic<bool> rebuild{true};
+
+   TaskHandle_t task = NULL;
+   std::function<void(size_t, int64_t)> dueCallback;
+
+   PumpSchedulerStats stats;
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+   uint32_t getNextCheck(size_t index, uint32_t localEpoch);
+
+   static bool isLater(const Event &first, const Event &second);
+};
+
+#endif
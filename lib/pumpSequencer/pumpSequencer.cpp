@@ -0,0 +1,263 @@
+#include "pumpSequencer.h"
+
+PumpSequencer::PumpSequencer(HydraulicPumpController *pumps, const uint8_t *priorities, size_t count, uint8_t maxConcurrent, uint32_t minGap, int masterValvePin, uint32_t masterValveLead)
+    : pumps(pumps),
+      priorities(priorities),
+      count(count),
+      maxConcurrent(maxConcurrent),
+      minGap(minGap),
+      masterValvePin(masterValvePin),
+      masterValveLead(masterValveLead) {
+}
+
+void PumpSequencer::begin() {
+   mutex = xSemaphoreCreateMutex();
+   queue.reserve(count);
+   started.reserve(count);
+
+   if (masterValvePin != SEQUENCER_NO_VALVE) {
+      pinMode(masterValvePin, OUTPUT);
+      digitalWrite(masterValvePin, LOW);
+   }
+}
+
+// A task informada é notificada a cada novo pedido para executar process()
+void PumpSequencer::setTask(TaskHandle_t task) {
+   this->task = task;
+}
+
+bool PumpSequencer::request(size_t index) {
+   bool queued = false;
+
+   if (index >= count)
+      return false;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      stats.requested++;
+
+      bool pending = pumps[index].getPumpState();
+      for (Request &entry : queue)
+         pending |= entry.index == index;
+
+      if (pending) {
+         stats.ignored++;
+      } else {
+         queue.push_back({(uint8_t)index, priorities[index], (uint32_t)millis(), nextOrder++, false});
+         stats.maxQueueLength = max(stats.maxQueueLength, (uint32_t)queue.size());
+         queued = true;
+      }
+
+      xSemaphoreGive(mutex);
+   }
+
+   if (queued && task != NULL)
+      xTaskNotifyGive(task);
+
+   return queued;
+}
+
+// Retira o pedido ainda não atendido da bomba. O ajuste do pulso feito para ele (setNextPulseDuration)
+// é descartado, para não valer no próximo acionamento.
+bool PumpSequencer::cancel(size_t index) {
+   bool cancelled = false;
+
+   if (index >= count)
+      return false;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      for (size_t entry = 0; entry < queue.size(); entry++) {
+         if (queue[entry].index == index) {
+            queue.erase(queue.begin() + entry);
+            pumps[index].setNextPulseDuration(0);
+            stats.cancelled++;
+            cancelled = true;
+            break;
+         }
+      }
+
+      xSemaphoreGive(mutex);
+   }
+
+   return cancelled;
+}
+
+// Cancela o pedido na fila e desliga a bomba. A task é notificada para que um pedido à espera de
+// vaga, ou a válvula mestra à espera da última bomba, seja atendido sem aguardar o prazo do pulso.
+bool PumpSequencer::stop(size_t index) {
+   bool running;
+
+   if (index >= count)
+      return false;
+
+   cancel(index);
+
+   running = pumps[index].getPumpState();
+   if (running) {
+      pumps[index].stopPump();
+
+      if (task != NULL)
+         xTaskNotifyGive(task);
+   }
+
+   return running;
+}
+
+uint32_t PumpSequencer::process() {
+   uint32_t nextDelay = SEQUENCER_NO_DEADLINE;
+
+   if (!xSemaphoreTake(mutex, portMAX_DELAY))
+      return nextDelay;
+
+   started.clear();
+
+   uint8_t running = countRunning();
+   uint32_t now = millis();
+
+   if (queue.empty()) {
+      // A válvula mestra só fecha depois que a última bomba parar
+      if (masterValveOpen && running == 0)
+         setMasterValve(false);
+      else if (masterValveOpen)
+         nextDelay = getPulseEnd(true);
+
+      xSemaphoreGive(mutex);
+      return nextDelay;
+   }
+
+   if (masterValvePin != SEQUENCER_NO_VALVE && !masterValveOpen) {
+      setMasterValve(true);
+      masterValveOpenedAt = now;
+   }
+
+   while (!queue.empty()) {
+      if (masterValveOpen && now - masterValveOpenedAt < masterValveLead) {
+         nextDelay = masterValveLead - (now - masterValveOpenedAt);
+         break;
+      }
+
+      // Sem vaga, só o fim do pulso mais curto (ou um stop(), que notifica a task) libera a próxima
+      if (running >= maxConcurrent) {
+         nextDelay = getPulseEnd(false);
+         break;
+      }
+
+      if (hasStarted && now - lastStart < minGap) {
+         nextDelay = minGap - (now - lastStart);
+         break;
+      }
+
+      // Maior prioridade primeiro; empates pela ordem de chegada
+      size_t best = 0;
+      for (size_t entry = 1; entry < queue.size(); entry++) {
+         const Request &candidate = queue[entry];
+         const Request &current = queue[best];
+
+         if (candidate.priority > current.priority || (candidate.priority == current.priority && candidate.order < current.order))
+            best = entry;
+      }
+
+      Request selected = queue[best];
+      queue.erase(queue.begin() + best);
+
+      uint32_t wait = now - selected.requestedAt;
+      if (selected.deferred)
+         stats.deferred++;
+      stats.maxWait = max(stats.maxWait, wait);
+
+      if (pumps[selected.index].startPump()) {
+         stats.started++;
+         running++;
+         stats.maxConcurrent = max(stats.maxConcurrent, running);
+         lastStart = now;
+         hasStarted = true;
+         started.push_back(selected.index);
+      } else {
+         stats.failures++;
+      }
+   }
+
+   // Os pedidos que ficaram na fila esperam ao menos até o próximo process()
+   for (Request &entry : queue)
+      entry.deferred = true;
+
+   if (queue.empty() && masterValveOpen)
+      nextDelay = getPulseEnd(true);
+
+   xSemaphoreGive(mutex);
+
+   if (startCallback)
+      for (uint8_t index : started)
+         startCallback(index);
+
+   return nextDelay;
+}
+
+void PumpSequencer::onStart(std::function<void(size_t)> callback) {
+   startCallback = callback;
+}
+
+size_t PumpSequencer::getQueueLength() {
+   size_t length = 0;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      length = queue.size();
+      xSemaphoreGive(mutex);
+   }
+
+   return length;
+}
+
+bool PumpSequencer::isMasterValveOpen() {
+   bool open = false;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      open = masterValveOpen;
+      xSemaphoreGive(mutex);
+   }
+
+   return open;
+}
+
+SequencerStats PumpSequencer::getStats() {
+   SequencerStats copy;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      copy = stats;
+      xSemaphoreGive(mutex);
+   }
+
+   return copy;
+}
+
+uint8_t PumpSequencer::countRunning() {
+   uint8_t running = 0;
+
+   for (size_t index = 0; index < count; index++)
+      running += pumps[index].getPumpState();
+
+   return running;
+}
+
+// Em ms até o fim do pulso mais curto ou, com last, do mais longo entre as bombas acionadas. O
+// milissegundo a mais garante que a task acorde com a bomba já parada.
+uint32_t PumpSequencer::getPulseEnd(bool last) {
+   uint32_t end = last ? 0 : SEQUENCER_NO_DEADLINE;
+
+   for (size_t index = 0; index < count; index++) {
+      if (!pumps[index].getPumpState())
+         continue;
+
+      uint32_t remaining = pumps[index].getPulseRemaining() + 1;
+      end = last ? max(end, remaining) : min(end, remaining);
+   }
+
+   return end;
+}
+
+void PumpSequencer::setMasterValve(bool open) {
+   if (masterValvePin == SEQUENCER_NO_VALVE)
+      return;
+
+   digitalWrite(masterValvePin, open ? HIGH : LOW);
+   masterValveOpen = open;
+}
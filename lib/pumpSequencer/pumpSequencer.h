@@ -0,0 +1,96 @@
+#ifndef _PUMPSEQUENCER_
+#define _PUMPSEQUENCER_
+
+#include <Arduino.h>
+
+#include <functional>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "hydraulicPumpController.h"
+
+#define SEQUENCER_NO_VALVE -1
+#define SEQUENCER_NO_DEADLINE UINT32_MAX  // process() sem pedidos na fila e com a válvula mestra fechada
+
+struct SequencerStats {
+   uint32_t requested = 0;
+   uint32_t started = 0;
+   uint32_t ignored = 0;         // Bomba já acionada ou já na fila
+   uint32_t cancelled = 0;       // Pedidos retirados da fila antes do acionamento
+   uint32_t deferred = 0;        // Acionamentos que tiveram de esperar na fila por vaga, intervalo ou válvula
+   uint32_t failures = 0;
+   uint32_t maxQueueLength = 0;
+   uint32_t maxWait = 0;         // Em ms, maior espera entre o pedido e o acionamento
+   uint8_t maxConcurrent = 0;    // Maior número de bombas acionadas simultaneamente
+};
+
+// Sequencia o acionamento das bombas respeitando o limite de bombas simultâneas, o intervalo
+// mínimo entre partidas, as prioridades e o intertravamento com a válvula mestra. Pedidos
+// concorrentes são atendidos por prioridade, depois por ordem de chegada e por índice.
+class PumpSequencer {
+  public:
+   PumpSequencer(HydraulicPumpController *pumps, const uint8_t *priorities, size_t count, uint8_t maxConcurrent, uint32_t minGap, int masterValvePin = SEQUENCER_NO_VALVE, uint32_t masterValveLead = 0);
+
+   void begin();
+
+   void setTask(TaskHandle_t task);
+
+   bool request(size_t index);
+   bool cancel(size_t index);
+   bool stop(size_t index);  // Retorna true se a bomba estava acionada
+
+   // Deve ser chamado por uma única task. Retorna em quantos ms precisa ser chamado de novo (válvula
+   // mestra, intervalo mínimo ou fim de um pulso), ou SEQUENCER_NO_DEADLINE quando só um novo
+   // pedido ou um stop(), que notificam a task, exigem outra chamada.
+   uint32_t process();
+
+   // O callback é chamado por process() fora do mutex, então pode usar o próprio sequenciador
+   void onStart(std::function<void(size_t)> callback);
+
+   size_t getQueueLength();
+   bool isMasterValveOpen();
+
+   SequencerStats getStats();
+
+  private:
+   struct Request {
+      uint8_t index;
+      uint8_t priority;
+      uint32_t requestedAt;
+      uint32_t order;
+      bool deferred;  // Não foi atendido no primeiro process() depois do pedido
+   };
+
+   HydraulicPumpController *pumps;
+   const uint8_t *priorities;
+   const size_t count;
+
+   const uint8_t maxConcurrent;
+   const uint32_t minGap;
+   const int masterValvePin;
+   const uint32_t masterValveLead;
+
+   std::vector<Request> queue;
+   std::vector<uint8_t> started;  // Acionadas na última chamada de process(), avisadas depois do mutex
+   uint32_t nextOrder = 0;
+   uint32_t lastStart = 0;
+   bool hasStarted = false;
+
+   bool masterValveOpen = false;
+   uint32_t masterValveOpenedAt = 0;
+
+   TaskHandle_t task = NULL;
+   SemaphoreHandle_t mutex = NULL;
+
+   std::function<void(size_t)> startCallback;
+
+   SequencerStats stats;
+
+   uint8_t countRunning();
+   uint32_t getPulseEnd(bool last);
+   void setMasterValve(bool open);
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "requestGovernor.h"
+
+#include <algorithm>
+
+#include "esp_heap_caps.h"
+
+RequestGovernor::RequestGovernor(const GovernorConfig &config)
+    : config(config),
+      leases(config.maxConcurrent, Lease{NULL, REQUEST_NORMAL, 0}) {
+}
+
+void RequestGovernor::onClassify(std::function<RequestClass(AsyncWebServerRequest *)> callback) {
+   classify = callback;
+}
+
+// Retorna true apenas para recusar, o 503 é enviado em handleRequest
+bool RequestGovernor::canHandle(AsyncWebServerRequest *request) {
+   RequestClass requestClass = classify ? classify(request) : REQUEST_NORMAL;
+
+   if (requestClass >= REQUEST_EXEMPT)
+      return false;
+
+   expireLeases();
+
+   bool lowHeap = requestClass != REQUEST_PRIORITY && isHeapLow();
+   bool admitted;
+
+   portENTER_CRITICAL(&mux);
+   uint8_t limit = requestClass == REQUEST_PRIORITY ? config.maxConcurrent : config.maxConcurrent - config.reserved;
+   admitted = !lowHeap && stats.active < limit && (requestClass != REQUEST_STATIC || stats.openFiles < config.maxFiles);
+
+   if (admitted) {
+      stats.admitted[requestClass]++;
+      stats.active++;
+      stats.maxActive = max(stats.maxActive, stats.active);
+      if (requestClass == REQUEST_STATIC)
+         stats.openFiles++;
+   } else {
+      stats.shed[requestClass]++;
+      if (lowHeap)
+         stats.shedLowHeap++;
+   }
+   portEXIT_CRITICAL(&mux);
+
+   // Há uma vaga livre por requisição abaixo de maxConcurrent
+   if (admitted) {
+      for (Lease &lease : leases) {
+         if (lease.request == NULL) {
+            lease = {request, requestClass, (uint32_t)millis()};
+            break;
+         }
+      }
+
+      request->onDisconnect([this, request]() {
+         release(request);
+      });
+   }
+
+   return !admitted;
+}
+
+void RequestGovernor::handleRequest(AsyncWebServerRequest *request) {
+   AsyncWebServerResponse *response = request->beginResponse(503, "text/plain", "Server busy");
+   response->addHeader("Retry-After", String(config.retryAfter));
+   request->send(response);
+}
+
+// O corpo das requisições recusadas é descartado
+bool RequestGovernor::isRequestHandlerTrivial() {
+   return true;
+}
+
+void RequestGovernor::onDisconnect(AsyncWebServerRequest *request, ArDisconnectHandler callback) {
+   request->onDisconnect([this, request, callback]() {
+      release(request);
+      callback();
+   });
+}
+
+GovernorStats RequestGovernor::getStats() {
+   uint32_t sorted[GOVERNOR_LATENCY_SAMPLES];
+   GovernorStats copy;
+   size_t count;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   count = latencyCount;
+   memcpy(sorted, latencies, count * sizeof(uint32_t));
+   portEXIT_CRITICAL(&mux);
+
+   // Percentis calculados sob demanda, fora da seção crítica
+   if (count > 0) {
+      size_t p50 = (count - 1) * 50 / 100;
+      size_t p99 = (count - 1) * 99 / 100;
+
+      std::nth_element(sorted, sorted + p50, sorted + count);
+      copy.p50 = sorted[p50];
+      std::nth_element(sorted, sorted + p99, sorted + count);
+      copy.p99 = sorted[p99];
+   }
+
+   return copy;
+}
+
+bool RequestGovernor::isHeapLow() {
+   return heap_caps_get_free_size(MALLOC_CAP_8BIT) < config.minHeap ||
+          heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) < config.minBlock;
+}
+
+// Uma conexão que nunca avisou o fim (callback sobrescrito) não pode ocupar a vaga para sempre.
+// A requisição já pode ter sido destruída, então só o registro é descartado.
+void RequestGovernor::expireLeases() {
+   uint32_t now = millis();
+
+   for (Lease &lease : leases)
+      if (lease.request != NULL && now - lease.start > config.maxHold)
+         vacate(lease, true);
+}
+
+// Requisições sem vaga registrada (recusadas ou com a vaga expirada) são ignoradas
+void RequestGovernor::release(AsyncWebServerRequest *request) {
+   for (Lease &lease : leases) {
+      if (lease.request == request) {
+         vacate(lease, false);
+         return;
+      }
+   }
+}
+
+void RequestGovernor::vacate(Lease &lease, bool expired) {
+   uint32_t latency = millis() - lease.start;
+
+   portENTER_CRITICAL(&mux);
+   if (stats.active > 0)
+      stats.active--;
+   if (lease.requestClass == REQUEST_STATIC && stats.openFiles > 0)
+      stats.openFiles--;
+
+   if (expired) {
+      stats.expired++;
+   } else {
+      latencies[latencyIndex] = latency;
+      latencyIndex = (latencyIndex + 1) % GOVERNOR_LATENCY_SAMPLES;
+      latencyCount = min(latencyCount + 1, (size_t)GOVERNOR_LATENCY_SAMPLES);
+      stats.maxLatency = max(stats.maxLatency, latency);
+   }
+   portEXIT_CRITICAL(&mux);
+
+   lease.request = NULL;
+}
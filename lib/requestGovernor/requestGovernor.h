@@ -0,0 +1,100 @@
+#ifndef _REQUESTGOVERNOR_
+#define _REQUESTGOVERNOR_
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include <functional>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+
+#define GOVERNOR_LATENCY_SAMPLES 128
+
+enum RequestClass : uint8_t {
+   REQUEST_PRIORITY = 0,  // Controle das bombas, API local e OTA
+   REQUEST_NORMAL = 1,    // Consultas da interface
+   REQUEST_STATIC = 2,    // Arquivos da SPIFFS, cada um com um arquivo aberto até o fim da resposta
+   REQUEST_EXEMPT = 3,    // Conexões longas com limite próprio (WebSocket e SSE)
+   REQUEST_CLASSES = 4,
+};
+
+struct GovernorConfig {
+   uint8_t maxConcurrent = 8;  // Requisições simultâneas de todas as classes
+   uint8_t reserved = 2;       // Vagas que só as prioritárias podem ocupar
+   uint8_t maxFiles = 2;       // Arquivos da SPIFFS abertos ao mesmo tempo
+   uint32_t minHeap = 40000;   // Em bytes, abaixo disso só as prioritárias são atendidas
+   uint32_t minBlock = 12000;  // Em bytes, maior bloco livre exigido pelas mesmas regras
+   uint32_t retryAfter = 5;    // Em s, sugerido no 503
+   uint32_t maxHold = 300000;  // Em ms, vaga ainda ocupada depois disso é devolvida
+};
+
+struct GovernorStats {
+   uint32_t admitted[REQUEST_CLASSES] = {};
+   uint32_t shed[REQUEST_CLASSES] = {};
+   uint32_t shedLowHeap = 0;  // Recusas por falta de heap, as demais são por limite de vagas
+   uint32_t expired = 0;      // Vagas devolvidas por maxHold, sem o fim da conexão
+   uint8_t active = 0;
+   uint8_t maxActive = 0;
+   uint8_t openFiles = 0;
+   uint32_t p50 = 0;         // Em ms, da admissão ao fim da conexão nas últimas requisições
+   uint32_t p99 = 0;         // Em ms
+   uint32_t maxLatency = 0;  // Em ms
+};
+
+// Primeiro handler do servidor: decide se cada requisição é atendida antes que qualquer outro
+// handler aloque buffers ou abra arquivos. As recusadas recebem 503 com Retry-After e as
+// admitidas seguem para os handlers normais, liberando a vaga quando a conexão fecha.
+//
+// A vaga é liberada pelo callback de onDisconnect da requisição, que guarda um único callback:
+// os handlers seguintes não devem chamar request->onDisconnect(), e sim governor.onDisconnect(),
+// que encadeia o callback à liberação. Cada vaga fica registrada no governor, que devolve as
+// presas além de maxHold caso algum handler sobrescreva o callback mesmo assim.
+class RequestGovernor : public AsyncWebHandler {
+  public:
+   RequestGovernor(const GovernorConfig &config);
+
+   void onClassify(std::function<RequestClass(AsyncWebServerRequest *)> callback);
+
+   bool canHandle(AsyncWebServerRequest *request) override;
+
+   void handleRequest(AsyncWebServerRequest *request) override;
+
+   bool isRequestHandlerTrivial() override;
+
+   // Substitui request->onDisconnect() nos handlers executados depois do governor
+   void onDisconnect(AsyncWebServerRequest *request, ArDisconnectHandler callback);
+
+   GovernorStats getStats();
+
+  private:
+   struct Lease {
+      AsyncWebServerRequest *request;  // NULL com a vaga livre
+      RequestClass requestClass;
+      uint32_t start;
+   };
+
+   GovernorConfig config;
+   GovernorStats stats;
+
+   std::function<RequestClass(AsyncWebServerRequest *)> classify;
+
+   // Uma por vaga; só a task do AsyncTCP, que executa os handlers e os callbacks, acessa
+   std::vector<Lease> leases;
+
+   uint32_t latencies[GOVERNOR_LATENCY_SAMPLES];
+   size_t latencyCount = 0;
+   size_t latencyIndex = 0;
+
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+   bool isHeapLow();
+
+   void expireLeases();
+
+   void release(AsyncWebServerRequest *request);
+
+   void vacate(Lease &lease, bool expired);
+};
+
+#endif
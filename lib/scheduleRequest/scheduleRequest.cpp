@@ -0,0 +1,151 @@
+#include "scheduleRequest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void ScheduleRequest::begin(ScheduleRequestKind kind) {
+   this->kind = kind;
+   ruleCount = 0;
+   pulseDuration = 0;
+   list = LIST_NONE;
+   listed = false;
+   error = NULL;
+
+   parser.begin(&ScheduleRequest::onEvent, this);
+}
+
+bool ScheduleRequest::feed(const uint8_t *data, size_t length) {
+   if (!parser.feed(data, length) && error == NULL)
+      error = "Invalid JSON";
+
+   return error == NULL;
+}
+
+// Valida o que só pode ser verificado com o corpo completo
+bool ScheduleRequest::finish() {
+   if (error != NULL)
+      return false;
+
+   if (!parser.finish())
+      return fail("Incomplete JSON");
+
+   if (kind == REQUEST_PULSE && pulseDuration == 0)
+      return fail("Missing pulseDuration");
+
+   // Um corpo sem driveTimes nem rules não deve apagar a agenda por engano
+   if (kind == REQUEST_SCHEDULE && !listed)
+      return fail("Missing driveTimes or rules");
+
+   return true;
+}
+
+ScheduleRequestKind ScheduleRequest::getKind() const {
+   return kind;
+}
+
+const char *ScheduleRequest::getError() const {
+   return error;
+}
+
+const ScheduleRule *ScheduleRequest::getRules() const {
+   return rules;
+}
+
+size_t ScheduleRequest::getRuleCount() const {
+   return ruleCount;
+}
+
+uint32_t ScheduleRequest::getPulseDuration() const {
+   return pulseDuration;
+}
+
+bool ScheduleRequest::addRule() {
+   if (!builder.isEnabled())
+      return true;
+
+   if (ruleCount >= SCHEDULE_MAX_RULES)
+      return fail("Too many rules");
+
+   if (!builder.build(rules[ruleCount]))
+      return fail("Invalid rule");
+
+   ruleCount++;
+   return true;
+}
+
+bool ScheduleRequest::fail(const char *message) {
+   if (error == NULL)
+      error = message;
+
+   return false;
+}
+
+// Profundidades: 1 membros da raiz, 2 itens das listas, 3 campos de cada regra, 4 lista de dias
+bool ScheduleRequest::handle(JsonStreamEvent event, const char *key, const char *value, uint8_t depth) {
+   if (depth == 0)
+      return event == JSON_STREAM_OBJECT_START || event == JSON_STREAM_OBJECT_END || fail("Body must be an object");
+
+   if (depth == 1) {
+      if (event == JSON_STREAM_NUMBER && strcmp(key, "pulseDuration") == 0) {
+         long duration = strtol(value, NULL, 10);
+         if (duration <= 0)
+            return fail("Invalid pulseDuration");
+         pulseDuration = duration;
+      }
+
+      if (event == JSON_STREAM_ARRAY_END)
+         list = LIST_NONE;
+
+      return true;
+   }
+
+   if (event == JSON_STREAM_ARRAY_START && depth == 2 && kind == REQUEST_SCHEDULE) {
+      if (strcmp(key, "driveTimes") == 0)
+         list = LIST_DRIVE_TIMES;
+      else if (strcmp(key, "rules") == 0)
+         list = LIST_RULES;
+      listed = listed || list != LIST_NONE;
+      return true;
+   }
+
+   if (list == LIST_NONE)
+      return true;
+
+   switch (event) {
+      case JSON_STREAM_OBJECT_START:
+         builder.reset();
+         return depth == 3 || fail("Unexpected object");
+
+      case JSON_STREAM_OBJECT_END:
+         return addRule();
+
+      case JSON_STREAM_ARRAY_START:
+         if (depth != 4 || strcmp(key, "days") != 0)
+            return fail("Unexpected array");
+         builder.clearDays();
+         return true;
+
+      case JSON_STREAM_STRING:
+         // Formato curto da lista de horários: ["06:00:00", ...]
+         if (depth == 2 && list == LIST_DRIVE_TIMES) {
+            builder.reset();
+            return (builder.setText("at", value) || fail("Invalid time")) && addRule();
+         }
+         if (depth == 4)
+            return builder.addDay(value) || fail("Invalid day");
+         return builder.setText(key, value) || fail("Invalid rule field");
+
+      case JSON_STREAM_NUMBER:
+         return builder.setNumber(key, strtol(value, NULL, 10)) || fail("Invalid rule field");
+
+      case JSON_STREAM_BOOLEAN:
+         return builder.setFlag(key, strcmp(value, "true") == 0);
+
+      default:
+         return true;
+   }
+}
+
+bool ScheduleRequest::onEvent(void *context, JsonStreamEvent event, const char *key, const char *value, uint8_t depth) {
+   return ((ScheduleRequest *)context)->handle(event, key, value, depth);
+}
@@ -0,0 +1,63 @@
+#ifndef _SCHEDULEREQUEST_
+#define _SCHEDULEREQUEST_
+
+// Sem dependências do Arduino para que também compile no host
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driveSchedule.h"
+#include "jsonStreamParser.h"
+
+#define SCHEDULE_REQUEST_MAX_BODY 4096
+
+enum ScheduleRequestKind : uint8_t {
+   REQUEST_SCHEDULE = 0,  // {"driveTimes": [...], "rules": [...]}, no mesmo formato do MongoDB
+   REQUEST_PULSE = 1,     // {"pulseDuration": 60000}
+};
+
+// Valida o corpo de um PUT à medida que os pedaços chegam do servidor assíncrono, guardando
+// apenas as regras já montadas. Não possui destrutor para poder ser liberado com free() pelo
+// AsyncWebServerRequest.
+class ScheduleRequest {
+  public:
+   void begin(ScheduleRequestKind kind);
+
+   bool feed(const uint8_t *data, size_t length);
+
+   bool finish();
+
+   const char *getError() const;
+   ScheduleRequestKind getKind() const;
+
+   const ScheduleRule *getRules() const;
+   size_t getRuleCount() const;
+   uint32_t getPulseDuration() const;
+
+  private:
+   enum List : uint8_t {
+      LIST_NONE,
+      LIST_DRIVE_TIMES,
+      LIST_RULES,
+   };
+
+   ScheduleRequestKind kind;
+   JsonStreamParser parser;
+   ScheduleRuleBuilder builder;
+
+   ScheduleRule rules[SCHEDULE_MAX_RULES];
+   size_t ruleCount = 0;
+   uint32_t pulseDuration = 0;
+
+   List list = LIST_NONE;
+   bool listed = false;
+   const char *error = NULL;
+
+   bool addRule();
+   bool fail(const char *message);
+
+   bool handle(JsonStreamEvent event, const char *key, const char *value, uint8_t depth);
+
+   static bool onEvent(void *context, JsonStreamEvent event, const char *key, const char *value, uint8_t depth);
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "sensorSampler.h"
+
+#include "xtensa/core-macros.h"
+
+SensorSampler::SensorSampler(adc1_channel_t soilChannel, adc1_channel_t tankChannel, uint8_t emaShift)
+    : soilChannel(soilChannel),
+      tankChannel(tankChannel),
+      emaShift(emaShift) {
+}
+
+bool SensorSampler::begin() {
+   adc_digi_init_config_t initConfig = {};
+   initConfig.max_store_buf_size = SENSOR_READ_BYTES * 4;
+   initConfig.conv_num_each_intr = SENSOR_READ_BYTES;
+   initConfig.adc1_chan_mask = BIT(soilChannel) | BIT(tankChannel);
+   initConfig.adc2_chan_mask = 0;
+
+   if (adc_digi_initialize(&initConfig) != ESP_OK) {
+      log_e("Failed initializing ADC DMA");
+      return false;
+   }
+
+   adc_digi_pattern_config_t pattern[2] = {};
+   pattern[0].atten = ADC_ATTEN_DB_11;
+   pattern[0].channel = soilChannel;
+   pattern[0].unit = 0;
+   pattern[0].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+   pattern[1] = pattern[0];
+   pattern[1].channel = tankChannel;
+
+   adc_digi_configuration_t digiConfig = {};
+   digiConfig.conv_limit_en = true;
+   digiConfig.conv_limit_num = 250;
+   digiConfig.pattern_num = 2;
+   digiConfig.adc_pattern = pattern;
+   digiConfig.sample_freq_hz = SENSOR_SAMPLE_FREQUENCY;
+   digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+   digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+   if (adc_digi_controller_configure(&digiConfig) != ESP_OK || adc_digi_start() != ESP_OK) {
+      log_e("Failed starting ADC DMA");
+      adc_digi_deinitialize();
+      return false;
+   }
+
+   running = true;
+   return true;
+}
+
+// Laço da task de amostragem: bloqueia apenas na leitura do DMA
+void SensorSampler::run() {
+   uint8_t buffer[SENSOR_READ_BYTES];
+
+   while (running) {
+      uint32_t length = 0;
+
+      if (adc_digi_read_bytes(buffer, SENSOR_READ_BYTES, &length, ADC_MAX_DELAY) != ESP_OK) {
+         portENTER_CRITICAL(&mux);
+         stats.readErrors++;
+         portEXIT_CRITICAL(&mux);
+         continue;
+      }
+
+      // Contabilizado localmente e publicado nas estatísticas uma vez por leitura do DMA
+      uint32_t samples = 0, maxCycles = 0;
+
+      for (uint32_t index = 0; index + SOC_ADC_DIGI_RESULT_BYTES <= length; index += SOC_ADC_DIGI_RESULT_BYTES) {
+         adc_digi_output_data_t *output = (adc_digi_output_data_t *)&buffer[index];
+         uint32_t start = XTHAL_GET_CCOUNT();
+
+         if (output->type1.channel == soilChannel) {
+            soilMoisture.store(filter(soilFilter, output->type1.data), std::memory_order_relaxed);
+         } else if (output->type1.channel == tankChannel) {
+            tankLevel.store(filter(tankFilter, output->type1.data), std::memory_order_relaxed);
+            decimation++;
+         } else {
+            continue;
+         }
+
+         uint32_t cycles = XTHAL_GET_CCOUNT() - start;
+         totalCycles += cycles;
+         samples++;
+         if (cycles > maxCycles)
+            maxCycles = cycles;
+      }
+
+      portENTER_CRITICAL(&mux);
+      stats.samples += samples;
+      if (stats.samples > 0)
+         stats.avgCycles = totalCycles / stats.samples;
+      if (maxCycles > stats.maxCycles)
+         stats.maxCycles = maxCycles;
+      portEXIT_CRITICAL(&mux);
+
+      lastUpdate.store(millis(), std::memory_order_release);
+
+      // O excedente passa para a próxima leitura publicada, que mantém o ritmo de SENSOR_PUBLISH_RATE
+      if (decimation >= SENSOR_DECIMATION) {
+         decimation -= SENSOR_DECIMATION;
+
+         SensorReading reading = {(uint32_t)millis(), soilMoisture.load(std::memory_order_relaxed), tankLevel.load(std::memory_order_relaxed)};
+         bool published = ring.push(reading);
+
+         portENTER_CRITICAL(&mux);
+         if (published)
+            stats.published++;
+         else
+            stats.overruns++;
+         portEXIT_CRITICAL(&mux);
+      }
+   }
+
+   adc_digi_stop();
+   adc_digi_deinitialize();
+}
+
+// Encerra run() ao fim da leitura do DMA em andamento; a partir daí decide() ignora os sensores
+void SensorSampler::end() {
+   running = false;
+}
+
+bool SensorSampler::read(SensorReading &reading) {
+   return ring.pop(reading);
+}
+
+// Não bloqueia: usa apenas os últimos valores filtrados publicados pela task de amostragem
+IrrigationDecision SensorSampler::decide(uint32_t pulseDuration) {
+   IrrigationDecision decision = {IRRIGATION_RUN, pulseDuration};
+
+   uint32_t updated = lastUpdate.load(std::memory_order_acquire);
+
+   if (running && updated != 0 && millis() - updated < SENSOR_STALE_TIMEOUT) {
+      uint16_t soil = soilMoisture.load(std::memory_order_relaxed);
+      uint16_t tank = tankLevel.load(std::memory_order_relaxed);
+
+      if (tank < thresholds.tankMinimum) {
+         decision = {IRRIGATION_DRY_RUN, 0};
+      } else if (soil < thresholds.wetBelow) {
+         decision = {IRRIGATION_SKIP, 0};
+      } else if (soil < thresholds.moistBelow) {
+         decision = {IRRIGATION_SHORTEN, pulseDuration * thresholds.shortenPercent / 100};
+      } else if (soil > thresholds.dryAbove) {
+         decision = {IRRIGATION_EXTEND, pulseDuration * thresholds.extendPercent / 100};
+      }
+   }
+
+   portENTER_CRITICAL(&mux);
+   stats.decisions[decision.action]++;
+   portEXIT_CRITICAL(&mux);
+
+   return decision;
+}
+
+void SensorSampler::setThresholds(SensorThresholds newThresholds) {
+   thresholds = newThresholds;
+}
+
+// Cópia consistente: a task de amostragem e a task das bombas atualizam as estatísticas em outros núcleos
+SensorStats SensorSampler::getStats() {
+   SensorStats copy;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
+
+uint16_t SensorSampler::filter(ChannelFilter &channel, uint16_t sample) {
+   channel.window[channel.position] = sample;
+   channel.position = (channel.position + 1) % SENSOR_MEDIAN_WINDOW;
+   if (channel.filled < SENSOR_MEDIAN_WINDOW)
+      channel.filled++;
+
+   // Mediana por ordenação por inserção da pequena janela
+   uint16_t sorted[SENSOR_MEDIAN_WINDOW] = {};
+   for (uint8_t index = 0; index < channel.filled; index++) {
+      uint16_t value = channel.window[index];
+      int8_t position = index - 1;
+
+      while (position >= 0 && sorted[position] > value) {
+         sorted[position + 1] = sorted[position];
+         position--;
+      }
+      sorted[position + 1] = value;
+   }
+
+   int32_t median = (int32_t)sorted[channel.filled / 2] << 16;
+
+   if (channel.filled == 1)
+      channel.ema = median;
+   else
+      channel.ema += (median - channel.ema) >> emaShift;
+
+   return channel.ema >> 16;
+}
@@ -0,0 +1,144 @@
+#ifndef _SENSORSAMPLER_
+#define _SENSORSAMPLER_
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "driver/adc.h"
+#include "freertos/FreeRTOS.h"
+
+#define SENSOR_READ_BYTES 256
+#define SENSOR_SAMPLE_FREQUENCY 20000  // Em Hz, somando os dois canais (mínimo do ADC DMA no ESP32)
+#define SENSOR_DECIMATION 10000        // Amostras filtradas por canal a cada leitura publicada
+#define SENSOR_PUBLISH_RATE (SENSOR_SAMPLE_FREQUENCY / 2 / SENSOR_DECIMATION)  // Leituras publicadas por segundo
+#define SENSOR_DRAIN_INTERVAL 180000   // Em ms, maior intervalo entre duas leituras do consumidor (telemetria)
+// Uma posição do buffer circular fica sempre vazia
+#define SENSOR_RING_SIZE (SENSOR_PUBLISH_RATE * SENSOR_DRAIN_INTERVAL / 1000 + 2)
+#define SENSOR_STALE_TIMEOUT 10000     // Em ms, após isso as decisões ignoram os sensores
+#define SENSOR_MEDIAN_WINDOW 5
+
+struct SensorReading {
+   uint32_t timestamp;  // Em ms
+   uint16_t soilMoisture;
+   uint16_t tankLevel;
+};
+
+// Buffer circular sem locks para um produtor e um consumidor
+template <size_t N>
+class SampleRing {
+  public:
+   bool push(const SensorReading &reading) {
+      size_t head = this->head.load(std::memory_order_relaxed);
+      size_t next = (head + 1) % N;
+
+      if (next == tail.load(std::memory_order_acquire))
+         return false;
+
+      buffer[head] = reading;
+      this->head.store(next, std::memory_order_release);
+      return true;
+   }
+
+   bool pop(SensorReading &reading) {
+      size_t tail = this->tail.load(std::memory_order_relaxed);
+
+      if (tail == head.load(std::memory_order_acquire))
+         return false;
+
+      reading = buffer[tail];
+      this->tail.store((tail + 1) % N, std::memory_order_release);
+      return true;
+   }
+
+  private:
+   SensorReading buffer[N];
+   std::atomic<size_t> head{0};
+   std::atomic<size_t> tail{0};
+};
+
+// Limiares em unidades brutas do ADC (12 bits). Nos sensores capacitivos de umidade
+// do solo a leitura aumenta quanto mais seco estiver o solo.
+struct SensorThresholds {
+   uint16_t wetBelow = 1400;    // Solo encharcado: pula o acionamento
+   uint16_t moistBelow = 1900;  // Solo úmido: encurta o pulso
+   uint16_t dryAbove = 2600;    // Solo seco: estende o pulso
+   uint16_t tankMinimum = 600;  // Reservatório abaixo disso: não aciona para não trabalhar a seco
+   uint8_t shortenPercent = 50;
+   uint8_t extendPercent = 150;
+};
+
+enum IrrigationAction : uint8_t {
+   IRRIGATION_RUN = 0,
+   IRRIGATION_SKIP = 1,
+   IRRIGATION_SHORTEN = 2,
+   IRRIGATION_EXTEND = 3,
+   IRRIGATION_DRY_RUN = 4,
+};
+
+struct IrrigationDecision {
+   IrrigationAction action;
+   uint32_t pulseDuration;
+};
+
+struct SensorStats {
+   uint32_t samples = 0;
+   uint32_t published = 0;
+   uint32_t overruns = 0;    // Leituras descartadas com o buffer circular cheio
+   uint32_t readErrors = 0;
+   uint32_t avgCycles = 0;   // Ciclos de CPU por amostra no filtro
+   uint32_t maxCycles = 0;
+   uint32_t decisions[IRRIGATION_DRY_RUN + 1] = {};
+};
+
+// Amostra os sensores de umidade do solo e nível do reservatório pelo ADC em modo contínuo
+// (DMA), filtrando cada canal em ponto fixo com mediana de 5 seguida de média móvel exponencial
+class SensorSampler {
+  public:
+   SensorSampler(adc1_channel_t soilChannel, adc1_channel_t tankChannel, uint8_t emaShift = 10);
+
+   bool begin();
+
+   void run();
+   void end();
+
+   bool read(SensorReading &reading);
+
+   IrrigationDecision decide(uint32_t pulseDuration);
+
+   void setThresholds(SensorThresholds newThresholds);
+
+   SensorStats getStats();
+
+  private:
+   struct ChannelFilter {
+      uint16_t window[SENSOR_MEDIAN_WINDOW];
+      uint8_t position;
+      uint8_t filled;
+      int32_t ema;  // Q16
+   };
+
+   const adc1_channel_t soilChannel;
+   const adc1_channel_t tankChannel;
+   const uint8_t emaShift;
+
+   ChannelFilter soilFilter = {};
+   ChannelFilter tankFilter = {};
+   uint32_t decimation = 0;
+
+   std::atomic<uint16_t> soilMoisture{0};
+   std::atomic<uint16_t> tankLevel{0};
+   std::atomic<uint32_t> lastUpdate{0};
+
+   SampleRing<SENSOR_RING_SIZE> ring;
+   SensorThresholds thresholds;
+   SensorStats stats;
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+   uint64_t totalCycles = 0;
+   std::atomic<bool> running{false};
+
+   uint16_t filter(ChannelFilter &channel, uint16_t sample);
+};
+
+#endif
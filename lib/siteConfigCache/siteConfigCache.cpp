@@ -0,0 +1,331 @@
+#include "siteConfigCache.h"
+
+#include <ESPmDNS.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+SiteConfigCache::SiteConfigCache(bool cacheRole)
+    : cacheRole(cacheRole) {
+}
+
+void SiteConfigCache::begin() {
+   mutex = xSemaphoreCreateMutex();
+}
+
+bool SiteConfigCache::isCacheRole() {
+   return cacheRole;
+}
+
+void SiteConfigCache::registerCode(const String &pumperCode) {
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      if (findEntry(pumperCode) == NULL)
+         entries.push_back({pumperCode, String(), 0});
+      xSemaphoreGive(mutex);
+   }
+}
+
+// fields são os campos do documento usados pela configuração; o restante é descartado na leitura
+bool SiteConfigCache::refresh(const char *findUrl, const char *apiKey, const char *rootCA, JsonVariantConst fields) {
+   // Mantém atualizada a lista de placas anunciadas, usada por serve() para aprender códigos
+   MDNS.updateBrowse();
+   if (!MDNS.isBrowsing())
+      MDNS.browseService(SITE_CACHE_SERVICE, SITE_CACHE_PROTO);
+
+   StaticJsonDocument<SITE_CACHE_FILTER_SIZE> filter;
+   filter.set(fields);
+   filter["pumperCode"] = true;
+
+   // Um único documento, reaproveitado por todos os elementos de todas as páginas
+   DynamicJsonDocument document(SITE_CACHE_DOCUMENT_SIZE);
+
+   bool success = true;
+   size_t first = 0;
+
+   // As entradas só são acrescentadas ao final, então os índices de uma página não mudam entre
+   // uma requisição e outra
+   while (true) {
+      String codes[SITE_CACHE_PAGE_SIZE];
+      size_t count = 0;
+
+      if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+         for (size_t index = first; index < entries.size() && count < SITE_CACHE_PAGE_SIZE; index++)
+            codes[count++] = entries[index].pumperCode;
+         xSemaphoreGive(mutex);
+      }
+
+      if (count == 0)
+         break;
+
+      success = refreshPage(findUrl, apiKey, rootCA, codes, count, filter, document) && success;
+      first += count;
+   }
+
+   return success;
+}
+
+bool SiteConfigCache::refreshPage(const char *findUrl, const char *apiKey, const char *rootCA, const String *codes, size_t count,
+                                  JsonDocument &filter, JsonDocument &document) {
+   StaticJsonDocument<SITE_CACHE_BODY_SIZE> body;
+
+   body["dataSource"] = "Tomatoes";
+   body["database"] = "first-api";
+   body["collection"] = "sensors";
+
+   // Os códigos entram como const char*, referenciados sem cópia
+   JsonArray page = body["filter"]["pumperCode"].createNestedArray("$in");
+
+   for (size_t index = 0; index < count; index++)
+      page.add(codes[index].c_str());
+
+   String json;
+   serializeJson(body, json);
+
+   WiFiClientSecure client;
+
+   client.setCACert(rootCA);
+
+   HTTPClient http;
+
+   // HTTP/1.0 evita a codificação chunked, permitindo ler o stream sem guardar o corpo em uma String
+   http.useHTTP10(true);
+   http.begin(client, findUrl);
+   http.addHeader("api-key", apiKey);
+   http.addHeader("Content-Type", "application/json");
+   http.addHeader("Accept", "application/json");
+
+   int httpResponseCode = http.POST(json);
+
+   countStat(stats.cloudRequests);
+
+   Stream &stream = http.getStream();
+   bool success = httpResponseCode == 200 && stream.find("\"documents\"") && stream.find("[");
+
+   // Lê um elemento de "documents" por vez: a memória usada é a de um documento, qualquer que seja
+   // o número de bombas da página
+   if (success && stream.peek() != ']') {
+      do {
+         if (deserializeJson(document, stream, DeserializationOption::Filter(filter))) {
+            success = false;
+            break;
+         }
+
+         store(document);
+      } while (stream.findUntil(",", "]"));
+   }
+
+   http.end();
+
+   return success;
+}
+
+void SiteConfigCache::store(JsonDocument &document) {
+   String serialized;
+   serializeJson(document, serialized);
+
+   uint32_t version = hash(serialized);
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      Entry *entry = findEntry(document["pumperCode"].as<String>());
+
+      if (entry != NULL && version != entry->version) {
+         entry->document = serialized;
+         entry->version = version;
+      }
+      xSemaphoreGive(mutex);
+   }
+}
+
+// client é o IP da placa que pediu o documento, ou IPAddress() quando a própria placa consulta
+int SiteConfigCache::serve(const String &pumperCode, uint32_t version, String &document, uint32_t &currentVersion, const IPAddress &client) {
+   int status = 404;
+   bool known = false;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      Entry *entry = findEntry(pumperCode);
+
+      if (entry != NULL) {
+         known = true;
+
+         if (entry->version != 0) {
+            currentVersion = entry->version;
+
+            if (entry->version == version) {
+               status = 304;
+            } else {
+               document = entry->document;
+               status = 200;
+            }
+         }
+      }
+
+      stats.served++;
+      xSemaphoreGive(mutex);
+   }
+
+   // Passa a buscar o código na próxima atualização; até lá o cliente usa a nuvem
+   if (!known)
+      learn(pumperCode, client);
+
+   return status;
+}
+
+// Só aprende códigos de placas anunciadas via mDNS e até SITE_CACHE_MAX_ENTRIES entradas, para
+// que pedidos de fora do site não aumentem a memória usada nem o número de requisições à nuvem
+void SiteConfigCache::learn(const String &pumperCode, const IPAddress &client) {
+   bool eligible = pumperCode.length() > 0 && pumperCode.length() <= SITE_CACHE_MAX_CODE && isDiscovered(client);
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      // Outro pedido pode ter aprendido o mesmo código enquanto o mutex estava livre
+      if (eligible && findEntry(pumperCode) == NULL && entries.size() < SITE_CACHE_MAX_ENTRIES)
+         entries.push_back({pumperCode, String(), 0});
+      else if (!eligible || findEntry(pumperCode) == NULL)
+         stats.refused++;
+      xSemaphoreGive(mutex);
+   }
+}
+
+bool SiteConfigCache::isDiscovered(const IPAddress &client) {
+   if (client == IPAddress())
+      return false;
+
+   MDNS.updateBrowse();
+
+   for (const MDNSBrowseResult &result : MDNS.browseResults())
+      if (result.ip == client)
+         return true;
+
+   return false;
+}
+
+bool SiteConfigCache::locate() {
+   MDNS.updateBrowse();
+
+   for (const MDNSBrowseResult &result : MDNS.browseResults()) {
+      for (const std::pair<String, String> &txt : result.txt) {
+         if (txt.first == "cache" && txt.second == "1" && result.ip != IPAddress()) {
+            cacheIP = result.ip;
+            cachePort = result.port;
+            return true;
+         }
+      }
+   }
+
+   if (!MDNS.isBrowsing())
+      MDNS.browseService(SITE_CACHE_SERVICE, SITE_CACHE_PROTO);
+
+   cachePort = 0;
+   return false;
+}
+
+// Retorna 200 quando o documento foi atualizado, 304 quando não mudou e valores
+// negativos quando o cache local não pôde ser usado
+int SiteConfigCache::fetch(const char *pumperCode, JsonDocument &jsonData) {
+   uint32_t knownVersion = getKnownVersion(pumperCode);
+   uint32_t currentVersion = 0;
+   String document;
+   int status;
+
+   if (cacheRole) {
+      status = serve(pumperCode, knownVersion, document, currentVersion, IPAddress());
+   } else {
+      if (cachePort == 0 && !locate()) {
+         countStat(stats.fallbacks);
+         return -1;
+      }
+
+      HTTPClient http;
+
+      http.begin(cacheIP.toString(), cachePort, String(SITE_CACHE_PATH) + "?code=" + pumperCode + "&version=" + knownVersion);
+
+      const char *headers[] = {"X-Config-Version"};
+      http.collectHeaders(headers, 1);
+
+      status = http.GET();
+      if (status == 200) {
+         document = http.getString();
+         currentVersion = strtoul(http.header("X-Config-Version").c_str(), NULL, 10);
+      }
+
+      http.end();
+
+      // Esquece o cache após uma falha de conexão para procurá-lo novamente via mDNS
+      if (status < 0)
+         cachePort = 0;
+   }
+
+   if (status == 304) {
+      countStat(stats.notModified);
+      return status;
+   }
+
+   if (status != 200 || deserializeJson(jsonData, document)) {
+      countStat(stats.fallbacks);
+      return -1;
+   }
+
+   setKnownVersion(pumperCode, currentVersion);
+   countStat(stats.localHits);
+
+   return status;
+}
+
+void SiteConfigCache::recordCloudRequest() {
+   countStat(stats.cloudRequests);
+}
+
+// Cópia consistente: a task de atualização e o handler do servidor assíncrono atualizam as estatísticas
+SiteCacheStats SiteConfigCache::getStats() {
+   SiteCacheStats copy;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      copy = stats;
+      xSemaphoreGive(mutex);
+   }
+
+   return copy;
+}
+
+void SiteConfigCache::countStat(uint32_t &counter) {
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      counter++;
+      xSemaphoreGive(mutex);
+   }
+}
+
+uint32_t SiteConfigCache::hash(const String &value) {
+   uint32_t result = 2166136261UL;
+
+   for (size_t index = 0; index < value.length(); index++) {
+      result ^= (uint8_t)value[index];
+      result *= 16777619UL;
+   }
+
+   return result;
+}
+
+SiteConfigCache::Entry *SiteConfigCache::findEntry(const String &pumperCode) {
+   for (Entry &entry : entries)
+      if (entry.pumperCode == pumperCode)
+         return &entry;
+
+   return NULL;
+}
+
+uint32_t SiteConfigCache::getKnownVersion(const char *pumperCode) {
+   for (KnownVersion &known : knownVersions)
+      if (known.pumperCode == pumperCode)
+         return known.version;
+
+   return 0;
+}
+
+void SiteConfigCache::setKnownVersion(const char *pumperCode, uint32_t version) {
+   for (KnownVersion &known : knownVersions) {
+      if (known.pumperCode == pumperCode) {
+         known.version = version;
+         return;
+      }
+   }
+
+   knownVersions.push_back({pumperCode, version});
+}
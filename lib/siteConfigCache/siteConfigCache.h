@@ -0,0 +1,91 @@
+#ifndef _SITECONFIGCACHE_
+#define _SITECONFIGCACHE_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define SITE_CACHE_SERVICE "_tomatoes"
+#define SITE_CACHE_PROTO "_tcp"
+#define SITE_CACHE_PATH "/site/config"
+#define SITE_CACHE_DOCUMENT_SIZE 4096  // Um elemento da resposta da nuvem, já filtrado
+#define SITE_CACHE_FILTER_SIZE 256
+#define SITE_CACHE_PAGE_SIZE 8  // Códigos por requisição à nuvem
+#define SITE_CACHE_BODY_SIZE (JSON_OBJECT_SIZE(4) + 2 * JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(SITE_CACHE_PAGE_SIZE))
+#define SITE_CACHE_MAX_ENTRIES 64  // Inclui os códigos da própria placa
+#define SITE_CACHE_MAX_CODE 32     // Maior código aprendido de outra placa
+
+struct SiteCacheStats {
+   uint32_t cloudRequests = 0;  // Requisições TLS feitas ao MongoDB Atlas
+   uint32_t localHits = 0;      // Configurações recebidas do cache local
+   uint32_t notModified = 0;    // Respostas 304 (versão inalterada)
+   uint32_t fallbacks = 0;      // Cache local indisponível, recorreu à nuvem
+   uint32_t served = 0;         // Requisições atendidas como cache
+   uint32_t refused = 0;        // Códigos desconhecidos não aprendidos (placa fora do mDNS ou cache cheio)
+};
+
+// Replica a configuração das bombas entre placas da mesma rede: uma placa (compilada com
+// SITE_CONFIG_CACHE) busca a agenda de todo o site na nuvem, SITE_CACHE_PAGE_SIZE códigos por
+// requisição, e as demais a consultam por HTTP local, recebendo o documento apenas quando a
+// versão muda
+class SiteConfigCache {
+  public:
+   SiteConfigCache(bool cacheRole);
+
+   void begin();
+
+   bool isCacheRole();
+
+   void registerCode(const String &pumperCode);
+   bool refresh(const char *findUrl, const char *apiKey, const char *rootCA, JsonVariantConst fields);
+   int serve(const String &pumperCode, uint32_t version, String &document, uint32_t &currentVersion, const IPAddress &client);
+
+   bool locate();
+   int fetch(const char *pumperCode, JsonDocument &jsonData);
+
+   void recordCloudRequest();
+
+   SiteCacheStats getStats();
+
+   static uint32_t hash(const String &value);
+
+  private:
+   struct Entry {
+      String pumperCode;
+      String document;
+      uint32_t version;
+   };
+
+   struct KnownVersion {
+      String pumperCode;
+      uint32_t version;
+   };
+
+   const bool cacheRole;
+
+   std::vector<Entry> entries;
+   std::vector<KnownVersion> knownVersions;
+
+   IPAddress cacheIP;
+   uint16_t cachePort = 0;
+
+   SiteCacheStats stats;
+   SemaphoreHandle_t mutex = NULL;
+
+   bool refreshPage(const char *findUrl, const char *apiKey, const char *rootCA, const String *codes, size_t count, JsonDocument &filter,
+                    JsonDocument &document);
+   void store(JsonDocument &document);
+   void learn(const String &pumperCode, const IPAddress &client);
+   bool isDiscovered(const IPAddress &client);
+   void countStat(uint32_t &counter);
+
+   Entry *findEntry(const String &pumperCode);
+   uint32_t getKnownVersion(const char *pumperCode);
+   void setKnownVersion(const char *pumperCode, uint32_t version);
+};
+
+#endif
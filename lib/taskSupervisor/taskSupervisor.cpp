@@ -0,0 +1,312 @@
+#include "taskSupervisor.h"
+
+TaskSupervisor::TaskSupervisor(uint32_t checkInterval, uint32_t stableTime)
+    : checkInterval(checkInterval),
+      stableTime(stableTime) {
+}
+
+// O timeout do task watchdog (em ms) e o panic valem para todas as tasks inscritas nele, inclusive a
+// idle task do núcleo 0 inscrita pelo core do Arduino: uma task que monopolize esse núcleo pelo
+// timeout inteiro também reinicia a placa, em vez de apenas imprimir o aviso do watchdog.
+bool TaskSupervisor::begin(uint32_t watchdogTimeout) {
+   return esp_task_wdt_init(max(watchdogTimeout / 1000, (uint32_t)1), true) == ESP_OK;
+}
+
+// Cria a task e passa a supervisioná-la. A função da task deve retornar quando isCancelled() for
+// verdadeiro, depois de liberar o que estiver usando; ela é então chamada de novo na mesma task.
+bool TaskSupervisor::start(const SupervisedTask &task, TaskHandle_t *handle) {
+   if (count >= SUPERVISOR_MAX_TASKS)
+      return false;
+
+   portENTER_CRITICAL(&mux);
+   Entry &entry = entries[count];
+   entry.task = task;
+   entry.supervisor = this;
+   entry.handle = handle;
+   entry.lastBeat = millis();
+   entry.lastRecovery = 0;
+   entry.measure = false;
+   entry.relapsed = false;
+   entry.cancelled = false;
+   entry.health = TaskHealth();
+   entry.health.name = task.name;
+   portEXIT_CRITICAL(&mux);
+
+   if (xTaskCreatePinnedToCore(&TaskSupervisor::run, task.name, task.stackSize, &entry, task.priority, handle, task.core) != pdPASS)
+      return false;
+
+   portENTER_CRITICAL(&mux);
+   count++;
+   portEXIT_CRITICAL(&mux);
+
+   return true;
+}
+
+// Chamado pela própria task a cada ciclo
+void TaskSupervisor::heartbeat() {
+   uint32_t now = millis();
+
+   portENTER_CRITICAL(&mux);
+   Entry *entry = findCurrent();
+
+   if (entry != NULL) {
+      TaskHealth &health = entry->health;
+
+      // O intervalo após um início ou uma espera sem prazo não representa o ciclo da task
+      if (entry->measure) {
+         uint32_t gap = now - entry->lastBeat;
+
+         health.lastGap = gap;
+         if (gap > health.maxGap)
+            health.maxGap = gap;
+
+         if (health.avgGap == 0)
+            health.avgGap = gap;
+         else
+            health.avgGap += ((int32_t)gap - (int32_t)health.avgGap) / 8;
+
+         health.jitter += ((int32_t)abs((int32_t)gap - (int32_t)health.avgGap) - (int32_t)health.jitter) / 8;
+      }
+
+      health.beats++;
+      health.idle = false;
+      entry->lastBeat = now;
+      entry->measure = true;
+   }
+   portEXIT_CRITICAL(&mux);
+}
+
+// Chamado antes de uma espera sem prazo (ex.: pelo WiFi), suspende a verificação até o próximo heartbeat
+void TaskSupervisor::idle() {
+   portENTER_CRITICAL(&mux);
+   Entry *entry = findCurrent();
+
+   if (entry != NULL) {
+      entry->health.idle = true;
+      entry->measure = false;
+   }
+   portEXIT_CRITICAL(&mux);
+}
+
+// Ponto de cancelamento, consultado pela própria task onde ela pode encerrar o ciclo com segurança
+bool TaskSupervisor::isCancelled() {
+   bool cancelled = false;
+
+   portENTER_CRITICAL(&mux);
+   Entry *entry = findCurrent();
+   if (entry != NULL)
+      cancelled = entry->cancelled;
+   portEXIT_CRITICAL(&mux);
+
+   return cancelled;
+}
+
+// Deve ser chamado periodicamente por uma única task, que fica inscrita no task watchdog. Retorna o
+// tempo em ms até a próxima verificação.
+uint32_t TaskSupervisor::check() {
+   if (!watching) {
+      watching = esp_task_wdt_add(NULL) == ESP_OK;
+      stats.watchdog = watching;
+   }
+
+   stats.checks++;
+
+   for (size_t index = 0; index < count && !rebooting; index++) {
+      Entry &entry = entries[index];
+      uint32_t now = millis();
+      bool recover;
+
+      portENTER_CRITICAL(&mux);
+      uint32_t gap = now - entry.lastBeat;
+      bool late = !entry.health.idle && gap > entry.task.deadline;
+
+      if (late)
+         stats.missed++;
+
+      if (entry.health.level > 0 && now - entry.lastRecovery < stableTime) {
+         // A etapa anterior ainda tem tempo para agir: o atraso só é anotado e a task recebe um novo prazo
+         if (late) {
+            entry.relapsed = true;
+            entry.lastBeat = now;
+            entry.measure = false;
+         }
+         recover = false;
+      } else if (entry.health.level > 0 && !late && !entry.relapsed) {
+         entry.health.level = 0;
+         recover = false;
+      } else {
+         recover = late || entry.relapsed;
+      }
+      portEXIT_CRITICAL(&mux);
+
+      if (!recover)
+         continue;
+
+      RecoveryAction action = escalate(entry);
+      recordEvent(index, action);
+
+      if (recoveryCallback)
+         recoveryCallback(entry.task.name, action, gap);
+
+      if (action == RECOVER_RESET_NETWORK && networkCallback) {
+         networkCallback();
+
+         portENTER_CRITICAL(&mux);
+         stats.networkResets++;
+         portEXIT_CRITICAL(&mux);
+      } else if (action == RECOVER_REBOOT) {
+         rebooting = true;
+      }
+   }
+
+   // Sem alimentar o watchdog a placa reinicia mesmo que o callback de reinício trave
+   if (rebooting) {
+      if (rebootCallback)
+         rebootCallback();
+      else
+         ESP.restart();
+
+      return checkInterval;
+   }
+
+   if (watching)
+      esp_task_wdt_reset();
+
+   return checkInterval;
+}
+
+void TaskSupervisor::onRecovery(std::function<void(const char *, RecoveryAction, uint32_t)> callback) {
+   recoveryCallback = callback;
+}
+
+void TaskSupervisor::onNetworkReset(std::function<void()> callback) {
+   networkCallback = callback;
+}
+
+void TaskSupervisor::onReboot(std::function<void()> callback) {
+   rebootCallback = callback;
+}
+
+size_t TaskSupervisor::getCount() {
+   return count;
+}
+
+TaskHealth TaskSupervisor::getHealth(size_t index) {
+   TaskHealth copy;
+
+   portENTER_CRITICAL(&mux);
+   if (index < count)
+      copy = entries[index].health;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
+
+// Copia os eventos de recuperação do mais antigo ao mais recente
+size_t TaskSupervisor::getEvents(RecoveryEvent *events, size_t maxEvents) {
+   size_t copied = 0;
+
+   portENTER_CRITICAL(&mux);
+   size_t first = (eventHead + SUPERVISOR_MAX_EVENTS - eventCount) % SUPERVISOR_MAX_EVENTS;
+   for (; copied < eventCount && copied < maxEvents; copied++)
+      events[copied] = this->events[(first + copied) % SUPERVISOR_MAX_EVENTS];
+   portEXIT_CRITICAL(&mux);
+
+   return copied;
+}
+
+SupervisorStats TaskSupervisor::getStats() {
+   SupervisorStats copy;
+
+   portENTER_CRITICAL(&mux);
+   copy = stats;
+   portEXIT_CRITICAL(&mux);
+
+   return copy;
+}
+
+const char *TaskSupervisor::getActionName(RecoveryAction action) {
+   switch (action) {
+      case RECOVER_CANCEL_TASK:
+         return "cancel";
+      case RECOVER_RESET_NETWORK:
+         return "network";
+      case RECOVER_REBOOT:
+         return "reboot";
+      default:
+         return "none";
+   }
+}
+
+TaskSupervisor::Entry *TaskSupervisor::findCurrent() {
+   TaskHandle_t current = xTaskGetCurrentTaskHandle();
+
+   for (size_t index = 0; index < count; index++)
+      if (*entries[index].handle == current)
+         return &entries[index];
+
+   return NULL;
+}
+
+// Aplica a etapa registrada seguinte à última aplicada: cancelamento, reinício da rede e reinício da
+// placa. Sem etapas restantes a task apenas recebe um novo prazo.
+RecoveryAction TaskSupervisor::escalate(Entry &entry) {
+   static const RecoveryAction steps[RECOVERY_LEVELS] = {RECOVER_CANCEL_TASK, RECOVER_RESET_NETWORK, RECOVER_REBOOT};
+   RecoveryAction action = RECOVER_NONE;
+
+   portENTER_CRITICAL(&mux);
+   for (uint8_t level = entry.health.level; level < RECOVERY_LEVELS; level++) {
+      if (entry.task.recovery & steps[level]) {
+         action = steps[level];
+         entry.health.level = level + 1;
+         break;
+      }
+   }
+
+   // O reinício da rede libera a task presa na conexão para que ela atenda o cancelamento
+   if (action == RECOVER_CANCEL_TASK || action == RECOVER_RESET_NETWORK)
+      entry.cancelled = true;
+   if (action == RECOVER_CANCEL_TASK)
+      stats.cancels++;
+   else if (action == RECOVER_REBOOT)
+      stats.reboots++;
+
+   entry.lastBeat = millis();
+   entry.measure = false;
+   entry.relapsed = false;
+
+   if (action != RECOVER_NONE) {
+      entry.lastRecovery = entry.lastBeat;
+      entry.health.recoveries++;
+   }
+   portEXIT_CRITICAL(&mux);
+
+   return action;
+}
+
+// Corpo de todas as tasks supervisionadas: a função retorna ao atender um cancelamento e recomeça
+// com a pilha limpa, sem vTaskDelete() e sem perder os mutexes que ela tenha liberado ao sair
+void TaskSupervisor::run(void *arg) {
+   Entry *entry = (Entry *)arg;
+   TaskSupervisor *supervisor = entry->supervisor;
+
+   while (1) {
+      entry->task.function(NULL);
+
+      portENTER_CRITICAL(&supervisor->mux);
+      entry->cancelled = false;
+      entry->measure = false;
+      entry->lastBeat = millis();
+      supervisor->stats.restarts++;
+      portEXIT_CRITICAL(&supervisor->mux);
+   }
+}
+
+void TaskSupervisor::recordEvent(size_t index, RecoveryAction action) {
+   portENTER_CRITICAL(&mux);
+   events[eventHead] = {(uint32_t)millis(), (uint8_t)index, action};
+   eventHead = (eventHead + 1) % SUPERVISOR_MAX_EVENTS;
+   if (eventCount < SUPERVISOR_MAX_EVENTS)
+      eventCount++;
+   portEXIT_CRITICAL(&mux);
+}
@@ -0,0 +1,135 @@
+#ifndef _TASKSUPERVISOR_
+#define _TASKSUPERVISOR_
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "esp_task_wdt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define SUPERVISOR_MAX_TASKS 10
+#define SUPERVISOR_MAX_EVENTS 8
+
+// Etapas de recuperação, aplicadas em ordem, uma por vez. Uma task registra apenas as etapas que
+// fazem sentido para ela. Depois de cada etapa a task tem stableTime para se recuperar: um novo
+// prazo perdido nesse período leva à etapa seguinte quando ele termina. Nenhuma task é apagada de
+// fora, o cancelamento é cooperativo.
+enum RecoveryAction : uint8_t {
+   RECOVER_NONE = 0,
+   RECOVER_CANCEL_TASK = 1,    // A task encerra o ciclo no próximo isCancelled() e recomeça do início
+   RECOVER_RESET_NETWORK = 2,  // Derruba a conexão que prende a task, que ainda deve atender o cancelamento
+   RECOVER_REBOOT = 4,
+};
+
+#define RECOVERY_LEVELS 3
+
+struct SupervisedTask {
+   TaskFunction_t function;
+   const char *name;
+   uint32_t stackSize;
+   UBaseType_t priority;
+   BaseType_t core;
+   uint32_t deadline;       // Em ms, maior intervalo aceito entre dois heartbeats
+   uint8_t recovery;  // Combinação de RecoveryAction
+};
+
+struct TaskHealth {
+   const char *name = NULL;
+   uint32_t beats = 0;
+   uint32_t lastGap = 0;  // Em ms
+   uint32_t avgGap = 0;   // Em ms, média móvel
+   uint32_t jitter = 0;   // Em ms, média móvel do desvio em relação a avgGap
+   uint32_t maxGap = 0;   // Em ms
+   uint32_t recoveries = 0;
+   uint8_t level = 0;     // Última etapa aplicada (1 a RECOVERY_LEVELS), 0 depois de um período estável
+   bool idle = false;
+};
+
+struct RecoveryEvent {
+   uint32_t time;  // Em ms desde o boot
+   uint8_t task;
+   RecoveryAction action;
+};
+
+struct SupervisorStats {
+   uint32_t checks = 0;
+   uint32_t missed = 0;  // Prazos perdidos
+   uint32_t cancels = 0;
+   uint32_t restarts = 0;  // Cancelamentos atendidos pela task
+   uint32_t networkResets = 0;
+   uint32_t reboots = 0;
+   bool watchdog = false;
+};
+
+// Cria e supervisiona as tasks: cada uma envia heartbeats e, ao perder o prazo, passa por
+// recuperações progressivas (cancelar o ciclo da task, reiniciar a rede, reiniciar a placa). A
+// task que chama check() alimenta o task watchdog, que reinicia a placa caso o próprio supervisor trave.
+class TaskSupervisor {
+  public:
+   TaskSupervisor(uint32_t checkInterval, uint32_t stableTime);
+
+   bool begin(uint32_t watchdogTimeout);
+
+   bool start(const SupervisedTask &task, TaskHandle_t *handle);
+
+   void heartbeat();
+   void idle();
+   bool isCancelled();
+
+   uint32_t check();
+
+   void onRecovery(std::function<void(const char *, RecoveryAction, uint32_t)> callback);
+   void onNetworkReset(std::function<void()> callback);
+   void onReboot(std::function<void()> callback);
+
+   size_t getCount();
+   TaskHealth getHealth(size_t index);
+   size_t getEvents(RecoveryEvent *events, size_t maxEvents);
+   SupervisorStats getStats();
+
+   static const char *getActionName(RecoveryAction action);
+
+  private:
+   struct Entry {
+      SupervisedTask task;
+      TaskSupervisor *supervisor;
+      TaskHandle_t *handle;
+      uint32_t lastBeat;
+      uint32_t lastRecovery;
+      bool measure;   // O próximo heartbeat mede o intervalo do ciclo
+      bool relapsed;  // Perdeu o prazo durante o período estável da última etapa
+      volatile bool cancelled;
+      TaskHealth health;
+   };
+
+   const uint32_t checkInterval;
+   const uint32_t stableTime;
+
+   Entry entries[SUPERVISOR_MAX_TASKS];
+   size_t count = 0;
+
+   RecoveryEvent events[SUPERVISOR_MAX_EVENTS];
+   size_t eventCount = 0;
+   size_t eventHead = 0;
+
+   bool watching = false;
+   bool rebooting = false;
+
+   std::function<void(const char *, RecoveryAction, uint32_t)> recoveryCallback;
+   std::function<void()> networkCallback;
+   std::function<void()> rebootCallback;
+
+   SupervisorStats stats;
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+   Entry *findCurrent();
+   RecoveryAction escalate(Entry &entry);
+   void recordEvent(size_t index, RecoveryAction action);
+
+   static void run(void *arg);
+};
+
+#endif
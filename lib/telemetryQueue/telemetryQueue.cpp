@@ -0,0 +1,365 @@
+#include "telemetryQueue.h"
+
+TelemetryQueue::TelemetryQueue(TelemetryQueuePolicy policy) {
+   this->policy = policy;
+}
+
+bool TelemetryQueue::begin(const char *partitionLabel) {
+   partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+
+   if (partition == NULL) {
+      log_e("Telemetry partition %s not found, flash the partitions_telemetry.csv table over serial", partitionLabel);
+      return false;
+   }
+
+   sectorCount = partition->size / TELEMETRY_QUEUE_SECTOR_SIZE;
+
+   if (sectorCount < 2) {
+      log_e("Telemetry partition too small");
+      partition = NULL;
+      return false;
+   }
+
+   // O setor de cabeça é o de maior sequência entre os setores válidos
+   SectorHeader header;
+   SectorHeader headHeader = {};
+   bool found = false;
+
+   for (uint16_t sector = 0; sector < sectorCount; sector++) {
+      if (readHeader(sector, &header) && (!found || header.sectorSequence > headHeader.sectorSequence)) {
+         headHeader = header;
+         head.sector = sector;
+         found = true;
+      }
+   }
+
+   if (!found) {
+      if (!eraseSector(0, 1, 1)) {
+         partition = NULL;
+         return false;
+      }
+      head = {0, 0};
+      tail = head;
+      headSectorSequence = 1;
+      nextSequence = 1;
+      tailSequence = 1;
+      return true;
+   }
+
+   headSectorSequence = headHeader.sectorSequence;
+
+   Record record;
+   head.slot = 0;
+   while (head.slot < recordsPerSector && readRecord(head, &record) && record.sequence != UINT32_MAX)
+      head.slot++;
+
+   nextSequence = headHeader.firstSequence + head.slot;
+
+   // Percorre do setor mais antigo ao mais novo procurando a última marca de consumo
+   bool tailFound = false;
+   bool oldestFound = false;
+
+   for (uint16_t offset = 1; offset <= sectorCount; offset++) {
+      uint16_t sector = (head.sector + offset) % sectorCount;
+
+      if (!readHeader(sector, &header))
+         continue;
+
+      if (!oldestFound) {
+         tail = {sector, 0};
+         tailSequence = header.firstSequence;
+         oldestFound = true;
+      }
+
+      for (uint16_t slot = 0; slot < recordsPerSector; slot++) {
+         Position position = {sector, slot};
+
+         if (!readRecord(position, &record) || record.sequence == UINT32_MAX)
+            break;
+
+         if (record.state == RECORD_CONSUMED) {
+            tail = {sector, (uint16_t)(slot + 1)};
+            tailSequence = record.sequence + 1;
+            tailFound = true;
+         }
+      }
+   }
+
+   if (!tailFound && !oldestFound) {
+      tail = head;
+      tailSequence = nextSequence;
+   }
+
+   normalize(tail);
+
+   return true;
+}
+
+bool TelemetryQueue::isAvailable() {
+   return partition != NULL;
+}
+
+size_t TelemetryQueue::push(const TelemetrySample *samples, size_t length) {
+   if (partition == NULL)
+      return 0;
+
+   Record records[32];
+   size_t accepted = 0;
+
+   while (accepted < length) {
+      if (head.slot >= recordsPerSector && !openNextSector())
+         break;
+
+      // Grava os registros consecutivos do setor atual em uma única escrita
+      size_t run = min((size_t)(recordsPerSector - head.slot), length - accepted);
+      run = min(run, sizeof(records) / sizeof(Record));
+
+      for (size_t index = 0; index < run; index++) {
+         const TelemetrySample &sample = samples[accepted + index];
+         Record &record = records[index];
+
+         record.sequence = nextSequence + index;
+         record.timestamp = sample.timestamp;
+         record.value = sample.value;
+         record.type = sample.type;
+         record.source = sample.source;
+         record.state = 0xFF;
+         record.crc = crc8((const uint8_t *)&record, offsetof(Record, state));
+      }
+
+      if (esp_partition_write(partition, offsetOf(head), records, run * sizeof(Record)) != ESP_OK) {
+         log_e("Failed writing telemetry records");
+         break;
+      }
+
+      stats.flashWrites++;
+      head.slot += run;
+      nextSequence += run;
+      accepted += run;
+   }
+
+   if (accepted > 0)
+      stats.batches++;
+   stats.pushed += accepted;
+   stats.rejected += length - accepted;
+
+   return accepted;
+}
+
+size_t TelemetryQueue::read(TelemetrySample *output, size_t maxLength) {
+   if (partition == NULL)
+      return 0;
+
+   Position position = tail;
+   uint32_t sequence = tailSequence;
+   size_t length = 0;
+
+   pendingCount = 0;
+
+   while (length < maxLength && sequence < nextSequence) {
+      normalize(position);
+
+      Record record;
+      if (!readRecord(position, &record))
+         break;
+
+      if (record.crc == crc8((const uint8_t *)&record, offsetof(Record, state))) {
+         output[length].timestamp = record.timestamp;
+         output[length].value = record.value;
+         output[length].type = record.type;
+         output[length].source = record.source;
+         length++;
+      } else {
+         stats.corrupted++;
+      }
+
+      position.slot++;
+      sequence++;
+      pendingCount++;
+   }
+
+   pendingTail = position;
+   pendingSequence = sequence;
+
+   return length;
+}
+
+void TelemetryQueue::commit() {
+   if (partition == NULL || pendingCount == 0)
+      return;
+
+   // Marca apenas o último registro lido: no boot a cauda é reconstruída a partir dessa marca
+   Position last = pendingTail;
+   last.slot--;
+
+   uint8_t consumed = RECORD_CONSUMED;
+   if (esp_partition_write(partition, offsetOf(last) + offsetof(Record, state), &consumed, sizeof(consumed)) == ESP_OK)
+      stats.flashWrites++;
+
+   stats.commits++;
+   stats.drained += pendingSequence - tailSequence;
+
+   tail = pendingTail;
+   tailSequence = pendingSequence;
+   pendingCount = 0;
+
+   normalize(tail);
+}
+
+// Ciclo de envio do vTaskTelemetry: fecha a janela do buffer da RAM e esvazia a fila assim que a
+// conexão voltar. Enquanto houver amostras antigas na flash o lote entra no fim da fila, e a nuvem
+// recebe tudo na ordem em que foi amostrado. Sem a partição (placa atualizada por OTA com a tabela
+// antiga) as amostras esperam a conexão na RAM, até a capacidade do buffer, em vez de serem
+// descartadas. networkMutex, quando informado, é tomado durante cada envio.
+void TelemetryQueue::flush(TelemetryUploader &telemetry, TelemetrySample *batch, size_t capacity, bool online, SemaphoreHandle_t networkMutex) {
+   bool direct = online && size() == 0;
+
+   if (telemetry.isWindowElapsed() && (direct || isAvailable())) {
+      // Com backpressure as amostras só saem da RAM quando houver espaço na flash
+      size_t room = capacity;
+      if (!direct && policy == QUEUE_BACKPRESSURE)
+         room = min(room, getFree());
+
+      size_t length = telemetry.takeBatch(batch, room);
+
+      if (length > 0 && !(direct && send(telemetry, batch, length, networkMutex)))
+         push(batch, length);
+   }
+
+   // Esvazia a fila em lotes; um lote só é marcado como consumido depois de enviado
+   while (online && size() > 0) {
+      size_t pending = size();
+      size_t length = read(batch, capacity);
+
+      if (length > 0 && !send(telemetry, batch, length, networkMutex))
+         break;
+
+      commit();
+
+      if (size() == pending)
+         break;
+   }
+}
+
+size_t TelemetryQueue::size() {
+   return nextSequence - tailSequence;
+}
+
+size_t TelemetryQueue::getFree() {
+   size_t used = size();
+   size_t capacity = getCapacity();
+
+   return used < capacity ? capacity - used : 0;
+}
+
+size_t TelemetryQueue::getCapacity() {
+   // Todos os setores recebem registros: o mais antigo só é apagado quando o de cabeça enche e a
+   // fila precisa de um novo setor, descartando-o (DROP_OLDEST) ou recusando a escrita (BACKPRESSURE)
+   return sectorCount * recordsPerSector;
+}
+
+void TelemetryQueue::setPolicy(TelemetryQueuePolicy newPolicy) {
+   policy = newPolicy;
+}
+
+TelemetryQueuePolicy TelemetryQueue::getPolicy() {
+   return policy;
+}
+
+TelemetryQueueStats TelemetryQueue::getStats() {
+   return stats;
+}
+
+bool TelemetryQueue::openNextSector() {
+   uint16_t next = (head.sector + 1) % sectorCount;
+
+   if (size() > 0 && tail.sector == next) {
+      if (policy == QUEUE_BACKPRESSURE)
+         return false;
+
+      // Descarta o setor mais antigo inteiro
+      uint32_t lost = recordsPerSector - tail.slot;
+
+      stats.dropped += lost;
+      tailSequence += lost;
+      tail = {(uint16_t)((next + 1) % sectorCount), 0};
+      pendingCount = 0;
+   }
+
+   if (!eraseSector(next, headSectorSequence + 1, nextSequence))
+      return false;
+
+   headSectorSequence++;
+   head = {next, 0};
+
+   return true;
+}
+
+bool TelemetryQueue::eraseSector(uint16_t sector, uint32_t sectorSequence, uint32_t firstSequence) {
+   SectorHeader header;
+   uint32_t eraseCount = readHeader(sector, &header) ? header.eraseCount + 1 : 1;
+
+   if (esp_partition_erase_range(partition, sector * TELEMETRY_QUEUE_SECTOR_SIZE, TELEMETRY_QUEUE_SECTOR_SIZE) != ESP_OK) {
+      log_e("Failed erasing telemetry sector %u", sector);
+      return false;
+   }
+
+   stats.flashErases++;
+   if (eraseCount > stats.maxEraseCount)
+      stats.maxEraseCount = eraseCount;
+
+   header = {TELEMETRY_QUEUE_MAGIC, sectorSequence, eraseCount, firstSequence};
+
+   if (esp_partition_write(partition, sector * TELEMETRY_QUEUE_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+      log_e("Failed writing telemetry sector header");
+      return false;
+   }
+
+   stats.flashWrites++;
+
+   return true;
+}
+
+void TelemetryQueue::normalize(Position &position) {
+   if (position.slot >= recordsPerSector)
+      position = {(uint16_t)((position.sector + 1) % sectorCount), 0};
+}
+
+size_t TelemetryQueue::offsetOf(Position position) {
+   return position.sector * TELEMETRY_QUEUE_SECTOR_SIZE + sizeof(SectorHeader) + position.slot * sizeof(Record);
+}
+
+bool TelemetryQueue::readHeader(uint16_t sector, SectorHeader *header) {
+   if (esp_partition_read(partition, sector * TELEMETRY_QUEUE_SECTOR_SIZE, header, sizeof(SectorHeader)) != ESP_OK)
+      return false;
+
+   return header->magic == TELEMETRY_QUEUE_MAGIC;
+}
+
+bool TelemetryQueue::readRecord(Position position, Record *record) {
+   return esp_partition_read(partition, offsetOf(position), record, sizeof(Record)) == ESP_OK;
+}
+
+uint8_t TelemetryQueue::crc8(const uint8_t *data, size_t length) {
+   uint8_t crc = 0;
+
+   for (size_t index = 0; index < length; index++) {
+      crc ^= data[index];
+      for (uint8_t bit = 0; bit < 8; bit++)
+         crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+   }
+
+   return crc;
+}
+
+bool TelemetryQueue::send(TelemetryUploader &telemetry, const TelemetrySample *batch, size_t length, SemaphoreHandle_t networkMutex) {
+   if (networkMutex != NULL && !xSemaphoreTake(networkMutex, portMAX_DELAY))
+      return false;
+
+   bool sent = telemetry.upload(batch, length);
+
+   if (networkMutex != NULL)
+      xSemaphoreGive(networkMutex);
+
+   return sent;
+}
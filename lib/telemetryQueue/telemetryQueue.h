@@ -0,0 +1,112 @@
+#ifndef _TELEMETRYQUEUE_
+#define _TELEMETRYQUEUE_
+
+#include <Arduino.h>
+
+#include "esp_partition.h"
+#include "telemetryUploader.h"
+
+#define TELEMETRY_QUEUE_MAGIC 0x544C4F47
+#define TELEMETRY_QUEUE_SECTOR_SIZE 4096
+
+enum TelemetryQueuePolicy : uint8_t {
+   QUEUE_DROP_OLDEST = 0,
+   QUEUE_BACKPRESSURE = 1,
+};
+
+struct TelemetryQueueStats {
+   uint32_t batches = 0;  // Lotes gravados por push()
+   uint32_t commits = 0;  // Lotes marcados como consumidos
+   uint32_t pushed = 0;
+   uint32_t drained = 0;
+   uint32_t dropped = 0;
+   uint32_t rejected = 0;
+   uint32_t corrupted = 0;
+   uint32_t flashWrites = 0;
+   uint32_t flashErases = 0;
+   uint32_t maxEraseCount = 0;
+};
+
+// Fila FIFO persistente em um log circular sobre uma partição de dados crua.
+// Cada setor de 4 KB tem um cabeçalho seguido de registros de tamanho fixo e
+// os setores são apagados em rodízio, distribuindo o desgaste da flash.
+class TelemetryQueue {
+  public:
+   TelemetryQueue(TelemetryQueuePolicy policy = QUEUE_DROP_OLDEST);
+
+   // Falha quando a tabela de partições gravada na placa não tem a partição (ver
+   // partitions_telemetry.csv): a fila fica indisponível e push() não aceita registros
+   bool begin(const char *partitionLabel = "telemetry");
+   bool isAvailable();
+
+   size_t push(const TelemetrySample *samples, size_t length);
+
+   size_t read(TelemetrySample *output, size_t maxLength);
+   void commit();
+
+   void flush(TelemetryUploader &telemetry, TelemetrySample *batch, size_t capacity, bool online, SemaphoreHandle_t networkMutex = NULL);
+
+   size_t size();
+   size_t getFree();
+   size_t getCapacity();
+
+   void setPolicy(TelemetryQueuePolicy newPolicy);
+   TelemetryQueuePolicy getPolicy();
+
+   TelemetryQueueStats getStats();
+
+  private:
+   struct SectorHeader {
+      uint32_t magic;
+      uint32_t sectorSequence;
+      uint32_t eraseCount;
+      uint32_t firstSequence;
+   };
+
+   struct Record {
+      uint32_t sequence;
+      uint32_t timestamp;
+      int32_t value;
+      uint8_t type;
+      uint8_t source;
+      uint8_t state;
+      uint8_t crc;
+   };
+
+   struct Position {
+      uint16_t sector;
+      uint16_t slot;
+   };
+
+   static const uint16_t recordsPerSector = (TELEMETRY_QUEUE_SECTOR_SIZE - sizeof(SectorHeader)) / sizeof(Record);
+   static const uint8_t RECORD_CONSUMED = 0x00;
+
+   const esp_partition_t *partition = NULL;
+   uint16_t sectorCount = 0;
+
+   TelemetryQueuePolicy policy;
+   TelemetryQueueStats stats;
+
+   Position head = {0, 0};
+   Position tail = {0, 0};
+   Position pendingTail = {0, 0};
+
+   uint32_t headSectorSequence = 0;
+   uint32_t nextSequence = 0;
+   uint32_t tailSequence = 0;
+   uint32_t pendingSequence = 0;
+   size_t pendingCount = 0;
+
+   bool openNextSector();
+   bool eraseSector(uint16_t sector, uint32_t sectorSequence, uint32_t firstSequence);
+   void normalize(Position &position);
+
+   size_t offsetOf(Position position);
+   bool readHeader(uint16_t sector, SectorHeader *header);
+   bool readRecord(Position position, Record *record);
+
+   static bool send(TelemetryUploader &telemetry, const TelemetrySample *batch, size_t length, SemaphoreHandle_t networkMutex);
+   static uint8_t crc8(const uint8_t *data, size_t length);
+};
+
+#endif
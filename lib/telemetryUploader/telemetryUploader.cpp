@@ -0,0 +1,176 @@
+#include "telemetryUploader.h"
+
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+#include "memoryPlacement.h"
+
+TelemetryUploader::TelemetryUploader(size_t capacity, uint32_t window)
+    : capacity(capacity),
+      window(window) {
+   windowStart = millis();
+   mutex = xSemaphoreCreateMutex();
+}
+
+TelemetryUploader::~TelemetryUploader() {
+   MemoryPlacement::release(samples);
+   vSemaphoreDelete(mutex);
+}
+
+void TelemetryUploader::begin(String deviceId, const char *url, const char *apiKey, const char *rootCA) {
+   this->deviceId = deviceId;
+   this->url = url;
+   this->apiKey = apiKey;
+   this->rootCA = rootCA;
+
+   // Alocado aqui e não no construtor global para que a PSRAM já esteja disponível
+   if (samples == NULL)
+      samples = MemoryPlacement::construct<TelemetrySample>(capacity, MEMORY_COLD);
+}
+
+bool TelemetryUploader::record(TelemetryType type, uint8_t source, int32_t value, uint32_t timestamp) {
+   bool recorded = false;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      if (samples != NULL && count < capacity) {
+         samples[count++] = {timestamp, value, (uint8_t)type, source};
+         recorded = true;
+      } else {
+         stats.dropped++;
+      }
+      xSemaphoreGive(mutex);
+   }
+
+   return recorded;
+}
+
+bool TelemetryUploader::isWindowElapsed() {
+   return (millis() - windowStart >= window) || count >= capacity;
+}
+
+size_t TelemetryUploader::takeBatch(TelemetrySample *output, size_t maxLength) {
+   size_t length = 0;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      length = min(count, maxLength);
+      memcpy(output, samples, length * sizeof(TelemetrySample));
+
+      // Amostras que não couberam permanecem no buffer para a próxima janela
+      memmove(samples, samples + length, (count - length) * sizeof(TelemetrySample));
+      count -= length;
+
+      windowStart = millis();
+      xSemaphoreGive(mutex);
+   }
+
+   return length;
+}
+
+bool TelemetryUploader::upload(const TelemetrySample *batch, size_t length) {
+   if (url == NULL || length == 0)
+      return false;
+
+   String payload;
+   size_t bytes = serializeBatch(batch, length, payload);
+
+   // Um lote truncado nunca é enviado: retornar false mantém as amostras na RAM ou na fila da flash
+   if (bytes == 0) {
+      if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+         stats.overflows++;
+         xSemaphoreGive(mutex);
+      }
+      return false;
+   }
+
+   uint32_t startTime = millis();
+   bool success = post(payload);
+   uint32_t latency = millis() - startTime;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      if (success) {
+         stats.batches++;
+         stats.samples += length;
+         stats.lastBatchSize = length;
+         stats.lastBytes = bytes;
+         stats.totalBytes += bytes;
+      } else {
+         stats.failures++;
+      }
+      stats.lastLatency = latency;
+      if (latency > stats.maxLatency)
+         stats.maxLatency = latency;
+      xSemaphoreGive(mutex);
+   }
+
+   return success;
+}
+
+size_t TelemetryUploader::getPending() {
+   return count;
+}
+
+void TelemetryUploader::setWindow(uint32_t newWindow) {
+   window = newWindow;
+}
+
+uint32_t TelemetryUploader::getWindow() {
+   return window;
+}
+
+TelemetryStats TelemetryUploader::getStats() {
+   TelemetryStats copy;
+
+   if (xSemaphoreTake(mutex, portMAX_DELAY)) {
+      copy = stats;
+      xSemaphoreGive(mutex);
+   }
+
+   return copy;
+}
+
+// Retorna 0 caso o documento não comporte o lote inteiro
+size_t TelemetryUploader::serializeBatch(const TelemetrySample *batch, size_t length, String &output) {
+   // Chaves curtas reduzem o payload: d = dispositivo, t = timestamp, k = tipo, s = origem, v = valor.
+   // Chaves, valores fixos e o deviceId entram como const char*, que o ArduinoJson referencia sem
+   // copiar, então o documento só precisa dos nós: raiz, array e um objeto de 5 membros por amostra.
+   DynamicJsonDocument body(JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(length) + length * JSON_OBJECT_SIZE(5));
+
+   body["dataSource"] = "Tomatoes";
+   body["database"] = "first-api";
+   body["collection"] = "telemetry";
+
+   JsonArray documents = body.createNestedArray("documents");
+
+   for (size_t index = 0; index < length; index++) {
+      JsonObject object = documents.createNestedObject();
+      object["d"] = deviceId.c_str();
+      object["t"] = batch[index].timestamp;
+      object["k"] = batch[index].type;
+      object["s"] = batch[index].source;
+      object["v"] = batch[index].value;
+   }
+
+   if (body.overflowed())
+      return 0;
+
+   return serializeJson(body, output);
+}
+
+bool TelemetryUploader::post(const String &payload) {
+   WiFiClientSecure client;
+
+   client.setCACert(rootCA);
+
+   HTTPClient http;
+
+   http.begin(client, url);
+   http.addHeader("api-key", apiKey);
+   http.addHeader("Content-Type", "application/json");
+   http.addHeader("Accept", "application/json");
+
+   int httpResponseCode = http.POST(payload);
+
+   http.end();
+
+   return httpResponseCode >= 200 && httpResponseCode < 300;
+}
@@ -0,0 +1,85 @@
+#ifndef _TELEMETRYUPLOADER_
+#define _TELEMETRYUPLOADER_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+enum TelemetryType : uint8_t {
+   TELEMETRY_PUMP_EVENT = 0,
+   TELEMETRY_RSSI = 1,
+   TELEMETRY_HEAP = 2,
+   TELEMETRY_NTP_OFFSET = 3,
+   TELEMETRY_WAKE_LATENCY = 4,
+   TELEMETRY_SOIL_MOISTURE = 5,
+   TELEMETRY_TANK_LEVEL = 6,
+   TELEMETRY_LARGEST_BLOCK = 7,  // Maior bloco livre do heap, acompanha a fragmentação ao longo das semanas
+};
+
+// Registro de tamanho fixo para que o lote ocupe um bloco contíguo de memória
+struct TelemetrySample {
+   uint32_t timestamp;
+   int32_t value;
+   uint8_t type;
+   uint8_t source;
+};
+
+struct TelemetryStats {
+   uint32_t batches = 0;
+   uint32_t samples = 0;
+   uint32_t failures = 0;
+   uint32_t dropped = 0;
+   uint32_t overflows = 0;  // Lotes que não couberam no documento JSON (sem memória), mantidos para a próxima tentativa
+   uint32_t lastBatchSize = 0;
+   uint32_t lastBytes = 0;
+   uint32_t totalBytes = 0;
+   uint32_t lastLatency = 0;  // Em ms
+   uint32_t maxLatency = 0;   // Em ms
+};
+
+class TelemetryUploader {
+  public:
+   TelemetryUploader(size_t capacity, uint32_t window);
+
+   ~TelemetryUploader();
+
+   void begin(String deviceId, const char *url, const char *apiKey, const char *rootCA);
+
+   bool record(TelemetryType type, uint8_t source, int32_t value, uint32_t timestamp);
+
+   bool isWindowElapsed();
+
+   size_t takeBatch(TelemetrySample *output, size_t maxLength);
+
+   bool upload(const TelemetrySample *batch, size_t length);
+
+   size_t getPending();
+
+   void setWindow(uint32_t newWindow);
+   uint32_t getWindow();
+
+   TelemetryStats getStats();
+
+  private:
+   String deviceId;
+   const char *url = NULL;
+   const char *apiKey = NULL;
+   const char *rootCA = NULL;
+
+   TelemetrySample *samples = NULL;
+   size_t capacity;
+   size_t count = 0;
+
+   uint32_t window;
+   uint32_t windowStart;
+
+   TelemetryStats stats;
+   SemaphoreHandle_t mutex;
+
+   size_t serializeBatch(const TelemetrySample *batch, size_t length, String &output);
+   bool post(const String &payload);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "wifiSupervisor.h"
+
+WiFiSupervisor::WiFiSupervisor(uint32_t minBackoff, uint32_t maxBackoff)
+    : minBackoff(minBackoff),
+      maxBackoff(maxBackoff),
+      timer("WiFiTimer", minBackoff, pdFALSE, (void *)this, &WiFiSupervisor::reconnectCallback) {
+}
+
+void WiFiSupervisor::begin(const char *ssid, const char *password) {
+   eventGroup = xEventGroupCreate();
+
+   WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+      onEvent(event, info);
+   });
+
+   // A reconexão fica a cargo do supervisor para que o backoff seja respeitado
+   WiFi.setAutoReconnect(false);
+   WiFi.mode(WIFI_STA);
+   WiFi.begin(ssid, password);
+}
+
+bool WiFiSupervisor::waitConnected(TickType_t timeout) {
+   return xEventGroupWaitBits(eventGroup, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE, timeout) & WIFI_CONNECTED_BIT;
+}
+
+bool WiFiSupervisor::isConnected() {
+   return xEventGroupGetBits(eventGroup) & WIFI_CONNECTED_BIT;
+}
+
+EventGroupHandle_t WiFiSupervisor::getEventGroup() {
+   return eventGroup;
+}
+
+WiFiSupervisorStats WiFiSupervisor::getStats() {
+   return stats;
+}
+
+void WiFiSupervisor::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+   switch (event) {
+      case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+         xEventGroupSetBits(eventGroup, WIFI_CONNECTED_BIT);
+         timer.stop();
+
+         if (disconnectedAt != 0) {
+            uint32_t outage = millis() - disconnectedAt;
+
+            stats.reconnects++;
+            stats.lastOutage = outage;
+            stats.totalOutage += outage;
+            if (outage > stats.maxOutage)
+               stats.maxOutage = outage;
+
+            disconnectedAt = 0;
+         }
+
+         attempt = 0;
+         wasConnected = true;
+         break;
+
+      case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+         xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
+
+         if (wasConnected && disconnectedAt == 0) {
+            stats.disconnects++;
+            disconnectedAt = millis();
+         }
+
+         scheduleReconnect();
+         break;
+
+      default:
+         break;
+   }
+}
+
+void WiFiSupervisor::scheduleReconnect() {
+   uint32_t backoff = maxBackoff;
+
+   if (attempt < 16)
+      backoff = min(minBackoff << attempt, maxBackoff);
+
+   // Jitter de até 50% evita que várias placas reconectem ao mesmo tempo
+   backoff = backoff / 2 + esp_random() % (backoff / 2 + 1);
+
+   attempt++;
+   stats.nextBackoff = backoff;
+
+   timer.changePeriod(backoff);
+   timer.start();
+}
+
+void WiFiSupervisor::reconnectCallback(TimerHandle_t xTimer) {
+   WiFiSupervisor *supervisor = (WiFiSupervisor *)pvTimerGetTimerID(xTimer);
+
+   supervisor->stats.attempts++;
+   WiFi.reconnect();
+}
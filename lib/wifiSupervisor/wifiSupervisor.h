@@ -0,0 +1,57 @@
+#ifndef _WIFISUPERVISOR_
+#define _WIFISUPERVISOR_
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "freeRTOSTimerController.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#define WIFI_CONNECTED_BIT BIT0
+
+struct WiFiSupervisorStats {
+   uint32_t disconnects = 0;
+   uint32_t reconnects = 0;
+   uint32_t attempts = 0;
+   uint32_t lastOutage = 0;   // Em ms
+   uint32_t maxOutage = 0;    // Em ms
+   uint32_t totalOutage = 0;  // Em ms
+   uint32_t nextBackoff = 0;  // Em ms
+};
+
+// Supervisiona a conexão a partir dos eventos do WiFi, sem polling: cada queda agenda
+// uma única tentativa de reconexão com backoff exponencial e jitter
+class WiFiSupervisor {
+  public:
+   WiFiSupervisor(uint32_t minBackoff, uint32_t maxBackoff);
+
+   void begin(const char *ssid, const char *password);
+
+   bool waitConnected(TickType_t timeout);
+   bool isConnected();
+
+   EventGroupHandle_t getEventGroup();
+
+   WiFiSupervisorStats getStats();
+
+  private:
+   const uint32_t minBackoff;
+   const uint32_t maxBackoff;
+
+   EventGroupHandle_t eventGroup = NULL;
+   FreeRTOSTimer timer;
+
+   uint32_t attempt = 0;
+   uint32_t disconnectedAt = 0;
+   bool wasConnected = false;
+
+   WiFiSupervisorStats stats;
+
+   void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+   void scheduleReconnect();
+
+   static void reconnectCallback(TimerHandle_t xTimer);
+};
+
+#endif
@@ -4,80 +4,276 @@
 #include <ESPAsyncWebServer.h>
 #include <ESPmDNS.h>
 #include <HTTPClient.h>
+#include <Preferences.h>
 #include <Update.h>
 #include <WiFi.h>
 #include <WiFiUDP.h>
 
+#include <atomic>
+#include <new>
 #include <set>
+#include <type_traits>
 
 #include "NTPClient.h"
 #include "SPIFFS.h"
+#include "apiCredentials.h"
+#include "asyncLogger.h"
+#include "boardProfile.h"
+#include "controlProtocol.h"
+#include "crashLog.h"
+#include "deepSleepScheduler.h"
+#include "driveSchedule.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "eventStream.h"
+#include "freeRTOSTimerController.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
 #include "hydraulicPumpController.h"
+#include "jsonPool.h"
+#include "memoryPlacement.h"
 #include "mongoDbAtlas.h"
+#include "powerManager.h"
+#include "pumpConfiguration.h"
+#include "pumpJournal.h"
+#include "pumpScheduler.h"
+#include "pumpSequencer.h"
+#include "requestGovernor.h"
+#include "scheduleRequest.h"
+#include "sensorSampler.h"
+#include "siteConfigCache.h"
+#include "taskSupervisor.h"
+#include "telemetryQueue.h"
+#include "telemetryUploader.h"
 #include "wifiCredentials.h"
+#include "wifiSupervisor.h"
 
 /*
 Task                Core  Prio     Descrição
 ----------------------------------------------------------------------------------------------------
-vTaskTurnOnPump      1     2     Liga a bomba quando chegar no seu horário de acionamento
+vTaskPumpController  1     3     Atende a agenda de todas as bombas a partir de um min-heap de prazos e aciona as
+                                 bombas pedidas respeitando limites de simultaneidade e intertravamentos
 vTaskNTP             0     1     Atualiza o horário com base no NTP
-vTaskUpdate          0     3     Atualiza as informações através de um POST no MongoDB Atlas
-vTaskCheckWiFi       0     2     Verifica a conexão WiFi e tenta reconectar caso esteja deconectado
+vTaskUpdate          0     3     Envia ao MongoDB Atlas as alterações pendentes da API local e atualiza as informações
+                                 de todas as bombas através do cache local do site ou de um POST no MongoDB Atlas
+vTaskSiteCache       0     3     (SITE_CONFIG_CACHE) Busca a configuração de todas as bombas do site no MongoDB Atlas
+vTaskTelemetry       0     1     Amostra RSSI e heap e envia a telemetria em lote para o MongoDB Atlas,
+                                 guardando os lotes na flash enquanto estiver offline
+vTaskSensors         1     1     (SENSOR_PIPELINE) Lê e filtra a umidade do solo e o nível do reservatório via ADC DMA
+vTaskEvents          0     1     Publica horário, RSSI e estado das saídas no stream SSE quando há painéis conectados
+vTaskLogger          0     1     Entrega os registros do log à serial, ao WebSocket /log e ao log de falhas na flash
+vTaskSupervisor      0     4     Verifica os heartbeats das demais tasks, aplica as recuperações e alimenta o task watchdog
 
 */
 
 // Configurações iniciais
+#define FIRMWARE_VERSION "1.1.0"
 #define LED_BUILTIN 25
-#define NUMBER_OUTPUTS 4
-#define ACTIVE_PUMPS 2
+#define NUMBER_OUTPUTS ActiveBoard::outputCount
+#define ACTIVE_PUMPS ActiveBoard::pumpCount
+#define TIME_OFFSET (-3 * 3600)
+#define MAX_SIZE_DOCUMENT JSON_POOL_LARGE_SIZE
+
+// Localização usada nas regras relativas ao nascer e pôr do sol quando a configuração não a informa
+#define SITE_LATITUDE -23.55
+#define SITE_LONGITUDE -46.63
 
 // Delay das tasks
-#define CHECK_WIFI_DELAY 100
 #define NTP_DELAY 600000
 #define UPDATE_DELAY 300000
 #define TURN_ON_PUMP_DELAY 100
-
-const uint8_t outputGPIOs[NUMBER_OUTPUTS] = {21, 19, 18, 5};
-
-// Tomatoes
-// HydraulicPumpController myPumps[ACTIVE_PUMPS] = {
-//     HydraulicPumpController("#01", outputGPIOs[1], 60000),
-//     HydraulicPumpController("#02", outputGPIOs[2], 900000),
-// };
-
-// Hydroponic
-HydraulicPumpController myPumps[ACTIVE_PUMPS] = {
-    HydraulicPumpController("#03", outputGPIOs[1], 900000),
-    HydraulicPumpController("#04", outputGPIOs[2], 900000),
-};
+#define NTP_WAIT_DELAY 1000
+#define TELEMETRY_SAMPLE_DELAY 60000
+
+// Configurações da telemetria
+#define TELEMETRY_WINDOW 900000
+#define TELEMETRY_CAPACITY 128
+
+// Backoff da reconexão WiFi
+#define WIFI_BACKOFF_MIN 1000
+#define WIFI_BACKOFF_MAX 120000
+
+// Modo de baixo consumo (instalações solares): habilitar com -D LOW_POWER_MODE. Com o core Arduino
+// pré-compilado é modem sleep e CPU a 80 MHz, sem light sleep (ver lib/powerManager)
+#ifdef LOW_POWER_MODE
+#define LOW_POWER_ENABLED true
+#else
+#define LOW_POWER_ENABLED false
+#endif
+#define LOW_POWER_MAX_SLEEP 60000
+
+// Partida suave das bombas via LEDC: habilitar com -D PUMP_SOFT_START
+#define SOFT_START_RAMP_UP 3000
+#define SOFT_START_RAMP_DOWN 1500
+
+// Sequenciamento das bombas
+#define SEQUENCER_MAX_CONCURRENT 1
+#define SEQUENCER_MIN_GAP 5000
+#define MASTER_VALVE_PIN SEQUENCER_NO_VALVE
+#define MASTER_VALVE_LEAD 2000
+
+// Cache de configuração do site: habilitar com -D SITE_CONFIG_CACHE em uma placa por rede
+#ifdef SITE_CONFIG_CACHE
+#define SITE_CACHE_ENABLED true
+#else
+#define SITE_CACHE_ENABLED false
+#endif
+
+// Sensores de umidade do solo (GPIO34) e nível do reservatório (GPIO35): habilitar com -D SENSOR_PIPELINE
+#define SENSOR_SOIL_CHANNEL ADC1_CHANNEL_6
+#define SENSOR_TANK_CHANNEL ADC1_CHANNEL_7
+
+// API local (PUT /pumps/{i}/schedule e /pumps/{i}/pulse), autenticada pelo token de include/apiCredentials.h
+#define LOCAL_API_NAMESPACE "localApi"
+
+// Stream SSE dos painéis (/events): no máximo um envio por intervalo, com os valores agrupados
+#define EVENTS_INTERVAL 1000
+#define EVENTS_MAX_CLIENTS 4
+#define EVENTS_MAX_BACKLOG 8
+
+// Admissão das requisições HTTP: vagas simultâneas, arquivos abertos e heap mínimo
+#define HTTP_MAX_CONCURRENT 8
+#define HTTP_RESERVED_PRIORITY 2
+#define HTTP_MAX_FILES 2
+#define HTTP_MIN_HEAP 40000
+#define HTTP_MIN_BLOCK 12000
+#define HTTP_RETRY_AFTER 5
+
+// Log assíncrono: nível padrão dos módulos (alterar com -D LOG_LEVEL=LOG_DEBUG) e log de falhas na flash
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_INFO
+#endif
+#define LOG_DRAIN_DELAY 200
+#define LOG_RATE_LIMIT 20  // Registros por módulo a cada segundo; os excedentes são descartados e contados
+#define LOG_FLASH_LEVEL LOG_WARN
+#define LOG_FLASH_INTERVAL 60000  // Em ms, prazo para gravar na flash as linhas pendentes do log de falhas
+#define LOG_FLASH_PATH "/crash.log"
+#define LOG_FLASH_OLD_PATH "/crash.old"
+#define LOG_FLASH_MAX_SIZE 16384
+
+// Supervisão das tasks: prazo entre heartbeats de cada task e recuperação progressiva. As tasks de
+// rede recebem a margem de um ciclo completo de requisições HTTPS além do seu intervalo.
+#define SUPERVISOR_CHECK_INTERVAL 1000
+#define SUPERVISOR_STABLE_TIME 600000
+#define SUPERVISOR_WDT_TIMEOUT 10000
+#define SUPERVISOR_HTTP_MARGIN 120000
+#define SUPERVISOR_NETWORK_RECOVERY (RECOVER_CANCEL_TASK | RECOVER_RESET_NETWORK | RECOVER_REBOOT)
+
+// Retomada após um reset: pulsos interrompidos com ao menos PUMP_RESUME_MIN ms restantes são
+// retomados e horários perdidos nos últimos CATCH_UP_WINDOW segundos são compensados conforme a política
+#define PUMP_RESUME_MIN 2000
+#define CATCH_UP_WINDOW 1800
+#define CATCH_UP_POLICY CATCH_UP_ONCE
+
+// Modo deep sleep (instalações a bateria): habilitar com -D DEEP_SLEEP_MODE
+#define DEEP_SLEEP_SYNC_EVERY 12
+#define DEEP_SLEEP_MAX_SLEEP 3600000
+
+static_assert(ACTIVE_PUMPS <= DEEP_SLEEP_MAX_PUMPS, "O perfil da placa excede as bombas suportadas no deep sleep");
+static_assert(ACTIVE_PUMPS <= PUMP_JOURNAL_MAX_PUMPS, "O perfil da placa excede as bombas suportadas no diário de acionamentos");
+static_assert(ACTIVE_PUMPS <= 32, "As alterações pendentes da API local são guardadas em uma máscara de 32 bits");
+static_assert(TELEMETRY_SAMPLE_DELAY + SUPERVISOR_HTTP_MARGIN <= SENSOR_DRAIN_INTERVAL, "As leituras dos sensores devem caber no buffer circular entre duas amostras da telemetria");
+
+// O AsyncWebServerRequest libera o _tempObject com free(), sem chamar o destrutor
+static_assert(std::is_trivially_destructible<ScheduleRequest>::value, "ScheduleRequest precisa ser liberado com free()");
+
+constexpr const uint8_t *outputGPIOs = ActiveBoard::Outputs::gpio;
+
+// Bombas e prioridades geradas a partir do perfil da placa (include/boardProfile.h)
+ActivePumpBank pumpBank;
+HydraulicPumpController (&myPumps)[ACTIVE_PUMPS] = pumpBank.pumps;
+
+PumpSequencer sequencer(myPumps, pumpBank.priorities, ACTIVE_PUMPS, SEQUENCER_MAX_CONCURRENT, SEQUENCER_MIN_GAP, MASTER_VALVE_PIN, MASTER_VALVE_LEAD);
+PumpScheduler pumpScheduler(myPumps, ACTIVE_PUMPS, TURN_ON_PUMP_DELAY, LOW_POWER_MAX_SLEEP);
+PumpJournal pumpJournal(ACTIVE_PUMPS, PUMP_RESUME_MIN);
 
 // Variáveis para armazenamento do handle das tasks e mutexes
 SemaphoreHandle_t xWifiMutex;
+SemaphoreHandle_t xLocalMutex;
 
-TaskHandle_t handleTurnOnPump = NULL;
+TaskHandle_t handlePumpController = NULL;
 TaskHandle_t handleNTP = NULL;
 TaskHandle_t handleUpdate = NULL;
-TaskHandle_t handleCheckWiFi = NULL;
+TaskHandle_t handleTelemetry = NULL;
+TaskHandle_t handleSiteCache = NULL;
+TaskHandle_t handleSensors = NULL;
+TaskHandle_t handleEvents = NULL;
+TaskHandle_t handleLogger = NULL;
+TaskHandle_t handleSupervisor = NULL;
 
 // Protótipos das Tasks
-void vTaskTurnOnPump(void *pvParametes);
+void vTaskPumpController(void *pvParameters);
 void vTaskNTP(void *pvParameters);
 void vTaskUpdate(void *pvParameters);
-void vTaskCheckWiFi(void *pvParametes);
+void vTaskTelemetry(void *pvParameters);
+void vTaskSiteCache(void *pvParameters);
+void vTaskSensors(void *pvParameters);
+void vTaskEvents(void *pvParameters);
+void vTaskLogger(void *pvParameters);
+void vTaskSupervisor(void *pvParameters);
+
+// Log sem bloquear as tasks que escrevem
+AsyncLogger logger(LOG_LEVEL, LOG_RATE_LIMIT);
+
+// Avisos e erros guardados na memória RTC e gravados na flash em lote
+CrashLog crashLog(LOG_FLASH_INTERVAL);
+
+// Heartbeats e recuperação das tasks
+TaskSupervisor supervisor(SUPERVISOR_CHECK_INTERVAL, SUPERVISOR_STABLE_TIME);
+
+// Supervisão da conexão WiFi
+WiFiSupervisor wifiSupervisor(WIFI_BACKOFF_MIN, WIFI_BACKOFF_MAX);
+
+// Gerenciamento de energia
+PowerManager powerManager(LOW_POWER_ENABLED, LOW_POWER_MAX_SLEEP);
+
+// Replicação da configuração entre as placas da rede local
+SiteConfigCache siteCache(SITE_CACHE_ENABLED);
+
+// Leitura dos sensores para decidir cada acionamento
+SensorSampler sensors(SENSOR_SOIL_CHANNEL, SENSOR_TANK_CHANNEL);
+
+// Alterações feitas pela API local, guardadas na NVS até serem enviadas ao MongoDB Atlas. A revisão
+// impede que uma alteração recebida durante o envio seja marcada como enviada.
+Preferences localChanges;
+std::atomic<uint32_t> pendingSchedules(0);
+std::atomic<uint32_t> pendingPulses(0);
+std::atomic<uint32_t> localRevision(0);
+
+// Execução da agenda em deep sleep
+DeepSleepScheduler deepSleep(DEEP_SLEEP_SYNC_EVERY, DEEP_SLEEP_MAX_SLEEP);
 
 // Configurações do NTP
 WiFiUDP udp;
-NTPClient ntp(udp, "a.st1.ntp.br", -3 * 3600, 3600000);
+NTPClient ntp(udp, "a.st1.ntp.br", TIME_OFFSET, 3600000);
+
+// Telemetria enviada em lote para o MongoDB Atlas
+TelemetryUploader telemetry(TELEMETRY_CAPACITY, TELEMETRY_WINDOW);
+TelemetryQueue telemetryQueue(QUEUE_DROP_OLDEST);
+TelemetrySample *telemetryBatch = NULL;
 
 // Configurações do WebServer
 String formatedTime;
 
 AsyncWebServer server(80);
+RequestGovernor governor({HTTP_MAX_CONCURRENT, HTTP_RESERVED_PRIORITY, HTTP_MAX_FILES, HTTP_MIN_HEAP, HTTP_MIN_BLOCK, HTTP_RETRY_AFTER});
 AsyncWebSocket ws("/ws");
+AsyncWebSocket logSocket("/log");
+EventStream events("/events", EVENTS_MAX_CLIENTS, EVENTS_INTERVAL, EVENTS_MAX_BACKLOG);
+
+// Remontagem das mensagens fragmentadas do WebSocket, uma por cliente
+#define CONTROL_MAX_CLIENTS DEFAULT_MAX_WS_CLIENTS
+
+struct ControlSession {
+   uint32_t clientId = 0;
+   bool active = false;
+   ControlAssembler message;
+};
+
+// Alocadas em initWebSocket, na PSRAM quando existir
+ControlSession *controlSessions = NULL;
 
 const char *getFormattedTime() {
    formatedTime = String(ntp.getFormattedTime());
@@ -106,7 +302,7 @@ const char *getHostname() {
    return ch;
 }
 
-const char *getPulseDuration(HydraulicPumpController pump) {
+const char *getPulseDuration(HydraulicPumpController &pump) {
    String pulseDuration = String(pump.getPulseDuration());
 
    char *ch = new char[pulseDuration.length() + 1];
@@ -122,6 +318,47 @@ String getID() {
    return id;
 }
 
+// Hash FNV-1a da agenda de todas as bombas, anunciado via mDNS
+uint32_t getScheduleHash() {
+   String schedule;
+
+   for (int indice = 0; indice < ACTIVE_PUMPS; indice++) {
+      schedule += myPumps[indice].pumperCode;
+      schedule += myPumps[indice].getPulseDuration();
+      for (String driveTime : myPumps[indice].getDriveTimes())
+         schedule += driveTime;
+   }
+
+   return SiteConfigCache::hash(schedule);
+}
+
+void updateServiceTxt() {
+   MDNS.addServiceTxt("_tomatoes", "_tcp", "schedule", String(getScheduleHash(), HEX));
+}
+
+String getBoards() {
+   // Dispara uma nova busca em segundo plano e responde com o que já está em cache
+   if (!MDNS.isBrowsing())
+      MDNS.browseService("_tomatoes", "_tcp");
+   MDNS.updateBrowse();
+
+   PooledJsonDocument boards(2048);
+
+   for (const MDNSBrowseResult &result : MDNS.browseResults()) {
+      JsonObject object = boards.createNestedObject();
+      object["hostname"] = result.hostname;
+      object["ip"] = result.ip.toString();
+      object["port"] = result.port;
+      for (const std::pair<String, String> &txt : result.txt)
+         object[txt.first] = txt.second;
+   }
+
+   String jsonString;
+   serializeJson(boards, jsonString);
+
+   return jsonString;
+}
+
 String sendTimers(std::set<String> pumpTimers) {
    String output;
 
@@ -134,11 +371,17 @@ String sendTimers(std::set<String> pumpTimers) {
 }
 
 String getOutputStates() {
-   DynamicJsonDocument myArray(512);
+   PooledJsonDocument myArray(512);
 
    for (int i = 0; i < NUMBER_OUTPUTS; i++) {
+      // Saídas em modo LEDC não podem ser lidas com digitalRead
+      int state = digitalRead(outputGPIOs[i]);
+      for (int indice = 0; indice < ACTIVE_PUMPS; indice++)
+         if (myPumps[indice].gpioPin == outputGPIOs[i])
+            state = myPumps[indice].getOutputState();
+
       myArray["gpios"][i]["output"] = String(outputGPIOs[i]);
-      myArray["gpios"][i]["state"] = String(digitalRead(outputGPIOs[i]));
+      myArray["gpios"][i]["state"] = String(state);
    }
    String jsonString;
    serializeJson(myArray, jsonString);
@@ -146,46 +389,661 @@ String getOutputStates() {
    return jsonString;
 }
 
+// Orçamento do documento do /metrics, contado por seção: cada membro de objeto ou elemento de array
+// ocupa um slot. As chaves e os textos são const char* referenciados sem cópia, exceto os nomes das
+// tasks (char*), copiados. Um campo novo deve entrar na contagem da sua seção.
+#define METRICS_TASK_HANDLES 9
+
+static constexpr size_t METRICS_DOCUMENT_SIZE =
+    JSON_OBJECT_SIZE(18) +                                                                             // Seções
+    JSON_OBJECT_SIZE(12) + JSON_OBJECT_SIZE(11) + JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(3) +          // telemetry, telemetryQueue, wifi, timers
+    JSON_OBJECT_SIZE(7) + JSON_ARRAY_SIZE(SCHEDULER_LATENCY_BUCKETS) +                                 // scheduler
+    JSON_OBJECT_SIZE(4 + METRICS_TASK_HANDLES) + METRICS_TASK_HANDLES * configMAX_TASK_NAME_LEN +      // tasks
+    JSON_OBJECT_SIZE(9) + JSON_OBJECT_SIZE(SUPERVISOR_MAX_TASKS) + SUPERVISOR_MAX_TASKS * JSON_OBJECT_SIZE(8) +
+    JSON_ARRAY_SIZE(SUPERVISOR_MAX_EVENTS) + SUPERVISOR_MAX_EVENTS * JSON_OBJECT_SIZE(3) +             // supervisor
+    JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(LOG_MODULES) + JSON_OBJECT_SIZE(6) +                        // log, crashLog
+    JSON_OBJECT_SIZE(6) + REGION_COUNT * JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(7) +                   // memory, jsonPool
+    JSON_OBJECT_SIZE(8 + REQUEST_EXEMPT) + REQUEST_EXEMPT * JSON_OBJECT_SIZE(2) +                      // http
+    JSON_OBJECT_SIZE(12) + JSON_OBJECT_SIZE(11) + JSON_OBJECT_SIZE(6) +                                // events, sequencer, journal
+    JSON_ARRAY_SIZE(ACTIVE_PUMPS) + ACTIVE_PUMPS * JSON_OBJECT_SIZE(7) +                               // pumps
+    JSON_OBJECT_SIZE(7) + JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(7) + JSON_OBJECT_SIZE(IRRIGATION_DRY_RUN + 1);  // siteCache, power, sensors
+
+static_assert(METRICS_DOCUMENT_SIZE <= JSON_POOL_LARGE_SIZE, "O /metrics deve caber em um bloco grande do JsonPool");
+
+String getMetrics() {
+   PooledJsonDocument metrics(METRICS_DOCUMENT_SIZE);
+
+   TelemetryStats telemetryStats = telemetry.getStats();
+   JsonObject telemetryObject = metrics.createNestedObject("telemetry");
+   telemetryObject["window"] = telemetry.getWindow();
+   telemetryObject["pending"] = telemetry.getPending();
+   telemetryObject["batches"] = telemetryStats.batches;
+   telemetryObject["samples"] = telemetryStats.samples;
+   telemetryObject["failures"] = telemetryStats.failures;
+   telemetryObject["dropped"] = telemetryStats.dropped;
+   telemetryObject["overflows"] = telemetryStats.overflows;
+   telemetryObject["lastBatchSize"] = telemetryStats.lastBatchSize;
+   telemetryObject["lastBytes"] = telemetryStats.lastBytes;
+   telemetryObject["totalBytes"] = telemetryStats.totalBytes;
+   telemetryObject["lastLatency"] = telemetryStats.lastLatency;
+   telemetryObject["maxLatency"] = telemetryStats.maxLatency;
+
+   TelemetryQueueStats queueStats = telemetryQueue.getStats();
+   JsonObject queueObject = metrics.createNestedObject("telemetryQueue");
+   queueObject["available"] = telemetryQueue.isAvailable();
+   queueObject["size"] = telemetryQueue.size();
+   queueObject["capacity"] = telemetryQueue.getCapacity();
+   queueObject["batches"] = queueStats.batches;
+   queueObject["commits"] = queueStats.commits;
+   queueObject["pushed"] = queueStats.pushed;
+   queueObject["drained"] = queueStats.drained;
+   queueObject["dropped"] = queueStats.dropped;
+   queueObject["rejected"] = queueStats.rejected;
+   queueObject["corrupted"] = queueStats.corrupted;
+   queueObject["flashWrites"] = queueStats.flashWrites;
+   queueObject["flashErases"] = queueStats.flashErases;
+   queueObject["maxEraseCount"] = queueStats.maxEraseCount;
+
+   WiFiSupervisorStats wifiStats = wifiSupervisor.getStats();
+   JsonObject wifiObject = metrics.createNestedObject("wifi");
+   wifiObject["connected"] = wifiSupervisor.isConnected();
+   wifiObject["disconnects"] = wifiStats.disconnects;
+   wifiObject["reconnects"] = wifiStats.reconnects;
+   wifiObject["attempts"] = wifiStats.attempts;
+   wifiObject["lastOutage"] = wifiStats.lastOutage;
+   wifiObject["maxOutage"] = wifiStats.maxOutage;
+   wifiObject["totalOutage"] = wifiStats.totalOutage;
+   wifiObject["nextBackoff"] = wifiStats.nextBackoff;
+
+   FreeRTOSTimerStats timerStats = FreeRTOSTimer::getGlobalStats();
+   JsonObject timerObject = metrics.createNestedObject("timers");
+   timerObject["commands"] = timerStats.commands;
+   timerObject["retries"] = timerStats.retries;
+   timerObject["failures"] = timerStats.failures;
+
+   PumpSchedulerStats schedulerStats = pumpScheduler.getStats();
+   JsonObject schedulerObject = metrics.createNestedObject("scheduler");
+   schedulerObject["checks"] = schedulerStats.checks;
+   schedulerObject["drives"] = schedulerStats.drives;
+   schedulerObject["missed"] = schedulerStats.missed;
+   schedulerObject["duplicates"] = schedulerStats.duplicates;
+   schedulerObject["rebuilds"] = schedulerStats.rebuilds;
+   schedulerObject["maxLateness"] = schedulerStats.maxLateness;
+   JsonArray latencyArray = schedulerObject.createNestedArray("latency");
+   for (uint32_t count : schedulerStats.latency)
+      latencyArray.add(count);
+
+   // Menor folga de stack já registrada por task, em bytes
+   JsonObject tasksObject = metrics.createNestedObject("tasks");
+   tasksObject["count"] = uxTaskGetNumberOfTasks();
+   tasksObject["freeHeap"] = ESP.getFreeHeap();
+   tasksObject["minFreeHeap"] = ESP.getMinFreeHeap();
+   tasksObject["largestFreeBlock"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+   const TaskHandle_t handles[METRICS_TASK_HANDLES] = {handlePumpController, handleUpdate, handleNTP, handleTelemetry, handleSiteCache,
+                                                       handleSensors, handleEvents, handleLogger, handleSupervisor};
+   for (TaskHandle_t handle : handles)
+      if (handle != NULL)
+         tasksObject[pcTaskGetTaskName(handle)] = uxTaskGetStackHighWaterMark(handle);
+
+   SupervisorStats supervisorStats = supervisor.getStats();
+   JsonObject supervisorObject = metrics.createNestedObject("supervisor");
+   supervisorObject["watchdog"] = supervisorStats.watchdog;
+   supervisorObject["checks"] = supervisorStats.checks;
+   supervisorObject["missed"] = supervisorStats.missed;
+   supervisorObject["cancels"] = supervisorStats.cancels;
+   supervisorObject["restarts"] = supervisorStats.restarts;
+   supervisorObject["networkResets"] = supervisorStats.networkResets;
+   supervisorObject["reboots"] = supervisorStats.reboots;
+   JsonObject heartbeatsObject = supervisorObject.createNestedObject("heartbeats");
+   for (size_t index = 0; index < supervisor.getCount(); index++) {
+      TaskHealth health = supervisor.getHealth(index);
+      JsonObject healthObject = heartbeatsObject.createNestedObject(health.name);
+      healthObject["beats"] = health.beats;
+      healthObject["lastGap"] = health.lastGap;
+      healthObject["avgGap"] = health.avgGap;
+      healthObject["jitter"] = health.jitter;
+      healthObject["maxGap"] = health.maxGap;
+      healthObject["recoveries"] = health.recoveries;
+      healthObject["level"] = health.level;
+      healthObject["idle"] = health.idle;
+   }
+   RecoveryEvent recoveryEvents[SUPERVISOR_MAX_EVENTS];
+   size_t recoveryCount = supervisor.getEvents(recoveryEvents, SUPERVISOR_MAX_EVENTS);
+   JsonArray recoveryArray = supervisorObject.createNestedArray("events");
+   for (size_t index = 0; index < recoveryCount; index++) {
+      JsonObject eventObject = recoveryArray.createNestedObject();
+      eventObject["time"] = recoveryEvents[index].time;
+      eventObject["task"] = supervisor.getHealth(recoveryEvents[index].task).name;
+      eventObject["action"] = TaskSupervisor::getActionName(recoveryEvents[index].action);
+   }
+
+   LoggerStats loggerStats = logger.getStats();
+   JsonObject logObject = metrics.createNestedObject("log");
+   logObject["written"] = loggerStats.written;
+   logObject["dropped"] = loggerStats.dropped;
+   logObject["truncated"] = loggerStats.truncated;
+   logObject["limited"] = loggerStats.limited;
+   logObject["maxUsed"] = loggerStats.maxUsed;
+   logObject["capacity"] = LOG_BUFFER_RECORDS;
+   JsonObject levelsObject = logObject.createNestedObject("levels");
+   for (uint8_t module = 0; module < LOG_MODULES; module++)
+      levelsObject[AsyncLogger::getModuleName((LogModule)module)] = logger.getLevel((LogModule)module);
+
+   CrashLogStats crashStats = crashLog.getStats();
+   JsonObject crashObject = logObject.createNestedObject("crashLog");
+   crashObject["pending"] = crashLog.getPending();
+   crashObject["recovered"] = crashStats.recovered;
+   crashObject["flushes"] = crashStats.flushes;
+   crashObject["flushed"] = crashStats.flushed;
+   crashObject["failures"] = crashStats.failures;
+   crashObject["dropped"] = crashStats.dropped;
+
+   PlacementStats placementStats = MemoryPlacement::getStats();
+   JsonObject memoryObject = metrics.createNestedObject("memory");
+   memoryObject["hasPsram"] = MemoryPlacement::hasPsram();
+   memoryObject["allocations"] = placementStats.allocations;
+   memoryObject["fallbacks"] = placementStats.fallbacks;
+   memoryObject["failures"] = placementStats.failures;
+   const char *regionNames[] = {"internal", "psram"};
+   for (uint8_t region = 0; region < REGION_COUNT; region++) {
+      RegionInfo info = MemoryPlacement::getRegion((MemoryRegion)region);
+      JsonObject regionObject = memoryObject.createNestedObject(regionNames[region]);
+      regionObject["total"] = info.total;
+      regionObject["free"] = info.free;
+      regionObject["minFree"] = info.minFree;
+      regionObject["largestBlock"] = info.largestBlock;
+      regionObject["placed"] = placementStats.placed[region];
+   }
+
+   JsonPoolStats poolStats = JsonPool::getStats();
+   JsonObject poolObject = metrics.createNestedObject("jsonPool");
+   poolObject["allocations"] = poolStats.allocations;
+   poolObject["fallbacks"] = poolStats.fallbacks;
+   poolObject["failures"] = poolStats.failures;
+   poolObject["largeInUse"] = poolStats.largeInUse;
+   poolObject["smallInUse"] = poolStats.smallInUse;
+   poolObject["maxLargeInUse"] = poolStats.maxLargeInUse;
+   poolObject["maxSmallInUse"] = poolStats.maxSmallInUse;
+
+   GovernorStats governorStats = governor.getStats();
+   JsonObject httpObject = metrics.createNestedObject("http");
+   httpObject["active"] = governorStats.active;
+   httpObject["maxActive"] = governorStats.maxActive;
+   httpObject["openFiles"] = governorStats.openFiles;
+   httpObject["shedLowHeap"] = governorStats.shedLowHeap;
+   httpObject["expired"] = governorStats.expired;
+   httpObject["p50"] = governorStats.p50;
+   httpObject["p99"] = governorStats.p99;
+   httpObject["maxLatency"] = governorStats.maxLatency;
+   const char *classNames[] = {"priority", "normal", "static"};
+   for (uint8_t requestClass = 0; requestClass < REQUEST_EXEMPT; requestClass++) {
+      JsonObject classObject = httpObject.createNestedObject(classNames[requestClass]);
+      classObject["admitted"] = governorStats.admitted[requestClass];
+      classObject["shed"] = governorStats.shed[requestClass];
+   }
+
+   EventStreamStats eventStats = events.getStats();
+   JsonObject eventsObject = metrics.createNestedObject("events");
+   eventsObject["clients"] = events.getClientCount();
+   eventsObject["interval"] = events.getInterval();
+   eventsObject["published"] = eventStats.published;
+   eventsObject["unchanged"] = eventStats.unchanged;
+   eventsObject["coalesced"] = eventStats.coalesced;
+   eventsObject["sent"] = eventStats.sent;
+   eventsObject["flushes"] = eventStats.flushes;
+   eventsObject["deferred"] = eventStats.deferred;
+   eventsObject["connects"] = eventStats.connects;
+   eventsObject["rejected"] = eventStats.rejected;
+   eventsObject["backlog"] = eventStats.backlog;
+   eventsObject["maxBacklog"] = eventStats.maxBacklog;
+
+   SequencerStats sequencerStats = sequencer.getStats();
+   JsonObject sequencerObject = metrics.createNestedObject("sequencer");
+   sequencerObject["queue"] = sequencer.getQueueLength();
+   sequencerObject["masterValve"] = sequencer.isMasterValveOpen();
+   sequencerObject["requested"] = sequencerStats.requested;
+   sequencerObject["started"] = sequencerStats.started;
+   sequencerObject["ignored"] = sequencerStats.ignored;
+   sequencerObject["cancelled"] = sequencerStats.cancelled;
+   sequencerObject["deferred"] = sequencerStats.deferred;
+   sequencerObject["failures"] = sequencerStats.failures;
+   sequencerObject["maxQueueLength"] = sequencerStats.maxQueueLength;
+   sequencerObject["maxWait"] = sequencerStats.maxWait;
+   sequencerObject["maxConcurrent"] = sequencerStats.maxConcurrent;
+
+   PumpJournalStats journalStats = pumpJournal.getStats();
+   JsonObject journalObject = metrics.createNestedObject("journal");
+   journalObject["recovered"] = journalStats.recovered;
+   journalObject["discarded"] = journalStats.discarded;
+   journalObject["resumed"] = journalStats.resumed;
+   journalObject["resumedTime"] = journalStats.resumedTime;
+   journalObject["caughtUp"] = journalStats.caughtUp;
+   journalObject["writes"] = journalStats.writes;
+
+   JsonArray pumpsArray = metrics.createNestedArray("pumps");
+   for (int indice = 0; indice < ACTIVE_PUMPS; indice++) {
+      PulseStats pulseStats = myPumps[indice].getPulseStats();
+      JsonObject pumpObject = pumpsArray.createNestedObject();
+      pumpObject["pumperCode"] = myPumps[indice].pumperCode;
+      pumpObject["pulses"] = pulseStats.pulses;
+      pumpObject["failures"] = pulseStats.failures;
+      pumpObject["lastRequested"] = pulseStats.lastRequested;
+      pumpObject["lastMeasured"] = pulseStats.lastMeasured;
+      pumpObject["lastError"] = pulseStats.lastError;
+      pumpObject["maxError"] = pulseStats.maxError;
+   }
+
+   SiteCacheStats siteStats = siteCache.getStats();
+   JsonObject siteObject = metrics.createNestedObject("siteCache");
+   siteObject["cacheRole"] = siteCache.isCacheRole();
+   siteObject["cloudRequests"] = siteStats.cloudRequests;
+   siteObject["localHits"] = siteStats.localHits;
+   siteObject["notModified"] = siteStats.notModified;
+   siteObject["fallbacks"] = siteStats.fallbacks;
+   siteObject["served"] = siteStats.served;
+   siteObject["refused"] = siteStats.refused;
+
+   PowerStats powerStats = powerManager.getStats();
+   JsonObject powerObject = metrics.createNestedObject("power");
+   powerObject["lowPower"] = powerManager.isLowPower();
+   powerObject["lightSleep"] = powerStats.lightSleep;
+   powerObject["cpuFrequency"] = powerStats.cpuFrequency;
+   powerObject["pollingTime"] = powerStats.pollingTime;
+   powerObject["blockedTime"] = powerStats.blockedTime;
+   powerObject["wakeups"] = powerStats.wakeups;
+   powerObject["awakeTime"] = powerStats.awakeTime;
+   powerObject["asleepTime"] = powerStats.asleepTime;
+   powerObject["dutyCycle"] = powerStats.dutyCycle;
+   powerObject["lastWakeLatency"] = powerStats.lastWakeLatency;
+   powerObject["maxWakeLatency"] = powerStats.maxWakeLatency;
+
+   SensorStats sensorStats = sensors.getStats();
+   JsonObject sensorObject = metrics.createNestedObject("sensors");
+   sensorObject["samples"] = sensorStats.samples;
+   sensorObject["published"] = sensorStats.published;
+   sensorObject["overruns"] = sensorStats.overruns;
+   sensorObject["readErrors"] = sensorStats.readErrors;
+   sensorObject["avgCycles"] = sensorStats.avgCycles;
+   sensorObject["maxCycles"] = sensorStats.maxCycles;
+   JsonObject decisionObject = sensorObject.createNestedObject("decisions");
+   decisionObject["run"] = sensorStats.decisions[IRRIGATION_RUN];
+   decisionObject["skip"] = sensorStats.decisions[IRRIGATION_SKIP];
+   decisionObject["shorten"] = sensorStats.decisions[IRRIGATION_SHORTEN];
+   decisionObject["extend"] = sensorStats.decisions[IRRIGATION_EXTEND];
+   decisionObject["dryRun"] = sensorStats.decisions[IRRIGATION_DRY_RUN];
+
+   // Métricas truncadas pareceriam contadores zerados: melhor não responder com elas
+   if (metrics.overflowed()) {
+      logger.log(LOG_WEB, LOG_ERROR, "Metrics document overflowed %u bytes, update METRICS_DOCUMENT_SIZE", (unsigned)METRICS_DOCUMENT_SIZE);
+      return "{\"error\":\"metrics overflowed\"}";
+   }
+
+   String jsonString;
+   serializeJson(metrics, jsonString);
+
+   return jsonString;
+}
+
+void recordPumpEvent(int indice, bool state) {
+   telemetry.record(TELEMETRY_PUMP_EVENT, indice, state, ntp.getEpochTime());
+}
+
 void notifyClients(String state) {
    ws.textAll(state);
 }
 
-void handleWebSocketMessage(void *arg, uint8_t *data, size_t len) {
+ControlSession *getControlSession(uint32_t clientId) {
+   ControlSession *available = NULL;
+
+   for (size_t index = 0; controlSessions != NULL && index < CONTROL_MAX_CLIENTS; index++) {
+      ControlSession &session = controlSessions[index];
+      if (session.active && session.clientId == clientId)
+         return &session;
+      if (!session.active && available == NULL)
+         available = &session;
+   }
+
+   if (available != NULL) {
+      available->clientId = clientId;
+      available->active = true;
+      available->message.reset();
+   }
+
+   return available;
+}
+
+void releaseControlSession(uint32_t clientId) {
+   for (size_t index = 0; controlSessions != NULL && index < CONTROL_MAX_CLIENTS; index++)
+      if (controlSessions[index].active && controlSessions[index].clientId == clientId)
+         controlSessions[index].active = false;
+}
+
+// Também retira da fila do sequenciador um acionamento ainda não atendido. O sequenciador acorda a
+// task das bombas, que aciona o próximo pedido à espera de vaga.
+void stopPumpByIndex(uint8_t indice) {
+   if (sequencer.stop(indice)) {
+      pumpJournal.recordStop(indice);
+      recordPumpEvent(indice, false);
+   }
+}
+
+// Troca a agenda da bomba de uma vez, mantendo a localização configurada. Nada muda se alguma regra
+// for recusada.
+bool applySchedule(size_t indice, const ScheduleRule *rules, size_t count) {
+   DriveSchedule schedule = myPumps[indice].getSchedule();
+
+   schedule.clear();
+   for (size_t index = 0; index < count; index++)
+      if (!schedule.addRule(rules[index]))
+         return false;
+
+   schedule.compile(ntp.getEpochTime());
+   myPumps[indice].setSchedule(schedule);
+   pumpScheduler.reschedule();
+
+   return true;
+}
+
+// Guarda a alteração na NVS e acorda a vTaskUpdate para enviá-la ao MongoDB Atlas
+void queueWriteBack() {
+   localRevision++;
+
+   if (handleUpdate != NULL)
+      xTaskNotifyGive(handleUpdate);
+}
+
+void storeSchedule(size_t indice, const ScheduleRule *rules, size_t count) {
+   char key[12];
+   snprintf(key, sizeof(key), "rules%u", (unsigned)indice);
+
+   xSemaphoreTake(xLocalMutex, portMAX_DELAY);
+   // putBytes não aceita tamanho zero, a ausência da chave representa uma agenda vazia
+   if (count > 0)
+      localChanges.putBytes(key, rules, count * sizeof(ScheduleRule));
+   else
+      localChanges.remove(key);
+   pendingSchedules |= 1UL << indice;
+   localChanges.putUInt("schedules", pendingSchedules);
+   xSemaphoreGive(xLocalMutex);
+
+   queueWriteBack();
+}
+
+void storePulse(size_t indice, uint32_t pulseDuration) {
+   char key[12];
+   snprintf(key, sizeof(key), "pulse%u", (unsigned)indice);
+
+   xSemaphoreTake(xLocalMutex, portMAX_DELAY);
+   localChanges.putUInt(key, pulseDuration);
+   pendingPulses |= 1UL << indice;
+   localChanges.putUInt("pulses", pendingPulses);
+   xSemaphoreGive(xLocalMutex);
+
+   queueWriteBack();
+}
+
+bool isLocalChangePending(size_t indice) {
+   return ((pendingSchedules | pendingPulses) & (1UL << indice)) != 0;
+}
+
+// Compara o token em tempo constante para não revelar o prefixo correto
+bool isAuthorized(AsyncWebServerRequest *request) {
+   if (!request->hasHeader("Authorization"))
+      return false;
+
+   String received = request->header("Authorization");
+   String expected = String("Bearer ") + apiToken;
+
+   if (received.length() != expected.length())
+      return false;
+
+   uint8_t difference = 0;
+   for (size_t index = 0; index < expected.length(); index++)
+      difference |= received[index] ^ expected[index];
+
+   return difference == 0;
+}
+
+// O corpo é validado à medida que chega, sem ser guardado por inteiro
+void onScheduleBody(AsyncWebServerRequest *request, ScheduleRequestKind kind, uint8_t *data, size_t len, size_t index, size_t total) {
+   if (index == 0) {
+      if (request->_tempObject != NULL || total > SCHEDULE_REQUEST_MAX_BODY || !isAuthorized(request))
+         return;
+
+      void *memory = MemoryPlacement::allocate(sizeof(ScheduleRequest), MEMORY_COLD);
+      if (memory == NULL)
+         return;
+
+      ScheduleRequest *body = new (memory) ScheduleRequest();
+      body->begin(kind);
+      request->_tempObject = body;
+   }
+
+   if (request->_tempObject != NULL)
+      ((ScheduleRequest *)request->_tempObject)->feed(data, len);
+}
+
+void sendLocalApiError(AsyncWebServerRequest *request, int code, const char *message) {
+   StaticJsonDocument<128> response;
+   response["error"] = message;
+
+   String jsonString;
+   serializeJson(response, jsonString);
+
+   request->send(code, "application/json", jsonString);
+}
+
+void handleScheduleRequest(AsyncWebServerRequest *request, size_t indice) {
+   ScheduleRequest *body = (ScheduleRequest *)request->_tempObject;
+
+   if (!isAuthorized(request))
+      return sendLocalApiError(request, 401, "Unauthorized");
+   if (request->contentLength() > SCHEDULE_REQUEST_MAX_BODY)
+      return sendLocalApiError(request, 413, "Body too large");
+   if (body == NULL)
+      return sendLocalApiError(request, 400, "Empty body");
+   if (!body->finish())
+      return sendLocalApiError(request, 400, body->getError());
+
+   StaticJsonDocument<128> response;
+   response["pumperCode"] = myPumps[indice].pumperCode;
+
+   if (body->getKind() == REQUEST_SCHEDULE) {
+      if (!applySchedule(indice, body->getRules(), body->getRuleCount()))
+         return sendLocalApiError(request, 400, "Invalid schedule");
+
+      storeSchedule(indice, body->getRules(), body->getRuleCount());
+      response["rules"] = body->getRuleCount();
+   } else {
+      // setPulseDuration reprograma o timer caso a bomba esteja acionada
+      myPumps[indice].setPulseDuration(body->getPulseDuration());
+      storePulse(indice, body->getPulseDuration());
+      response["pulseDuration"] = body->getPulseDuration();
+   }
+
+   String jsonString;
+   serializeJson(response, jsonString);
+
+   request->send(200, "application/json", jsonString);
+}
+
+ControlStatus executeControlCommand(const ControlCommand &command, bool &notify) {
+   uint8_t indice;
+   uint32_t pulseDuration;
+   uint32_t seconds[CONTROL_MAX_TIMES];
+   size_t count;
+
+   switch (command.opcode) {
+      case CONTROL_STATES:
+         notify = true;
+         return command.length == 0 ? CONTROL_OK : CONTROL_MALFORMED;
+
+      case CONTROL_START:
+      case CONTROL_STOP:
+         if (!ControlReader::readPump(command, indice))
+            return CONTROL_MALFORMED;
+         if (indice >= ACTIVE_PUMPS)
+            return CONTROL_INVALID_PUMP;
+
+         notify = true;
+         if (command.opcode == CONTROL_STOP) {
+            stopPumpByIndex(indice);
+            return CONTROL_OK;
+         }
+         return sequencer.request(indice) ? CONTROL_OK : CONTROL_REJECTED;
+
+      case CONTROL_SET_PULSE:
+         if (!ControlReader::readPulse(command, indice, pulseDuration))
+            return CONTROL_MALFORMED;
+         if (indice >= ACTIVE_PUMPS)
+            return CONTROL_INVALID_PUMP;
+
+         if (pulseDuration == 0)
+            return CONTROL_REJECTED;
+
+         myPumps[indice].setPulseDuration(pulseDuration);
+         storePulse(indice, pulseDuration);
+         return CONTROL_OK;
+
+      case CONTROL_SET_SCHEDULE: {
+         if (!ControlReader::readSchedule(command, indice, seconds, count))
+            return CONTROL_MALFORMED;
+         if (indice >= ACTIVE_PUMPS)
+            return CONTROL_INVALID_PUMP;
+
+         // Horários fixos diários, persistidos como as alterações da API local
+         if (count > SCHEDULE_MAX_RULES)
+            return CONTROL_REJECTED;
+
+         ScheduleRule rules[SCHEDULE_MAX_RULES];
+         for (size_t index = 0; index < count; index++)
+            rules[index].start = seconds[index];
+
+         if (!applySchedule(indice, rules, count))
+            return CONTROL_REJECTED;
+
+         storeSchedule(indice, rules, count);
+         return CONTROL_OK;
+      }
+
+      default:
+         return CONTROL_UNKNOWN;
+   }
+}
+
+// Executa todos os comandos da mensagem e responde com os ACKs em um único frame
+void handleControlMessage(AsyncWebSocketClient *client, const uint8_t *data, size_t size) {
+   ControlReader reader(data, size);
+   ControlAckWriter acks;
+   ControlCommand command;
+   bool notify = false;
+
+   while (reader.next(command))
+      acks.add(command, executeControlCommand(command, notify));
+
+   if (reader.isTruncated())
+      acks.add(0, 0, CONTROL_MALFORMED);
+
+   if (acks.getSize() > 0)
+      client->binary((const char *)acks.getData(), acks.getSize());
+
+   if (notify)
+      notifyClients(getOutputStates());
+}
+
+// Protocolo texto original: "states" ou o número do GPIO a ser alternado
+void handleTextMessage(const uint8_t *data, size_t size) {
+   char text[8];
+
+   if (size == 0 || size >= sizeof(text))
+      return;
+
+   memcpy(text, data, size);
+   text[size] = 0;
+
+   if (strcmp(text, "states") != 0) {
+      char *end;
+      unsigned long gpio = strtoul(text, &end, 10);
+
+      if (end == text || *end != '\0')
+         return;
+
+      for (int indice = 0; indice < ACTIVE_PUMPS; indice++)
+         if (gpio == myPumps[indice].gpioPin) {
+            // Uma bomba na fila do sequenciador conta como acionada: o toggle cancela o pedido
+            if (sequencer.cancel(indice) || myPumps[indice].getPumpState())
+               stopPumpByIndex(indice);
+            else
+               sequencer.request(indice);
+         }
+   }
+
+   notifyClients(getOutputStates());
+}
+
+void handleWebSocketMessage(AsyncWebSocketClient *client, void *arg, uint8_t *data, size_t len) {
    AwsFrameInfo *info = (AwsFrameInfo *)arg;
-   if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-      data[len] = 0;
-      if (strcmp((char *)data, "states") == 0) {
-         notifyClients(getOutputStates());
-      } else {
-         uint8_t gpio = (uint8_t)atoi((char *)data);
+   ControlSession *session = getControlSession(client->id());
+
+   if (session == NULL)
+      return;
+
+   // Primeiro trecho do primeiro frame inicia uma nova mensagem
+   if (info->num == 0 && info->index == 0)
+      session->message.reset();
 
-         for (int indice; indice < ACTIVE_PUMPS; indice++)
-            if (gpio == myPumps[indice].gpioPin)
-               myPumps[indice].getPumpState() ? myPumps[indice].stopPump() : myPumps[indice].startPump();
+   session->message.append(data, len);
 
-         notifyClients(getOutputStates());
+   // A mensagem só está completa no último trecho do frame final
+   if (!info->final || info->index + len != info->len)
+      return;
+
+   if (session->message.isOverflowed()) {
+      if (info->message_opcode == WS_BINARY) {
+         ControlAckWriter acks;
+         acks.add(0, 0, CONTROL_OVERFLOW);
+         client->binary((const char *)acks.getData(), acks.getSize());
       }
+      return;
    }
+
+   if (info->message_opcode == WS_BINARY)
+      handleControlMessage(client, session->message.getData(), session->message.getSize());
+   else if (info->message_opcode == WS_TEXT)
+      handleTextMessage(session->message.getData(), session->message.getSize());
 }
 
 void restart() {
+   logger.waitDrained(LOG_DRAIN_DELAY);
+   crashLog.flush();
    yield();
    delay(1000);
    yield();
    ESP.restart();
 }
 
+// Espera pelo WiFi sem que a queda da rede conte como travamento da task
+void waitNetwork() {
+   if (!wifiSupervisor.isConnected()) {
+      supervisor.idle();
+      wifiSupervisor.waitConnected(portMAX_DELAY);
+   }
+
+   supervisor.heartbeat();
+}
+
 void onEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
              void *arg, uint8_t *data, size_t len) {
    switch (type) {
       case WS_EVT_CONNECT:
-         Serial.printf("WebSocket client #%u connected from %s\n", client->id(), client->remoteIP().toString().c_str());
+         logger.log(LOG_WEB, LOG_INFO, "WebSocket client #%u connected from %s", client->id(), client->remoteIP().toString().c_str());
          break;
       case WS_EVT_DISCONNECT:
-         Serial.printf("WebSocket client #%u disconnected\n", client->id());
+         logger.log(LOG_WEB, LOG_INFO, "WebSocket client #%u disconnected", client->id());
+         releaseControlSession(client->id());
          break;
       case WS_EVT_DATA:
-         handleWebSocketMessage(arg, data, len);
+         handleWebSocketMessage(client, arg, data, len);
          break;
       case WS_EVT_PONG:
       case WS_EVT_ERROR:
@@ -193,20 +1051,24 @@ void onEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType
    }
 }
 
-void loadConfigurationCloud(const char *pumperCode, DynamicJsonDocument *jsonData) {
-   DynamicJsonDocument response(MAX_SIZE_DOCUMENT);
-   DynamicJsonDocument body(512);  // Pode ser pequeno pois é o que será enviado
+void refreshSiteCache() {
+   StaticJsonDocument<SITE_CACHE_FILTER_SIZE> fields;
+   PumpConfiguration::setFields(fields.to<JsonObject>());
 
-   const size_t CAPACITY = JSON_OBJECT_SIZE(1);
-   StaticJsonDocument<CAPACITY> doc;
+   siteCache.refresh(findUrl, apiKey, root_ca, fields.as<JsonVariantConst>());
+}
 
-   JsonObject object = doc.to<JsonObject>();
-   object["pumperCode"] = pumperCode;
+// Interpreta a resposta direto do stream, mantendo apenas os campos usados pela configuração
+bool loadConfigurationCloud(const char *pumperCode, JsonDocument &response) {
+   StaticJsonDocument<256> body;  // Pode ser pequeno pois é o que será enviado
 
    body["dataSource"] = "Tomatoes";
    body["database"] = "first-api";
    body["collection"] = "sensors";
-   body["filter"] = object;
+   body["filter"]["pumperCode"] = pumperCode;
+
+   StaticJsonDocument<256> filter;
+   PumpConfiguration::setFields(filter.createNestedObject("document"));
 
    // Serialize JSON document
    String json;
@@ -218,6 +1080,8 @@ void loadConfigurationCloud(const char *pumperCode, DynamicJsonDocument *jsonDat
 
    HTTPClient http;
 
+   // HTTP/1.0 evita a codificação chunked, permitindo ler o stream sem guardar o corpo em uma String
+   http.useHTTP10(true);
    http.begin(client, serverName);
    http.addHeader("api-key", apiKey);
    http.addHeader("Content-Type", "application/json");
@@ -225,72 +1089,255 @@ void loadConfigurationCloud(const char *pumperCode, DynamicJsonDocument *jsonDat
 
    int httpResponseCode = http.POST(json);
 
-   Serial.print("HTTP Response code: ");
-   Serial.println(httpResponseCode);
-
-   String payload = http.getString();
+   DeserializationError error = deserializeJson(response, http.getStream(), DeserializationOption::Filter(filter));
 
    // Disconnect
    http.end();
 
-   DeserializationError error = deserializeJson(response, payload);
+   if (httpResponseCode != 200 || error || response["document"].isNull()) {
+      logger.log(LOG_CONFIG, LOG_WARN, "Failed to read document of pump %s (HTTP %d, %s), keeping current configuration", pumperCode,
+                 httpResponseCode, error.c_str());
+      return false;
+   }
+
+   logger.log(LOG_CONFIG, LOG_DEBUG, "Document of pump %s read from the cloud (%u bytes in use)", pumperCode, (unsigned)response.memoryUsage());
 
-   if (error)
-      Serial.println("Failed to read document, using default configuration");
+   return true;
+}
 
-   serializeJsonPretty(response["document"], Serial);
+void updateConfiguration(JsonVariantConst inputDocument, HydraulicPumpController *pump) {
+   PumpConfiguration configuration(SITE_LATITUDE, SITE_LONGITUDE, TIME_OFFSET);
 
-   *jsonData = response["document"];
+   configuration.read(inputDocument, ntp.getEpochTime());
+
+   if (configuration.getIgnoredRules() > 0)
+      logger.log(LOG_CONFIG, LOG_WARN, "Ignoring %u schedule rules of pump %s", (unsigned)configuration.getIgnoredRules(), pump->pumperCode);
+   if (configuration.isTruncated())
+      logger.log(LOG_CONFIG, LOG_WARN, "Schedule of pump %s truncated to %d drives per day", pump->pumperCode, SCHEDULE_MAX_EVENTS);
+   if (configuration.getPulseDuration() == 0)
+      logger.log(LOG_CONFIG, LOG_WARN, "Document of pump %s has no pulseDuration, keeping %u ms", pump->pumperCode,
+                 (unsigned)pump->getPulseDuration());
+
+   configuration.apply(*pump);
+
+   logger.log(LOG_CONFIG, LOG_INFO, "Pump %s configured with %u rules and a %u ms pulse", pump->pumperCode,
+              (unsigned)configuration.getRuleCount(), (unsigned)pump->getPulseDuration());
 }
 
-void updateConfiguration(DynamicJsonDocument inputDocument, std::set<String> *inputDriveTime, uint32_t *inputDuration) {
-   JsonArray tempArray = inputDocument["driveTimes"].as<JsonArray>();
+// Tenta o cache local do site antes de recorrer ao MongoDB Atlas. O documento vem do pool e
+// só existe durante a atualização; com 304 ou falha a bomba mantém a configuração em uso.
+void loadConfiguration(HydraulicPumpController *pump) {
+   PooledJsonDocument document(MAX_SIZE_DOCUMENT);
+   int status = siteCache.fetch(pump->pumperCode, document);
+
+   if (status == 200) {
+      updateConfiguration(document.as<JsonVariantConst>(), pump);
+   } else if (status < 0) {
+      siteCache.recordCloudRequest();
+      if (loadConfigurationCloud(pump->pumperCode, document))
+         updateConfiguration(document["document"], pump);
+   }
+}
+
+// Grava no documento da bomba, no MongoDB Atlas, a agenda e o pulso definidos pela API local
+bool writeBackConfiguration(size_t indice) {
+   uint32_t mask = 1UL << indice;
+   uint32_t revision = localRevision;
+   bool schedulePending = (pendingSchedules & mask) != 0;
+   bool pulsePending = (pendingPulses & mask) != 0;
+
+   if (!schedulePending && !pulsePending)
+      return true;
 
-   inputDriveTime->clear();
-   for (JsonVariant index : tempArray) {
-      JsonObject object = index.as<JsonObject>();
-      const char *tempTime = object["time"];
-      bool tempState = object["state"];
+   PooledJsonDocument body(MAX_SIZE_DOCUMENT);
 
-      if (tempState)
-         inputDriveTime->insert(tempTime);
+   body["dataSource"] = "Tomatoes";
+   body["database"] = "first-api";
+   body["collection"] = "sensors";
+   body["filter"]["pumperCode"] = myPumps[indice].pumperCode;
+
+   JsonObject fields = body["update"].createNestedObject("$set");
+
+   if (schedulePending) {
+      // Os horários fixos passam a ser regras, a lista antiga é esvaziada
+      DriveSchedule schedule = myPumps[indice].getSchedule();
+      fields.createNestedArray("driveTimes");
+      JsonArray rules = fields.createNestedArray("rules");
+      for (const ScheduleRule &rule : schedule.getRules())
+         PumpConfiguration::writeRule(rule, rules.createNestedObject());
    }
 
-   *inputDuration = inputDocument["pulseDuration"].as<uint32_t>();
+   if (pulsePending)
+      fields["pulseDuration"] = myPumps[indice].getPulseDuration();
+
+   String json;
+   serializeJson(body, json);
+
+   WiFiClientSecure client;
+
+   client.setCACert(root_ca);
+
+   HTTPClient http;
+
+   http.begin(client, updateOneUrl);
+   http.addHeader("api-key", apiKey);
+   http.addHeader("Content-Type", "application/json");
+   http.addHeader("Accept", "application/json");
+
+   int httpResponseCode = http.POST(json);
+
+   http.end();
+
+   if (httpResponseCode != 200) {
+      logger.log(LOG_CONFIG, LOG_WARN, "Write-back of pump %s failed: HTTP %d", myPumps[indice].pumperCode, httpResponseCode);
+      return false;
+   }
+
+   // Uma alteração recebida durante o envio continua pendente até o próximo ciclo
+   xSemaphoreTake(xLocalMutex, portMAX_DELAY);
+   if (revision == localRevision) {
+      pendingSchedules &= ~mask;
+      pendingPulses &= ~mask;
+      localChanges.putUInt("schedules", pendingSchedules);
+      localChanges.putUInt("pulses", pendingPulses);
+   }
+   xSemaphoreGive(xLocalMutex);
+
+   return true;
+}
+
+// Reaplica as alterações da API local que ainda não chegaram ao MongoDB Atlas
+void initLocalChanges() {
+   xLocalMutex = xSemaphoreCreateMutex();
+
+   if (!localChanges.begin(LOCAL_API_NAMESPACE)) {
+      logger.log(LOG_CONFIG, LOG_ERROR, "Local API storage unavailable, local changes will not survive a restart");
+      return;
+   }
+
+   pendingSchedules = localChanges.getUInt("schedules", 0);
+   pendingPulses = localChanges.getUInt("pulses", 0);
+
+   for (int indice = 0; indice < ACTIVE_PUMPS; indice++) {
+      char key[12];
+
+      if (pendingSchedules & (1UL << indice)) {
+         ScheduleRule rules[SCHEDULE_MAX_RULES];
+         snprintf(key, sizeof(key), "rules%d", indice);
+         size_t count = localChanges.getBytes(key, rules, sizeof(rules)) / sizeof(ScheduleRule);
+         applySchedule(indice, rules, count);
+      }
+
+      if (pendingPulses & (1UL << indice)) {
+         snprintf(key, sizeof(key), "pulse%d", indice);
+         myPumps[indice].setPulseDuration(localChanges.getUInt(key, myPumps[indice].getPulseDuration()));
+      }
+   }
+
+   updateServiceTxt();
+}
+
+// Grava na flash um lote de avisos e erros, mantendo o arquivo anterior quando o atual enche
+bool writeCrashLog(const char *data, size_t length) {
+   File file = SPIFFS.open(LOG_FLASH_PATH, FILE_APPEND);
+
+   if (!file)
+      return false;
+
+   bool written = file.write((const uint8_t *)data, length) == length;
+   bool full = file.size() >= LOG_FLASH_MAX_SIZE;
+   file.close();
+
+   if (full) {
+      SPIFFS.remove(LOG_FLASH_OLD_PATH);
+      SPIFFS.rename(LOG_FLASH_PATH, LOG_FLASH_OLD_PATH);
+   }
+
+   return written;
+}
+
+const char *getResetReason() {
+   switch (esp_reset_reason()) {
+      case ESP_RST_PANIC:
+         return "panic";
+      case ESP_RST_INT_WDT:
+         return "interrupt watchdog";
+      case ESP_RST_TASK_WDT:
+         return "task watchdog";
+      case ESP_RST_WDT:
+         return "watchdog";
+      case ESP_RST_BROWNOUT:
+         return "brownout";
+      default:
+         return NULL;
+   }
+}
+
+// A task de entrega começa antes do resto do setup para que nenhum print bloqueie a inicialização.
+// Todos os destinos são registrados antes dela: os que dependem da SPIFFS ou do servidor esperam
+// por eles sem deixar de receber os registros.
+void initLogger() {
+   esp_reset_reason_t reason = esp_reset_reason();
+
+   // As linhas que não chegaram à flash antes do reset continuam na memória RTC
+   crashLog.begin(reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT);
+
+   logger.addSink(LOG_DEBUG, [](const LogRecord &record, const char *line) {
+      Serial.print(line);
+   });
+   logger.addSink(LOG_FLASH_LEVEL, [](const LogRecord &record, const char *line) {
+      crashLog.append(line);
+   });
+
+   // Acompanhamento do log em tempo real, apenas enquanto houver alguém conectado ao /log
+   logger.addSink(LOG_DEBUG, [](const LogRecord &record, const char *line) {
+      if (logSocket.count() > 0)
+         logSocket.textAll(line);
+   });
+
+   // Um logger travado só é recuperado com o reinício da placa, já que a task pode deter o sistema de arquivos
+   supervisor.start({vTaskLogger, "taskLogger", configMINIMAL_STACK_SIZE + 2048, 1, PRO_CPU_NUM, 10000, RECOVER_REBOOT}, &handleLogger);
+   logger.setTask(handleLogger);
+
+   if (getResetReason() != NULL)
+      logger.log(LOG_SYSTEM, LOG_ERROR, "Restarted after %s", getResetReason());
 }
 
 void initSPIFFS() {
    if (!SPIFFS.begin(true)) {
-      Serial.println("An error has occurred while mounting SPIFFS");
+      logger.log(LOG_SYSTEM, LOG_ERROR, "An error has occurred while mounting SPIFFS");
+      return;
    }
-   Serial.println("SPIFFS mounted successfully");
+   logger.log(LOG_SYSTEM, LOG_INFO, "SPIFFS mounted successfully");
+
+   // Grava as linhas anteriores ao reset e as do início do boot, com o motivo do reset
+   logger.waitDrained(LOG_DRAIN_DELAY);
+   crashLog.setWriter(writeCrashLog);
+   crashLog.flush();
 }
 
 void initWiFi() {
-   WiFi.mode(WIFI_STA);
-   WiFi.begin(ssid, password);
-   Serial.print("Connecting to WiFi ..");
-   while (WiFi.status() != WL_CONNECTED) {
-      Serial.print('.');
-      delay(1000);
-   }
-   Serial.println();
-   Serial.print("MAC Address:  ");
-   Serial.println(WiFi.macAddress());
-   Serial.print("Local IP:  ");
-   Serial.println(WiFi.localIP());
-   Serial.print("Hostname:  ");
-   Serial.println(WiFi.getHostname());
+   wifiSupervisor.begin(ssid, password);
+   logger.log(LOG_NETWORK, LOG_INFO, "Connecting to WiFi ..");
+   wifiSupervisor.waitConnected(portMAX_DELAY);
+   logger.log(LOG_NETWORK, LOG_INFO, "MAC Address: %s, Local IP: %s, Hostname: %s", WiFi.macAddress().c_str(), WiFi.localIP().toString().c_str(),
+              WiFi.getHostname());
 
    if (!MDNS.begin(WiFi.getHostname())) {
-      Serial.println("Error setting up MDNS responder!");
+      logger.log(LOG_NETWORK, LOG_ERROR, "Error setting up MDNS responder!");
       while (1) {
          delay(1000);
       }
    }
-   Serial.println("mDNS responder started");
-   Serial.print("mDNS Adress:  ");
-   Serial.println(WiFi.getHostname());
+   logger.log(LOG_NETWORK, LOG_INFO, "mDNS responder started at %s.local", WiFi.getHostname());
+
+   MDNS.addService("_tomatoes", "_tcp", 80);
+   MDNS.addServiceTxt("_tomatoes", "_tcp", "pumps", String(ACTIVE_PUMPS));
+   MDNS.addServiceTxt("_tomatoes", "_tcp", "firmware", FIRMWARE_VERSION);
+   if (siteCache.isCacheRole())
+      MDNS.addServiceTxt("_tomatoes", "_tcp", "cache", "1");
+
+   powerManager.begin(logger);
 }
 
 void initNTP() {
@@ -299,30 +1346,251 @@ void initNTP() {
 }
 
 void initWebSocket() {
+   controlSessions = MemoryPlacement::construct<ControlSession>(CONTROL_MAX_CLIENTS, MEMORY_COLD);
+   if (controlSessions == NULL)
+      logger.log(LOG_WEB, LOG_ERROR, "WebSocket sessions unavailable, control messages will be ignored");
+
    ws.onEvent(onEvent);
    server.addHandler(&ws);
+
+   // Acompanhamento do log em tempo real; o destino é registrado em initLogger()
+   server.addHandler(&logSocket);
 }
 
 void initConfiguration() {
+   siteCache.begin();
+
+   if (siteCache.isCacheRole()) {
+      for (int indice = 0; indice < ACTIVE_PUMPS; indice++)
+         siteCache.registerCode(myPumps[indice].pumperCode);
+      refreshSiteCache();
+   }
+
+   for (int indice = 0; indice < ACTIVE_PUMPS; indice++)
+      loadConfiguration(&myPumps[indice]);
+
+   updateServiceTxt();
+}
+
+void initPumps() {
+#ifdef PUMP_SOFT_START
+   for (int indice = 0; indice < ACTIVE_PUMPS; indice++)
+      if (!myPumps[indice].enableSoftStart(indice, SOFT_START_RAMP_UP, SOFT_START_RAMP_DOWN))
+         logger.log(LOG_PUMPS, LOG_WARN, "Soft start unavailable for pump %s", myPumps[indice].pumperCode);
+#endif
+}
+
+void initTelemetry() {
+   telemetry.begin(getID(), insertManyUrl, apiKey, root_ca);
+   telemetryBatch = MemoryPlacement::construct<TelemetrySample>(TELEMETRY_CAPACITY, MEMORY_COLD);
+   if (telemetryBatch == NULL)
+      logger.log(LOG_TELEMETRY, LOG_ERROR, "Failed allocating the telemetry batch, telemetry upload disabled");
+
+   if (!telemetryQueue.begin("telemetry"))
+      logger.log(LOG_TELEMETRY, LOG_ERROR, "Telemetry queue unavailable, offline samples limited to the RAM buffer");
+}
+
+void initSensors() {
+#ifdef SENSOR_PIPELINE
+   if (!sensors.begin())
+      logger.log(LOG_PUMPS, LOG_ERROR, "Sensor pipeline unavailable, pumps will run on schedule only");
+#endif
+}
+
+// Acionamento de um horário da agenda, ajustado pelos sensores
+bool requestDrive(size_t indice) {
+   HydraulicPumpController &pump = myPumps[indice];
+
+   if (pump.getPumpState())
+      return false;
+
+   // Solo encharcado ou reservatório vazio pulam o acionamento, nos demais casos o pulso é ajustado
+   IrrigationDecision decision = sensors.decide(pump.getPulseDuration());
+   if (decision.action == IRRIGATION_SKIP || decision.action == IRRIGATION_DRY_RUN)
+      return false;
+
+   pump.setNextPulseDuration(decision.pulseDuration);
+
+   return sequencer.request(indice);
+}
+
+// Chamado pela task das bombas quando um horário de acionamento é alcançado
+void onDriveDue(size_t indice, int64_t expectedWake) {
+   if (requestDrive(indice))
+      powerManager.recordPumpStart(expectedWake);
+}
+
+// A task das bombas começa antes do WiFi para que um pulso interrompido por um reset seja retomado
+// em poucos milissegundos. A agenda só é atendida depois que o NTP ajustar o horário.
+void initPumpController() {
+   sequencer.begin();
+   sequencer.onStart([](size_t indice) {
+      pumpJournal.recordStart(indice, myPumps[indice].getPulseRemaining(), ntp.isTimeSet() ? ntp.getEpochTime() : 0);
+      recordPumpEvent(indice, true);
+   });
+   pumpScheduler.onDue(onDriveDue);
+
+   // Uma única task atende a agenda e o sequenciador de todas as bombas. Travada, ela é recuperada pelo
+   // reinício da placa, e o diário retoma os pulsos interrompidos.
+   supervisor.start({vTaskPumpController, "taskPumpController", configMINIMAL_STACK_SIZE + 2048, 3, APP_CPU_NUM, LOW_POWER_MAX_SLEEP + 30000, RECOVER_REBOOT},
+                    &handlePumpController);
+   sequencer.setTask(handlePumpController);
+   pumpScheduler.setTask(handlePumpController);
+}
+
+// Retoma, pelo sequenciador e portanto com a válvula mestra, o restante dos pulsos interrompidos.
+// Depois de um power-on a memória RTC não é confiável e, no deep sleep, os pulsos são do DeepSleepScheduler.
+void resumePulses() {
+   esp_reset_reason_t reason = esp_reset_reason();
+
+   if (!pumpJournal.begin(reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && reason != ESP_RST_DEEPSLEEP))
+      return;
+
    for (int indice = 0; indice < ACTIVE_PUMPS; indice++) {
-      loadConfigurationCloud(myPumps[indice].pumperCode, myPumps[indice].getJsonDataPointer());
-      updateConfiguration(myPumps[indice].getJsonData(), myPumps[indice].getDriveTimesPointer(), myPumps[indice].pulseDurationPointer);
+      uint32_t remaining = pumpJournal.takeResumePulse(indice);
+      if (remaining == 0)
+         continue;
+
+      myPumps[indice].setNextPulseDuration(remaining);
+      sequencer.request(indice);
+      logger.log(LOG_PUMPS, LOG_WARN, "Resuming pump %s for %lu ms after reset", myPumps[indice].pumperCode, (unsigned long)remaining);
    }
 }
 
-void initRtos() {
-   xWifiMutex = xSemaphoreCreateMutex();
+// Compensa os horários que venceram enquanto a placa reiniciava, depois de carregada a agenda
+void catchUpDrives() {
+   if (CATCH_UP_POLICY == CATCH_UP_NONE || !pumpJournal.getStats().recovered)
+      return;
+
+   if (!ntp.isTimeSet()) {
+      logger.log(LOG_PUMPS, LOG_WARN, "Time not set, missed drives will not be caught up");
+      return;
+   }
 
-   xTaskCreatePinnedToCore(vTaskCheckWiFi, "taskCheckWiFi", configMINIMAL_STACK_SIZE, NULL, 2, &handleCheckWiFi, PRO_CPU_NUM);
-   xTaskCreatePinnedToCore(vTaskNTP, "taskNTP", configMINIMAL_STACK_SIZE + 2048, NULL, 1, &handleNTP, PRO_CPU_NUM);
+   uint32_t now = ntp.getEpochTime();
 
    for (int indice = 0; indice < ACTIVE_PUMPS; indice++) {
-      xTaskCreatePinnedToCore(vTaskUpdate, "taskUpdate", configMINIMAL_STACK_SIZE + 8192, &myPumps[indice], 3, &handleUpdate, PRO_CPU_NUM);
-      xTaskCreatePinnedToCore(vTaskTurnOnPump, "taskTurnOnPump", configMINIMAL_STACK_SIZE + 1024, &myPumps[indice], 2, &handleTurnOnPump, APP_CPU_NUM);
+      uint32_t start = pumpJournal.getCatchUpStart(indice, now, CATCH_UP_WINDOW);
+      if (start == 0)
+         continue;
+
+      DriveSchedule schedule = myPumps[indice].getSchedule();
+      size_t missed = schedule.countEventsBetween(start, now);
+      if (missed == 0)
+         continue;
+
+      logger.log(LOG_PUMPS, LOG_WARN, "Pump %s missed %u drive(s) during reset", myPumps[indice].pumperCode, (unsigned)missed);
+
+      if (requestDrive(indice))
+         pumpJournal.recordCatchUp();
    }
 }
 
+void initSupervisor() {
+   if (!supervisor.begin(SUPERVISOR_WDT_TIMEOUT))
+      logger.log(LOG_SYSTEM, LOG_ERROR, "Task watchdog unavailable, a stalled supervisor will not reset the board");
+
+   // Registrado como erro para que fique no log de falhas da flash
+   supervisor.onRecovery([](const char *name, RecoveryAction action, uint32_t gap) {
+      logger.log(LOG_SYSTEM, LOG_ERROR, "Task %s missed its heartbeat for %lu ms, recovery: %s", name, (unsigned long)gap,
+                 TaskSupervisor::getActionName(action));
+   });
+
+   // A queda provocada encerra as conexões pendentes e o WiFiSupervisor reconecta com backoff
+   supervisor.onNetworkReset([]() {
+      WiFi.disconnect();
+   });
+
+   supervisor.onReboot(restart);
+
+   xTaskCreatePinnedToCore(vTaskSupervisor, "taskSupervisor", configMINIMAL_STACK_SIZE + 2048, NULL, 4, &handleSupervisor, PRO_CPU_NUM);
+}
+
+// As tasks de rede atendem o cancelamento no início do ciclo, quando não detêm o xWifiMutex
+void initRtos() {
+   xWifiMutex = xSemaphoreCreateMutex();
+
+   supervisor.start({vTaskNTP, "taskNTP", configMINIMAL_STACK_SIZE + 2048, 1, PRO_CPU_NUM, NTP_DELAY + SUPERVISOR_HTTP_MARGIN, SUPERVISOR_NETWORK_RECOVERY},
+                    &handleNTP);
+   if (siteCache.isCacheRole())
+      supervisor.start({vTaskSiteCache, "taskSiteCache", configMINIMAL_STACK_SIZE + 8192, 3, PRO_CPU_NUM, UPDATE_DELAY + SUPERVISOR_HTTP_MARGIN,
+                        SUPERVISOR_NETWORK_RECOVERY},
+                       &handleSiteCache);
+   supervisor.start({vTaskTelemetry, "taskTelemetry", configMINIMAL_STACK_SIZE + 8192, 1, PRO_CPU_NUM, TELEMETRY_SAMPLE_DELAY + SUPERVISOR_HTTP_MARGIN,
+                     SUPERVISOR_NETWORK_RECOVERY},
+                    &handleTelemetry);
+#ifdef SENSOR_PIPELINE
+   xTaskCreatePinnedToCore(vTaskSensors, "taskSensors", configMINIMAL_STACK_SIZE + 2048, NULL, 1, &handleSensors, APP_CPU_NUM);
+#endif
+   supervisor.start({vTaskUpdate, "taskUpdate", configMINIMAL_STACK_SIZE + 8192, 3, PRO_CPU_NUM, UPDATE_DELAY + SUPERVISOR_HTTP_MARGIN, SUPERVISOR_NETWORK_RECOVERY},
+                    &handleUpdate);
+   supervisor.start({vTaskEvents, "taskEvents", configMINIMAL_STACK_SIZE + 2048, 1, PRO_CPU_NUM, 30000, RECOVER_CANCEL_TASK | RECOVER_REBOOT}, &handleEvents);
+
+   initSupervisor();
+}
+
+template <size_t Index>
+void initPumpRoutes() {
+   server.on(PumpRoute<Index>::timers, HTTP_GET, [](AsyncWebServerRequest *request) {
+      // verificar se a solicitação não vem do AJAX
+      if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
+         request->send(403);  // retornar um erro 403 (Proibido)
+      } else
+         request->send(200, "text/plain", sendTimers(myPumps[Index].getDriveTimes()));
+   });
+
+   server.on(PumpRoute<Index>::pulse, HTTP_GET, [](AsyncWebServerRequest *request) {
+      // verificar se a solicitação não vem do AJAX
+      if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
+         request->send(403);  // retornar um erro 403 (Proibido)
+      } else
+         request->send(200, "text/plain", getPulseDuration(myPumps[Index]));
+   });
+
+   server.on(
+       PumpRoute<Index>::schedulePut, HTTP_PUT, [](AsyncWebServerRequest *request) { handleScheduleRequest(request, Index); }, NULL,
+       [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+          onScheduleBody(request, REQUEST_SCHEDULE, data, len, index, total);
+       });
+
+   server.on(
+       PumpRoute<Index>::pulsePut, HTTP_PUT, [](AsyncWebServerRequest *request) { handleScheduleRequest(request, Index); }, NULL,
+       [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+          onScheduleBody(request, REQUEST_PULSE, data, len, index, total);
+       });
+}
+
+// Rotas /timersN, /pulseN e da API local para cada bomba do perfil
+template <size_t... Index>
+void initPumpRoutes(std::index_sequence<Index...>) {
+   (initPumpRoutes<Index>(), ...);
+}
+
+// Controle das bombas, API local e OTA continuam sendo atendidos quando a interface é recusada
+RequestClass classifyRequest(AsyncWebServerRequest *request) {
+   const String &url = request->url();
+
+   if (url == "/ws" || url == "/events" || url == "/log")
+      return REQUEST_EXEMPT;
+
+   if (request->method() != HTTP_GET || url.startsWith("/pumps/"))
+      return REQUEST_PRIORITY;
+
+   const char *queries[] = {"/time", "/rssi", "/hostname", "/metrics", "/boards", "/update/identity", "/timers", "/pulse", SITE_CACHE_PATH};
+   for (const char *query : queries)
+      if (url.startsWith(query))
+         return REQUEST_NORMAL;
+
+   // Todo o resto é servido da SPIFFS, diretamente ou pelo redirecionamento ao index.html
+   return REQUEST_STATIC;
+}
+
 void initServer() {
+   // Precisa ser o primeiro handler para decidir antes que os demais aloquem memória. Os handlers
+   // seguintes registram o fim da conexão por governor.onDisconnect(), nunca pela requisição.
+   governor.onClassify(classifyRequest);
+   server.addHandler(&governor);
+
    server.serveStatic("/", SPIFFS, "/");
 
    server.onNotFound([](AsyncWebServerRequest *request) {
@@ -343,68 +1611,70 @@ void initServer() {
       request->send(SPIFFS, "/index.html", "text/html", false);
    });
 
-   server.on("/timers1", HTTP_GET, [](AsyncWebServerRequest *request) {
-      // verificar se a solicitação não vem do AJAX
-      if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
-         request->send(403);  // retornar um erro 403 (Proibido)
-      } else
-         request->send(200, "text/plain", sendTimers(myPumps[0].getDriveTimes()));
-   });
+   initPumpRoutes(std::make_index_sequence<ACTIVE_PUMPS>());
 
-   server.on("/pulse1", HTTP_GET, [](AsyncWebServerRequest *request) {
+   server.on("/time", HTTP_GET, [](AsyncWebServerRequest *request) {
       // verificar se a solicitação não vem do AJAX
       if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
          request->send(403);  // retornar um erro 403 (Proibido)
       } else
-         request->send(200, "text/plain", getPulseDuration(myPumps[0]));
+         request->send_P(200, "text/plain", getFormattedTime());
    });
 
-   server.on("/timers2", HTTP_GET, [](AsyncWebServerRequest *request) {
+   server.on("/rssi", HTTP_GET, [](AsyncWebServerRequest *request) {
       // verificar se a solicitação não vem do AJAX
       if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
          request->send(403);  // retornar um erro 403 (Proibido)
       } else
-         request->send(200, "text/plain", sendTimers(myPumps[1].getDriveTimes()));
+         request->send_P(200, "text/plain", getRSSI());
    });
 
-   server.on("/pulse2", HTTP_GET, [](AsyncWebServerRequest *request) {
+   server.on("/hostname", HTTP_GET, [](AsyncWebServerRequest *request) {
       // verificar se a solicitação não vem do AJAX
       if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
          request->send(403);  // retornar um erro 403 (Proibido)
       } else
-         request->send(200, "text/plain", getPulseDuration(myPumps[1]));
+         request->send_P(200, "text/plain", getHostname());
    });
 
-   server.on("/time", HTTP_GET, [](AsyncWebServerRequest *request) {
+   server.on("/update/identity", HTTP_GET, [](AsyncWebServerRequest *request) {
       // verificar se a solicitação não vem do AJAX
       if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
          request->send(403);  // retornar um erro 403 (Proibido)
       } else
-         request->send_P(200, "text/plain", getFormattedTime());
+         request->send(200, "application/json", "{\"id\": \"" + getID() + "\", \"hardware\": \"ESP32\"}");
    });
 
-   server.on("/rssi", HTTP_GET, [](AsyncWebServerRequest *request) {
+   server.on("/boards", HTTP_GET, [](AsyncWebServerRequest *request) {
       // verificar se a solicitação não vem do AJAX
       if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
          request->send(403);  // retornar um erro 403 (Proibido)
       } else
-         request->send_P(200, "text/plain", getRSSI());
+         request->send(200, "application/json", getBoards());
    });
 
-   server.on("/hostname", HTTP_GET, [](AsyncWebServerRequest *request) {
-      // verificar se a solicitação não vem do AJAX
-      if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
-         request->send(403);  // retornar um erro 403 (Proibido)
-      } else
-         request->send_P(200, "text/plain", getHostname());
+   server.on(SITE_CACHE_PATH, HTTP_GET, [](AsyncWebServerRequest *request) {
+      if (!siteCache.isCacheRole() || !request->hasParam("code")) {
+         request->send(404);
+         return;
+      }
+
+      String document;
+      uint32_t currentVersion = 0;
+      uint32_t version = request->hasParam("version") ? strtoul(request->getParam("version")->value().c_str(), NULL, 10) : 0;
+      int status = siteCache.serve(request->getParam("code")->value(), version, document, currentVersion, request->client()->remoteIP());
+
+      AsyncWebServerResponse *response = status == 200 ? request->beginResponse(200, "application/json", document) : request->beginResponse(status);
+      response->addHeader("X-Config-Version", String(currentVersion));
+      request->send(response);
    });
 
-   server.on("/update/identity", HTTP_GET, [](AsyncWebServerRequest *request) {
+   server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
       // verificar se a solicitação não vem do AJAX
       if (!request->hasHeader("X-Requested-With") || request->header("X-Requested-With") != "XMLHttpRequest") {
          request->send(403);  // retornar um erro 403 (Proibido)
       } else
-         request->send(200, "application/json", "{\"id\": \"" + getID() + "\", \"hardware\": \"ESP32\"}");
+         request->send(200, "application/json", getMetrics());
    });
 
    server.on(
@@ -419,7 +1689,7 @@ void initServer() {
              int cmd = (filename == "firmware.bin") ? U_FLASH : U_SPIFFS;
 
              if (!Update.begin(UPDATE_SIZE_UNKNOWN, cmd)) {
-                Update.printError(Serial);
+                logger.log(LOG_SYSTEM, LOG_ERROR, "OTA could not begin: %s", Update.errorString());
                 return request->send(400, "text/plain", "OTA could not begin");
              }
           }
@@ -430,7 +1700,7 @@ void initServer() {
           }
           if (final) {
              if (!Update.end(true)) {
-                Update.printError(Serial);
+                logger.log(LOG_SYSTEM, LOG_ERROR, "Could not end OTA: %s", Update.errorString());
                 return request->send(400, "text/plain", "Could not end OTA");
              }
           } else {
@@ -438,19 +1708,66 @@ void initServer() {
           }
        });
 
+   events.begin(server);
+
    // DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
 
    server.begin();
 }
 
+void initDeepSleep() {
+   deepSleep.synchronize(ntp.getEpochTime());
+
+   for (int indice = 0; indice < ACTIVE_PUMPS; indice++)
+      deepSleep.store(indice, myPumps[indice].gpioPin, myPumps[indice].getPulseDuration(), myPumps[indice].getSchedule());
+
+   // Envia a latência medida nos despertares rápidos antes de voltar a dormir
+   telemetry.record(TELEMETRY_WAKE_LATENCY, 0, deepSleep.getMaxWakeToGpio(), ntp.getEpochTime());
+
+   if (telemetryBatch != NULL) {
+      size_t length = telemetry.takeBatch(telemetryBatch, TELEMETRY_CAPACITY);
+      telemetry.upload(telemetryBatch, length);
+   }
+
+   logger.waitDrained(LOG_DRAIN_DELAY);
+   crashLog.flush();
+   deepSleep.sleep();
+}
+
 void setup() {
+#ifdef DEEP_SLEEP_MODE
+   // Despertar rápido: executa a agenda guardada na RTC sem WiFi, NTP e nuvem
+   if (deepSleep.resume())
+      deepSleep.sleep();
+#endif
+
    Serial.begin(115200);
 
+   // Reservado antes de qualquer outra alocação, enquanto o heap ainda é contíguo
+   bool jsonPool = JsonPool::begin();
+
+   initLogger();
+
+   if (!jsonPool)
+      logger.log(LOG_SYSTEM, LOG_ERROR, "JSON pool unavailable, documents will use the heap");
+
    initSPIFFS();
+   initPumps();
+   initPumpController();
+   resumePulses();
    initWiFi();
    initNTP();
    initWebSocket();
    initConfiguration();
+   initLocalChanges();
+   initTelemetry();
+
+#ifdef DEEP_SLEEP_MODE
+   initDeepSleep();
+#endif
+
+   initSensors();
+   catchUpDrives();
    initRtos();
    initServer();
 }
@@ -459,22 +1776,19 @@ void loop() {
    vTaskDelete(NULL);
 }
 
-void vTaskCheckWiFi(void *pvParameters) {
-   while (1) {
-      if (WiFi.status() != WL_CONNECTED) {
-         Serial.println("Reconnecting to WiFi...");
-         WiFi.disconnect();
-         WiFi.reconnect();
-      }
-
-      vTaskDelay(pdMS_TO_TICKS(CHECK_WIFI_DELAY));
-   }
-}
-
 void vTaskNTP(void *pvParameters) {
-   while (1) {
+   while (!supervisor.isCancelled()) {
+      waitNetwork();
+
       if (xSemaphoreTake(xWifiMutex, portMAX_DELAY)) {
-         ntp.update();
+         if (ntp.update()) {
+            char data[EVENT_STREAM_MAX_DATA];
+            snprintf(data, sizeof(data), "{\"epoch\":%lu,\"offset\":%ld}", ntp.getEpochTime(), ntp.getLastOffset());
+            events.publish(EVENT_NTP, data);
+
+            telemetry.record(TELEMETRY_NTP_OFFSET, 0, ntp.getLastOffset(), ntp.getEpochTime());
+            pumpScheduler.reschedule();
+         }
          xSemaphoreGive(xWifiMutex);
       }
 
@@ -483,30 +1797,143 @@ void vTaskNTP(void *pvParameters) {
 }
 
 void vTaskUpdate(void *pvParameters) {
-   HydraulicPumpController *pump = (HydraulicPumpController *)pvParameters;
+   while (!supervisor.isCancelled()) {
+      waitNetwork();
 
-   while (1) {
       if (xSemaphoreTake(xWifiMutex, portMAX_DELAY)) {
-         loadConfigurationCloud(pump->pumperCode, pump->getJsonDataPointer());
-         updateConfiguration(pump->getJsonData(), pump->getDriveTimesPointer(), pump->pulseDurationPointer);
+         int failures = 0;
+
+         // Bombas com alterações locais ainda não enviadas mantêm a configuração local
+         for (int indice = 0; indice < ACTIVE_PUMPS; indice++) {
+            if (!writeBackConfiguration(indice))
+               failures++;
+            else if (!isLocalChangePending(indice))
+               loadConfiguration(&myPumps[indice]);
+         }
+         updateServiceTxt();
          xSemaphoreGive(xWifiMutex);
+
+         char data[EVENT_STREAM_MAX_DATA];
+         snprintf(data, sizeof(data), "{\"epoch\":%lu,\"schedule\":\"%08x\",\"pending\":%d,\"failures\":%d}", ntp.getEpochTime(),
+                  (unsigned)getScheduleHash(), __builtin_popcount(pendingSchedules | pendingPulses), failures);
+         events.publish(EVENT_CONFIG, data);
+      }
+
+      pumpScheduler.reschedule();
+
+      // A API local acorda a task antes do prazo para enviar a alteração
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPDATE_DELAY));
+   }
+}
+
+void vTaskPumpController(void *pvParameters) {
+   while (1) {
+      supervisor.heartbeat();
+      powerManager.recordWake();
+
+      uint32_t taskDelay = NTP_WAIT_DELAY;
+
+      // O heap dispara cada bomba só no seu prazo, o custo não depende do número de bombas ou regras
+      if (ntp.isTimeSet()) {
+         uint32_t now = ntp.getEpochTime();
+         taskDelay = pumpScheduler.process(now);
+         pumpJournal.recordAlive(now);
       }
 
+      uint32_t sequencerDelay = sequencer.process();
+      if (sequencerDelay != SEQUENCER_NO_DEADLINE && sequencerDelay < taskDelay)
+         taskDelay = sequencerDelay;
+
+      powerManager.recordDelay(taskDelay, TURN_ON_PUMP_DELAY);
+
+      // Acorda antes do prazo quando um novo pedido de acionamento chega ou a agenda muda
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(taskDelay));
+   }
+}
+
+void vTaskTelemetry(void *pvParameters) {
+   while (!supervisor.isCancelled()) {
+      supervisor.heartbeat();
+
+      uint32_t timestamp = ntp.getEpochTime();
+
+      telemetry.record(TELEMETRY_RSSI, 0, WiFi.RSSI(), timestamp);
+      telemetry.record(TELEMETRY_HEAP, 0, ESP.getFreeHeap(), timestamp);
+      telemetry.record(TELEMETRY_LARGEST_BLOCK, 0, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), timestamp);
+
+      // Média das leituras publicadas pelos sensores desde a última amostra
+      SensorReading reading;
+      uint32_t soilSum = 0, tankSum = 0, readings = 0;
+      while (sensors.read(reading)) {
+         soilSum += reading.soilMoisture;
+         tankSum += reading.tankLevel;
+         readings++;
+      }
+      if (readings > 0) {
+         telemetry.record(TELEMETRY_SOIL_MOISTURE, 0, soilSum / readings, timestamp);
+         telemetry.record(TELEMETRY_TANK_LEVEL, 0, tankSum / readings, timestamp);
+      }
+
+      // Sem o buffer do lote, cuja alocação falhou no boot, as amostras não saem da RAM
+      if (telemetryBatch != NULL)
+         telemetryQueue.flush(telemetry, telemetryBatch, TELEMETRY_CAPACITY, wifiSupervisor.isConnected(), xWifiMutex);
+
+      vTaskDelay(pdMS_TO_TICKS(TELEMETRY_SAMPLE_DELAY));
+   }
+}
+
+void vTaskSiteCache(void *pvParameters) {
+   while (!supervisor.isCancelled()) {
       vTaskDelay(pdMS_TO_TICKS(UPDATE_DELAY));
+
+      waitNetwork();
+
+      if (xSemaphoreTake(xWifiMutex, portMAX_DELAY)) {
+         refreshSiteCache();
+         xSemaphoreGive(xWifiMutex);
+      }
    }
 }
 
-void vTaskTurnOnPump(void *pvParameters) {
-   HydraulicPumpController *pump = (HydraulicPumpController *)pvParameters;
+void vTaskSensors(void *pvParameters) {
+   sensors.run();
 
-   while (1) {
-      String formatedTime = ntp.getFormattedTime();
+   vTaskDelete(NULL);
+}
+
+void vTaskEvents(void *pvParameters) {
+   char data[EVENT_STREAM_MAX_DATA];
 
-      for (String driveTime : pump->getDriveTimes()) {
-         if (formatedTime == driveTime)
-            pump->startPump();
+   while (!supervisor.isCancelled()) {
+      supervisor.heartbeat();
+
+      // Sem painéis conectados nada é montado, quem conectar recebe os últimos valores conhecidos
+      if (events.getClientCount() > 0) {
+         events.publish(EVENT_TIME, ntp.getFormattedTime().c_str());
+
+         snprintf(data, sizeof(data), "%d", WiFi.RSSI());
+         events.publish(EVENT_RSSI, data);
+
+         events.publish(EVENT_PUMPS, getOutputStates().c_str());
       }
 
-      vTaskDelay(pdMS_TO_TICKS(TURN_ON_PUMP_DELAY));
+      vTaskDelay(pdMS_TO_TICKS(events.flush()));
+   }
+}
+
+void vTaskLogger(void *pvParameters) {
+   while (1) {
+      supervisor.heartbeat();
+      logger.drain();
+      crashLog.flushIfDue();
+
+      // Acordada antes do prazo quando metade do buffer estiver ocupada
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_DELAY));
+   }
+}
+
+void vTaskSupervisor(void *pvParameters) {
+   while (1) {
+      vTaskDelay(pdMS_TO_TICKS(supervisor.check()));
    }
 }
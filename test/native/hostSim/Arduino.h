@@ -0,0 +1,84 @@
+#ifndef _HOSTSIM_ARDUINO_
+#define _HOSTSIM_ARDUINO_
+
+// Subconjunto do core Arduino do ESP32 usado pelas bibliotecas do firmware, sobre o relógio e os
+// GPIOs do HostSim
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+using std::max;
+using std::min;
+
+// Logs do core descartados, como em uma build com CORE_DEBUG_LEVEL 0
+#define log_e(format, ...)
+#define log_w(format, ...)
+#define log_i(format, ...)
+#define log_d(format, ...)
+
+#define constrain(amount, low, high) ((amount) < (low) ? (low) : ((amount) > (high) ? (high) : (amount)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+long random(long maximum);
+long random(long minimum, long maximum);
+void randomSeed(unsigned long seed);
+
+inline uint16_t word(uint8_t high, uint8_t low) {
+   return high << 8 | low;
+}
+
+class HardwareSerial : public Print {
+  public:
+   void begin(unsigned long baud) {}
+   size_t write(uint8_t character) override;
+   size_t write(const uint8_t *buffer, size_t size) override;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+  public:
+   void restart();
+   uint32_t getFreeHeap();
+   uint32_t getMinFreeHeap();
+   uint32_t getMaxAllocHeap();
+   uint64_t getEfuseMac() { return 0x00000000A0B1C2D3ULL; }
+};
+
+extern EspClass ESP;
+
+#endif
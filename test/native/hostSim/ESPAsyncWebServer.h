@@ -0,0 +1,80 @@
+#ifndef _HOSTSIM_ESPASYNCWEBSERVER_
+#define _HOSTSIM_ESPASYNCWEBSERVER_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "WString.h"
+
+typedef enum {
+   HTTP_GET = 0b00000001,
+   HTTP_POST = 0b00000010,
+   HTTP_DELETE = 0b00000100,
+   HTTP_PUT = 0b00001000,
+   HTTP_PATCH = 0b00010000,
+   HTTP_HEAD = 0b00100000,
+   HTTP_OPTIONS = 0b01000000,
+   HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef std::function<void(void)> ArDisconnectHandler;
+
+class AsyncWebServerResponse {
+  public:
+   AsyncWebServerResponse(int code, const String &contentType, const String &content) : code(code), contentType(contentType), content(content) {}
+
+   void addHeader(const String &name, const String &value) { headers.push_back({name, value}); }
+
+   int code;
+   String contentType;
+   String content;
+   std::vector<std::pair<String, String>> headers;
+};
+
+// Requisição criada pelo teste no lugar do AsyncTCP. Como na biblioteca, onDisconnect guarda um
+// único callback, chamado por disconnect() quando o teste encerra a conexão.
+class AsyncWebServerRequest {
+  public:
+   AsyncWebServerRequest(const String &url, WebRequestMethod method = HTTP_GET) : requestUrl(url), requestMethod(method) {}
+   ~AsyncWebServerRequest() { delete response; }
+
+   const String &url() const { return requestUrl; }
+   WebRequestMethod method() const { return requestMethod; }
+
+   void onDisconnect(ArDisconnectHandler callback) { disconnectHandler = callback; }
+
+   AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String()) {
+      return new AsyncWebServerResponse(code, contentType, content);
+   }
+
+   void send(AsyncWebServerResponse *sent) {
+      delete response;
+      response = sent;
+   }
+   void send(int code, const String &contentType = String(), const String &content = String()) { send(beginResponse(code, contentType, content)); }
+
+   // Resposta enviada, NULL se nenhum handler respondeu
+   AsyncWebServerResponse *getResponse() const { return response; }
+
+   void disconnect() {
+      if (disconnectHandler)
+         disconnectHandler();
+   }
+
+  private:
+   String requestUrl;
+   WebRequestMethod requestMethod;
+   ArDisconnectHandler disconnectHandler;
+   AsyncWebServerResponse *response = NULL;
+};
+
+class AsyncWebHandler {
+  public:
+   virtual ~AsyncWebHandler() {}
+   virtual bool canHandle(AsyncWebServerRequest *request) { return false; }
+   virtual void handleRequest(AsyncWebServerRequest *request) {}
+   virtual bool isRequestHandlerTrivial() { return true; }
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _HOSTSIM_ESPMDNS_
+#define _HOSTSIM_ESPMDNS_
+
+#include <Arduino.h>
+
+#include <utility>
+#include <vector>
+
+// Mesma interface de busca de lib/ESPmDNS: a busca termina depois do timeout e encontra os
+// serviços anunciados no HostNet naquele instante
+struct MDNSBrowseResult {
+   String instance;
+   String hostname;
+   IPAddress ip;
+   uint16_t port;
+   std::vector<std::pair<String, String>> txt;
+   uint32_t expires;  // millis() em que a entrada deixa de ser válida
+};
+
+class MDNSResponder {
+  public:
+   bool begin(const String &hostName) { return true; }
+   void end();
+
+   bool browseService(const char *service, const char *proto, uint32_t timeout = 3000);
+   int updateBrowse();
+   bool isBrowsing();
+   std::vector<MDNSBrowseResult> browseResults();
+
+  private:
+   bool browsing = false;
+   uint32_t browseStart = 0;
+   uint32_t browseTimeout = 0;
+   std::vector<MDNSBrowseResult> browseCache;
+};
+
+extern MDNSResponder MDNS;
+
+#endif
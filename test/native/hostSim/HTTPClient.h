@@ -0,0 +1,49 @@
+#ifndef _HOSTSIM_HTTPCLIENT_
+#define _HOSTSIM_HTTPCLIENT_
+
+#include <utility>
+#include <vector>
+
+#include "WString.h"
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+// Cliente HTTP síncrono sobre o HostNet: cada GET ou POST chama o handler do teste, e a resposta
+// fica disponível em getString() ou getStream() até end()
+class HTTPClient {
+  public:
+   bool begin(WiFiClient &client, const String &url);
+   bool begin(const String &host, uint16_t port, const String &uri);
+   void end();
+
+   void useHTTP10(bool enabled) {}
+   void setTimeout(uint16_t timeout) {}
+   void setReuse(bool reuse) {}
+
+   void addHeader(const String &name, const String &value);
+   void collectHeaders(const char *headers[], size_t count) {}
+   String header(const char *name);
+
+   int GET();
+   int POST(const String &payload);
+   int POST(const uint8_t *payload, size_t size) { return POST(String((const char *)payload, size)); }
+
+   int getSize();
+   String getString();
+   WiFiClient &getStream();
+
+  private:
+   WiFiClient ownClient;
+   WiFiClient *client = NULL;
+   String host;
+   uint16_t port = 0;
+   String url;
+   std::vector<std::pair<String, String>> requestHeaders;
+   std::vector<std::pair<String, String>> responseHeaders;
+   int size = -1;
+
+   int send(const char *method, const String &payload);
+};
+
+#endif
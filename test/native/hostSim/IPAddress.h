@@ -0,0 +1,25 @@
+#ifndef _HOSTSIM_IPADDRESS_
+#define _HOSTSIM_IPADDRESS_
+
+#include <stdint.h>
+
+#include "WString.h"
+
+class IPAddress {
+  public:
+   IPAddress() : IPAddress(0, 0, 0, 0) {}
+   IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) : bytes{first, second, third, fourth} {}
+   IPAddress(uint32_t address) : bytes{(uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)} {}
+
+   operator uint32_t() const { return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24; }
+   bool operator==(const IPAddress &other) const { return (uint32_t)*this == (uint32_t)other; }
+   uint8_t operator[](int index) const { return bytes[index]; }
+   uint8_t &operator[](int index) { return bytes[index]; }
+
+   String toString() const;
+
+  private:
+   uint8_t bytes[4];
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _HOSTSIM_PRINT_
+#define _HOSTSIM_PRINT_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WString.h"
+
+class Print {
+  public:
+   virtual ~Print() {}
+
+   virtual size_t write(uint8_t character) = 0;
+   virtual size_t write(const uint8_t *buffer, size_t size);
+   size_t write(const char *text);
+
+   size_t print(const String &text);
+   size_t print(const char *text);
+   size_t print(long number);
+   size_t println(const String &text);
+   size_t println(const char *text = "");
+   size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _HOSTSIM_STREAM_
+#define _HOSTSIM_STREAM_
+
+#include "Print.h"
+
+// Sem bloqueio: no host os dados já estão todos no buffer de quem implementa a Stream
+class Stream : public Print {
+  public:
+   virtual int available() = 0;
+   virtual int read() = 0;
+   virtual int peek() = 0;
+
+   void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+
+   size_t readBytes(char *buffer, size_t length);
+   size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+   bool find(const char *target);
+   bool findUntil(const char *target, const char *terminator);
+   String readString();
+
+  protected:
+   unsigned long timeout = 1000;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef _HOSTSIM_WSTRING_
+#define _HOSTSIM_WSTRING_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#define DEC 10
+#define HEX 16
+
+// String do Arduino sobre std::string, com a interface usada pelo firmware e pelo ArduinoJson
+class String {
+  public:
+   String() {}
+   String(const char *text) : value(text != NULL ? text : "") {}
+   String(const char *text, size_t length) : value(text, length) {}
+   String(const std::string &text) : value(text) {}
+   explicit String(char character) : value(1, character) {}
+   explicit String(int number, unsigned char base = DEC);
+   explicit String(unsigned int number, unsigned char base = DEC);
+   explicit String(long number, unsigned char base = DEC);
+   explicit String(unsigned long number, unsigned char base = DEC);
+   explicit String(long long number, unsigned char base = DEC);
+   explicit String(unsigned long long number, unsigned char base = DEC);
+   explicit String(float number, unsigned int decimals = 2);
+   explicit String(double number, unsigned int decimals = 2);
+
+   const char *c_str() const { return value.c_str(); }
+   size_t length() const { return value.length(); }
+   bool isEmpty() const { return value.empty(); }
+   bool reserve(size_t size) {
+      value.reserve(size);
+      return true;
+   }
+
+   bool concat(const String &other) {
+      value += other.value;
+      return true;
+   }
+   bool concat(const char *text) {
+      if (text == NULL)
+         return false;
+      value += text;
+      return true;
+   }
+   bool concat(const char *text, size_t length) {
+      value.append(text, length);
+      return true;
+   }
+   bool concat(char character) {
+      value += character;
+      return true;
+   }
+   bool concat(unsigned char character) { return concat((char)character); }
+   bool concat(int number) { return concat(String(number)); }
+   bool concat(unsigned int number) { return concat(String(number)); }
+   bool concat(long number) { return concat(String(number)); }
+   bool concat(unsigned long number) { return concat(String(number)); }
+
+   template <typename T>
+   String &operator+=(const T &other) {
+      concat(other);
+      return *this;
+   }
+
+   char operator[](size_t index) const { return index < value.length() ? value[index] : 0; }
+   char &operator[](size_t index) { return value[index]; }
+   char charAt(size_t index) const { return (*this)[index]; }
+
+   bool operator==(const String &other) const { return value == other.value; }
+   bool operator==(const char *other) const { return value == (other != NULL ? other : ""); }
+   bool operator!=(const String &other) const { return value != other.value; }
+   bool operator!=(const char *other) const { return !(*this == other); }
+   bool operator<(const String &other) const { return value < other.value; }
+   bool equals(const String &other) const { return value == other.value; }
+
+   int indexOf(char character, size_t from = 0) const;
+   int indexOf(const char *text, size_t from = 0) const;
+   int lastIndexOf(char character) const;
+   bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.length(), prefix.value) == 0; }
+   bool endsWith(const String &suffix) const;
+   String substring(size_t from) const { return from < value.length() ? String(value.substr(from)) : String(); }
+   String substring(size_t from, size_t to) const;
+   void trim();
+   void toLowerCase();
+   void toUpperCase();
+   void remove(size_t index, size_t count = (size_t)-1);
+   long toInt() const;
+   float toFloat() const;
+
+  private:
+   std::string value;
+};
+
+// Resultado das concatenações com +, reconhecido pelo ArduinoJson
+class StringSumHelper : public String {
+  public:
+   StringSumHelper(const String &text) : String(text) {}
+   StringSumHelper(const char *text) : String(text) {}
+};
+
+StringSumHelper operator+(const StringSumHelper &first, const String &second);
+StringSumHelper operator+(const StringSumHelper &first, const char *second);
+StringSumHelper operator+(const StringSumHelper &first, char second);
+StringSumHelper operator+(const String &first, const String &second);
+StringSumHelper operator+(const String &first, const char *second);
+StringSumHelper operator+(const char *first, const String &second);
+StringSumHelper operator+(const String &first, char second);
+StringSumHelper operator+(const StringSumHelper &first, int second);
+StringSumHelper operator+(const StringSumHelper &first, unsigned int second);
+StringSumHelper operator+(const StringSumHelper &first, long second);
+StringSumHelper operator+(const StringSumHelper &first, unsigned long second);
+StringSumHelper operator+(const String &first, int second);
+StringSumHelper operator+(const String &first, unsigned int second);
+StringSumHelper operator+(const String &first, long second);
+StringSumHelper operator+(const String &first, unsigned long second);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _HOSTSIM_WIFICLIENT_
+#define _HOSTSIM_WIFICLIENT_
+
+#include <string>
+
+#include "Stream.h"
+
+// Conexão simulada: guarda o corpo da resposta entregue pelo HostNet e o expõe como Stream. O
+// buffer faz o papel dos buffers do lwIP e fica fora da contagem do heap.
+class WiFiClient : public Stream {
+  public:
+   virtual ~WiFiClient() {}
+
+   int available() override { return data.size() - position; }
+   int read() override { return position < data.size() ? (uint8_t)data[position++] : -1; }
+   int peek() override { return position < data.size() ? (uint8_t)data[position] : -1; }
+   size_t write(uint8_t character) override { return 1; }
+
+   virtual bool isSecure() const { return false; }
+
+   void load(const String &body);
+   void stop();
+
+  private:
+   std::string data;
+   size_t position = 0;
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _HOSTSIM_WIFICLIENTSECURE_
+#define _HOSTSIM_WIFICLIENTSECURE_
+
+#include "WiFiClient.h"
+
+// O certificado é ignorado: o HostNet só distingue as requisições à nuvem (TLS) das locais
+class WiFiClientSecure : public WiFiClient {
+  public:
+   void setCACert(const char *rootCA) {}
+   void setInsecure() {}
+
+   bool isSecure() const override { return true; }
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _HOSTSIM_ADC_
+#define _HOSTSIM_ADC_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// ADC em modo contínuo (DMA) do ESP32: os resultados vêm da fonte registrada com
+// HostSim::onAdcRead, e cada leitura passa o tempo que o DMA levaria para convertê-los na
+// frequência configurada. Sem fonte, ou com a fonte retornando 0, a leitura falha por timeout.
+#define BIT(nr) (1UL << (nr))
+
+#define SOC_ADC_DIGI_RESULT_BYTES 2
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define ADC_MAX_DELAY UINT32_MAX
+
+typedef enum {
+   ADC1_CHANNEL_0 = 0,
+   ADC1_CHANNEL_1,
+   ADC1_CHANNEL_2,
+   ADC1_CHANNEL_3,
+   ADC1_CHANNEL_4,
+   ADC1_CHANNEL_5,
+   ADC1_CHANNEL_6,
+   ADC1_CHANNEL_7,
+   ADC1_CHANNEL_MAX,
+} adc1_channel_t;
+
+typedef enum {
+   ADC_ATTEN_DB_0 = 0,
+   ADC_ATTEN_DB_2_5 = 1,
+   ADC_ATTEN_DB_6 = 2,
+   ADC_ATTEN_DB_11 = 3,
+} adc_atten_t;
+
+typedef enum {
+   ADC_CONV_SINGLE_UNIT_1 = 1,
+   ADC_CONV_SINGLE_UNIT_2 = 2,
+   ADC_CONV_BOTH_UNIT = 3,
+   ADC_CONV_ALTER_UNIT = 7,
+} adc_digi_convert_mode_t;
+
+typedef enum {
+   ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+   ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+} adc_digi_output_format_t;
+
+typedef struct {
+   uint32_t max_store_buf_size;
+   uint32_t conv_num_each_intr;
+   uint32_t adc1_chan_mask;
+   uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct {
+   uint8_t atten;
+   uint8_t channel;
+   uint8_t unit;
+   uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+   bool conv_limit_en;
+   uint32_t conv_limit_num;
+   uint32_t pattern_num;
+   adc_digi_pattern_config_t *adc_pattern;
+   uint32_t sample_freq_hz;
+   adc_digi_convert_mode_t conv_mode;
+   adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+typedef struct {
+   union {
+      struct {
+         uint16_t data : 12;
+         uint16_t channel : 4;
+      } type1;
+      uint16_t val;
+   };
+} adc_digi_output_data_t;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *config);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config);
+esp_err_t adc_digi_start();
+esp_err_t adc_digi_stop();
+esp_err_t adc_digi_read_bytes(uint8_t *buffer, uint32_t maxLength, uint32_t *length, uint32_t timeout);
+esp_err_t adc_digi_deinitialize();
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _HOSTSIM_GPIO_
+#define _HOSTSIM_GPIO_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Os níveis ficam no HostSim, que avisa o teste de cada transição
+typedef enum {
+   GPIO_NUM_NC = -1,
+   GPIO_NUM_0 = 0,
+   GPIO_NUM_2 = 2,
+   GPIO_NUM_4 = 4,
+   GPIO_NUM_5 = 5,
+   GPIO_NUM_12 = 12,
+   GPIO_NUM_13 = 13,
+   GPIO_NUM_14 = 14,
+   GPIO_NUM_15 = 15,
+   GPIO_NUM_18 = 18,
+   GPIO_NUM_19 = 19,
+   GPIO_NUM_21 = 21,
+   GPIO_NUM_22 = 22,
+   GPIO_NUM_23 = 23,
+   GPIO_NUM_25 = 25,
+   GPIO_NUM_26 = 26,
+   GPIO_NUM_27 = 27,
+   GPIO_NUM_32 = 32,
+   GPIO_NUM_33 = 33,
+   GPIO_NUM_34 = 34,
+   GPIO_NUM_35 = 35,
+   GPIO_NUM_MAX = 40,
+} gpio_num_t;
+
+typedef enum {
+   GPIO_MODE_DISABLE = 0,
+   GPIO_MODE_INPUT = 1,
+   GPIO_MODE_OUTPUT = 2,
+} gpio_mode_t;
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level);
+int gpio_get_level(gpio_num_t pin);
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode);
+esp_err_t gpio_reset_pin(gpio_num_t pin);
+esp_err_t gpio_hold_en(gpio_num_t pin);
+esp_err_t gpio_hold_dis(gpio_num_t pin);
+void gpio_deep_sleep_hold_en();
+void gpio_deep_sleep_hold_dis();
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _HOSTSIM_LEDC_
+#define _HOSTSIM_LEDC_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// O fade é aplicado de imediato: o ritmo da rampa vem do esp_timer de quem o usa. O nível do GPIO
+// do canal acompanha o duty (> 0 é nível alto).
+typedef enum {
+   LEDC_HIGH_SPEED_MODE = 0,
+   LEDC_LOW_SPEED_MODE = 1,
+   LEDC_SPEED_MODE_MAX = 2,
+} ledc_mode_t;
+
+typedef enum {
+   LEDC_TIMER_0 = 0,
+   LEDC_TIMER_1 = 1,
+   LEDC_TIMER_2 = 2,
+   LEDC_TIMER_3 = 3,
+} ledc_timer_t;
+
+typedef enum {
+   LEDC_CHANNEL_0 = 0,
+   LEDC_CHANNEL_1,
+   LEDC_CHANNEL_2,
+   LEDC_CHANNEL_3,
+   LEDC_CHANNEL_4,
+   LEDC_CHANNEL_5,
+   LEDC_CHANNEL_6,
+   LEDC_CHANNEL_7,
+   LEDC_CHANNEL_MAX,
+} ledc_channel_t;
+
+typedef enum {
+   LEDC_TIMER_8_BIT = 8,
+   LEDC_TIMER_10_BIT = 10,
+   LEDC_TIMER_12_BIT = 12,
+   LEDC_TIMER_13_BIT = 13,
+} ledc_timer_bit_t;
+
+typedef enum {
+   LEDC_AUTO_CLK = 0,
+} ledc_clk_cfg_t;
+
+typedef enum {
+   LEDC_INTR_DISABLE = 0,
+} ledc_intr_type_t;
+
+typedef enum {
+   LEDC_FADE_NO_WAIT = 0,
+   LEDC_FADE_WAIT_DONE = 1,
+} ledc_fade_mode_t;
+
+typedef struct {
+   ledc_mode_t speed_mode;
+   ledc_timer_bit_t duty_resolution;
+   ledc_timer_t timer_num;
+   uint32_t freq_hz;
+   ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct {
+   int gpio_num;
+   ledc_mode_t speed_mode;
+   ledc_channel_t channel;
+   ledc_intr_type_t intr_type;
+   ledc_timer_t timer_sel;
+   uint32_t duty;
+   int hpoint;
+} ledc_channel_config_t;
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config);
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config);
+esp_err_t ledc_fade_func_install(int flags);
+esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, int time);
+esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel, ledc_fade_mode_t fadeMode);
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty);
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel);
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel);
+
+#endif
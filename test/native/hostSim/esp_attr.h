@@ -0,0 +1,13 @@
+#ifndef _HOSTSIM_ESP_ATTR_
+#define _HOSTSIM_ESP_ATTR_
+
+// No host a RTC memory é memória comum: os testes simulam o reset recriando os objetos sobre ela
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_SLOW_ATTR
+#define RTC_IRAM_ATTR
+
+#endif
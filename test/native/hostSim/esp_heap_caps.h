@@ -0,0 +1,26 @@
+#ifndef _HOSTSIM_ESP_HEAP_CAPS_
+#define _HOSTSIM_ESP_HEAP_CAPS_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Regiões simuladas pelo HostSim (configureHeap), com alocação first-fit para que a fragmentação
+// apareça no maior bloco livre como acontece na placa
+#define MALLOC_CAP_EXEC (1 << 0)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t count, size_t size, uint32_t caps);
+void *heap_caps_realloc(void *pointer, size_t size, uint32_t caps);
+void heap_caps_free(void *pointer);
+size_t heap_caps_get_total_size(uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _HOSTSIM_ESP_PARTITION_
+#define _HOSTSIM_ESP_PARTITION_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+   ESP_PARTITION_TYPE_APP = 0x00,
+   ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+   ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+   esp_partition_type_t type;
+   esp_partition_subtype_t subtype;
+   uint32_t address;
+   uint32_t size;
+   char label[17];
+   bool encrypted;
+} esp_partition_t;
+
+// Partições criadas com HostSim::addPartition, sempre do tipo dados
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *destination, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *source, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+#endif
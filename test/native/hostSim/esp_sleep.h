@@ -0,0 +1,25 @@
+#ifndef _HOSTSIM_ESP_SLEEP_
+#define _HOSTSIM_ESP_SLEEP_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+   ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+   ESP_SLEEP_WAKEUP_EXT0 = 2,
+   ESP_SLEEP_WAKEUP_EXT1 = 3,
+   ESP_SLEEP_WAKEUP_TIMER = 4,
+} esp_sleep_wakeup_cause_t;
+
+// Lançada por esp_deep_sleep_start(): o teste avança o relógio pelo tempo pedido e chama
+// HostSim::reboot(ESP_RST_DEEPSLEEP), que acorda a placa pelo timer
+struct HostDeepSleep {
+   uint64_t duration;  // Em us, 0 sem despertar pelo timer
+};
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t duration);
+[[noreturn]] void esp_deep_sleep_start();
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _HOSTSIM_ESP_SYSTEM_
+#define _HOSTSIM_ESP_SYSTEM_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+   ESP_RST_UNKNOWN,
+   ESP_RST_POWERON,
+   ESP_RST_EXT,
+   ESP_RST_SW,
+   ESP_RST_PANIC,
+   ESP_RST_INT_WDT,
+   ESP_RST_TASK_WDT,
+   ESP_RST_WDT,
+   ESP_RST_DEEPSLEEP,
+   ESP_RST_BROWNOUT,
+   ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+// Definido com HostSim::setResetReason
+esp_reset_reason_t esp_reset_reason();
+
+// Aborta o teste: nenhum caminho testado no host deve reiniciar a placa
+void esp_restart();
+
+uint32_t esp_random();
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
+
+#endif
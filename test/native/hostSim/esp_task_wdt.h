@@ -0,0 +1,16 @@
+#ifndef _HOSTSIM_ESP_TASK_WDT_
+#define _HOSTSIM_ESP_TASK_WDT_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Sem watchdog no host: as chamadas só são aceitas
+esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic);
+esp_err_t esp_task_wdt_add(TaskHandle_t task);
+esp_err_t esp_task_wdt_reset();
+
+#endif
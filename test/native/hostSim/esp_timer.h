@@ -0,0 +1,33 @@
+#ifndef _HOSTSIM_ESP_TIMER_
+#define _HOSTSIM_ESP_TIMER_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Mesma semântica do ESP-IDF: iniciar um timer ativo retorna ESP_ERR_INVALID_STATE
+typedef struct HostEspTimer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+   ESP_TIMER_TASK,
+   ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+   esp_timer_cb_t callback;
+   void *arg;
+   esp_timer_dispatch_t dispatch_method;
+   const char *name;
+   bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _HOSTSIM_TIMERS_
+#define _HOSTSIM_TIMERS_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Timers do FreeRTOS disparados pelo relógio simulado, no contexto da task do timer service.
+// HostSim::failTimerCommands simula a fila de comandos cheia.
+typedef struct HostRtosTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+typedef struct {
+   void *reserved[12];
+} StaticTimer_t;
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id, TimerCallbackFunction_t callback);
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t autoReload, void *id, TimerCallbackFunction_t callback,
+                                 StaticTimer_t *buffer);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t blockTime);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t blockTime);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t blockTime);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t blockTime);
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t blockTime);
+BaseType_t xTimerStartFromISR(TimerHandle_t timer, BaseType_t *woken);
+BaseType_t xTimerStopFromISR(TimerHandle_t timer, BaseType_t *woken);
+BaseType_t xTimerResetFromISR(TimerHandle_t timer, BaseType_t *woken);
+BaseType_t xTimerChangePeriodFromISR(TimerHandle_t timer, TickType_t period, BaseType_t *woken);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void *pvTimerGetTimerID(TimerHandle_t timer);
+TickType_t xTimerGetPeriod(TimerHandle_t timer);
+TickType_t xTimerGetExpiryTime(TimerHandle_t timer);
+TaskHandle_t xTimerGetTimerDaemonTaskHandle();
+
+#endif
@@ -0,0 +1,245 @@
+#include "hostNet.h"
+
+#include "ESPmDNS.h"
+#include "HTTPClient.h"
+#include "WiFiClient.h"
+#include "hostSim.h"
+
+struct HostNetState {
+   IPAddress localIP;
+   std::function<void(const HostHttpRequest &, HostHttpResponse &)> handler;
+   std::vector<HostService> services;
+};
+
+static HostNetState &netState() {
+   static HostNetState *net = new HostNetState();
+   return *net;
+}
+
+MDNSResponder MDNS;
+
+void HostNet::reset() {
+   HostNetState &net = netState();
+   HostUntracked untracked;
+
+   net.localIP = IPAddress();
+   net.handler = nullptr;
+   net.services.clear();
+
+   MDNS.end();
+}
+
+void HostNet::setLocalIP(const IPAddress &ip) {
+   netState().localIP = ip;
+}
+
+IPAddress HostNet::getLocalIP() {
+   return netState().localIP;
+}
+
+void HostNet::onHttp(std::function<void(const HostHttpRequest &, HostHttpResponse &)> handler) {
+   HostUntracked untracked;
+
+   netState().handler = handler;
+}
+
+// Sem handler nenhum servidor responde, como uma falha de conexão
+HostHttpResponse HostNet::request(const HostHttpRequest &request) {
+   HostHttpResponse response;
+
+   if (netState().handler)
+      netState().handler(request, response);
+
+   return response;
+}
+
+void HostNet::announce(const HostService &service) {
+   HostUntracked untracked;
+
+   withdraw(service.hostname);
+   netState().services.push_back(service);
+}
+
+void HostNet::withdraw(const String &hostname) {
+   std::vector<HostService> &services = netState().services;
+
+   for (size_t index = 0; index < services.size(); index++) {
+      if (services[index].hostname == hostname) {
+         services.erase(services.begin() + index);
+         return;
+      }
+   }
+}
+
+std::vector<HostService> HostNet::getServices() {
+   return netState().services;
+}
+
+// WiFiClient
+
+void WiFiClient::load(const String &body) {
+   HostUntracked untracked;
+
+   data.assign(body.c_str(), body.length());
+   position = 0;
+}
+
+void WiFiClient::stop() {
+   HostUntracked untracked;
+
+   std::string().swap(data);
+   position = 0;
+}
+
+// HTTPClient
+
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+   this->client = &client;
+   this->host = String();
+   this->port = 0;
+   this->url = url;
+
+   return true;
+}
+
+bool HTTPClient::begin(const String &host, uint16_t port, const String &uri) {
+   this->client = &ownClient;
+   this->host = host;
+   this->port = port;
+   this->url = uri;
+
+   return true;
+}
+
+void HTTPClient::end() {
+   HostUntracked untracked;
+
+   if (client != NULL)
+      client->stop();
+
+   client = NULL;
+   requestHeaders.clear();
+   responseHeaders.clear();
+   size = -1;
+}
+
+void HTTPClient::addHeader(const String &name, const String &value) {
+   requestHeaders.push_back({name, value});
+}
+
+String HTTPClient::header(const char *name) {
+   for (const std::pair<String, String> &header : responseHeaders)
+      if (header.first == name)
+         return header.second;
+
+   return String();
+}
+
+int HTTPClient::GET() {
+   return send("GET", String());
+}
+
+int HTTPClient::POST(const String &payload) {
+   return send("POST", payload);
+}
+
+int HTTPClient::getSize() {
+   return size;
+}
+
+String HTTPClient::getString() {
+   return client != NULL ? client->readString() : String();
+}
+
+WiFiClient &HTTPClient::getStream() {
+   return client != NULL ? *client : ownClient;
+}
+
+int HTTPClient::send(const char *method, const String &payload) {
+   if (client == NULL)
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+
+   HostHttpResponse response;
+
+   {
+      HostUntracked untracked;
+      HostHttpRequest request = {method, client->isSecure(), host, port, url, payload, HostNet::getLocalIP(), requestHeaders};
+
+      response = HostNet::request(request);
+      responseHeaders = response.headers;
+   }
+
+   if (response.status < 0)
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+
+   client->load(response.body);
+   size = response.body.length();
+
+   return response.status;
+}
+
+// MDNSResponder
+
+void MDNSResponder::end() {
+   HostUntracked untracked;
+
+   browsing = false;
+   browseCache.clear();
+}
+
+bool MDNSResponder::browseService(const char *service, const char *proto, uint32_t timeout) {
+   if (!browsing) {
+      browsing = true;
+      browseStart = millis();
+      browseTimeout = timeout;
+   }
+
+   return true;
+}
+
+int MDNSResponder::updateBrowse() {
+   HostUntracked untracked;
+   uint32_t now = millis();
+
+   if (browsing && now - browseStart >= browseTimeout) {
+      browsing = false;
+
+      for (const HostService &service : HostNet::getServices()) {
+         MDNSBrowseResult *entry = NULL;
+
+         for (MDNSBrowseResult &cached : browseCache)
+            if (cached.hostname == service.hostname)
+               entry = &cached;
+
+         if (entry == NULL) {
+            browseCache.push_back(MDNSBrowseResult());
+            entry = &browseCache.back();
+            entry->instance = service.hostname;
+            entry->hostname = service.hostname;
+         }
+
+         entry->ip = service.ip;
+         entry->port = service.port;
+         entry->txt = service.txt;
+         entry->expires = now + service.ttl * 1000;
+      }
+   }
+
+   for (size_t index = 0; index < browseCache.size();) {
+      if ((int32_t)(browseCache[index].expires - now) <= 0)
+         browseCache.erase(browseCache.begin() + index);
+      else
+         index++;
+   }
+
+   return browseCache.size();
+}
+
+bool MDNSResponder::isBrowsing() {
+   return browsing;
+}
+
+// Como em lib/ESPmDNS, uma cópia: a cópia é feita pelo firmware e entra na contagem do heap
+std::vector<MDNSBrowseResult> MDNSResponder::browseResults() {
+   return browseCache;
+}
@@ -0,0 +1,53 @@
+#ifndef _HOSTNET_
+#define _HOSTNET_
+
+#include <Arduino.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+struct HostHttpRequest {
+   String method;
+   bool secure;     // Requisições à nuvem, feitas com WiFiClientSecure
+   String host;     // Vazio quando a requisição foi aberta por URL
+   uint16_t port;
+   String url;      // URL completa ou caminho com a query
+   String body;
+   IPAddress client;  // IP da placa que fez a requisição
+   std::vector<std::pair<String, String>> headers;
+};
+
+struct HostHttpResponse {
+   int status = -1;  // Negativo simula uma falha de conexão
+   String body;
+   std::vector<std::pair<String, String>> headers;
+};
+
+struct HostService {
+   String hostname;
+   IPAddress ip;
+   uint16_t port;
+   std::vector<std::pair<String, String>> txt;
+   uint32_t ttl;  // Em s
+};
+
+// Rede simulada dos testes: várias placas em um só processo, que se distinguem pelo IP local
+// definido antes de cada requisição. O HTTP é atendido pelo handler do teste e o mDNS pelos
+// serviços anunciados aqui.
+class HostNet {
+  public:
+   static void reset();
+
+   static void setLocalIP(const IPAddress &ip);
+   static IPAddress getLocalIP();
+
+   static void onHttp(std::function<void(const HostHttpRequest &, HostHttpResponse &)> handler);
+   static HostHttpResponse request(const HostHttpRequest &request);
+
+   static void announce(const HostService &service);
+   static void withdraw(const String &hostname);
+   static std::vector<HostService> getServices();
+};
+
+#endif
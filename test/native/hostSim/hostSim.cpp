@@ -0,0 +1,1853 @@
+#include "hostSim.h"
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+#include <map>
+#include <new>
+#include <vector>
+
+#include "driver/adc.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_sleep.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "freertos/timers.h"
+#include "hostNet.h"
+
+#define HOST_GPIO_COUNT 64
+#define HOST_DEFAULT_INTERNAL_HEAP (200 * 1024)
+#define HOST_BLOCK_HEADER 8
+#define HOST_BLOCK_MIN 16
+#define HOST_FLASH_SECTOR 4096
+
+struct HostEspTimer {
+   esp_timer_cb_t callback;
+   void *arg;
+   esp_timer_dispatch_t dispatch;
+   int64_t due;
+   int64_t period;  // 0 para um único disparo
+   int64_t latency;  // Em us, atraso do callback em relação a due
+   uint64_t order;
+   bool active;
+};
+
+struct HostRtosTimer {
+   TimerCallbackFunction_t callback;
+   void *id;
+   TickType_t period;
+   int64_t due;
+   uint64_t order;
+   bool autoReload;
+   bool active;
+   bool dynamic;
+};
+
+static_assert(sizeof(HostRtosTimer) <= sizeof(StaticTimer_t), "StaticTimer_t não comporta o timer simulado");
+
+struct HostTask {
+   TaskFunction_t function;
+   const char *name;
+   void *parameters;
+   bool suspended;
+};
+
+struct HostSemaphore {
+   UBaseType_t count;
+   UBaseType_t maxCount;
+   bool mutex;
+   TaskHandle_t holder;
+   UBaseType_t depth;
+};
+
+// Região do heap_caps: blocos com cabeçalho de 8 bytes percorridos em ordem de endereço
+struct HostRegion {
+   uint8_t *base = NULL;
+   size_t size = 0;
+   size_t minFree = 0;
+};
+
+struct HostBlock {
+   uint32_t size;  // Inclui o cabeçalho
+   uint32_t used;
+};
+
+struct HostPartition {
+   esp_partition_t partition;
+   std::vector<uint8_t> data;
+   std::vector<uint32_t> sectorErases;
+   HostFlashStats stats;
+};
+
+struct HostState {
+   int64_t now = 0;
+   int64_t boot = 0;  // Instante do último reboot(), origem do esp_timer, do millis() e dos ticks
+   uint64_t order = 0;
+   uint32_t failCommands = 0;
+
+   std::vector<HostEspTimer *> espTimers;
+   std::vector<HostRtosTimer *> rtosTimers;
+   std::vector<HostTask *> tasks;
+   std::map<void *, uint32_t> notifications;
+   void *currentTask = NULL;
+   std::function<int64_t()> blockRunner;
+   std::function<int64_t()> espTimerLatency;
+   bool blocked = false;
+   HostTask daemon = {NULL, "Tmr Svc", NULL, false};
+
+   bool gpio[HOST_GPIO_COUNT] = {};
+   bool gpioHold[HOST_GPIO_COUNT] = {};
+   bool deepSleepHold = false;
+   std::function<void(uint8_t, bool)> gpioListener;
+
+   int64_t sleepTimer = -1;  // Em us, despertar pedido com esp_sleep_enable_timer_wakeup
+   esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+   bool adcInitialized = false;
+   bool adcStarted = false;
+   uint32_t adcFrequency = 0;  // Em Hz
+   std::function<size_t(uint8_t *, size_t)> adcSource;
+
+   uint32_t ledcDuty[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX] = {};
+   uint32_t ledcTarget[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX] = {};
+   int ledcPin[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX] = {};
+
+   int resetReason = ESP_RST_POWERON;
+   uint32_t random = 0x12345678;
+
+   HostRegion regions[2];
+
+   std::vector<HostPartition *> partitions;
+};
+
+static void initRegion(HostRegion &region, size_t size);
+
+// Estado criado no primeiro uso, já que objetos globais dos testes usam o HostSim nos construtores
+static HostState *createState() {
+   HostUntracked untracked;
+   HostState *sim = new HostState();
+
+   initRegion(sim->regions[0], HOST_DEFAULT_INTERNAL_HEAP);
+
+   return sim;
+}
+
+static HostState &state() {
+   static HostState *instance = createState();
+   return *instance;
+}
+
+// Contagem das alocações: cada bloco do operator new leva um cabeçalho com o tamanho pedido
+struct HostAllocation {
+   size_t size;
+   uint32_t tracked;
+   uint32_t magic;
+};
+
+#define HOST_ALLOCATION_MAGIC 0x484F5354
+
+static HostHeapStats heapStats;
+static bool heapTracking = true;
+
+static void *hostAllocate(size_t size) {
+   HostAllocation *header = (HostAllocation *)malloc(sizeof(HostAllocation) + size);
+
+   if (header == NULL)
+      return NULL;
+
+   header->size = size;
+   header->tracked = heapTracking;
+   header->magic = HOST_ALLOCATION_MAGIC;
+
+   if (heapTracking) {
+      heapStats.allocations++;
+      heapStats.live += size;
+      if (heapStats.live > heapStats.peak)
+         heapStats.peak = heapStats.live;
+   }
+
+   return header + 1;
+}
+
+static void hostRelease(void *pointer) {
+   if (pointer == NULL)
+      return;
+
+   HostAllocation *header = (HostAllocation *)pointer - 1;
+
+   if (header->magic != HOST_ALLOCATION_MAGIC)
+      abort();
+
+   if (header->tracked) {
+      heapStats.frees++;
+      heapStats.live -= header->size;
+   }
+
+   header->magic = 0;
+   free(header);
+}
+
+void *operator new(size_t size) {
+   void *pointer = hostAllocate(size);
+
+   if (pointer == NULL)
+      throw std::bad_alloc();
+
+   return pointer;
+}
+
+void *operator new[](size_t size) {
+   return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+   return hostAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+   return hostAllocate(size);
+}
+
+void operator delete(void *pointer) noexcept {
+   hostRelease(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+   hostRelease(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+   hostRelease(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+   hostRelease(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+   hostRelease(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+   hostRelease(pointer);
+}
+
+// Relógio e timers
+
+void HostSim::reset() {
+   HostState &sim = state();
+
+   reboot(ESP_RST_POWERON);
+
+   sim.now = 0;
+   sim.boot = 0;
+   sim.order = 0;
+   sim.failCommands = 0;
+   sim.gpioListener = nullptr;
+   sim.blockRunner = nullptr;
+   sim.espTimerLatency = nullptr;
+   sim.adcSource = nullptr;
+   sim.random = 0x12345678;
+
+   {
+      HostUntracked untracked;
+
+      for (HostPartition *partition : sim.partitions)
+         delete partition;
+      sim.partitions.clear();
+   }
+
+   HostNet::reset();
+}
+
+void HostSim::reboot(int reason) {
+   HostState &sim = state();
+   HostUntracked untracked;
+
+   for (HostEspTimer *timer : sim.espTimers)
+      delete timer;
+   for (HostRtosTimer *timer : sim.rtosTimers)
+      if (timer->dynamic)
+         delete timer;
+   for (HostTask *task : sim.tasks)
+      delete task;
+
+   sim.espTimers.clear();
+   sim.rtosTimers.clear();
+   sim.tasks.clear();
+   sim.notifications.clear();
+   sim.currentTask = NULL;
+   sim.blocked = false;
+   sim.resetReason = reason;
+   sim.boot = sim.now;
+
+   // Saídas com gpio_hold_en mantêm o nível durante o deep sleep quando gpio_deep_sleep_hold_en foi chamado
+   bool keepHeld = reason == ESP_RST_DEEPSLEEP && sim.deepSleepHold;
+   sim.wakeupCause = reason == ESP_RST_DEEPSLEEP && sim.sleepTimer >= 0 ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+   sim.sleepTimer = -1;
+   sim.deepSleepHold = false;
+
+   for (int pin = 0; pin < HOST_GPIO_COUNT; pin++) {
+      if (!keepHeld || !sim.gpioHold[pin]) {
+         sim.gpio[pin] = false;
+         sim.gpioHold[pin] = false;
+      }
+   }
+
+   sim.adcInitialized = false;
+   sim.adcStarted = false;
+   sim.adcFrequency = 0;
+
+   memset(sim.ledcDuty, 0, sizeof(sim.ledcDuty));
+   memset(sim.ledcTarget, 0, sizeof(sim.ledcTarget));
+   memset(sim.ledcPin, 0, sizeof(sim.ledcPin));
+}
+
+int64_t HostSim::now() {
+   return state().now;
+}
+
+void HostSim::advance(int64_t duration) {
+   advanceTo(state().now + duration);
+}
+
+// Dispara em ordem de prazo, e na ordem em que foram armados quando o prazo é o mesmo, os timers
+// que vencem até time. Um callback pode armar outros timers, inclusive dentro do intervalo.
+// Instante em que o callback roda: o alarme de hardware mais o atraso da esp_timer task
+static int64_t getDispatch(const HostEspTimer *timer) {
+   return timer->due + timer->latency;
+}
+
+static int64_t sampleLatency(const HostEspTimer *timer) {
+   HostState &sim = state();
+
+   return timer->dispatch == ESP_TIMER_TASK && sim.espTimerLatency ? sim.espTimerLatency() : 0;
+}
+
+void HostSim::advanceTo(int64_t time) {
+   HostState &sim = state();
+
+   while (true) {
+      HostEspTimer *espTimer = NULL;
+      HostRtosTimer *rtosTimer = NULL;
+
+      for (HostEspTimer *timer : sim.espTimers)
+         if (timer->active && getDispatch(timer) <= time &&
+             (espTimer == NULL || getDispatch(timer) < getDispatch(espTimer) || (getDispatch(timer) == getDispatch(espTimer) && timer->order < espTimer->order)))
+            espTimer = timer;
+
+      for (HostRtosTimer *timer : sim.rtosTimers)
+         if (timer->active && timer->due <= time && (rtosTimer == NULL || timer->due < rtosTimer->due || (timer->due == rtosTimer->due && timer->order < rtosTimer->order)))
+            rtosTimer = timer;
+
+      if (espTimer != NULL &&
+          (rtosTimer == NULL || getDispatch(espTimer) < rtosTimer->due || (getDispatch(espTimer) == rtosTimer->due && espTimer->order < rtosTimer->order))) {
+         sim.now = max(sim.now, getDispatch(espTimer));
+         if (espTimer->period > 0) {
+            espTimer->due += espTimer->period;
+            espTimer->latency = sampleLatency(espTimer);
+            espTimer->order = sim.order++;
+         } else {
+            espTimer->active = false;
+         }
+         espTimer->callback(espTimer->arg);
+      } else if (rtosTimer != NULL) {
+         sim.now = max(sim.now, rtosTimer->due);
+         if (rtosTimer->autoReload) {
+            rtosTimer->due += (int64_t)rtosTimer->period * 1000;
+            rtosTimer->order = sim.order++;
+         } else {
+            rtosTimer->active = false;
+         }
+
+         void *previous = sim.currentTask;
+         sim.currentTask = &sim.daemon;
+         rtosTimer->callback(rtosTimer);
+         sim.currentTask = previous;
+      } else {
+         break;
+      }
+   }
+
+   sim.now = max(sim.now, time);
+}
+
+int64_t HostSim::getNextTimer() {
+   HostState &sim = state();
+   int64_t next = INT64_MAX;
+
+   for (HostEspTimer *timer : sim.espTimers)
+      if (timer->active)
+         next = min(next, getDispatch(timer));
+   for (HostRtosTimer *timer : sim.rtosTimers)
+      if (timer->active)
+         next = min(next, timer->due);
+
+   return next;
+}
+
+void HostSim::failTimerCommands(uint32_t count) {
+   state().failCommands = count;
+}
+
+bool HostSim::takeTimerCommand() {
+   HostState &sim = state();
+
+   if (sim.failCommands == 0)
+      return true;
+
+   sim.failCommands--;
+   return false;
+}
+
+// GPIOs
+
+bool HostSim::getGpio(uint8_t pin) {
+   return pin < HOST_GPIO_COUNT && state().gpio[pin];
+}
+
+void HostSim::setGpio(uint8_t pin, bool level) {
+   HostState &sim = state();
+
+   if (pin >= HOST_GPIO_COUNT || sim.gpio[pin] == level)
+      return;
+
+   sim.gpio[pin] = level;
+   if (sim.gpioListener)
+      sim.gpioListener(pin, level);
+}
+
+void HostSim::onGpio(std::function<void(uint8_t, bool)> listener) {
+   HostUntracked untracked;
+
+   state().gpioListener = listener;
+}
+
+// ADC
+
+void HostSim::onAdcRead(std::function<size_t(uint8_t *, size_t)> source) {
+   HostUntracked untracked;
+
+   state().adcSource = source;
+}
+
+// Tasks
+
+void HostSim::setCurrentTask(void *task) {
+   state().currentTask = task;
+}
+
+void *HostSim::getCurrentTask() {
+   return state().currentTask;
+}
+
+void HostSim::notify(void *task) {
+   HostUntracked untracked;
+
+   state().notifications[task]++;
+}
+
+uint32_t HostSim::takeNotifications(void *task) {
+   HostState &sim = state();
+   auto found = sim.notifications.find(task);
+
+   if (found == sim.notifications.end())
+      return 0;
+
+   uint32_t count = found->second;
+   found->second = 0;
+
+   return count;
+}
+
+void HostSim::setEspTimerLatency(std::function<int64_t()> latency) {
+   HostUntracked untracked;
+
+   state().espTimerLatency = latency;
+}
+
+void HostSim::onBlock(std::function<int64_t()> runner) {
+   HostUntracked untracked;
+
+   state().blockRunner = runner;
+}
+
+// Passa o tempo até time ou até done() ser verdadeiro, executando as outras tasks enquanto a
+// task atual está bloqueada. Um bloqueio dentro do runner não executa o runner de novo.
+template <typename Done>
+static bool waitUntil(int64_t time, Done done) {
+   HostState &sim = state();
+   void *task = sim.currentTask;
+   bool nested = sim.blocked;
+
+   sim.blocked = true;
+
+   while (!done()) {
+      int64_t wake = INT64_MAX;
+
+      if (sim.blockRunner && !nested) {
+         wake = sim.blockRunner();
+         sim.currentTask = task;
+         if (done())
+            break;
+      }
+
+      if (sim.now >= time)
+         break;
+
+      int64_t next = min(min(time, HostSim::getNextTimer()), wake);
+      if (next == INT64_MAX) {
+         fprintf(stderr, "Task bloqueada sem prazo e sem nada que a acorde\n");
+         abort();
+      }
+
+      HostSim::advanceTo(max(next, sim.now + (next <= sim.now ? 1 : 0)));
+   }
+
+   sim.blocked = nested;
+
+   return done();
+}
+
+void HostSim::sleepUntil(int64_t time) {
+   waitUntil(time, [time]() { return state().now >= time; });
+}
+
+void HostSim::setResetReason(int reason) {
+   state().resetReason = reason;
+}
+
+int HostSim::getResetReason() {
+   return state().resetReason;
+}
+
+// Heap
+
+HostHeapStats HostSim::getHeapStats() {
+   return heapStats;
+}
+
+void HostSim::resetHeapPeak() {
+   heapStats.peak = heapStats.live;
+}
+
+bool HostSim::setHeapTracking(bool enabled) {
+   bool previous = heapTracking;
+
+   heapTracking = enabled;
+
+   return previous;
+}
+
+static void initRegion(HostRegion &region, size_t size) {
+   free(region.base);
+
+   size &= ~(size_t)7;
+   region.base = size > 0 ? (uint8_t *)malloc(size) : NULL;
+   region.size = region.base != NULL ? size : 0;
+   region.minFree = region.size > 0 ? region.size - HOST_BLOCK_HEADER : 0;
+
+   if (region.size > 0)
+      *(HostBlock *)region.base = {(uint32_t)region.size, 0};
+}
+
+void HostSim::configureHeap(size_t internal, size_t psram) {
+   HostState &sim = state();
+
+   initRegion(sim.regions[0], internal);
+   initRegion(sim.regions[1], psram);
+}
+
+static HostRegionStats getRegionStats(const HostRegion &region) {
+   HostRegionStats stats;
+
+   stats.total = region.size;
+   stats.minFree = region.minFree;
+
+   for (size_t offset = 0; offset < region.size;) {
+      HostBlock *block = (HostBlock *)(region.base + offset);
+      if (!block->used) {
+         stats.free += block->size - HOST_BLOCK_HEADER;
+         stats.largestBlock = max(stats.largestBlock, (size_t)block->size - HOST_BLOCK_HEADER);
+      }
+      offset += block->size;
+   }
+
+   return stats;
+}
+
+HostRegionStats HostSim::getRegion(bool psram) {
+   return getRegionStats(state().regions[psram ? 1 : 0]);
+}
+
+static HostRegion *findRegion(uint32_t caps) {
+   HostState &sim = state();
+
+   if (caps & MALLOC_CAP_SPIRAM)
+      return sim.regions[1].size > 0 ? &sim.regions[1] : NULL;
+
+   return &sim.regions[0];
+}
+
+static HostRegion *findOwner(void *pointer) {
+   HostState &sim = state();
+
+   for (HostRegion &region : sim.regions)
+      if ((uint8_t *)pointer >= region.base && (uint8_t *)pointer < region.base + region.size)
+         return &region;
+
+   return NULL;
+}
+
+static void *regionAllocate(HostRegion &region, size_t size) {
+   uint32_t needed = max((size_t)HOST_BLOCK_MIN, ((size + 7) & ~(size_t)7) + HOST_BLOCK_HEADER);
+
+   for (size_t offset = 0; offset < region.size;) {
+      HostBlock *block = (HostBlock *)(region.base + offset);
+
+      if (!block->used && block->size >= needed) {
+         if (block->size - needed >= HOST_BLOCK_MIN) {
+            *(HostBlock *)(region.base + offset + needed) = {block->size - needed, 0};
+            block->size = needed;
+         }
+         block->used = 1;
+
+         region.minFree = min(region.minFree, getRegionStats(region).free);
+         return block + 1;
+      }
+
+      offset += block->size;
+   }
+
+   return NULL;
+}
+
+// Junta os blocos livres vizinhos
+static void regionRelease(HostRegion &region, void *pointer) {
+   ((HostBlock *)pointer - 1)->used = 0;
+
+   for (size_t offset = 0; offset < region.size;) {
+      HostBlock *block = (HostBlock *)(region.base + offset);
+
+      while (!block->used && offset + block->size < region.size) {
+         HostBlock *next = (HostBlock *)(region.base + offset + block->size);
+         if (next->used)
+            break;
+         block->size += next->size;
+      }
+
+      offset += block->size;
+   }
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+   HostRegion *region = findRegion(caps);
+
+   return region != NULL ? regionAllocate(*region, size) : NULL;
+}
+
+void *heap_caps_calloc(size_t count, size_t size, uint32_t caps) {
+   void *pointer = heap_caps_malloc(count * size, caps);
+
+   if (pointer != NULL)
+      memset(pointer, 0, count * size);
+
+   return pointer;
+}
+
+void *heap_caps_realloc(void *pointer, size_t size, uint32_t caps) {
+   if (pointer == NULL)
+      return heap_caps_malloc(size, caps);
+
+   size_t current = ((HostBlock *)pointer - 1)->size - HOST_BLOCK_HEADER;
+   if (size <= current)
+      return pointer;
+
+   void *resized = heap_caps_malloc(size, caps);
+   if (resized != NULL) {
+      memcpy(resized, pointer, current);
+      heap_caps_free(pointer);
+   }
+
+   return resized;
+}
+
+// Liberar com heap_caps_free um ponteiro que não veio do heap_caps é um erro do firmware
+void heap_caps_free(void *pointer) {
+   if (pointer == NULL)
+      return;
+
+   HostRegion *region = findOwner(pointer);
+   if (region == NULL) {
+      fprintf(stderr, "heap_caps_free: %p não pertence ao heap simulado\n", pointer);
+      abort();
+   }
+
+   regionRelease(*region, pointer);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+   HostRegion *region = findRegion(caps);
+
+   return region != NULL ? region->size : 0;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+   HostRegion *region = findRegion(caps);
+
+   return region != NULL ? getRegionStats(*region).free : 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+   HostRegion *region = findRegion(caps);
+
+   return region != NULL ? region->minFree : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+   HostRegion *region = findRegion(caps);
+
+   return region != NULL ? getRegionStats(*region).largestBlock : 0;
+}
+
+// esp_timer
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+   if (args == NULL || args->callback == NULL || handle == NULL)
+      return ESP_ERR_INVALID_ARG;
+
+   HostEspTimer *timer = new HostEspTimer{args->callback, args->arg, args->dispatch_method, 0, 0, 0, 0, false};
+   HostUntracked untracked;
+
+   state().espTimers.push_back(timer);
+   *handle = timer;
+
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout) {
+   if (timer == NULL)
+      return ESP_ERR_INVALID_ARG;
+   if (timer->active)
+      return ESP_ERR_INVALID_STATE;
+
+   timer->due = state().now + (int64_t)timeout;
+   timer->period = 0;
+   timer->latency = sampleLatency(timer);
+   timer->order = state().order++;
+   timer->active = true;
+
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+   if (timer == NULL || period == 0)
+      return ESP_ERR_INVALID_ARG;
+   if (timer->active)
+      return ESP_ERR_INVALID_STATE;
+
+   timer->due = state().now + (int64_t)period;
+   timer->period = period;
+   timer->latency = sampleLatency(timer);
+   timer->order = state().order++;
+   timer->active = true;
+
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+   if (timer == NULL)
+      return ESP_ERR_INVALID_ARG;
+   if (!timer->active)
+      return ESP_ERR_INVALID_STATE;
+
+   timer->active = false;
+
+   return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+   if (timer == NULL)
+      return ESP_ERR_INVALID_ARG;
+   if (timer->active)
+      return ESP_ERR_INVALID_STATE;
+
+   std::vector<HostEspTimer *> &timers = state().espTimers;
+   timers.erase(std::remove(timers.begin(), timers.end(), timer), timers.end());
+   delete timer;
+
+   return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+   return timer != NULL && timer->active;
+}
+
+int64_t esp_timer_get_time() {
+   return state().now - state().boot;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+   switch (code) {
+      case ESP_OK:
+         return "ESP_OK";
+      case ESP_FAIL:
+         return "ESP_FAIL";
+      case ESP_ERR_NO_MEM:
+         return "ESP_ERR_NO_MEM";
+      case ESP_ERR_INVALID_ARG:
+         return "ESP_ERR_INVALID_ARG";
+      case ESP_ERR_INVALID_STATE:
+         return "ESP_ERR_INVALID_STATE";
+      case ESP_ERR_INVALID_SIZE:
+         return "ESP_ERR_INVALID_SIZE";
+      case ESP_ERR_NOT_FOUND:
+         return "ESP_ERR_NOT_FOUND";
+      case ESP_ERR_TIMEOUT:
+         return "ESP_ERR_TIMEOUT";
+      default:
+         return "UNKNOWN ERROR";
+   }
+}
+
+// Sistema
+
+esp_reset_reason_t esp_reset_reason() {
+   return (esp_reset_reason_t)state().resetReason;
+}
+
+// Relógio do sistema: derivado do timer RTC no ESP32, continua contando depois de um reboot()
+extern "C" int gettimeofday(struct timeval *tv, void *tz) {
+   int64_t now = state().now;
+
+   tv->tv_sec = now / 1000000;
+   tv->tv_usec = now % 1000000;
+
+   return 0;
+}
+
+void esp_restart() {
+   fprintf(stderr, "esp_restart() chamado durante a simulação\n");
+   abort();
+}
+
+esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) {
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task) {
+   return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset() {
+   return ESP_OK;
+}
+
+uint32_t esp_random() {
+   uint32_t &value = state().random;
+
+   value ^= value << 13;
+   value ^= value >> 17;
+   value ^= value << 5;
+
+   return value;
+}
+
+uint32_t esp_get_free_heap_size() {
+   return heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+   return heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+}
+
+// Tasks do FreeRTOS
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackSize, void *parameters, UBaseType_t priority,
+                                   TaskHandle_t *handle, BaseType_t core) {
+   HostTask *task = new HostTask{function, name, parameters, false};
+   HostUntracked untracked;
+
+   state().tasks.push_back(task);
+   if (handle != NULL)
+      *handle = task;
+
+   return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackSize, void *parameters, UBaseType_t priority, TaskHandle_t *handle) {
+   return xTaskCreatePinnedToCore(function, name, stackSize, parameters, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+   std::vector<HostTask *> &tasks = state().tasks;
+
+   if (task == NULL)
+      task = (TaskHandle_t)state().currentTask;
+
+   tasks.erase(std::remove(tasks.begin(), tasks.end(), task), tasks.end());
+   delete task;
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+   if (task != NULL)
+      task->suspended = true;
+}
+
+void vTaskResume(TaskHandle_t task) {
+   if (task != NULL)
+      task->suspended = false;
+}
+
+void vTaskDelay(TickType_t ticks) {
+   HostSim::sleepUntil(state().now + (int64_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount() {
+   return (TickType_t)((state().now - state().boot) / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+   return (TaskHandle_t)state().currentTask;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+   return task != NULL ? task->name : "main";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+   return 1024;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+   HostSim::notify(task);
+
+   return pdPASS;
+}
+
+// Sem notificação pendente, a task fica bloqueada até alguma chegar ou o prazo vencer
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t timeout) {
+   HostUntracked untracked;
+   HostState &sim = state();
+   void *task = sim.currentTask;
+   int64_t deadline = timeout == portMAX_DELAY ? INT64_MAX : sim.now + (int64_t)timeout * 1000;
+
+   waitUntil(deadline, [&sim, task]() { return sim.notifications[task] > 0; });
+
+   uint32_t &count = sim.notifications[task];
+   uint32_t taken = count;
+
+   if (clear)
+      count = 0;
+   else if (count > 0)
+      count--;
+
+   return taken;
+}
+
+// Semáforos
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount, bool mutex) {
+   return new HostSemaphore{initialCount, maxCount, mutex, NULL, 0};
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+   return createSemaphore(1, 1, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+   return createSemaphore(1, 1, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+   return createSemaphore(1, 0, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+   return createSemaphore(maxCount, initialCount, false);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+   delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout) {
+   if (semaphore == NULL)
+      return pdFALSE;
+
+   if (semaphore->count == 0) {
+      int64_t deadline = timeout == portMAX_DELAY ? INT64_MAX : state().now + (int64_t)timeout * 1000;
+
+      if (!waitUntil(deadline, [semaphore]() { return semaphore->count > 0; }))
+         return pdFALSE;
+   }
+
+   semaphore->count--;
+   if (semaphore->mutex)
+      semaphore->holder = xTaskGetCurrentTaskHandle();
+
+   return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+   if (semaphore == NULL || semaphore->count >= semaphore->maxCount)
+      return pdFALSE;
+
+   semaphore->count++;
+   semaphore->holder = NULL;
+
+   return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t timeout) {
+   if (semaphore != NULL && semaphore->depth > 0 && semaphore->holder == xTaskGetCurrentTaskHandle()) {
+      semaphore->depth++;
+      return pdTRUE;
+   }
+
+   if (xSemaphoreTake(semaphore, timeout) != pdTRUE)
+      return pdFALSE;
+
+   semaphore->depth = 1;
+   return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+   if (semaphore == NULL || semaphore->depth == 0)
+      return pdFALSE;
+
+   if (--semaphore->depth > 0)
+      return pdTRUE;
+
+   return xSemaphoreGive(semaphore);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken) {
+   return xSemaphoreGive(semaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+   return semaphore != NULL ? semaphore->count : 0;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t semaphore) {
+   return semaphore != NULL ? semaphore->holder : NULL;
+}
+
+// Timers do FreeRTOS
+
+static TimerHandle_t registerTimer(HostRtosTimer *timer) {
+   HostUntracked untracked;
+
+   state().rtosTimers.push_back(timer);
+
+   return timer;
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id, TimerCallbackFunction_t callback) {
+   if (period == 0)
+      return NULL;
+
+   return registerTimer(new HostRtosTimer{callback, id, period, 0, 0, autoReload != pdFALSE, false, true});
+}
+
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t autoReload, void *id, TimerCallbackFunction_t callback,
+                                 StaticTimer_t *buffer) {
+   if (period == 0 || buffer == NULL)
+      return NULL;
+
+   return registerTimer(new (buffer) HostRtosTimer{callback, id, period, 0, 0, autoReload != pdFALSE, false, false});
+}
+
+static BaseType_t armTimer(TimerHandle_t timer) {
+   if (timer == NULL || !HostSim::takeTimerCommand())
+      return pdFAIL;
+
+   timer->due = state().now + (int64_t)timer->period * 1000;
+   timer->order = state().order++;
+   timer->active = true;
+
+   return pdPASS;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t blockTime) {
+   return armTimer(timer);
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t blockTime) {
+   return armTimer(timer);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t blockTime) {
+   if (timer == NULL || !HostSim::takeTimerCommand())
+      return pdFAIL;
+
+   timer->active = false;
+
+   return pdPASS;
+}
+
+// Como no FreeRTOS, alterar o período também inicia o timer
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t blockTime) {
+   if (timer == NULL || period == 0)
+      return pdFAIL;
+
+   TickType_t previous = timer->period;
+   timer->period = period;
+
+   if (armTimer(timer) != pdPASS) {
+      timer->period = previous;
+      return pdFAIL;
+   }
+
+   return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t blockTime) {
+   if (timer == NULL || !HostSim::takeTimerCommand())
+      return pdFAIL;
+
+   std::vector<HostRtosTimer *> &timers = state().rtosTimers;
+   timers.erase(std::remove(timers.begin(), timers.end(), timer), timers.end());
+
+   if (timer->dynamic)
+      delete timer;
+   else
+      timer->active = false;
+
+   return pdPASS;
+}
+
+BaseType_t xTimerStartFromISR(TimerHandle_t timer, BaseType_t *woken) {
+   return xTimerStart(timer, 0);
+}
+
+BaseType_t xTimerStopFromISR(TimerHandle_t timer, BaseType_t *woken) {
+   return xTimerStop(timer, 0);
+}
+
+BaseType_t xTimerResetFromISR(TimerHandle_t timer, BaseType_t *woken) {
+   return xTimerReset(timer, 0);
+}
+
+BaseType_t xTimerChangePeriodFromISR(TimerHandle_t timer, TickType_t period, BaseType_t *woken) {
+   return xTimerChangePeriod(timer, period, 0);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+   return timer != NULL && timer->active ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) {
+   return timer != NULL ? timer->id : NULL;
+}
+
+TickType_t xTimerGetPeriod(TimerHandle_t timer) {
+   return timer != NULL ? timer->period : 0;
+}
+
+TickType_t xTimerGetExpiryTime(TimerHandle_t timer) {
+   return timer != NULL ? (TickType_t)(timer->due / 1000) : 0;
+}
+
+TaskHandle_t xTimerGetTimerDaemonTaskHandle() {
+   return &state().daemon;
+}
+
+// GPIO e LEDC
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+   if (pin < 0 || pin >= GPIO_NUM_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   HostSim::setGpio(pin, level != 0);
+
+   return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+   return HostSim::getGpio(pin);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) {
+   return pin >= 0 && pin < GPIO_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin) {
+   return gpio_set_level(pin, 0);
+}
+
+esp_err_t gpio_hold_en(gpio_num_t pin) {
+   if (pin < 0 || pin >= GPIO_NUM_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   state().gpioHold[pin] = true;
+
+   return ESP_OK;
+}
+
+esp_err_t gpio_hold_dis(gpio_num_t pin) {
+   if (pin < 0 || pin >= GPIO_NUM_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   state().gpioHold[pin] = false;
+
+   return ESP_OK;
+}
+
+void gpio_deep_sleep_hold_en() {
+   state().deepSleepHold = true;
+}
+
+void gpio_deep_sleep_hold_dis() {
+   state().deepSleepHold = false;
+}
+
+// ADC DMA
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *config) {
+   HostState &sim = state();
+
+   if (sim.adcInitialized)
+      return ESP_ERR_INVALID_STATE;
+
+   sim.adcInitialized = true;
+   return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config) {
+   if (!state().adcInitialized || config->sample_freq_hz == 0)
+      return ESP_ERR_INVALID_ARG;
+
+   state().adcFrequency = config->sample_freq_hz;
+   return ESP_OK;
+}
+
+esp_err_t adc_digi_start() {
+   HostState &sim = state();
+
+   if (!sim.adcInitialized || sim.adcFrequency == 0)
+      return ESP_ERR_INVALID_STATE;
+
+   sim.adcStarted = true;
+   return ESP_OK;
+}
+
+esp_err_t adc_digi_stop() {
+   state().adcStarted = false;
+   return ESP_OK;
+}
+
+// Bloqueia pelo tempo de conversão dos resultados entregues, como a espera pelo DMA na placa
+esp_err_t adc_digi_read_bytes(uint8_t *buffer, uint32_t maxLength, uint32_t *length, uint32_t timeout) {
+   HostState &sim = state();
+
+   *length = 0;
+   if (!sim.adcStarted)
+      return ESP_ERR_INVALID_STATE;
+
+   size_t read = sim.adcSource ? sim.adcSource(buffer, maxLength - maxLength % SOC_ADC_DIGI_RESULT_BYTES) : 0;
+   if (read == 0)
+      return ESP_ERR_TIMEOUT;
+
+   HostSim::sleepUntil(sim.now + (int64_t)(read / SOC_ADC_DIGI_RESULT_BYTES) * 1000000 / sim.adcFrequency);
+
+   *length = read;
+   return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize() {
+   HostState &sim = state();
+
+   sim.adcInitialized = false;
+   sim.adcStarted = false;
+   sim.adcFrequency = 0;
+   return ESP_OK;
+}
+
+// Deep sleep
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+   return state().wakeupCause;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t duration) {
+   state().sleepTimer = duration;
+
+   return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+   HostState &sim = state();
+
+   throw HostDeepSleep{sim.sleepTimer >= 0 ? (uint64_t)sim.sleepTimer : 0};
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config) {
+   return config != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config) {
+   if (config == NULL || config->speed_mode >= LEDC_SPEED_MODE_MAX || config->channel >= LEDC_CHANNEL_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   HostState &sim = state();
+   sim.ledcPin[config->speed_mode][config->channel] = config->gpio_num;
+   sim.ledcDuty[config->speed_mode][config->channel] = config->duty;
+   HostSim::setGpio(config->gpio_num, config->duty > 0);
+
+   return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int flags) {
+   return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, int time) {
+   if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   state().ledcTarget[mode][channel] = duty;
+
+   return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel, ledc_fade_mode_t fadeMode) {
+   if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   return ledc_set_duty(mode, channel, state().ledcTarget[mode][channel]) == ESP_OK ? ledc_update_duty(mode, channel) : ESP_FAIL;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty) {
+   if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   state().ledcTarget[mode][channel] = duty;
+
+   return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) {
+   if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+      return ESP_ERR_INVALID_ARG;
+
+   HostState &sim = state();
+   sim.ledcDuty[mode][channel] = sim.ledcTarget[mode][channel];
+   HostSim::setGpio(sim.ledcPin[mode][channel], sim.ledcDuty[mode][channel] > 0);
+
+   return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel) {
+   if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+      return 0;
+
+   return state().ledcDuty[mode][channel];
+}
+
+// Core Arduino
+
+HardwareSerial Serial;
+EspClass ESP;
+
+unsigned long millis() {
+   return (state().now - state().boot) / 1000;
+}
+
+unsigned long micros() {
+   return state().now - state().boot;
+}
+
+void delay(uint32_t ms) {
+   vTaskDelay(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+   HostSim::advance(us);
+}
+
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+   HostSim::setGpio(pin, level != LOW);
+}
+
+int digitalRead(uint8_t pin) {
+   return HostSim::getGpio(pin) ? HIGH : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+   return 0;
+}
+
+long random(long maximum) {
+   return maximum > 0 ? esp_random() % maximum : 0;
+}
+
+long random(long minimum, long maximum) {
+   return maximum > minimum ? minimum + random(maximum - minimum) : minimum;
+}
+
+void randomSeed(unsigned long seed) {
+   if (seed != 0)
+      state().random = seed;
+}
+
+size_t HardwareSerial::write(uint8_t character) {
+   return fwrite(&character, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+   return fwrite(buffer, 1, size, stdout);
+}
+
+void EspClass::restart() {
+   esp_restart();
+}
+
+uint32_t EspClass::getFreeHeap() {
+   return esp_get_free_heap_size();
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+   return esp_get_minimum_free_heap_size();
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+   return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+}
+
+// Print e Stream
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+   size_t written = 0;
+
+   while (written < size && write(buffer[written]) == 1)
+      written++;
+
+   return written;
+}
+
+size_t Print::write(const char *text) {
+   return text != NULL ? write((const uint8_t *)text, strlen(text)) : 0;
+}
+
+size_t Print::print(const String &text) {
+   return write((const uint8_t *)text.c_str(), text.length());
+}
+
+size_t Print::print(const char *text) {
+   return write(text);
+}
+
+size_t Print::print(long number) {
+   return print(String(number));
+}
+
+size_t Print::println(const String &text) {
+   return print(text) + write("\r\n");
+}
+
+size_t Print::println(const char *text) {
+   return print(text) + write("\r\n");
+}
+
+size_t Print::printf(const char *format, ...) {
+   char buffer[256];
+   va_list arguments;
+
+   va_start(arguments, format);
+   int length = vsnprintf(buffer, sizeof(buffer), format, arguments);
+   va_end(arguments);
+
+   return length > 0 ? write((const uint8_t *)buffer, min((size_t)length, sizeof(buffer) - 1)) : 0;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+   size_t count = 0;
+
+   while (count < length) {
+      int character = read();
+      if (character < 0)
+         break;
+      buffer[count++] = (char)character;
+   }
+
+   return count;
+}
+
+bool Stream::find(const char *target) {
+   size_t length = strlen(target), matched = 0;
+
+   if (length == 0)
+      return true;
+
+   for (int character = read(); character >= 0; character = read()) {
+      if (character == target[matched]) {
+         if (++matched == length)
+            return true;
+      } else {
+         // Recomeça a comparação sem perder um prefixo que também case
+         size_t restart = matched;
+         while (restart > 0) {
+            restart--;
+            if (memcmp(target, target + matched - restart, restart) == 0 && target[restart] == character)
+               break;
+         }
+         matched = target[restart] == character ? restart + 1 : 0;
+      }
+   }
+
+   return false;
+}
+
+// Usado com alvos curtos (separadores do JSON): a comparação recomeça do primeiro caractere
+bool Stream::findUntil(const char *target, const char *terminator) {
+   size_t targetLength = strlen(target), terminatorLength = strlen(terminator);
+   size_t targetMatched = 0, terminatorMatched = 0;
+
+   for (int character = read(); character >= 0; character = read()) {
+      targetMatched = character == target[targetMatched] ? targetMatched + 1 : character == target[0];
+      terminatorMatched = terminatorLength > 0 && character == terminator[terminatorMatched] ? terminatorMatched + 1 : character == terminator[0];
+
+      if (targetMatched == targetLength)
+         return true;
+      if (terminatorLength > 0 && terminatorMatched == terminatorLength)
+         return false;
+   }
+
+   return false;
+}
+
+String Stream::readString() {
+   String text;
+
+   for (int character = read(); character >= 0; character = read())
+      text.concat((char)character);
+
+   return text;
+}
+
+// String
+
+static std::string formatNumber(unsigned long long number, bool negative, unsigned char base) {
+   char buffer[72];
+   size_t position = sizeof(buffer) - 1;
+
+   if (base < 2 || base > 36)
+      base = DEC;
+
+   buffer[position] = '\0';
+   do {
+      uint8_t digit = number % base;
+      buffer[--position] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+      number /= base;
+   } while (number > 0);
+
+   if (negative)
+      buffer[--position] = '-';
+
+   return std::string(buffer + position);
+}
+
+String::String(int number, unsigned char base) : String((long long)number, base) {}
+
+String::String(unsigned int number, unsigned char base) : String((unsigned long long)number, base) {}
+
+String::String(long number, unsigned char base) : String((long long)number, base) {}
+
+String::String(unsigned long number, unsigned char base) : String((unsigned long long)number, base) {}
+
+String::String(long long number, unsigned char base) {
+   bool negative = number < 0 && base == DEC;
+
+   value = formatNumber(negative ? -(unsigned long long)number : (unsigned long long)number, negative, base);
+}
+
+String::String(unsigned long long number, unsigned char base) : value(formatNumber(number, false, base)) {}
+
+String::String(float number, unsigned int decimals) : String((double)number, decimals) {}
+
+String::String(double number, unsigned int decimals) {
+   char buffer[64];
+
+   snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+   value = buffer;
+}
+
+int String::indexOf(char character, size_t from) const {
+   size_t position = value.find(character, from);
+
+   return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const char *text, size_t from) const {
+   size_t position = value.find(text, from);
+
+   return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::lastIndexOf(char character) const {
+   size_t position = value.rfind(character);
+
+   return position == std::string::npos ? -1 : (int)position;
+}
+
+bool String::endsWith(const String &suffix) const {
+   return value.length() >= suffix.value.length() && value.compare(value.length() - suffix.value.length(), suffix.value.length(), suffix.value) == 0;
+}
+
+String String::substring(size_t from, size_t to) const {
+   if (from > to)
+      std::swap(from, to);
+   if (from >= value.length())
+      return String();
+
+   return String(value.substr(from, min(to, value.length()) - from));
+}
+
+void String::trim() {
+   size_t first = value.find_first_not_of(" \t\r\n");
+   size_t last = value.find_last_not_of(" \t\r\n");
+
+   value = first == std::string::npos ? std::string() : value.substr(first, last - first + 1);
+}
+
+void String::toLowerCase() {
+   for (char &character : value)
+      character = tolower(character);
+}
+
+void String::toUpperCase() {
+   for (char &character : value)
+      character = toupper(character);
+}
+
+void String::remove(size_t index, size_t count) {
+   if (index < value.length())
+      value.erase(index, count);
+}
+
+long String::toInt() const {
+   return strtol(value.c_str(), NULL, 10);
+}
+
+float String::toFloat() const {
+   return strtof(value.c_str(), NULL);
+}
+
+StringSumHelper operator+(const StringSumHelper &first, const String &second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &first, const char *second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &first, char second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, const String &second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, const char *second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const char *first, const String &second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, char second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &first, int second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &first, unsigned int second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &first, long second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const StringSumHelper &first, unsigned long second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, int second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, unsigned int second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, long second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+StringSumHelper operator+(const String &first, unsigned long second) {
+   StringSumHelper sum(first);
+   sum.concat(second);
+   return sum;
+}
+
+String IPAddress::toString() const {
+   char text[16];
+
+   snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+
+   return String(text);
+}
+
+// Flash
+
+void HostSim::addPartition(const char *label, size_t size) {
+   HostState &sim = state();
+   HostUntracked untracked;
+   HostPartition *partition = new HostPartition();
+   uint32_t address = 0x3E0000;
+
+   for (HostPartition *other : sim.partitions)
+      address = max(address, other->partition.address + other->partition.size);
+
+   partition->partition.type = ESP_PARTITION_TYPE_DATA;
+   partition->partition.subtype = (esp_partition_subtype_t)0x40;
+   partition->partition.address = address;
+   partition->partition.size = size;
+   partition->partition.encrypted = false;
+   snprintf(partition->partition.label, sizeof(partition->partition.label), "%s", label);
+
+   partition->data.assign(size, 0xFF);
+   partition->sectorErases.assign((size + HOST_FLASH_SECTOR - 1) / HOST_FLASH_SECTOR, 0);
+
+   sim.partitions.push_back(partition);
+}
+
+static HostPartition *findPartition(const esp_partition_t *partition) {
+   for (HostPartition *candidate : state().partitions)
+      if (&candidate->partition == partition)
+         return candidate;
+
+   return NULL;
+}
+
+HostFlashStats HostSim::getFlashStats(const char *label) {
+   for (HostPartition *partition : state().partitions) {
+      if (strcmp(partition->partition.label, label) == 0) {
+         HostFlashStats stats = partition->stats;
+
+         stats.minSectorErases = *std::min_element(partition->sectorErases.begin(), partition->sectorErases.end());
+         stats.maxSectorErases = *std::max_element(partition->sectorErases.begin(), partition->sectorErases.end());
+
+         return stats;
+      }
+   }
+
+   return HostFlashStats();
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) {
+   for (HostPartition *partition : state().partitions) {
+      if (partition->partition.type != type)
+         continue;
+      if (subtype != ESP_PARTITION_SUBTYPE_ANY && partition->partition.subtype != subtype)
+         continue;
+      if (label == NULL || strcmp(partition->partition.label, label) == 0)
+         return &partition->partition;
+   }
+
+   return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *destination, size_t size) {
+   HostPartition *flash = findPartition(partition);
+
+   if (flash == NULL || destination == NULL)
+      return ESP_ERR_INVALID_ARG;
+   if (offset > flash->data.size() || size > flash->data.size() - offset)
+      return ESP_ERR_INVALID_SIZE;
+
+   memcpy(destination, flash->data.data() + offset, size);
+
+   return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *source, size_t size) {
+   HostPartition *flash = findPartition(partition);
+
+   if (flash == NULL || source == NULL)
+      return ESP_ERR_INVALID_ARG;
+   if (offset > flash->data.size() || size > flash->data.size() - offset)
+      return ESP_ERR_INVALID_SIZE;
+
+   // A escrita só leva bits de 1 para 0
+   for (size_t index = 0; index < size; index++)
+      flash->data[offset + index] &= ((const uint8_t *)source)[index];
+
+   flash->stats.writes++;
+   flash->stats.bytesWritten += size;
+
+   return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+   HostPartition *flash = findPartition(partition);
+
+   if (flash == NULL)
+      return ESP_ERR_INVALID_ARG;
+   if (offset % HOST_FLASH_SECTOR != 0 || size % HOST_FLASH_SECTOR != 0)
+      return ESP_ERR_INVALID_ARG;
+   if (offset > flash->data.size() || size > flash->data.size() - offset)
+      return ESP_ERR_INVALID_SIZE;
+
+   memset(flash->data.data() + offset, 0xFF, size);
+
+   for (size_t sector = offset / HOST_FLASH_SECTOR; sector < (offset + size) / HOST_FLASH_SECTOR; sector++)
+      flash->sectorErases[sector]++;
+
+   flash->stats.erases++;
+
+   return ESP_OK;
+}
@@ -0,0 +1,109 @@
+#ifndef _HOSTSIM_
+#define _HOSTSIM_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+struct HostHeapStats {
+   uint32_t allocations = 0;  // Chamadas ao operator new contabilizadas
+   uint32_t frees = 0;
+   size_t live = 0;  // Em bytes
+   size_t peak = 0;  // Em bytes, maior valor de live desde o último resetHeapPeak()
+};
+
+struct HostFlashStats {
+   uint32_t writes = 0;
+   uint32_t erases = 0;
+   size_t bytesWritten = 0;
+   uint32_t maxSectorErases = 0;  // Maior número de apagamentos de um mesmo setor
+   uint32_t minSectorErases = 0;
+};
+
+struct HostRegionStats {
+   size_t total = 0;
+   size_t free = 0;
+   size_t minFree = 0;
+   size_t largestBlock = 0;
+};
+
+// Ambiente simulado usado pelos testes do env native: relógio único para o esp_timer, os ticks do
+// FreeRTOS e o millis(), timers disparados em ordem quando o relógio avança, GPIOs, notificações
+// das tasks e contagem das alocações. Tudo roda em uma única thread e é determinístico.
+class HostSim {
+  public:
+   // Zera o relógio e descarta timers, notificações, GPIOs e a rede do HostNet. Deve ser chamado
+   // antes de criar os objetos do teste, já que os timers criados antes deixam de existir.
+   static void reset();
+
+   // Reset da CPU: descarta timers, tasks e GPIOs, mas mantém o relógio e as variáveis globais, que
+   // fazem o papel da memória RTC. Os objetos do firmware devem ser criados de novo, como no boot.
+   // Como na placa, esp_timer_get_time(), millis() e os ticks recomeçam do zero. Com
+   // ESP_RST_DEEPSLEEP a placa acorda pelo timer, se armado, e as saídas com hold mantêm o nível.
+   static void reboot(int reason);
+
+   static int64_t now();  // Em us, desde o reset(); não recomeça no reboot()
+   static void advance(int64_t duration);
+   static void advanceTo(int64_t time);
+   static int64_t getNextTimer();  // Em us, INT64_MAX sem timers ativos
+
+   // Atraso, em us, sorteado a cada disparo dos esp_timer com ESP_TIMER_TASK: o tempo até a
+   // esp_timer task rodar o callback depois do alarme. Os de ESP_TIMER_ISR não atrasam.
+   static void setEspTimerLatency(std::function<int64_t()> latency);
+
+   // Os próximos count comandos enviados ao timer service falham como se a fila estivesse cheia
+   static void failTimerCommands(uint32_t count);
+   static bool takeTimerCommand();
+
+   static bool getGpio(uint8_t pin);
+   static void setGpio(uint8_t pin, bool level);
+   static void onGpio(std::function<void(uint8_t, bool)> listener);
+
+   // Fonte dos resultados do ADC DMA: preenche até maxLength bytes com adc_digi_output_data_t e
+   // retorna quantos preencheu. Pode encerrar quem lê (ex.: SensorSampler::end()) de dentro dela.
+   static void onAdcRead(std::function<size_t(uint8_t *buffer, size_t maxLength)> source);
+
+   // Task em execução, usada por xTaskGetCurrentTaskHandle e ulTaskNotifyTake
+   static void setCurrentTask(void *task);
+   static void *getCurrentTask();
+   static void notify(void *task);
+   static uint32_t takeNotifications(void *task);
+
+   // Bloqueios (vTaskDelay, ulTaskNotifyTake, xSemaphoreTake com prazo) passam o tempo chamando
+   // runner, que executa as demais tasks simuladas prontas e retorna o próximo instante em que
+   // alguma delas acorda (INT64_MAX se nenhuma). Sem runner o tempo só avança de timer em timer.
+   static void onBlock(std::function<int64_t()> runner);
+   static void sleepUntil(int64_t time);
+
+   static void setResetReason(int reason);
+   static int getResetReason();
+
+   // Contagem das alocações feitas pelo operator new. Com o tracking desligado, as alocações do
+   // próprio teste (registros, relatórios) não entram nas estatísticas.
+   static HostHeapStats getHeapStats();
+   static void resetHeapPeak();
+   static bool setHeapTracking(bool enabled);
+
+   // Heap do heap_caps_* com alocação first-fit, para medir fragmentação. psram 0 simula uma placa sem PSRAM.
+   static void configureHeap(size_t internal, size_t psram);
+   static HostRegionStats getRegion(bool psram);
+
+   // Partição de dados na flash simulada, lida e gravada pelo esp_partition_*. Como na NOR, a
+   // escrita só zera bits e o apagamento, em setores de 4 KB, volta o setor para 0xFF. O conteúdo
+   // sobrevive ao reboot(); o reset() remove todas as partições.
+   static void addPartition(const char *label, size_t size);
+   static HostFlashStats getFlashStats(const char *label);
+};
+
+// Desliga o tracking do heap enquanto existir
+class HostUntracked {
+  public:
+   HostUntracked() : previous(HostSim::setHeapTracking(false)) {}
+   ~HostUntracked() { HostSim::setHeapTracking(previous); }
+
+  private:
+   bool previous;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _HOSTSIM_CORE_MACROS_
+#define _HOSTSIM_CORE_MACROS_
+
+#include <stdint.h>
+
+// Contador de ciclos do host no lugar do CCOUNT do Xtensa: os valores medidos no host só servem
+// para comparação entre si, não para estimar os ciclos na placa
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define XTHAL_GET_CCOUNT() ((uint32_t)__rdtsc())
+#else
+#include <time.h>
+static inline uint32_t hostCycleCount() {
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+#define XTHAL_GET_CCOUNT() hostCycleCount()
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+// Limite de registros por módulo do AsyncLogger e gravação em lote do CrashLog: um módulo em laço
+// não tira o espaço dos outros, a supressão aparece no log, as linhas de aviso chegam à flash em
+// poucos lotes e as que ainda estavam na memória RTC no reset são gravadas no boot seguinte.
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "asyncLogger.h"
+#include "crashLog.h"
+#include "esp_system.h"
+#include "freertos/task.h"
+#include "hostSim.h"
+
+#define RATE_LIMIT 20
+#define FLUSH_INTERVAL 60000  // Em ms
+#define DRAIN_DELAY 200       // Em ms, período da vTaskLogger
+
+// Flash simulada: cada chamada do writer é uma abertura do arquivo
+struct Flash {
+   std::string content;
+   uint32_t writes = 0;
+   bool failing = false;
+
+   CrashLogWriter writer() {
+      return [this](const char *data, size_t length) {
+         if (failing)
+            return false;
+         content.append(data, length);
+         writes++;
+         return true;
+      };
+   }
+};
+
+static std::vector<std::string> lines;
+
+static void collect(const LogRecord &record, const char *line) {
+   lines.push_back(line);
+}
+
+void setUp() {
+   HostSim::reset();
+   lines.clear();
+}
+
+void tearDown() {}
+
+void test_rate_limit_per_module() {
+   AsyncLogger logger(LOG_DEBUG, RATE_LIMIT);
+   uint32_t accepted = 0;
+
+   logger.addSink(LOG_DEBUG, collect);
+
+   for (int index = 0; index < 100; index++) {
+      accepted += logger.log(LOG_PUMPS, LOG_ERROR, "failure %d", index);
+      logger.drain();
+   }
+   TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT, accepted);
+
+   // Os demais módulos continuam com a própria cota
+   TEST_ASSERT_TRUE(logger.log(LOG_WEB, LOG_INFO, "request"));
+   logger.drain();
+
+   HostSim::advance(LOG_RATE_WINDOW * 1000LL);
+   TEST_ASSERT_TRUE(logger.log(LOG_PUMPS, LOG_ERROR, "failure again"));
+   logger.drain();
+
+   LoggerStats stats = logger.getStats();
+   TEST_ASSERT_EQUAL_UINT32(100 - RATE_LIMIT, stats.limited);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+   TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT + 3, lines.size());
+   TEST_ASSERT_TRUE(lines[RATE_LIMIT + 1].find("[W][pumps] 80 records suppressed by the rate limit") != std::string::npos);
+   TEST_ASSERT_TRUE(lines[RATE_LIMIT + 2].find("failure again") != std::string::npos);
+
+   // Sem novos excessos, a janela seguinte não repete o aviso
+   HostSim::advance(LOG_RATE_WINDOW * 1000LL);
+   logger.log(LOG_PUMPS, LOG_ERROR, "last");
+   logger.drain();
+   TEST_ASSERT_TRUE(lines.back().find("last") != std::string::npos);
+   TEST_ASSERT_EQUAL_UINT32(RATE_LIMIT + 4, lines.size());
+}
+
+void test_sinks_are_fixed_once_delivery_starts() {
+   AsyncLogger logger(LOG_DEBUG);
+   TaskHandle_t task;
+
+   xTaskCreatePinnedToCore(NULL, "taskLogger", 4096, NULL, 1, &task, PRO_CPU_NUM);
+   TEST_ASSERT_TRUE(logger.addSink(LOG_DEBUG, collect));
+   logger.setTask(task);
+   TEST_ASSERT_FALSE(logger.addSink(LOG_WARN, collect));
+}
+
+// Avisos em rajada pela vTaskLogger: poucas aberturas do arquivo e nenhuma linha perdida
+void test_crash_log_is_written_in_batches() {
+   AsyncLogger logger(LOG_DEBUG);
+   CrashLog crashLog(FLUSH_INTERVAL);
+   Flash flash;
+   std::string expected;
+
+   crashLog.begin(false);
+   logger.addSink(LOG_WARN, [&crashLog](const LogRecord &record, const char *line) { crashLog.append(line); });
+   logger.addSink(LOG_WARN, collect);
+   crashLog.setWriter(flash.writer());
+
+   for (int index = 0; index < 600; index++) {
+      logger.log((LogModule)(index % LOG_MODULES), index % 3 ? LOG_WARN : LOG_DEBUG, "event %d with some detail", index);
+
+      if (index % 10 == 9) {
+         HostSim::advance(DRAIN_DELAY * 1000LL);
+         logger.drain();
+         crashLog.flushIfDue();
+      }
+   }
+
+   // Menos da metade do buffer pendente: só grava no prazo
+   crashLog.flush();
+   logger.log(LOG_SYSTEM, LOG_ERROR, "tail");
+   logger.drain();
+
+   for (const std::string &line : lines)
+      expected += line;
+
+   TEST_ASSERT_GREATER_THAN(0, crashLog.getPending());
+   uint32_t writes = flash.writes;
+   crashLog.flushIfDue();
+   TEST_ASSERT_EQUAL_UINT32(writes, flash.writes);
+   HostSim::advance(FLUSH_INTERVAL * 1000LL);
+   crashLog.flushIfDue();
+
+   printf("%u linhas, %u bytes em %u gravações\n", (unsigned)lines.size(), (unsigned)flash.content.size(), flash.writes);
+   TEST_ASSERT_EQUAL(0, crashLog.getPending());
+   TEST_ASSERT_EQUAL_STRING(expected.c_str(), flash.content.c_str());
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(lines.size() / 10, flash.writes);
+   TEST_ASSERT_EQUAL_UINT32(flash.writes, crashLog.getStats().flushes);
+}
+
+// Linhas que não chegaram à flash antes de um panic são gravadas no boot seguinte, antes das novas
+void test_pending_lines_survive_a_panic() {
+   Flash flash;
+
+   {
+      CrashLog crashLog(FLUSH_INTERVAL);
+      crashLog.begin(false);
+      crashLog.setWriter(flash.writer());
+      crashLog.append("[W] before the write\n");
+      crashLog.flush();
+      crashLog.append("[E] stack overflow in taskPumps\n");
+   }
+
+   HostSim::reboot(ESP_RST_PANIC);
+
+   CrashLog crashLog(FLUSH_INTERVAL);
+   TEST_ASSERT_TRUE(crashLog.begin(true));
+   TEST_ASSERT_EQUAL_UINT32(strlen("[E] stack overflow in taskPumps\n"), crashLog.getStats().recovered);
+
+   // Sem a SPIFFS montada as linhas só se acumulam
+   crashLog.append("[E] Restarted after panic\n");
+   TEST_ASSERT_FALSE(crashLog.flush());
+
+   crashLog.setWriter(flash.writer());
+   TEST_ASSERT_TRUE(crashLog.flush());
+   TEST_ASSERT_EQUAL_STRING("[W] before the write\n[E] stack overflow in taskPumps\n[E] Restarted after panic\n", flash.content.c_str());
+   TEST_ASSERT_EQUAL_UINT32(2, flash.writes);
+
+   // Depois de um power-on o conteúdo da memória RTC é descartado
+   crashLog.append("[W] lost with the power\n");
+   HostSim::reboot(ESP_RST_POWERON);
+
+   CrashLog afterPowerOn(FLUSH_INTERVAL);
+   TEST_ASSERT_FALSE(afterPowerOn.begin(false));
+   TEST_ASSERT_EQUAL(0, afterPowerOn.getPending());
+}
+
+// Com a flash falhando, as linhas ficam pendentes e só são tentadas de novo no prazo
+void test_failing_flash_keeps_lines_and_backs_off() {
+   CrashLog crashLog(FLUSH_INTERVAL);
+   Flash flash;
+   char line[64];
+   uint32_t appended = 0;
+
+   crashLog.begin(false);
+   crashLog.setWriter(flash.writer());
+   flash.failing = true;
+
+   for (int index = 0; index < 200; index++) {
+      snprintf(line, sizeof(line), "[W][system] warning number %03d\n", index);
+      appended += crashLog.append(line);
+      crashLog.flushIfDue();
+   }
+
+   CrashLogStats stats = crashLog.getStats();
+   TEST_ASSERT_EQUAL_UINT32(1, stats.failures);
+   TEST_ASSERT_EQUAL_UINT32(200 - appended, stats.dropped);
+   TEST_ASSERT_GREATER_THAN_UINT32(CRASH_LOG_BUFFER - 64, crashLog.getPending());
+
+   flash.failing = false;
+   HostSim::advance(FLUSH_INTERVAL * 1000LL);
+   TEST_ASSERT_TRUE(crashLog.flushIfDue());
+   TEST_ASSERT_EQUAL(appended * strlen(line), flash.content.size());
+   TEST_ASSERT_TRUE(flash.content.find("[W][system] warning number 000") == 0);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_rate_limit_per_module);
+   RUN_TEST(test_sinks_are_fixed_once_delivery_starts);
+   RUN_TEST(test_crash_log_is_written_in_batches);
+   RUN_TEST(test_pending_lines_survive_a_panic);
+   RUN_TEST(test_failing_flash_keeps_lines_and_backs_off);
+   return UNITY_END();
+}
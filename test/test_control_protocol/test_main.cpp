@@ -0,0 +1,318 @@
+// Regressão e fuzzing do protocolo binário de controle: mensagens válidas geradas ao acaso e
+// fragmentadas em trechos aleatórios voltam idênticas do ControlAssembler e do ControlReader, e
+// mensagens aleatórias ou corrompidas nunca são lidas além do fim (o buffer tem o tamanho exato,
+// para o AddressSanitizer acusar) e sempre produzem um ACK por comando, mais um se truncada.
+#include <unity.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "controlProtocol.h"
+
+#define FUZZ_ITERATIONS 200000
+
+struct Encoded {
+   uint8_t opcode;
+   uint16_t sequence;
+   std::vector<uint8_t> payload;
+};
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+static void encode(std::vector<uint8_t> &message, const Encoded &command) {
+   message.push_back(command.opcode);
+   message.push_back(command.sequence & 0xFF);
+   message.push_back(command.sequence >> 8);
+   message.push_back(command.payload.size());
+   message.insert(message.end(), command.payload.begin(), command.payload.end());
+}
+
+static Encoded randomCommand() {
+   Encoded command;
+
+   command.opcode = CONTROL_STATES + nextRandom(5);
+   command.sequence = nextRandom(65536);
+
+   switch (command.opcode) {
+      case CONTROL_START:
+      case CONTROL_STOP:
+         command.payload.push_back(nextRandom(8));
+         break;
+
+      case CONTROL_SET_PULSE: {
+         uint32_t pulse = 1 + nextRandom(0xFFFFFF) * 251;
+         command.payload = {(uint8_t)nextRandom(8), (uint8_t)pulse, (uint8_t)(pulse >> 8), (uint8_t)(pulse >> 16), (uint8_t)(pulse >> 24)};
+         break;
+      }
+
+      case CONTROL_SET_SCHEDULE:
+         command.payload.push_back(nextRandom(8));
+         for (size_t index = 0, count = nextRandom(CONTROL_MAX_TIMES + 1); index < count; index++) {
+            uint32_t second = nextRandom(86400);
+            command.payload.insert(command.payload.end(), {(uint8_t)second, (uint8_t)(second >> 8), (uint8_t)(second >> 16)});
+         }
+         break;
+   }
+
+   return command;
+}
+
+// Entrega a mensagem em trechos de tamanho aleatório, como os frames do WebSocket
+static void assemble(ControlAssembler &assembler, const std::vector<uint8_t> &message) {
+   assembler.reset();
+
+   for (size_t position = 0; position < message.size();) {
+      size_t length = 1 + nextRandom(message.size() - position < 64 ? message.size() - position : 64);
+      assembler.append(message.data() + position, length);
+      position += length;
+   }
+}
+
+// Mesmo laço de handleControlMessage, com os payloads decodificados pelos helpers do leitor
+static ControlAckWriter readAll(const uint8_t *data, size_t size, size_t &commands, size_t &consumed) {
+   ControlReader reader(data, size);
+   ControlAckWriter acks;
+   ControlCommand command;
+   uint8_t pump;
+   uint32_t pulse;
+   uint32_t seconds[CONTROL_MAX_TIMES];
+   size_t count;
+
+   commands = 0;
+   consumed = 0;
+
+   while (reader.next(command)) {
+      TEST_ASSERT_TRUE(command.payload >= data && command.payload + command.length <= data + size);
+
+      ControlReader::readPump(command, pump);
+      ControlReader::readPulse(command, pump, pulse);
+      if (ControlReader::readSchedule(command, pump, seconds, count))
+         TEST_ASSERT_LESS_OR_EQUAL(CONTROL_MAX_TIMES, count);
+
+      TEST_ASSERT_TRUE(acks.add(command, CONTROL_OK));
+      consumed += CONTROL_HEADER_SIZE + command.length;
+      commands++;
+   }
+
+   TEST_ASSERT_EQUAL(reader.isTruncated(), consumed < size);
+   if (reader.isTruncated())
+      TEST_ASSERT_TRUE(acks.add(0, 0, CONTROL_MALFORMED));
+
+   return acks;
+}
+
+void setUp() {
+   seed = 0xF022;
+}
+
+void tearDown() {}
+
+void test_fragmented_messages_round_trip() {
+   ControlAssembler assembler;
+
+   for (size_t iteration = 0; iteration < 5000; iteration++) {
+      std::vector<Encoded> expected;
+      std::vector<uint8_t> message;
+
+      while (true) {
+         Encoded command = randomCommand();
+         if (message.size() + CONTROL_HEADER_SIZE + command.payload.size() > CONTROL_MAX_MESSAGE)
+            break;
+         encode(message, command);
+         expected.push_back(command);
+      }
+
+      assemble(assembler, message);
+      TEST_ASSERT_FALSE(assembler.isOverflowed());
+      TEST_ASSERT_EQUAL(message.size(), assembler.getSize());
+
+      std::vector<uint8_t> exact(assembler.getData(), assembler.getData() + assembler.getSize());
+      ControlReader reader(exact.data(), exact.size());
+      ControlCommand command;
+      size_t index = 0;
+
+      while (reader.next(command)) {
+         TEST_ASSERT_LESS_THAN(expected.size(), index);
+
+         const Encoded &source = expected[index++];
+         TEST_ASSERT_EQUAL_UINT8(source.opcode, command.opcode);
+         TEST_ASSERT_EQUAL_UINT16(source.sequence, command.sequence);
+         TEST_ASSERT_EQUAL(source.payload.size(), command.length);
+         if (command.length > 0)
+            TEST_ASSERT_EQUAL_MEMORY(source.payload.data(), command.payload, command.length);
+
+         uint8_t pump;
+         uint32_t pulse;
+         uint32_t seconds[CONTROL_MAX_TIMES];
+         size_t count;
+
+         if (command.opcode == CONTROL_START || command.opcode == CONTROL_STOP) {
+            TEST_ASSERT_TRUE(ControlReader::readPump(command, pump));
+            TEST_ASSERT_EQUAL_UINT8(source.payload[0], pump);
+         } else if (command.opcode == CONTROL_SET_PULSE) {
+            TEST_ASSERT_TRUE(ControlReader::readPulse(command, pump, pulse));
+            TEST_ASSERT_EQUAL_MEMORY(source.payload.data() + 1, &pulse, 4);
+         } else if (command.opcode == CONTROL_SET_SCHEDULE) {
+            TEST_ASSERT_TRUE(ControlReader::readSchedule(command, pump, seconds, count));
+            TEST_ASSERT_EQUAL((source.payload.size() - 1) / 3, count);
+            for (size_t time = 0; time < count; time++)
+               TEST_ASSERT_EQUAL_MEMORY(source.payload.data() + 1 + time * 3, &seconds[time], 3);
+         }
+      }
+
+      TEST_ASSERT_FALSE(reader.isTruncated());
+      TEST_ASSERT_EQUAL(expected.size(), index);
+   }
+}
+
+// Bytes aleatórios e mensagens válidas com bytes trocados, removidos ou cortadas no meio
+void test_random_and_corrupted_messages_are_contained() {
+   ControlAssembler assembler;
+   size_t truncated = 0, overflowed = 0, maxCommands = 0;
+
+   for (size_t iteration = 0; iteration < FUZZ_ITERATIONS; iteration++) {
+      std::vector<uint8_t> message;
+
+      if (nextRandom(2)) {
+         for (size_t index = 0, size = nextRandom(CONTROL_MAX_MESSAGE + 64); index < size; index++)
+            message.push_back(nextRandom(256));
+      } else {
+         while (message.size() < CONTROL_MAX_MESSAGE && nextRandom(8))
+            encode(message, randomCommand());
+
+         for (size_t mutation = 0, mutations = nextRandom(4); mutation < mutations && !message.empty(); mutation++) {
+            size_t position = nextRandom(message.size());
+            if (nextRandom(2))
+               message[position] = nextRandom(256);
+            else
+               message.erase(message.begin() + position);
+         }
+
+         if (nextRandom(4) == 0)
+            message.resize(nextRandom(message.size() + 1));
+      }
+
+      assemble(assembler, message);
+
+      if (message.size() > CONTROL_MAX_MESSAGE) {
+         TEST_ASSERT_TRUE(assembler.isOverflowed());
+         TEST_ASSERT_EQUAL(0, assembler.getSize());
+         overflowed++;
+         continue;
+      }
+
+      TEST_ASSERT_FALSE(assembler.isOverflowed());
+      if (!message.empty())
+         TEST_ASSERT_EQUAL_MEMORY(message.data(), assembler.getData(), message.size());
+
+      std::vector<uint8_t> exact(assembler.getData(), assembler.getData() + assembler.getSize());
+      size_t commands, consumed;
+      ControlAckWriter acks = readAll(exact.data(), exact.size(), commands, consumed);
+
+      TEST_ASSERT_LESS_OR_EQUAL(CONTROL_MAX_COMMANDS, commands);
+      TEST_ASSERT_EQUAL((commands + (consumed < exact.size())) * CONTROL_ACK_SIZE, acks.getSize());
+      truncated += consumed < exact.size();
+      if (commands > maxCommands)
+         maxCommands = commands;
+   }
+
+   printf("%u mensagens: %u truncadas, %u excedidas, até %u comandos\n", FUZZ_ITERATIONS, (unsigned)truncated, (unsigned)overflowed,
+          (unsigned)maxCommands);
+   TEST_ASSERT_GREATER_THAN(0, truncated);
+   TEST_ASSERT_GREATER_THAN(0, overflowed);
+}
+
+// Casos de borda já encontrados, mantidos como regressão
+void test_edge_cases() {
+   ControlAssembler assembler;
+   std::vector<uint8_t> message;
+   size_t commands, consumed;
+
+   // 128 comandos sem payload ocupam a mensagem inteira e todos recebem ACK
+   for (size_t index = 0; index < CONTROL_MAX_COMMANDS; index++)
+      encode(message, {CONTROL_STATES, (uint16_t)index, {}});
+   TEST_ASSERT_EQUAL(CONTROL_MAX_MESSAGE, message.size());
+   TEST_ASSERT_EQUAL(CONTROL_MAX_COMMANDS * CONTROL_ACK_SIZE, readAll(message.data(), message.size(), commands, consumed).getSize());
+   TEST_ASSERT_EQUAL(CONTROL_MAX_COMMANDS, commands);
+
+   // 127 comandos e um cabeçalho com payload além do fim: o ACK da truncagem ainda cabe
+   message.resize(message.size() - CONTROL_HEADER_SIZE);
+   encode(message, {CONTROL_START, 0xBEEF, {}});
+   message.back() = 1;
+   TEST_ASSERT_EQUAL(CONTROL_MAX_COMMANDS * CONTROL_ACK_SIZE, readAll(message.data(), message.size(), commands, consumed).getSize());
+   TEST_ASSERT_EQUAL(CONTROL_MAX_COMMANDS - 1, commands);
+
+   // Um byte além do limite descarta a mensagem até o próximo reset
+   assembler.reset();
+   TEST_ASSERT_TRUE(assembler.append(message.data(), CONTROL_MAX_MESSAGE));
+   TEST_ASSERT_FALSE(assembler.append(message.data(), 1));
+   TEST_ASSERT_FALSE(assembler.append(message.data(), 0));
+   TEST_ASSERT_TRUE(assembler.isOverflowed());
+   assembler.reset();
+   TEST_ASSERT_TRUE(assembler.append(message.data(), 0));
+   TEST_ASSERT_FALSE(assembler.isOverflowed());
+
+   // Cabeçalhos incompletos
+   for (size_t size = 1; size < CONTROL_HEADER_SIZE; size++) {
+      std::vector<uint8_t> partial(message.begin(), message.begin() + size);
+      TEST_ASSERT_EQUAL(CONTROL_ACK_SIZE, readAll(partial.data(), partial.size(), commands, consumed).getSize());
+      TEST_ASSERT_EQUAL(0, commands);
+   }
+
+   ControlCommand command;
+   uint8_t pump;
+   uint32_t pulse;
+   uint32_t seconds[CONTROL_MAX_TIMES];
+   size_t count;
+   uint8_t payload[255] = {};
+
+   // Sequência little endian e payloads com tamanho errado
+   command = {CONTROL_SET_PULSE, 0x1234, 5, payload};
+   TEST_ASSERT_FALSE(ControlReader::readPulse(command, pump, pulse));  // Duração 0
+   payload[4] = 0x80;
+   TEST_ASSERT_TRUE(ControlReader::readPulse(command, pump, pulse));
+   TEST_ASSERT_EQUAL_UINT32(0x80000000, pulse);
+   command.length = 4;
+   TEST_ASSERT_FALSE(ControlReader::readPulse(command, pump, pulse));
+   command.length = 0;
+   TEST_ASSERT_FALSE(ControlReader::readPump(command, pump));
+   TEST_ASSERT_FALSE(ControlReader::readSchedule(command, pump, seconds, count));
+
+   // O maior payload de horários traz exatamente CONTROL_MAX_TIMES horários
+   memset(payload, 0, sizeof(payload));
+   command = {CONTROL_SET_SCHEDULE, 1, (uint8_t)(1 + CONTROL_MAX_TIMES * 3), payload};
+   TEST_ASSERT_TRUE(ControlReader::readSchedule(command, pump, seconds, count));
+   TEST_ASSERT_EQUAL(CONTROL_MAX_TIMES, count);
+   command.length = 255;
+   TEST_ASSERT_FALSE(ControlReader::readSchedule(command, pump, seconds, count));
+
+   // 86400 não é um segundo do dia
+   command.length = 4;
+   payload[1] = 86400 & 0xFF;
+   payload[2] = (86400 >> 8) & 0xFF;
+   payload[3] = 86400 >> 16;
+   TEST_ASSERT_FALSE(ControlReader::readSchedule(command, pump, seconds, count));
+   payload[1]--;
+   TEST_ASSERT_TRUE(ControlReader::readSchedule(command, pump, seconds, count));
+   TEST_ASSERT_EQUAL_UINT32(86399, seconds[0]);
+
+   // O ACK repete a sequência e marca o opcode
+   ControlAckWriter acks;
+   TEST_ASSERT_TRUE(acks.add(CONTROL_STOP, 0xA1B2, CONTROL_INVALID_PUMP));
+   const uint8_t expected[] = {CONTROL_STOP | CONTROL_ACK, 0xB2, 0xA1, CONTROL_INVALID_PUMP};
+   TEST_ASSERT_EQUAL_MEMORY(expected, acks.getData(), sizeof(expected));
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_fragmented_messages_round_trip);
+   RUN_TEST(test_random_and_corrupted_messages_are_contained);
+   RUN_TEST(test_edge_cases);
+   return UNITY_END();
+}
@@ -0,0 +1,266 @@
+// Propriedades do compilador de regras ao longo de um ano simulado: o índice do dia consultado a
+// cada segundo (isDue) e a contagem por intervalo (countEventsBetween) são comparados com uma
+// avaliação por força bruta das regras, segundo a segundo. O mesmo avaliador confere a agenda
+// executada em deep sleep, que guarda as regras na RTC e recompila o dia a cada despertar.
+#include <unity.h>
+
+#include <vector>
+
+#include "deepSleepScheduler.h"
+#include "driveSchedule.h"
+#include "esp_sleep.h"
+#include "hostSim.h"
+
+#define LOCAL_EPOCH 1767225600UL  // 01/01/2026 00:00 no horário local
+#define DAYS 365
+#define RANDOM_SCHEDULES 6
+
+#define SYNC_EVERY 12  // Mesmos valores de src/main.cpp
+#define MAX_SLEEP 3600000
+#define PUMP_PIN 25
+#define PULSE 30000  // Em ms
+
+struct Site {
+   float latitude;
+   float longitude;
+   int32_t utcOffset;
+};
+
+// São Paulo, Londres e Tromsø, com noite polar e sol da meia-noite
+static const Site sites[] = {{-23.5, -46.6, -10800}, {51.5, -0.1, 0}, {69.6, 18.9, 3600}};
+
+// Avaliação direta das regras: um segundo é um horário quando alguma regra ativa no dia da semana
+// começa nele ou o alcança em um múltiplo do intervalo até o fim
+class BruteForce {
+  public:
+   BruteForce(const std::vector<ScheduleRule> &rules, const Site &site) : rules(rules), site(site) {}
+
+   bool fires(uint32_t localEpoch) {
+      uint32_t day = localEpoch / 86400;
+      int32_t second = localEpoch % 86400;
+
+      if (day != cachedDay)
+         prepare(day);
+
+      for (const Window &window : windows) {
+         if (second == window.first)
+            return true;
+         if (window.interval > 0 && second > window.first && second <= window.last && (second - window.first) % window.interval == 0)
+            return true;
+      }
+
+      return false;
+   }
+
+   size_t count(uint32_t fromEpoch, uint32_t toEpoch) {
+      size_t total = 0;
+
+      for (uint32_t epoch = fromEpoch; epoch <= toEpoch; epoch++)
+         total += fires(epoch);
+
+      return total;
+   }
+
+  private:
+   struct Window {
+      int32_t first;
+      int32_t last;
+      int32_t interval;
+   };
+
+   std::vector<ScheduleRule> rules;
+   Site site;
+   uint32_t cachedDay = UINT32_MAX;
+   std::vector<Window> windows;
+
+   void prepare(uint32_t day) {
+      uint8_t weekday = 1 << ((day + 4) % 7);
+
+      windows.clear();
+      cachedDay = day;
+
+      for (const ScheduleRule &rule : rules) {
+         if (!(rule.weekdays & weekday))
+            continue;
+
+         int32_t first = rule.start;
+
+         if (rule.anchor != ANCHOR_CLOCK) {
+            int32_t sun = DriveSchedule::getSunEvent(day, site.latitude, site.longitude, site.utcOffset, rule.anchor == ANCHOR_SUNRISE);
+            if (sun < 0)
+               continue;
+            first += sun;
+         }
+
+         if (first < 0 || first >= 86400)
+            continue;
+
+         int32_t last = rule.end < 86400 ? rule.end : 86399;
+         windows.push_back({first, last, (int32_t)rule.interval});
+      }
+   }
+};
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+// Até 6 regras com intervalo de pelo menos 30 min: no máximo 288 horários por dia, sem truncar
+static std::vector<ScheduleRule> randomRules() {
+   std::vector<ScheduleRule> rules(1 + nextRandom(6));
+
+   for (ScheduleRule &rule : rules) {
+      rule.weekdays = 1 + nextRandom(SCHEDULE_EVERY_DAY);
+      rule.anchor = (ScheduleAnchor)(nextRandom(5) < 3 ? ANCHOR_CLOCK : 1 + nextRandom(2));
+      rule.start = rule.anchor == ANCHOR_CLOCK ? (int32_t)nextRandom(86400) : (int32_t)nextRandom(4 * 3600) - 2 * 3600;
+
+      if (nextRandom(2)) {
+         rule.interval = 1800 + nextRandom(4 * 3600);
+         rule.end = nextRandom(86400);
+      }
+   }
+
+   return rules;
+}
+
+static DriveSchedule compileRules(const std::vector<ScheduleRule> &rules, const Site &site) {
+   DriveSchedule schedule;
+
+   schedule.setLocation(site.latitude, site.longitude, site.utcOffset);
+   for (const ScheduleRule &rule : rules)
+      TEST_ASSERT_TRUE(schedule.addRule(rule));
+
+   return schedule;
+}
+
+void setUp() {
+   HostSim::reset();
+   seed = 0x5EED;
+}
+
+void tearDown() {}
+
+// Consultado a cada segundo do ano, o índice dispara exatamente nos segundos da força bruta, sem
+// atraso e sem descartar nenhum horário
+void test_due_times_match_brute_force_over_a_year() {
+   for (size_t index = 0; index < RANDOM_SCHEDULES; index++) {
+      const Site &site = sites[index % 3];
+      std::vector<ScheduleRule> rules = randomRules();
+      DriveSchedule schedule = compileRules(rules, site);
+      BruteForce reference(rules, site);
+      uint32_t fired = 0, missed = 0;
+
+      for (uint32_t epoch = LOCAL_EPOCH; epoch < LOCAL_EPOCH + DAYS * 86400; epoch++) {
+         uint32_t lateness = UINT32_MAX;
+         bool due = schedule.isDue(epoch, &lateness, &missed);
+
+         if (due != reference.fires(epoch)) {
+            char message[64];
+            snprintf(message, sizeof(message), "agenda %u, dia %u, segundo %u", (unsigned)index, (unsigned)(epoch - LOCAL_EPOCH) / 86400,
+                     (unsigned)epoch % 86400);
+            TEST_FAIL_MESSAGE(message);
+         }
+
+         if (due) {
+            TEST_ASSERT_EQUAL_UINT32(0, lateness);
+            fired++;
+         }
+      }
+
+      TEST_ASSERT_FALSE(schedule.isTruncated());
+      TEST_ASSERT_EQUAL_UINT32(0, missed);
+      TEST_ASSERT_GREATER_THAN_UINT32(0, fired);
+   }
+}
+
+// Intervalos aleatórios de até dois dias, atravessando a meia-noite
+void test_event_counts_match_brute_force() {
+   for (size_t index = 0; index < RANDOM_SCHEDULES; index++) {
+      const Site &site = sites[index % 3];
+      std::vector<ScheduleRule> rules = randomRules();
+      DriveSchedule schedule = compileRules(rules, site);
+      BruteForce reference(rules, site);
+
+      for (size_t sample = 0; sample < 50; sample++) {
+         uint32_t from = LOCAL_EPOCH + nextRandom(DAYS * 86400);
+         uint32_t to = from + nextRandom(2 * 86400);
+
+         TEST_ASSERT_EQUAL_UINT32(reference.count(from, to), schedule.countEventsBetween(from, to));
+      }
+   }
+}
+
+// Um ano inteiro em deep sleep, sincronizando a cada SYNC_EVERY despertares como o setup(): com
+// regras de dias da semana, do nascer e do pôr do sol e 31 horários nas segundas, quartas e
+// sextas, cada horário da força bruta aciona a bomba exatamente uma vez, no segundo certo
+void test_deep_sleep_follows_the_rules_for_a_year() {
+   const Site &site = sites[0];
+   std::vector<ScheduleRule> rules(5);
+
+   rules[0].weekdays = 0x2A;  // Segunda, quarta e sexta
+   rules[0].start = 0;
+   rules[0].end = 4 * 3600 + 45 * 60;
+   rules[0].interval = 900;
+   rules[1].start = 10 * 3600;
+   rules[1].end = 13 * 3600;
+   rules[1].interval = 1200;
+   rules[2].anchor = ANCHOR_SUNRISE;
+   rules[2].start = 1800;
+   rules[3].weekdays = SCHEDULE_WEEKENDS;
+   rules[3].anchor = ANCHOR_SUNSET;
+   rules[3].start = -3600;
+   rules[4].weekdays = 0x01;  // Domingo
+   rules[4].start = 22 * 3600 + 30 * 60;
+
+   DriveSchedule schedule = compileRules(rules, site);
+   BruteForce reference(rules, site);
+   std::vector<uint32_t> starts;
+   uint32_t wakes = 0;
+
+   HostSim::onGpio([&starts](uint8_t pin, bool level) {
+      if (pin == PUMP_PIN && level)
+         starts.push_back(LOCAL_EPOCH + HostSim::now() / 1000000);
+   });
+
+   while (HostSim::now() < (int64_t)DAYS * 86400 * 1000000) {
+      DeepSleepScheduler deepSleep(SYNC_EVERY, MAX_SLEEP);
+
+      try {
+         if (deepSleep.resume())
+            deepSleep.sleep();
+
+         deepSleep.synchronize(LOCAL_EPOCH + HostSim::now() / 1000000);
+         deepSleep.store(0, PUMP_PIN, PULSE, schedule);
+         deepSleep.sleep();
+      } catch (const HostDeepSleep &sleep) {
+         TEST_ASSERT_GREATER_THAN_UINT32(0, sleep.duration);
+         HostSim::advance(sleep.duration);
+         HostSim::reboot(ESP_RST_DEEPSLEEP);
+         wakes++;
+      }
+   }
+
+   std::vector<uint32_t> expected;
+   for (uint32_t epoch = LOCAL_EPOCH; epoch < LOCAL_EPOCH + DAYS * 86400; epoch++)
+      if (reference.fires(epoch))
+         expected.push_back(epoch);
+
+   // Nenhum horário acontece nos últimos segundos do ano, então o último pulso já terminou
+   TEST_ASSERT_FALSE(HostSim::getGpio(PUMP_PIN));
+   TEST_ASSERT_EQUAL_UINT32(expected.size(), starts.size());
+   for (size_t index = 0; index < expected.size(); index++)
+      TEST_ASSERT_EQUAL_UINT32(expected[index], starts[index]);
+
+   printf("deep sleep: %u horários em %u dias, %u despertares\n", (unsigned)starts.size(), DAYS, (unsigned)wakes);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_due_times_match_brute_force_over_a_year);
+   RUN_TEST(test_event_counts_match_brute_force);
+   RUN_TEST(test_deep_sleep_follows_the_rules_for_a_year);
+   return UNITY_END();
+}
@@ -0,0 +1,236 @@
+// Fragmentação do heap em 30 dias de operação sem PSRAM: os documentos de src/main.cpp (estado das
+// saídas a cada segundo, /metrics, placas vizinhas e configurações) montados sobre o heap
+// simulado junto com o tráfego do WiFi e do TLS. O relatório mostra, por dia, o menor bloco livre
+// com o JsonPool e com os documentos direto no heap, como era antes do pool.
+#include <unity.h>
+
+#include <vector>
+
+#include "esp_heap_caps.h"
+#include "hostSim.h"
+#include "jsonPool.h"
+#include "memoryPlacement.h"
+
+#define HEAP_SIZE 120000
+#define DAYS 30
+#define DAY 86400  // Em s
+
+#define OUTPUT_STATES_SIZE 512  // Mesmos tamanhos de src/main.cpp
+#define BOARDS_SIZE 2048
+#define METRICS_SIZE 5600
+#define CONFIG_SIZE JSON_POOL_LARGE_SIZE
+#define ACTIVE_PUMPS 2
+#define MIN_BLOCK 12000  // Menor bloco exigido pelo RequestGovernor para as requisições normais
+
+// Documentos direto no heap, como o DynamicJsonDocument fazia antes do pool
+struct HeapAllocator {
+   void *allocate(size_t size) { return heap_caps_malloc(size, MALLOC_CAP_8BIT); }
+   void deallocate(void *pointer) { heap_caps_free(pointer); }
+   void *reallocate(void *pointer, size_t size) { return heap_caps_realloc(pointer, size, MALLOC_CAP_8BIT); }
+};
+
+typedef BasicJsonDocument<HeapAllocator> HeapJsonDocument;
+
+// Alocação de outro módulo, liberada no segundo indicado
+struct Held {
+   void *pointer;
+   uint32_t until;
+};
+
+struct DailyReport {
+   size_t minLargest[DAYS];
+   size_t minFree[DAYS];
+   uint32_t failures = 0;
+};
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+static void hold(std::vector<Held> &held, size_t size, uint32_t until, DailyReport &report) {
+   void *pointer = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+
+   if (pointer != NULL)
+      held.push_back({pointer, until});
+   else
+      report.failures++;
+}
+
+// Documento montado, serializado em uma resposta que o AsyncTCP mantém por alguns segundos
+template <typename Document>
+static void buildDocument(size_t capacity, size_t responseSize, uint32_t now, std::vector<Held> &held, DailyReport &report) {
+   Document document(capacity);
+
+   if (document.capacity() == 0) {
+      report.failures++;
+      return;
+   }
+
+   document["uptime"] = now;
+   if (responseSize > 0)
+      hold(held, responseSize, now + 1 + nextRandom(3), report);
+}
+
+template <typename Document>
+static DailyReport simulate() {
+   std::vector<Held> held;
+   DailyReport report;
+
+   seed = 0xF4A6;
+
+   for (uint32_t now = 0; now < DAYS * DAY; now++) {
+      // Pacotes do lwIP e do WiFi, liberados em poucos segundos
+      for (uint32_t packet = nextRandom(4); packet > 0; packet--)
+         hold(held, 64 + nextRandom(1600), now + nextRandom(4), report);
+
+      buildDocument<Document>(OUTPUT_STATES_SIZE, 120, now, held, report);
+
+      if (now % 10 == 0)
+         buildDocument<Document>(METRICS_SIZE, 2600 + nextRandom(400), now, held, report);
+      if (now % 30 == 0)
+         buildDocument<Document>(BOARDS_SIZE, 200 + nextRandom(600), now, held, report);
+
+      // Configuração das bombas: o documento e a sessão TLS existem juntos
+      if (now % 300 == 0) {
+         for (uint8_t pump = 0; pump < ACTIVE_PUMPS; pump++) {
+            hold(held, 16384, now + 2 + nextRandom(4), report);
+            hold(held, 4096, now + 2 + nextRandom(4), report);
+            buildDocument<Document>(CONFIG_SIZE, 0, now, held, report);
+         }
+      }
+
+      // Entradas de longa duração (ARP, mDNS, timers), criadas entre as alocações temporárias
+      if (nextRandom(1800) == 0)
+         hold(held, 32 + nextRandom(256), now + 3600 * (6 + nextRandom(30)), report);
+
+      for (size_t index = 0; index < held.size();) {
+         if (held[index].until <= now) {
+            heap_caps_free(held[index].pointer);
+            held[index] = held.back();
+            held.pop_back();
+         } else {
+            index++;
+         }
+      }
+
+      HostRegionStats region = HostSim::getRegion(false);
+      uint32_t day = now / DAY;
+
+      if (now % DAY == 0) {
+         report.minLargest[day] = region.largestBlock;
+         report.minFree[day] = region.free;
+      }
+      report.minLargest[day] = min(report.minLargest[day], region.largestBlock);
+      report.minFree[day] = min(report.minFree[day], region.free);
+   }
+
+   for (Held &entry : held)
+      heap_caps_free(entry.pointer);
+
+   return report;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_thirty_days_keep_the_largest_block() {
+   HostRegionStats initial = HostSim::getRegion(false);
+   JsonPoolStats before = JsonPool::getStats();
+
+   DailyReport pooled = simulate<PooledJsonDocument>();
+   JsonPoolStats stats = JsonPool::getStats();
+   TEST_ASSERT_EQUAL(initial.largestBlock, HostSim::getRegion(false).largestBlock);
+
+   DailyReport heap = simulate<HeapJsonDocument>();
+   TEST_ASSERT_EQUAL(initial.largestBlock, HostSim::getRegion(false).largestBlock);
+
+   printf("%4s %16s %16s\n", "dia", "pool (maior/livre)", "heap (maior/livre)");
+   for (uint32_t day = 0; day < DAYS; day++)
+      printf("%4u %8u %7u %8u %7u\n", day + 1, (unsigned)pooled.minLargest[day], (unsigned)pooled.minFree[day], (unsigned)heap.minLargest[day],
+             (unsigned)heap.minFree[day]);
+   printf("falhas: pool %u, heap %u; maior uso do pool: %u grandes, %u pequenos\n", pooled.failures, heap.failures, stats.maxLargeInUse,
+          stats.maxSmallInUse);
+
+   // Todos os documentos couberam no pool
+   TEST_ASSERT_EQUAL_UINT32(0, stats.fallbacks - before.fallbacks);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.failures - before.failures);
+   TEST_ASSERT_EQUAL_UINT32(0, pooled.failures);
+
+   size_t pooledWorst = SIZE_MAX, heapWorst = SIZE_MAX, firstWeek = SIZE_MAX, lastWeek = SIZE_MAX;
+   for (uint32_t day = 0; day < DAYS; day++) {
+      pooledWorst = min(pooledWorst, pooled.minLargest[day]);
+      heapWorst = min(heapWorst, heap.minLargest[day]);
+
+      // O primeiro dia fica de fora: as entradas de longa duração ainda estão se acumulando
+      if (day >= 1 && day < 8)
+         firstWeek = min(firstWeek, pooled.minLargest[day]);
+      if (day >= DAYS - 7)
+         lastWeek = min(lastWeek, pooled.minLargest[day]);
+
+      // Com o pool, o /metrics continua admitido pelo RequestGovernor em todos os dias
+      TEST_ASSERT_GREATER_OR_EQUAL(MIN_BLOCK, pooled.minLargest[day]);
+   }
+
+   // A última semana não fica pior que a primeira, e o pool nunca perde para o heap
+   TEST_ASSERT_GREATER_OR_EQUAL(firstWeek * 9 / 10, lastWeek);
+   TEST_ASSERT_GREATER_OR_EQUAL(heapWorst, pooledWorst);
+}
+
+// Documentos maiores que o bloco ou com o pool cheio vão para o heap pela MemoryPlacement, e o
+// shrinkToFit e o destrutor os devolvem pelo mesmo caminho
+void test_fallback_documents_use_memory_placement() {
+   HostRegionStats initial = HostSim::getRegion(false);
+   JsonPoolStats before = JsonPool::getStats();
+   PlacementStats placement = MemoryPlacement::getStats();
+
+   {
+      PooledJsonDocument oversized(JSON_POOL_LARGE_SIZE * 2);
+      TEST_ASSERT_EQUAL(JSON_POOL_LARGE_SIZE * 2, oversized.capacity());
+      TEST_ASSERT_LESS_THAN(initial.free, HostSim::getRegion(false).free);
+
+      oversized["value"] = 1;
+      oversized.shrinkToFit();
+      TEST_ASSERT_EQUAL(oversized.memoryUsage(), oversized.capacity());
+      TEST_ASSERT_EQUAL(1, oversized["value"].as<int>());
+   }
+   TEST_ASSERT_EQUAL(initial.free, HostSim::getRegion(false).free);
+
+   {
+      PooledJsonDocument first(CONFIG_SIZE), second(CONFIG_SIZE), third(CONFIG_SIZE);
+      TEST_ASSERT_EQUAL(CONFIG_SIZE, third.capacity());
+
+      // Dentro do bloco o shrinkToFit mantém o ponteiro
+      first["value"] = 1;
+      first.shrinkToFit();
+      TEST_ASSERT_EQUAL(1, first["value"].as<int>());
+
+      third["value"] = 3;
+      third.shrinkToFit();
+      TEST_ASSERT_EQUAL(3, third["value"].as<int>());
+   }
+   TEST_ASSERT_EQUAL(initial.free, HostSim::getRegion(false).free);
+
+   JsonPoolStats stats = JsonPool::getStats();
+   TEST_ASSERT_EQUAL_UINT32(2, stats.fallbacks - before.fallbacks);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.failures - before.failures);
+   TEST_ASSERT_EQUAL(0, stats.largeInUse);
+
+   // Duas alocações e dois shrinkToFit fora do pool
+   TEST_ASSERT_EQUAL_UINT32(4, MemoryPlacement::getStats().allocations - placement.allocations);
+}
+
+int main(int argc, char **argv) {
+   // O pool é reservado uma vez, como no setup(), e vale para todos os testes
+   HostSim::reset();
+   HostSim::configureHeap(HEAP_SIZE, 0);
+   JsonPool::begin();
+
+   UNITY_BEGIN();
+   RUN_TEST(test_thirty_days_keep_the_largest_block);
+   RUN_TEST(test_fallback_documents_use_memory_placement);
+   return UNITY_END();
+}
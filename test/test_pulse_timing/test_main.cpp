@@ -0,0 +1,141 @@
+// Duração real dos pulsos, do nível alto ao nível baixo da saída, comparada com a solicitada. A
+// esp_timer task atrasa cada callback como na placa: dezenas de us na maior parte das vezes e
+// algumas centenas quando a task do WiFi, de prioridade maior, está rodando. O erro fica abaixo
+// de 1 ms e a própria medição do controlador (PulseStats) bate com a saída.
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "hostSim.h"
+#include "hydraulicPumpController.h"
+
+#define PUMP_PIN 16
+#define TOLERANCE 1000  // Em us
+#define PULSES 400
+#define MS 1000LL
+
+struct Output {
+   int64_t risingAt = -1;
+   std::vector<int64_t> pulses;  // Em us
+
+   void attach() {
+      HostSim::onGpio([this](uint8_t pin, bool level) {
+         if (pin != PUMP_PIN)
+            return;
+
+         if (level) {
+            risingAt = HostSim::now();
+         } else if (risingAt >= 0) {
+            pulses.push_back(HostSim::now() - risingAt);
+            risingAt = -1;
+         }
+      });
+   }
+};
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+// 2% dos disparos esperam a task do WiFi
+static int64_t timerTaskLatency() {
+   return nextRandom(50) == 0 ? 300 + nextRandom(400) : 20 + nextRandom(100);
+}
+
+void setUp() {
+   HostSim::reset();
+   HostSim::setEspTimerLatency(timerTaskLatency);
+   seed = 0x9E15E;
+}
+
+void tearDown() {}
+
+void test_measured_pulse_matches_the_requested_duration() {
+   HydraulicPumpController pump("P0", PUMP_PIN, 1000);
+   Output output;
+   int64_t worst = 0;
+
+   output.attach();
+
+   for (size_t pulse = 0; pulse < PULSES; pulse++) {
+      // De 5 ms a 10 min
+      uint32_t duration = pulse % 4 == 0 ? 5 + nextRandom(100) : 1000 + nextRandom(600000);
+
+      pump.setPulseDuration(duration);
+      TEST_ASSERT_TRUE(pump.startPump());
+      HostSim::advance((int64_t)duration * MS + 5 * MS);
+      TEST_ASSERT_FALSE(pump.getPumpState());
+      TEST_ASSERT_EQUAL(pulse + 1, output.pulses.size());
+
+      int64_t error = output.pulses.back() - (int64_t)duration * MS;
+      TEST_ASSERT_TRUE(error >= 0);
+      worst = std::max(worst, error);
+
+      PulseStats stats = pump.getPulseStats();
+      TEST_ASSERT_EQUAL_UINT32(duration * MS, stats.lastRequested);
+      TEST_ASSERT_EQUAL_UINT32(output.pulses.back(), stats.lastMeasured);
+      TEST_ASSERT_EQUAL_INT32(error, stats.lastError);
+
+      HostSim::advance(nextRandom(2000) * MS);
+   }
+
+   PulseStats stats = pump.getPulseStats();
+   printf("%u pulsos: maior erro %lld us, medido pelo controlador %u us\n", stats.pulses, (long long)worst, stats.maxError);
+
+   TEST_ASSERT_EQUAL_UINT32(PULSES, stats.pulses);
+   TEST_ASSERT_EQUAL_UINT32(worst, stats.maxError);
+   TEST_ASSERT_LESS_THAN(TOLERANCE, worst);
+}
+
+// Uma nova duração durante o pulso vale para o pulso inteiro, medido desde o acionamento
+void test_duration_change_during_a_pulse() {
+   HydraulicPumpController pump("P0", PUMP_PIN, 20000);
+   Output output;
+
+   output.attach();
+
+   // Alongado no meio do pulso
+   TEST_ASSERT_TRUE(pump.startPump());
+   HostSim::advance(8000 * MS);
+   pump.setPulseDuration(30000);
+   HostSim::advance(30000 * MS);
+   TEST_ASSERT_EQUAL(1, output.pulses.size());
+   TEST_ASSERT_INT64_WITHIN(TOLERANCE, 30000 * MS, output.pulses[0]);
+
+   // Encurtado para antes do instante atual: termina na hora
+   TEST_ASSERT_TRUE(pump.startPump());
+   HostSim::advance(12000 * MS);
+   pump.setPulseDuration(10000);
+   TEST_ASSERT_FALSE(pump.getPumpState());
+   TEST_ASSERT_EQUAL_INT64(12000 * MS, output.pulses[1]);
+
+   // O pulso de setNextPulseDuration mantém a própria duração
+   pump.setNextPulseDuration(4000);
+   TEST_ASSERT_TRUE(pump.startPump());
+   pump.setPulseDuration(60000);
+   HostSim::advance(10000 * MS);
+   TEST_ASSERT_EQUAL(3, output.pulses.size());
+   TEST_ASSERT_INT64_WITHIN(TOLERANCE, 4000 * MS, output.pulses[2]);
+
+   // Parada manual: a duração medida é a real, e o timer não desliga a próxima
+   TEST_ASSERT_TRUE(pump.startPump());
+   HostSim::advance(1500 * MS);
+   pump.stopPump();
+   TEST_ASSERT_EQUAL_INT64(1500 * MS, output.pulses[3]);
+   TEST_ASSERT_TRUE(pump.startPump());
+   HostSim::advance(59000 * MS);
+   TEST_ASSERT_TRUE(pump.getPumpState());
+   HostSim::advance(2000 * MS);
+   TEST_ASSERT_INT64_WITHIN(TOLERANCE, 60000 * MS, output.pulses[4]);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_measured_pulse_matches_the_requested_duration);
+   RUN_TEST(test_duration_change_during_a_pulse);
+   return UNITY_END();
+}
@@ -0,0 +1,145 @@
+// Documento de configuração da bomba (MongoDB Atlas e cache local do site) aplicado ao
+// HydraulicPumpController: campos ausentes ou inválidos mantêm o que a bomba já usa, inclusive
+// durante um pulso em andamento, e as regras escritas pela API local são lidas de volta iguais.
+#include <unity.h>
+
+#include "hostSim.h"
+#include "hydraulicPumpController.h"
+#include "pumpConfiguration.h"
+
+#define PUMP_PIN 16
+#define TIME_OFFSET (-3 * 3600)
+#define LATITUDE -23.55
+#define LONGITUDE -46.63
+#define LOCAL_EPOCH 1767139200UL  // 31/12/2025 00:00 no horário local
+#define MS 1000LL
+
+static size_t applyDocument(HydraulicPumpController &pump, const char *json) {
+   StaticJsonDocument<1024> document;
+   TEST_ASSERT_FALSE(deserializeJson(document, json));
+
+   PumpConfiguration configuration(LATITUDE, LONGITUDE, TIME_OFFSET);
+   configuration.read(document.as<JsonVariantConst>(), LOCAL_EPOCH);
+   configuration.apply(pump);
+
+   return configuration.getRuleCount();
+}
+
+void setUp() {
+   HostSim::reset();
+}
+
+void tearDown() {}
+
+// Sem pulseDuration a agenda é trocada e o pulso continua o mesmo
+void test_missing_pulse_duration_keeps_the_current_one() {
+   HydraulicPumpController pump("P0", PUMP_PIN, 30000);
+
+   TEST_ASSERT_EQUAL(2, applyDocument(pump, "{\"driveTimes\":[{\"time\":\"06:00:00\",\"state\":true},{\"time\":\"18:00:00\",\"state\":true}]}"));
+   TEST_ASSERT_EQUAL_UINT32(30000, pump.getPulseDuration());
+   TEST_ASSERT_EQUAL(2, pump.getSchedule().getEvents().size());
+
+   TEST_ASSERT_EQUAL(1, applyDocument(pump, "{\"pulseDuration\":45000,\"rules\":[{\"at\":\"07:00\"}]}"));
+   TEST_ASSERT_EQUAL_UINT32(45000, pump.getPulseDuration());
+   TEST_ASSERT_EQUAL(1, pump.getSchedule().getEvents().size());
+
+   // Valores que não são uma duração
+   const char *invalid[] = {
+       "{\"pulseDuration\":0}",
+       "{\"pulseDuration\":-5000}",
+       "{\"pulseDuration\":\"60000\"}",
+       "{\"pulseDuration\":null}",
+   };
+
+   for (const char *json : invalid) {
+      applyDocument(pump, json);
+      TEST_ASSERT_EQUAL_UINT32(45000, pump.getPulseDuration());
+   }
+}
+
+// Um documento sem pulseDuration chegando durante o pulso não o encerra nem o reprograma
+void test_missing_pulse_duration_during_a_pulse() {
+   HydraulicPumpController pump("P0", PUMP_PIN, 20000);
+
+   TEST_ASSERT_TRUE(pump.startPump());
+   HostSim::advance(5000 * MS);
+
+   applyDocument(pump, "{\"rules\":[{\"days\":\"daily\",\"from\":\"06:00\",\"to\":\"18:00\",\"every\":3600}]}");
+   TEST_ASSERT_TRUE(pump.getPumpState());
+   TEST_ASSERT_UINT32_WITHIN(1, 15000, pump.getPulseRemaining());
+
+   HostSim::advance(15000 * MS);
+   TEST_ASSERT_FALSE(pump.getPumpState());
+   TEST_ASSERT_EQUAL_UINT32(20000 * MS, pump.getPulseStats().lastMeasured);
+}
+
+// Regras escritas por writeRule (agenda enviada de volta à nuvem) são lidas iguais por read()
+void test_written_rules_read_back() {
+   HydraulicPumpController pump("P0", PUMP_PIN, 30000);
+   const char *json = "{\"pulseDuration\":60000,\"rules\":[{\"days\":\"weekdays\",\"from\":\"06:30\",\"to\":\"17:30\",\"every\":3600},"
+                      "{\"days\":[\"sat\",\"sun\"],\"at\":\"08:00\"},{\"anchor\":\"sunrise\",\"offset\":1800},"
+                      "{\"at\":\"12:00\",\"state\":false},{\"at\":\"25:00\"}]}";
+
+   StaticJsonDocument<1024> document;
+   TEST_ASSERT_FALSE(deserializeJson(document, json));
+
+   PumpConfiguration configuration(LATITUDE, LONGITUDE, TIME_OFFSET);
+   configuration.read(document.as<JsonVariantConst>(), LOCAL_EPOCH);
+   TEST_ASSERT_EQUAL(3, configuration.getRuleCount());
+   TEST_ASSERT_EQUAL(1, configuration.getIgnoredRules());
+   configuration.apply(pump);
+
+   DriveSchedule schedule = pump.getSchedule();
+   StaticJsonDocument<1024> written;
+   JsonArray rules = written.createNestedArray("rules");
+   for (const ScheduleRule &rule : schedule.getRules())
+      PumpConfiguration::writeRule(rule, rules.createNestedObject());
+
+   PumpConfiguration reread(LATITUDE, LONGITUDE, TIME_OFFSET);
+   reread.read(written.as<JsonVariantConst>(), LOCAL_EPOCH);
+   TEST_ASSERT_EQUAL(3, reread.getRuleCount());
+   TEST_ASSERT_EQUAL(0, reread.getIgnoredRules());
+   TEST_ASSERT_EQUAL_UINT32(0, reread.getPulseDuration());
+
+   HydraulicPumpController copy("P1", PUMP_PIN + 1, 30000);
+   reread.apply(copy);
+
+   std::vector<ScheduleRule> expected = schedule.getRules(), actual = copy.getSchedule().getRules();
+   TEST_ASSERT_EQUAL(expected.size(), actual.size());
+   for (size_t index = 0; index < expected.size(); index++) {
+      TEST_ASSERT_EQUAL_UINT8(expected[index].weekdays, actual[index].weekdays);
+      TEST_ASSERT_EQUAL(expected[index].anchor, actual[index].anchor);
+      TEST_ASSERT_EQUAL_INT32(expected[index].start, actual[index].start);
+      TEST_ASSERT_EQUAL_INT32(expected[index].end, actual[index].end);
+      TEST_ASSERT_EQUAL_UINT32(expected[index].interval, actual[index].interval);
+   }
+   TEST_ASSERT_EQUAL(schedule.getEvents().size(), copy.getSchedule().getEvents().size());
+   TEST_ASSERT_EQUAL_UINT32(30000, copy.getPulseDuration());
+}
+
+// O filtro de setFields mantém todos os campos lidos por read()
+void test_fields_filter_keeps_the_configuration() {
+   const char *json = "{\"document\":{\"pumperCode\":\"P0\",\"history\":[1,2,3,4,5,6,7,8],\"pulseDuration\":90000,"
+                      "\"latitude\":-10.5,\"longitude\":-40.25,\"rules\":[{\"anchor\":\"sunset\",\"offset\":-600}]}}";
+
+   StaticJsonDocument<256> filter;
+   PumpConfiguration::setFields(filter.createNestedObject("document"));
+
+   StaticJsonDocument<512> document;
+   TEST_ASSERT_FALSE(deserializeJson(document, json, DeserializationOption::Filter(filter)));
+   TEST_ASSERT_TRUE(document["document"]["history"].isNull());
+
+   PumpConfiguration configuration(LATITUDE, LONGITUDE, TIME_OFFSET);
+   configuration.read(document["document"], LOCAL_EPOCH);
+   TEST_ASSERT_EQUAL(1, configuration.getRuleCount());
+   TEST_ASSERT_EQUAL_UINT32(90000, configuration.getPulseDuration());
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_missing_pulse_duration_keeps_the_current_one);
+   RUN_TEST(test_missing_pulse_duration_during_a_pulse);
+   RUN_TEST(test_written_rules_read_back);
+   RUN_TEST(test_fields_filter_keeps_the_configuration);
+   return UNITY_END();
+}
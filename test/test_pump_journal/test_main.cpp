@@ -0,0 +1,244 @@
+// Reset da placa em instantes arbitrários de um pulso: o diário na memória RTC retoma apenas o que
+// faltava, e a configuração reaplicada no boot não pode estender o pulso retomado
+#include <unity.h>
+
+#include "esp_system.h"
+#include "hostSim.h"
+#include "hydraulicPumpController.h"
+#include "pumpJournal.h"
+
+// Mesmos valores de src/main.cpp
+#define PUMP_RESUME_MIN 2000
+
+#define PUMP_PIN 25
+#define PULSE 60000           // Em ms
+#define BOOT_DELAY 400        // Em ms, do reset até resumePulses()
+#define CONFIG_DELAY 3000     // Em ms, de resumePulses() até updateConfiguration() (WiFi + HTTP)
+#define LOCAL_EPOCH 1767258000UL
+#define MS 1000LL
+
+// Tempo em que a saída da bomba ficou acionada, somando os trechos antes e depois de cada reset
+class PinMeter {
+  public:
+   int64_t onTime = 0;  // Em us
+   uint32_t risingEdges = 0;
+
+   void attach() {
+      HostSim::onGpio([this](uint8_t pin, bool level) {
+         if (pin == PUMP_PIN)
+            level ? rise() : fall();
+      });
+   }
+
+   // O reset derruba a saída sem passar pelo driver
+   void powerCut() { fall(); }
+
+  private:
+   int64_t highSince = -1;
+
+   void rise() {
+      if (highSince < 0) {
+         highSince = HostSim::now();
+         risingEdges++;
+      }
+   }
+
+   void fall() {
+      if (highSince >= 0)
+         onTime += HostSim::now() - highSince;
+      highSince = -1;
+   }
+};
+
+// Sequência de boot de src/main.cpp reduzida ao que toca a bomba: initPumps, resumePulses (com o
+// onStart do sequenciador registrando o pulso) e, depois da rede, updateConfiguration
+struct Board {
+   HydraulicPumpController pump;
+   PumpJournal journal;
+
+   Board() : pump("P1", PUMP_PIN, PULSE), journal(1, PUMP_RESUME_MIN) {
+      esp_reset_reason_t reason = esp_reset_reason();
+      journal.begin(reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && reason != ESP_RST_DEEPSLEEP);
+   }
+
+   uint32_t resume() {
+      uint32_t remaining = journal.takeResumePulse(0);
+
+      if (remaining > 0) {
+         pump.setNextPulseDuration(remaining);
+         start();
+      }
+
+      return remaining;
+   }
+
+   void start() {
+      if (pump.startPump())
+         journal.recordStart(0, pump.getPulseRemaining(), LOCAL_EPOCH);
+   }
+};
+
+static PinMeter meter;
+
+static Board *reboot(Board *board, esp_reset_reason_t reason) {
+   meter.powerCut();
+   delete board;
+
+   HostSim::reboot(reason);
+   meter.attach();
+   HostSim::advance(BOOT_DELAY * MS);
+
+   return new Board();
+}
+
+static void runUntilStopped(Board *board) {
+   while (board->pump.getPumpState() && HostSim::getNextTimer() != INT64_MAX)
+      HostSim::advanceTo(HostSim::getNextTimer());
+}
+
+void setUp() {
+   HostSim::reset();
+   meter = PinMeter();
+   meter.attach();
+}
+
+void tearDown() {}
+
+// Reset a cada 250 ms ao longo do pulso e depois dele: o tempo total acionado nunca passa do pulso
+// e só perde o tempo do boot, ou o restante abaixo de PUMP_RESUME_MIN que não é retomado
+void test_reset_at_any_point_never_overruns_the_pulse() {
+   for (int64_t offset = 0; offset <= PULSE + 2000; offset += 250) {
+      HostSim::reset();
+      meter = PinMeter();
+      meter.attach();
+
+      Board *board = new Board();
+      board->start();
+      HostSim::advance(offset * MS);
+
+      board = reboot(board, ESP_RST_PANIC);
+      uint32_t resumed = board->resume();
+
+      // updateConfiguration reaplica a mesma duração vinda da nuvem
+      HostSim::advance(CONFIG_DELAY * MS);
+      board->pump.setPulseDuration(PULSE);
+      runUntilStopped(board);
+
+      int64_t before = std::min(offset, (int64_t)PULSE);
+      int64_t left = PULSE - offset - BOOT_DELAY;
+      int64_t expected = left >= PUMP_RESUME_MIN ? PULSE - BOOT_DELAY : before;
+
+      TEST_ASSERT_EQUAL_UINT32(left >= PUMP_RESUME_MIN ? 1 : 0, resumed > 0);
+      TEST_ASSERT_INT64_WITHIN(2 * MS, expected * MS, meter.onTime);
+      TEST_ASSERT_LESS_OR_EQUAL_INT64(PULSE * MS, meter.onTime);
+
+      delete board;
+   }
+}
+
+// Uma nova duração recebida depois do boot vale para os próximos pulsos, não para o retomado
+void test_config_change_does_not_rearm_a_resumed_pulse() {
+   Board *board = new Board();
+   board->start();
+   HostSim::advance(20000 * MS);
+
+   board = reboot(board, ESP_RST_TASK_WDT);
+   TEST_ASSERT_INT64_WITHIN(1, PULSE - 20000 - BOOT_DELAY, board->resume());
+
+   HostSim::advance(CONFIG_DELAY * MS);
+   board->pump.setPulseDuration(90000);
+   runUntilStopped(board);
+
+   TEST_ASSERT_INT64_WITHIN(2 * MS, (PULSE - BOOT_DELAY) * MS, meter.onTime);
+   TEST_ASSERT_EQUAL_UINT32(90000, board->pump.getPulseDuration());
+
+   // O acionamento seguinte usa a nova duração
+   meter = PinMeter();
+   meter.attach();
+   board->start();
+   runUntilStopped(board);
+   TEST_ASSERT_EQUAL_INT64(90000 * MS, meter.onTime);
+
+   delete board;
+}
+
+// Em um pulso normal a nova duração vale imediatamente, e reaplicar a mesma não reprograma o timer
+void test_config_change_rearms_a_scheduled_pulse() {
+   Board *board = new Board();
+   board->start();
+   HostSim::advance(10000 * MS);
+
+   board->pump.setPulseDuration(PULSE);
+   TEST_ASSERT_EQUAL_INT64(HostSim::now() + (PULSE - 10000) * MS, HostSim::getNextTimer());
+
+   board->pump.setPulseDuration(30000);
+   runUntilStopped(board);
+   TEST_ASSERT_EQUAL_INT64(30000 * MS, meter.onTime);
+
+   delete board;
+}
+
+// O pulso encurtado ou estendido pelos sensores (requestDrive) mantém a duração ajustada quando a
+// configuração é reaplicada durante o acionamento
+void test_sensor_adjusted_pulse_keeps_its_duration() {
+   Board *board = new Board();
+
+   board->pump.setNextPulseDuration(PULSE * 150 / 100);
+   board->start();
+   HostSim::advance(5000 * MS);
+
+   board->pump.setPulseDuration(PULSE);
+   board->pump.setPulseDuration(45000);
+   runUntilStopped(board);
+   TEST_ASSERT_EQUAL_INT64(PULSE * 150 / 100 * MS, meter.onTime);
+
+   delete board;
+}
+
+// Resets em sequência durante o pulso retomado: cada boot retoma o que falta do pulso original
+void test_repeated_resets_resume_the_original_pulse() {
+   Board *board = new Board();
+   board->start();
+
+   const int64_t offsets[] = {7000, 13000, 1000, 21000};
+   for (int64_t offset : offsets) {
+      HostSim::advance(offset * MS);
+      board = reboot(board, ESP_RST_INT_WDT);
+      board->resume();
+   }
+
+   HostSim::advance(CONFIG_DELAY * MS);
+   board->pump.setPulseDuration(PULSE);
+   runUntilStopped(board);
+
+   TEST_ASSERT_INT64_WITHIN(10 * MS, (PULSE - 4 * BOOT_DELAY) * MS, meter.onTime);
+   TEST_ASSERT_EQUAL_UINT32(5, meter.risingEdges);
+   TEST_ASSERT_EQUAL_UINT32(1, board->journal.getStats().resumed);
+
+   delete board;
+}
+
+// Depois de uma queda de energia a memória RTC não é confiável e nada é retomado
+void test_power_on_discards_the_journal() {
+   Board *board = new Board();
+   board->start();
+   HostSim::advance(5000 * MS);
+
+   board = reboot(board, ESP_RST_POWERON);
+   TEST_ASSERT_EQUAL_UINT32(0, board->resume());
+   TEST_ASSERT_FALSE(board->journal.getStats().recovered);
+   TEST_ASSERT_EQUAL_INT64(5000 * MS, meter.onTime);
+
+   delete board;
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_reset_at_any_point_never_overruns_the_pulse);
+   RUN_TEST(test_config_change_does_not_rearm_a_resumed_pulse);
+   RUN_TEST(test_config_change_rearms_a_scheduled_pulse);
+   RUN_TEST(test_sensor_adjusted_pulse_keeps_its_duration);
+   RUN_TEST(test_repeated_resets_resume_the_original_pulse);
+   RUN_TEST(test_power_on_discards_the_journal);
+   return UNITY_END();
+}
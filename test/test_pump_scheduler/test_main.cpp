@@ -0,0 +1,174 @@
+// Benchmark da task de acionamento: um dia de agenda com N regras distribuídas entre as bombas,
+// atendido pela varredura anterior (uma task por bomba verificando a agenda a cada
+// TURN_ON_PUMP_DELAY) e pelo PumpScheduler (uma task dormindo até o prazo mais próximo do
+// min-heap). Compara os despertares e a memória das duas, que devem disparar os mesmos horários.
+#include <unity.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "hostSim.h"
+#include "hydraulicPumpController.h"
+#include "pumpScheduler.h"
+
+// Mesmos valores de src/main.cpp
+#define TURN_ON_PUMP_DELAY 100
+#define LOW_POWER_MAX_SLEEP 60000
+#define PUMP_TASK_STACK (configMINIMAL_STACK_SIZE + 1024)        // taskTurnOnPump, uma por bomba
+#define CONTROLLER_TASK_STACK (configMINIMAL_STACK_SIZE + 2048)  // taskPumpController
+
+#define PUMPS 4
+#define DAY_EPOCH 1767139200UL  // 31/12/2025 00:00 no horário local
+#define DAY 86400
+#define MS 1000LL
+#define SECOND 1000000LL
+
+typedef std::pair<size_t, uint32_t> Drive;  // Bomba e epoch local do disparo
+
+struct Report {
+   uint32_t wakeups = 0;
+   uint32_t allocations = 0;  // Durante o dia, depois da criação
+   size_t peak = 0;           // Em bytes, pico transitório do heap durante o dia
+   size_t memory = 0;         // Em bytes, estruturas da abordagem e pilhas das tasks
+   std::vector<Drive> drives;
+};
+
+static const uint8_t pins[PUMPS] = {12, 13, 14, 15};
+
+static uint32_t localEpoch() {
+   return DAY_EPOCH + HostSim::now() / SECOND;
+}
+
+// Regras de um único horário espalhadas pelo dia, cada bomba com rules / PUMPS delas
+static void configure(HydraulicPumpController *pumps, size_t rules) {
+   for (size_t pump = 0; pump < PUMPS; pump++) {
+      DriveSchedule schedule;
+      size_t perPump = rules / PUMPS;
+
+      for (size_t index = 0; index < perPump; index++) {
+         ScheduleRule rule;
+         rule.start = index * DAY / perPump + pump * 337 + 60;
+         TEST_ASSERT_TRUE(schedule.addRule(rule));
+      }
+
+      schedule.compile(localEpoch());
+      pumps[pump].setSchedule(schedule);
+   }
+}
+
+// Antes: cada task de bomba acorda a cada TURN_ON_PUMP_DELAY e consulta a própria agenda
+static Report runScan(size_t rules) {
+   HydraulicPumpController pumps[PUMPS] = {{"P0", pins[0], 1000}, {"P1", pins[1], 1000}, {"P2", pins[2], 1000}, {"P3", pins[3], 1000}};
+   Report report;
+
+   configure(pumps, rules);
+   report.memory = PUMPS * PUMP_TASK_STACK;
+
+   HostHeapStats start = HostSim::getHeapStats();
+   HostSim::resetHeapPeak();
+
+   for (int64_t tick = 0; tick < DAY * SECOND; tick += TURN_ON_PUMP_DELAY * MS) {
+      HostSim::advanceTo(tick);
+
+      for (size_t pump = 0; pump < PUMPS; pump++) {
+         report.wakeups++;
+
+         if (pumps[pump].isDriveDue(localEpoch())) {
+            HostUntracked untracked;
+            report.drives.push_back({pump, localEpoch()});
+         }
+      }
+   }
+
+   HostHeapStats end = HostSim::getHeapStats();
+   report.allocations = end.allocations - start.allocations;
+   report.peak = end.peak - start.live;
+
+   return report;
+}
+
+// Agora: uma task dorme até o prazo mais próximo do heap e só volta à verificação fina perto de um horário
+static Report runHeap(size_t rules) {
+   HydraulicPumpController pumps[PUMPS] = {{"P0", pins[0], 1000}, {"P1", pins[1], 1000}, {"P2", pins[2], 1000}, {"P3", pins[3], 1000}};
+   Report report;
+
+   configure(pumps, rules);
+
+   size_t before = HostSim::getHeapStats().live;
+   PumpScheduler *scheduler = new PumpScheduler(pumps, PUMPS, TURN_ON_PUMP_DELAY, LOW_POWER_MAX_SLEEP);
+
+   scheduler->onDue([&report](size_t index, int64_t expectedWake) {
+      HostUntracked untracked;
+      report.drives.push_back({index, localEpoch()});
+   });
+
+   // A primeira chamada monta o heap
+   int64_t wake = HostSim::now() + (int64_t)scheduler->process(localEpoch()) * MS;
+   report.wakeups++;
+   report.memory = HostSim::getHeapStats().live - before + CONTROLLER_TASK_STACK;
+
+   HostHeapStats start = HostSim::getHeapStats();
+   HostSim::resetHeapPeak();
+
+   while (wake < DAY * SECOND) {
+      HostSim::advanceTo(wake);
+      report.wakeups++;
+      wake = HostSim::now() + std::max((int64_t)scheduler->process(localEpoch()), (int64_t)1) * MS;
+   }
+
+   HostHeapStats end = HostSim::getHeapStats();
+   report.allocations = end.allocations - start.allocations;
+   report.peak = end.peak - start.live;
+
+   TEST_ASSERT_EQUAL_UINT32(rules, scheduler->getStats().drives);
+   TEST_ASSERT_EQUAL_UINT32(0, scheduler->getStats().missed);
+   delete scheduler;
+
+   return report;
+}
+
+void setUp() {
+   HostSim::reset();
+}
+
+void tearDown() {}
+
+void test_wakeups_and_memory_per_rule_count() {
+   const size_t ruleCounts[] = {8, 32, 128};
+
+   for (size_t rules : ruleCounts) {
+      HostSim::reset();
+      Report scan = runScan(rules);
+      HostSim::reset();
+      Report heap = runHeap(rules);
+
+      printf("%3u regras: varredura %7u despertares, %5u bytes, %u alocações no dia | heap %5u despertares, %5u bytes, %u alocações no dia\n",
+             (unsigned)rules, scan.wakeups, (unsigned)scan.memory, scan.allocations, heap.wakeups, (unsigned)heap.memory, heap.allocations);
+
+      // Os mesmos horários, uma única vez cada
+      std::sort(scan.drives.begin(), scan.drives.end());
+      std::sort(heap.drives.begin(), heap.drives.end());
+      TEST_ASSERT_EQUAL(rules, scan.drives.size());
+      TEST_ASSERT_TRUE(scan.drives == heap.drives);
+
+      // A varredura não depende das regras: PUMPS despertares a cada tick. O heap acorda no máximo
+      // a cada LOW_POWER_MAX_SLEEP por bomba, mais a verificação fina do último segundo de cada horário.
+      TEST_ASSERT_EQUAL_UINT32(PUMPS * (DAY * 1000 / TURN_ON_PUMP_DELAY), scan.wakeups);
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(PUMPS * (DAY * 1000 / LOW_POWER_MAX_SLEEP + 1) + rules * (1000 / TURN_ON_PUMP_DELAY + 2), heap.wakeups);
+      TEST_ASSERT_TRUE(heap.wakeups * 100 < scan.wakeups);
+
+      // Nenhuma das duas aloca no caminho de acionamento; o heap ocupa menos que uma pilha de task
+      TEST_ASSERT_EQUAL_UINT32(0, scan.allocations);
+      TEST_ASSERT_EQUAL_UINT32(0, heap.allocations);
+      TEST_ASSERT_EQUAL(0, heap.peak);
+      TEST_ASSERT_TRUE(heap.memory < scan.memory);
+   }
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_wakeups_and_memory_per_rule_count);
+   return UNITY_END();
+}
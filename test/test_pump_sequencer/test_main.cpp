@@ -0,0 +1,309 @@
+// Centenas de pedidos, cancelamentos e paradas sobrepostos sobre o sequenciador, em rajadas no
+// mesmo instante: as saídas nunca passam do limite de bombas simultâneas, as partidas respeitam o
+// intervalo mínimo e a antecedência da válvula mestra, e cada partida é a de maior prioridade
+// (depois a mais antiga) entre os pedidos na fila, comparada com um modelo da fila.
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "freertos/task.h"
+#include "hostSim.h"
+#include "hydraulicPumpController.h"
+#include "pumpSequencer.h"
+
+#define PUMPS 8
+#define MAX_CONCURRENT 3
+#define MIN_GAP 2000  // Em ms
+#define VALVE_PIN 23
+#define VALVE_LEAD 500  // Em ms
+#define BURSTS 120
+#define MS 1000LL
+
+static const uint8_t pins[PUMPS] = {12, 13, 14, 15, 18, 19, 21, 22};
+static const uint8_t priorities[PUMPS] = {0, 2, 1, 2, 0, 1, 3, 0};
+
+struct Rig {
+   HydraulicPumpController pumps[PUMPS] = {{"P0", pins[0], 20000}, {"P1", pins[1], 20000}, {"P2", pins[2], 20000}, {"P3", pins[3], 20000},
+                                          {"P4", pins[4], 20000}, {"P5", pins[5], 20000}, {"P6", pins[6], 20000}, {"P7", pins[7], 20000}};
+   PumpSequencer sequencer;
+   int64_t nextProcess = INT64_MAX;  // Em us, prazo pedido pelo último process()
+   uint32_t wakeups = 0;             // Chamadas pelo prazo, sem notificação
+
+   Rig() : sequencer(pumps, priorities, PUMPS, MAX_CONCURRENT, MIN_GAP, VALVE_PIN, VALVE_LEAD) { sequencer.begin(); }
+
+   // Laço da vTaskPumpController: um pedido notifica a task, que chama process() na hora
+   void process() {
+      uint32_t delay = sequencer.process();
+
+      if (delay == SEQUENCER_NO_DEADLINE) {
+         TEST_ASSERT_EQUAL_UINT32(0, sequencer.getQueueLength());
+         TEST_ASSERT_FALSE(sequencer.isMasterValveOpen());
+         nextProcess = INT64_MAX;
+      } else {
+         nextProcess = HostSim::now() + delay * MS;
+      }
+   }
+
+   void runUntil(int64_t time) {
+      while (nextProcess <= time) {
+         HostSim::advanceTo(nextProcess);
+         wakeups++;
+         process();
+      }
+
+      HostSim::advanceTo(time);
+   }
+
+   void runUntilIdle() {
+      while (nextProcess != INT64_MAX) {
+         HostSim::advanceTo(nextProcess);
+         wakeups++;
+         process();
+      }
+   }
+};
+
+// Fila esperada: pedidos aceitos na ordem de chegada
+struct Model {
+   std::vector<size_t> queue;
+
+   bool contains(size_t index) { return std::find(queue.begin(), queue.end(), index) != queue.end(); }
+
+   void remove(size_t index) { queue.erase(std::find(queue.begin(), queue.end(), index)); }
+
+   // Maior prioridade, depois o pedido mais antigo
+   size_t best() {
+      size_t selected = queue.front();
+
+      for (size_t index : queue)
+         if (priorities[index] > priorities[selected])
+            selected = index;
+
+      return selected;
+   }
+};
+
+// Acompanha as saídas: bombas acionadas, partidas e a válvula mestra
+struct Outputs {
+   int running = 0;
+   int maxRunning = 0;
+   int64_t lastStart = -1;
+   int64_t minGap = INT64_MAX;
+   int64_t valveOpenedAt = -1;
+   int64_t minLead = INT64_MAX;
+   uint32_t starts = 0;
+   uint32_t valveClosedWhileRunning = 0;
+   int64_t pulseStart[PUMPS] = {};
+   int64_t lastPulse[PUMPS] = {};  // Em us, duração do último pulso de cada bomba
+
+   void attach() {
+      HostSim::onGpio([this](uint8_t pin, bool level) {
+         int64_t now = HostSim::now();
+
+         if (pin == VALVE_PIN) {
+            valveOpenedAt = level ? now : -1;
+            valveClosedWhileRunning += !level && running > 0;
+            return;
+         }
+
+         size_t index = std::find(pins, pins + PUMPS, pin) - pins;
+         if (index == PUMPS)
+            return;
+
+         if (level) {
+            running++;
+            maxRunning = std::max(maxRunning, running);
+            starts++;
+            if (lastStart >= 0)
+               minGap = std::min(minGap, now - lastStart);
+            lastStart = now;
+            minLead = std::min(minLead, valveOpenedAt >= 0 ? now - valveOpenedAt : -1);
+            pulseStart[index] = now;
+         } else {
+            running--;
+            lastPulse[index] = now - pulseStart[index];
+         }
+      });
+   }
+};
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+void setUp() {
+   HostSim::reset();
+   seed = 0xC0FFEE;
+}
+
+void tearDown() {}
+
+void test_overlapping_requests_respect_limits_and_priorities() {
+   Rig rig;
+   Model model;
+   Outputs outputs;
+   uint32_t requests = 0, accepted = 0, cancelled = 0, started = 0;
+
+   outputs.attach();
+
+   // O callback roda fora do mutex e pode consultar o sequenciador
+   rig.sequencer.onStart([&](size_t index) {
+      TEST_ASSERT_TRUE(model.contains(index));
+      TEST_ASSERT_EQUAL_UINT32(model.best(), index);
+      model.remove(index);
+      started++;
+
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(model.queue.size(), rig.sequencer.getQueueLength());
+      TEST_ASSERT_EQUAL_UINT32(started, rig.sequencer.getStats().started);
+   });
+
+   rig.process();
+   TEST_ASSERT_EQUAL_INT64(INT64_MAX, rig.nextProcess);
+
+   for (size_t burst = 0; burst < BURSTS; burst++) {
+      rig.runUntil(HostSim::now() + (int64_t)nextRandom(45000) * MS);
+
+      // Rajada de pedidos, cancelamentos e paradas no mesmo instante
+      for (size_t event = 0, events = 2 + nextRandom(10); event < events; event++) {
+         size_t index = nextRandom(PUMPS);
+         uint32_t kind = nextRandom(10);
+
+         if (kind < 7) {
+            // Encurtar o pulso de uma bomba acionada pode encerrá-lo na hora
+            if (nextRandom(3) == 0)
+               rig.pumps[index].setPulseDuration(5000 + nextRandom(40000));
+
+            bool expected = !model.contains(index) && !rig.pumps[index].getPumpState();
+
+            requests++;
+            TEST_ASSERT_EQUAL(expected, rig.sequencer.request(index));
+            if (expected) {
+               model.queue.push_back(index);
+               accepted++;
+            }
+         } else {
+            // Parada pelo CONTROL_STOP ou pelo toggle: cancela o pedido e desliga a saída
+            bool queued = model.contains(index);
+
+            TEST_ASSERT_EQUAL(queued, rig.sequencer.cancel(index));
+            if (queued) {
+               model.remove(index);
+               cancelled++;
+            }
+            if (kind == 9)
+               TEST_ASSERT_EQUAL(rig.pumps[index].getPumpState(), rig.sequencer.stop(index));
+         }
+      }
+
+      rig.process();
+   }
+
+   rig.runUntilIdle();
+
+   SequencerStats stats = rig.sequencer.getStats();
+
+   printf("%u pedidos em %u rajadas: %u aceitos, %u acionados, %u cancelados; espera máx %u ms, fila máx %u; %u despertares pelo prazo\n", requests,
+          BURSTS, accepted, started, cancelled, stats.maxWait, stats.maxQueueLength, rig.wakeups);
+
+   TEST_ASSERT_GREATER_OR_EQUAL_UINT32(300, requests);
+   TEST_ASSERT_TRUE(model.queue.empty());
+   TEST_ASSERT_EQUAL_UINT32(accepted, started + cancelled);
+   TEST_ASSERT_EQUAL_UINT32(requests, stats.requested);
+   TEST_ASSERT_EQUAL_UINT32(requests - accepted, stats.ignored);
+   TEST_ASSERT_EQUAL_UINT32(cancelled, stats.cancelled);
+   TEST_ASSERT_EQUAL_UINT32(started, stats.started);
+   TEST_ASSERT_EQUAL_UINT32(started, outputs.starts);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.failures);
+
+   TEST_ASSERT_LESS_OR_EQUAL(MAX_CONCURRENT, outputs.maxRunning);
+   TEST_ASSERT_EQUAL(MAX_CONCURRENT, stats.maxConcurrent);
+   TEST_ASSERT_GREATER_OR_EQUAL_INT64(MIN_GAP * MS, outputs.minGap);
+   TEST_ASSERT_GREATER_OR_EQUAL_INT64(VALVE_LEAD * MS, outputs.minLead);
+   TEST_ASSERT_EQUAL_UINT32(0, outputs.valveClosedWhileRunning);
+   TEST_ASSERT_EQUAL(0, outputs.running);
+   TEST_ASSERT_FALSE(HostSim::getGpio(VALVE_PIN));
+
+   // Cada despertar pelo prazo corresponde a um evento (fim de pulso, intervalo mínimo, antecedência
+   // da válvula ou seu fechamento), e não a uma consulta periódica durante os pulsos
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(4 * started, rig.wakeups);
+}
+
+// Sem vaga, a task dorme até o fim do pulso mais curto, e uma parada a acorda na hora
+void test_full_sequencer_sleeps_until_a_pulse_ends() {
+   Rig rig;
+   Outputs outputs;
+   TaskHandle_t task;
+
+   xTaskCreatePinnedToCore(NULL, "taskPumpController", 4096, NULL, 3, &task, APP_CPU_NUM);
+   rig.sequencer.setTask(task);
+   outputs.attach();
+
+   for (size_t index = 0; index < MAX_CONCURRENT; index++) {
+      rig.pumps[index].setPulseDuration(30000 + index * 10000);
+      TEST_ASSERT_TRUE(rig.sequencer.request(index));
+      rig.process();
+      rig.runUntil(HostSim::now() + MIN_GAP * MS);
+   }
+   TEST_ASSERT_EQUAL(MAX_CONCURRENT, outputs.running);
+
+   // A bomba 0 partiu primeiro e termina em 30 s depois da válvula: a task dorme até lá
+   TEST_ASSERT_TRUE(rig.sequencer.request(3));
+   HostSim::takeNotifications(task);
+   uint32_t delay = rig.sequencer.process();
+   int64_t firstEnd = outputs.pulseStart[0] + 30000 * MS;
+   TEST_ASSERT_UINT32_WITHIN(2, (firstEnd - HostSim::now()) / MS + 1, delay);
+
+   // Parar a bomba 1 notifica a task, que aciona a 3 depois do intervalo mínimo, sem esperar a 0
+   TEST_ASSERT_TRUE(rig.sequencer.stop(1));
+   TEST_ASSERT_FALSE(rig.sequencer.stop(1));
+   TEST_ASSERT_EQUAL_UINT32(1, HostSim::takeNotifications(task));
+   rig.process();
+   rig.runUntil(HostSim::now() + MIN_GAP * MS);
+   TEST_ASSERT_TRUE(rig.pumps[3].getPumpState());
+   TEST_ASSERT_TRUE(outputs.pulseStart[3] < firstEnd);
+   TEST_ASSERT_EQUAL_UINT32(0, rig.sequencer.getQueueLength());
+
+   // Com a fila vazia, a válvula espera só o fim do pulso mais longo
+   delay = rig.sequencer.process();
+   int64_t lastEnd = std::max(outputs.pulseStart[2] + 50000 * MS, outputs.pulseStart[3] + 20000 * MS);
+   TEST_ASSERT_UINT32_WITHIN(2, (lastEnd - HostSim::now()) / MS + 1, delay);
+
+   uint32_t wakeups = rig.wakeups;
+   rig.runUntilIdle();
+   TEST_ASSERT_FALSE(HostSim::getGpio(VALVE_PIN));
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(wakeups + 2, rig.wakeups);
+}
+
+// O pulso ajustado para um pedido cancelado não vale para o acionamento seguinte
+void test_cancel_discards_the_adjusted_pulse() {
+   Rig rig;
+   Outputs outputs;
+
+   outputs.attach();
+   rig.pumps[2].setPulseDuration(10000);
+   rig.pumps[2].setNextPulseDuration(30000);
+
+   TEST_ASSERT_TRUE(rig.sequencer.request(2));
+   TEST_ASSERT_TRUE(rig.sequencer.cancel(2));
+   TEST_ASSERT_FALSE(rig.sequencer.cancel(2));
+   TEST_ASSERT_EQUAL_UINT32(0, rig.sequencer.getQueueLength());
+
+   TEST_ASSERT_TRUE(rig.sequencer.request(2));
+   rig.process();
+   rig.runUntilIdle();
+
+   TEST_ASSERT_EQUAL_UINT32(1, outputs.starts);
+   TEST_ASSERT_EQUAL_INT64(10000 * MS, outputs.lastPulse[2]);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_overlapping_requests_respect_limits_and_priorities);
+   RUN_TEST(test_cancel_discards_the_adjusted_pulse);
+   RUN_TEST(test_full_sequencer_sleeps_until_a_pulse_ends);
+   return UNITY_END();
+}
@@ -0,0 +1,250 @@
+// Gerador de carga sobre o governor: clientes chegam ao acaso com a mistura da interface (comandos,
+// consultas e arquivos da SPIFFS), cada requisição admitida divide a CPU com as demais até
+// terminar, e o relatório mostra p50, p99 e a taxa de recusa por classe em cada fase (carga leve,
+// sobrecarga, recuperação e heap baixo). As vagas nunca passam dos limites e nenhuma fica presa.
+#include <unity.h>
+
+#include <vector>
+
+#include "esp_heap_caps.h"
+#include "hostSim.h"
+#include "requestGovernor.h"
+
+#define MAX_CONCURRENT 8  // Mesmos valores de src/main.cpp
+#define RESERVED 2
+#define MAX_FILES 2
+#define MIN_HEAP 40000
+#define MIN_BLOCK 12000
+#define RETRY_AFTER 5
+#define MAX_HOLD 300000  // Em ms
+
+#define HEAP_SIZE 160000
+#define PHASE_DURATION 60000  // Em ms
+
+static const char *classNames[] = {"priority", "normal", "static"};
+
+struct Phase {
+   const char *name;
+   uint32_t rate;  // Requisições por segundo
+   bool lowHeap;
+};
+
+struct PhaseReport {
+   uint32_t arrivals[REQUEST_EXEMPT] = {};
+   uint32_t shed[REQUEST_EXEMPT] = {};
+   GovernorStats stats;
+
+   float shedRate(uint8_t requestClass) const { return arrivals[requestClass] ? (float)shed[requestClass] / arrivals[requestClass] : 0; }
+};
+
+// Requisição admitida, ainda em processamento
+struct Active {
+   AsyncWebServerRequest *request;
+   float work;  // Em ms de CPU ainda necessários
+};
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+static GovernorConfig makeConfig() {
+   return {MAX_CONCURRENT, RESERVED, MAX_FILES, MIN_HEAP, MIN_BLOCK, RETRY_AFTER, MAX_HOLD};
+}
+
+// Mesma classificação de classifyRequest
+static RequestClass classify(AsyncWebServerRequest *request) {
+   if (request->method() != HTTP_GET || request->url().startsWith("/pumps/"))
+      return REQUEST_PRIORITY;
+   if (request->url().startsWith("/metrics"))
+      return REQUEST_NORMAL;
+   return REQUEST_STATIC;
+}
+
+static AsyncWebServerRequest *newRequest(RequestClass requestClass) {
+   if (requestClass == REQUEST_PRIORITY)
+      return new AsyncWebServerRequest("/pumps/1", HTTP_POST);
+   if (requestClass == REQUEST_NORMAL)
+      return new AsyncWebServerRequest("/metrics");
+   return new AsyncWebServerRequest("/index.html");
+}
+
+// Em ms de CPU: comandos são curtos, arquivos da SPIFFS são os mais longos
+static float newWork(RequestClass requestClass) {
+   if (requestClass == REQUEST_PRIORITY)
+      return 5 + nextRandom(10);
+   if (requestClass == REQUEST_NORMAL)
+      return 20 + nextRandom(40);
+   return 80 + nextRandom(120);
+}
+
+void setUp() {
+   HostSim::reset();
+   HostSim::configureHeap(HEAP_SIZE, 0);
+   seed = 0x10AD;
+}
+
+void tearDown() {}
+
+void test_load_phases_report_latency_and_shedding() {
+   RequestGovernor governor(makeConfig());
+   std::vector<Active> active;
+   uint32_t chained = 0, chainedCalls = 0;
+
+   governor.onClassify(classify);
+
+   const Phase phases[] = {{"leve", 5, false}, {"sobrecarga", 60, false}, {"recuperação", 5, false}, {"heap baixo", 20, true}};
+   PhaseReport reports[4];
+
+   for (size_t phase = 0; phase < 4; phase++) {
+      PhaseReport &report = reports[phase];
+      void *ballast = phases[phase].lowHeap ? heap_caps_malloc(HEAP_SIZE - MIN_HEAP / 2, MALLOC_CAP_8BIT) : NULL;
+
+      if (phases[phase].lowHeap)
+         TEST_ASSERT_NOT_NULL(ballast);
+
+      for (uint32_t tick = 0; tick < PHASE_DURATION; tick++) {
+         // Chegadas do último ms
+         if (nextRandom(1000) < phases[phase].rate) {
+            uint32_t mix = nextRandom(100);
+            RequestClass requestClass = mix < 15 ? REQUEST_PRIORITY : mix < 60 ? REQUEST_NORMAL : REQUEST_STATIC;
+            AsyncWebServerRequest *request = newRequest(requestClass);
+
+            report.arrivals[requestClass]++;
+
+            if (governor.canHandle(request)) {
+               governor.handleRequest(request);
+               TEST_ASSERT_EQUAL(503, request->getResponse()->code);
+               TEST_ASSERT_EQUAL_STRING("Retry-After", request->getResponse()->headers[0].first.c_str());
+               report.shed[requestClass]++;
+               request->disconnect();
+               delete request;
+            } else {
+               // Parte dos handlers também acompanha o fim da conexão
+               if (nextRandom(4) == 0) {
+                  governor.onDisconnect(request, [&chainedCalls]() { chainedCalls++; });
+                  chained++;
+               }
+               active.push_back({request, newWork(requestClass)});
+            }
+         }
+
+         // Um ms de CPU dividido entre as requisições em andamento
+         HostSim::advance(1000);
+         float share = active.empty() ? 0 : 1.0f / active.size();
+         for (size_t index = 0; index < active.size();) {
+            active[index].work -= share;
+            if (active[index].work <= 0) {
+               active[index].request->disconnect();
+               delete active[index].request;
+               active.erase(active.begin() + index);
+            } else {
+               index++;
+            }
+         }
+
+         GovernorStats stats = governor.getStats();
+         TEST_ASSERT_EQUAL(active.size(), stats.active);
+         TEST_ASSERT_LESS_OR_EQUAL(MAX_FILES, stats.openFiles);
+      }
+
+      report.stats = governor.getStats();
+      heap_caps_free(ballast);
+   }
+
+   // Termina as requisições em andamento
+   for (Active &entry : active) {
+      entry.request->disconnect();
+      delete entry.request;
+   }
+
+   printf("%-12s %6s %6s %6s  %-22s\n", "fase", "p50", "p99", "chegad", "recusas (prio/norm/arq)");
+   for (size_t phase = 0; phase < 4; phase++) {
+      const PhaseReport &report = reports[phase];
+      uint32_t arrivals = report.arrivals[0] + report.arrivals[1] + report.arrivals[2];
+
+      printf("%-12s %4u ms %4u ms %6u  %5.1f%% %5.1f%% %5.1f%%\n", phases[phase].name, report.stats.p50, report.stats.p99, arrivals,
+             100 * report.shedRate(REQUEST_PRIORITY), 100 * report.shedRate(REQUEST_NORMAL), 100 * report.shedRate(REQUEST_STATIC));
+   }
+
+   GovernorStats stats = governor.getStats();
+   TEST_ASSERT_EQUAL(0, stats.active);
+   TEST_ASSERT_EQUAL(0, stats.openFiles);
+   TEST_ASSERT_EQUAL(0, stats.expired);
+   TEST_ASSERT_EQUAL(MAX_CONCURRENT, stats.maxActive);
+   TEST_ASSERT_EQUAL_UINT32(chained, chainedCalls);
+   TEST_ASSERT_GREATER_THAN_UINT32(0, chained);
+
+   for (uint8_t requestClass = 0; requestClass < REQUEST_EXEMPT; requestClass++)
+      printf("%s: %u admitidas, %u recusadas\n", classNames[requestClass], stats.admitted[requestClass], stats.shed[requestClass]);
+
+   // Carga leve: as prioritárias nunca são recusadas e quase nada é recusado
+   TEST_ASSERT_EQUAL(0, reports[0].shed[REQUEST_PRIORITY]);
+   TEST_ASSERT_TRUE(reports[0].shedRate(REQUEST_NORMAL) < 0.02f);
+
+   // Sobrecarga: as vagas reservadas seguram as prioritárias enquanto as demais são recusadas, e a
+   // latência fica limitada pelas vagas (no máximo MAX_CONCURRENT dividindo a CPU)
+   TEST_ASSERT_TRUE(reports[1].shedRate(REQUEST_PRIORITY) < 0.05f);
+   TEST_ASSERT_TRUE(reports[1].shedRate(REQUEST_NORMAL) > 0.2f);
+   TEST_ASSERT_TRUE(reports[1].shedRate(REQUEST_STATIC) > reports[1].shedRate(REQUEST_NORMAL));
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_CONCURRENT * 200, reports[1].stats.p99);
+   TEST_ASSERT_GREATER_THAN_UINT32(reports[0].stats.p99, reports[1].stats.p99);
+
+   // Recuperação: a latência volta ao nível da carga leve
+   TEST_ASSERT_LESS_THAN_UINT32(reports[1].stats.p99, reports[2].stats.p99);
+   TEST_ASSERT_EQUAL(0, reports[2].shed[REQUEST_PRIORITY]);
+
+   // Heap baixo: só as prioritárias passam
+   TEST_ASSERT_EQUAL(0, reports[3].shed[REQUEST_PRIORITY]);
+   TEST_ASSERT_EQUAL(reports[3].arrivals[REQUEST_NORMAL], reports[3].shed[REQUEST_NORMAL]);
+   TEST_ASSERT_EQUAL(reports[3].arrivals[REQUEST_STATIC], reports[3].shed[REQUEST_STATIC]);
+   TEST_ASSERT_EQUAL(reports[3].shed[REQUEST_NORMAL] + reports[3].shed[REQUEST_STATIC], stats.shedLowHeap);
+}
+
+// Um handler que sobrescreve request->onDisconnect() prende a vaga, que volta depois de maxHold
+void test_overwritten_disconnect_expires() {
+   RequestGovernor governor(makeConfig());
+   AsyncWebServerRequest *requests[MAX_CONCURRENT];
+
+   governor.onClassify(classify);
+
+   for (size_t index = 0; index < MAX_CONCURRENT; index++) {
+      requests[index] = newRequest(REQUEST_PRIORITY);
+      TEST_ASSERT_FALSE(governor.canHandle(requests[index]));
+   }
+
+   requests[0]->onDisconnect([]() {});
+   requests[0]->disconnect();
+   delete requests[0];
+
+   AsyncWebServerRequest late("/pumps/2", HTTP_POST);
+   TEST_ASSERT_TRUE(governor.canHandle(&late));
+   TEST_ASSERT_EQUAL(MAX_CONCURRENT, governor.getStats().active);
+
+   HostSim::advance((MAX_HOLD + 1) * 1000LL);
+
+   // As demais continuam abertas e também passaram de maxHold: todas as vagas são devolvidas
+   TEST_ASSERT_FALSE(governor.canHandle(&late));
+   GovernorStats stats = governor.getStats();
+   TEST_ASSERT_EQUAL(MAX_CONCURRENT, stats.expired);
+   TEST_ASSERT_EQUAL(1, stats.active);
+
+   // O fim das conexões expiradas não libera a vaga de outra requisição
+   for (size_t index = 1; index < MAX_CONCURRENT; index++) {
+      requests[index]->disconnect();
+      delete requests[index];
+   }
+   TEST_ASSERT_EQUAL(1, governor.getStats().active);
+
+   late.disconnect();
+   TEST_ASSERT_EQUAL(0, governor.getStats().active);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_load_phases_report_latency_and_shedding);
+   RUN_TEST(test_overwritten_disconnect_expires);
+   return UNITY_END();
+}
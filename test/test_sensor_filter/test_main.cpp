@@ -0,0 +1,167 @@
+// Filtro dos sensores (mediana de 5 seguida de média móvel exponencial em ponto fixo) alimentado
+// pelo ADC DMA simulado na frequência real. Serve de benchmark do custo por amostra no host,
+// comparado com o intervalo entre amostras do DMA, e verifica que o buffer circular comporta as
+// leituras publicadas entre duas amostras da telemetria.
+#include <unity.h>
+
+#include <chrono>
+
+#include "hostSim.h"
+#include "sensorSampler.h"
+
+#define SOIL_CHANNEL ADC1_CHANNEL_6
+#define TANK_CHANNEL ADC1_CHANNEL_7
+#define SECOND 1000000LL
+#define READ_PERIOD (SENSOR_READ_BYTES / SOC_ADC_DIGI_RESULT_BYTES * 1000 / SENSOR_SAMPLE_FREQUENCY + 1)  // Em ms, arredondado para cima
+#define SAMPLE_BUDGET (1000000000LL / SENSOR_SAMPLE_FREQUENCY)  // Em ns, intervalo entre duas amostras do DMA
+
+static uint32_t seed;
+
+static uint32_t nextRandom(uint32_t range) {
+   seed = seed * 1664525 + 1013904223;
+   return (seed >> 8) % range;
+}
+
+// Canais intercalados como no padrão configurado pelo SensorSampler, com ruído de +-noise e um
+// pico isolado no fundo de escala a cada spikeEvery amostras (0 desliga)
+struct Signal {
+   SensorSampler *sampler;
+   uint16_t soil = 2000;
+   uint16_t tank = 1500;
+   uint16_t noise = 20;
+   uint32_t spikeEvery = 0;
+   int64_t until = 0;  // Em us, instante em que run() é encerrado
+   uint32_t delivered = 0;
+
+   void attach() {
+      HostSim::onAdcRead([this](uint8_t *buffer, size_t maxLength) {
+         size_t count = maxLength / SOC_ADC_DIGI_RESULT_BYTES;
+         adc_digi_output_data_t *output = (adc_digi_output_data_t *)buffer;
+
+         for (size_t index = 0; index < count; index++, delivered++) {
+            bool soilSample = delivered % 2 == 0;
+            uint16_t value = (soilSample ? soil : tank) + nextRandom(2 * noise + 1) - noise;
+
+            if (spikeEvery != 0 && nextRandom(spikeEvery) == 0)
+               value = 4095;
+
+            output[index].type1.channel = soilSample ? SOIL_CHANNEL : TANK_CHANNEL;
+            output[index].type1.data = value;
+         }
+
+         // Duração da leitura no DMA: a última antes de until encerra o laço
+         if (HostSim::now() + (int64_t)count * SECOND / SENSOR_SAMPLE_FREQUENCY >= until)
+            sampler->end();
+
+         return count * SOC_ADC_DIGI_RESULT_BYTES;
+      });
+   }
+
+   void run(SensorSampler &sampler, int64_t duration) {
+      this->sampler = &sampler;
+      until = HostSim::now() + duration;
+
+      attach();
+      TEST_ASSERT_TRUE(sampler.begin());
+      sampler.run();
+   }
+};
+
+void setUp() {
+   HostSim::reset();
+   seed = 0x5E45;
+}
+
+void tearDown() {}
+
+void test_filter_cost_per_sample() {
+   SensorSampler sampler(SOIL_CHANNEL, TANK_CHANNEL);
+   Signal signal;
+
+   signal.spikeEvery = 50;
+
+   auto start = std::chrono::steady_clock::now();
+   signal.run(sampler, 60 * SECOND);
+   int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+   SensorStats stats = sampler.getStats();
+   int64_t perSample = elapsed / stats.samples;
+
+   printf("%u amostras: %lld ns por amostra (decodificação, filtro e publicação), %u ciclos do host no filtro (máximo %u), "
+          "intervalo do DMA %lld ns\n",
+          stats.samples, (long long)perSample, stats.avgCycles, stats.maxCycles, (long long)SAMPLE_BUDGET);
+
+   TEST_ASSERT_EQUAL_UINT32(signal.delivered, stats.samples);
+   TEST_ASSERT_EQUAL_UINT32(60 * SENSOR_PUBLISH_RATE, stats.published);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.readErrors);
+   TEST_ASSERT_TRUE(perSample < SAMPLE_BUDGET);
+}
+
+// A mediana descarta os picos isolados e a média móvel acompanha um degrau do sinal
+void test_filter_rejects_spikes_and_follows_steps() {
+   SensorSampler sampler(SOIL_CHANNEL, TANK_CHANNEL);
+   Signal signal;
+   SensorReading reading;
+
+   signal.spikeEvery = 20;
+   signal.run(sampler, 5 * SECOND);
+
+   while (sampler.read(reading)) {
+      TEST_ASSERT_UINT32_WITHIN(signal.noise, 2000, reading.soilMoisture);
+      TEST_ASSERT_UINT32_WITHIN(signal.noise, 1500, reading.tankLevel);
+   }
+
+   // Solo secando de uma vez: a constante de tempo é de 2^emaShift amostras por canal (~0,1 s)
+   signal.soil = 3000;
+   signal.run(sampler, 2 * SECOND);
+
+   uint32_t count = 0;
+   while (sampler.read(reading))
+      count++;
+
+   TEST_ASSERT_EQUAL_UINT32(2, count);
+   TEST_ASSERT_UINT32_WITHIN(signal.noise, 3000, reading.soilMoisture);
+   TEST_ASSERT_UINT32_WITHIN(signal.noise, 1500, reading.tankLevel);
+
+   IrrigationDecision decision = sampler.decide(10000);
+   TEST_ASSERT_EQUAL(IRRIGATION_RUN, decision.action);
+}
+
+// A telemetria lê o buffer a cada TELEMETRY_SAMPLE_DELAY, e no pior caso depois da margem HTTP
+// do supervisor: nenhuma leitura se perde nesse intervalo
+void test_ring_holds_a_drain_interval() {
+   SensorSampler sampler(SOIL_CHANNEL, TANK_CHANNEL);
+   Signal signal;
+   SensorReading reading;
+
+   signal.run(sampler, (int64_t)SENSOR_DRAIN_INTERVAL * 1000);
+
+   SensorStats stats = sampler.getStats();
+   TEST_ASSERT_EQUAL_UINT32(SENSOR_DRAIN_INTERVAL / 1000 * SENSOR_PUBLISH_RATE, stats.published);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+
+   // Publicadas ao fim de uma leitura do DMA, sem acumular atraso
+   uint32_t count = 0, first = 0, previous = 0;
+   while (sampler.read(reading)) {
+      if (count == 0)
+         first = reading.timestamp;
+      else
+         TEST_ASSERT_UINT32_WITHIN(READ_PERIOD, 1000 / SENSOR_PUBLISH_RATE, reading.timestamp - previous);
+      previous = reading.timestamp;
+      count++;
+   }
+   TEST_ASSERT_EQUAL_UINT32(stats.published, count);
+   TEST_ASSERT_UINT32_WITHIN(READ_PERIOD, (count - 1) * 1000 / SENSOR_PUBLISH_RATE, previous - first);
+
+   // Sem consumidor além do intervalo as leituras mais novas são descartadas e contadas
+   signal.run(sampler, (int64_t)SENSOR_DRAIN_INTERVAL * 1000 + 10 * SECOND);
+   TEST_ASSERT_GREATER_THAN_UINT32(0, sampler.getStats().overruns);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_filter_cost_per_sample);
+   RUN_TEST(test_filter_rejects_spikes_and_follows_steps);
+   RUN_TEST(test_ring_holds_a_drain_interval);
+   return UNITY_END();
+}
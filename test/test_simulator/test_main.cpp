@@ -0,0 +1,557 @@
+// Simulador com avanço de tempo do laço de controle: 30 dias simulados com o NTPClient, o
+// HydraulicPumpController, o PumpScheduler, o FreeRTOSTimer e o parser de configuração reais sobre
+// relógio, GPIO, UDP e HTTP simulados. Serve de benchmark para liberar cada versão do firmware:
+// reporta acionamentos perdidos e duplicados, a distribuição da latência e o uso do heap.
+#include <unity.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "NTPClient.h"
+#include "boardProfile.h"
+#include "driveSchedule.h"
+#include "freeRTOSTimerController.h"
+#include "hostSim.h"
+#include "hydraulicPumpController.h"
+#include "pumpScheduler.h"
+#include "scheduleRequest.h"
+
+// Mesmos valores de src/main.cpp
+#define ACTIVE_PUMPS ActiveBoard::pumpCount
+#define TIME_OFFSET (-3 * 3600)
+#define NTP_DELAY 600000
+#define NTP_INTERVAL 3600000
+#define UPDATE_DELAY 300000
+#define TURN_ON_PUMP_DELAY 100
+#define NTP_WAIT_DELAY 1000
+#define LOW_POWER_MAX_SLEEP 60000
+
+#define SIMULATED_DAYS 30
+#define START_EPOCH 1767225600UL  // 01/01/2026 00:00 UTC, 31/12/2025 21:00 no horário local
+#define SECOND 1000000LL
+#define PROBE_FINE 10000       // Em us, amostragem do relógio local a menos de 2 s de um horário
+#define PROBE_COARSE 1000000   // Em us
+#define HTTP_LATENCY 800       // Em ms, handshake TLS e resposta do MongoDB Atlas
+#define HTTP_TIMEOUT 5000      // Em ms, requisição sem resposta durante uma queda da rede
+#define HTTP_SEGMENT 48        // Maior pedaço entregue ao parser, como os segmentos TCP do corpo
+
+// Instante da simulação (em us) de um horário local no dia day, contado a partir de 01/01/2026
+static int64_t localAt(uint32_t day, const char *time) {
+   return ((int64_t)day * 86400 + DriveSchedule::parseTime(time) - TIME_OFFSET) * SECOND;
+}
+
+// Servidor NTP: responde com o horário verdadeiro mais o ajuste configurado, a menos que a rede esteja fora
+class SimNtpServer : public UDP {
+  public:
+   bool online = true;
+   int32_t step = 0;  // Em s, correção aplicada pelo servidor (ex.: deriva acumulada do relógio da placa)
+   uint32_t requests = 0;
+
+   uint8_t begin(uint16_t port) override { return 1; }
+   void stop() override {}
+   int beginPacket(IPAddress ip, uint16_t port) override { return 1; }
+   int beginPacket(const char *host, uint16_t port) override { return 1; }
+   size_t write(uint8_t character) override { return 1; }
+   size_t write(const uint8_t *buffer, size_t size) override { return size; }
+
+   int endPacket() override {
+      requests++;
+      if (!online)
+         return 1;
+
+      uint32_t seconds = START_EPOCH + HostSim::now() / SECOND + step + SEVENZYYEARS;
+      memset(packet, 0, sizeof(packet));
+      packet[40] = seconds >> 24;
+      packet[41] = seconds >> 16;
+      packet[42] = seconds >> 8;
+      packet[43] = seconds;
+      pending = true;
+      return 1;
+   }
+
+   int parsePacket() override { return pending ? NTP_PACKET_SIZE : 0; }
+   int available() override { return pending ? NTP_PACKET_SIZE : 0; }
+   int read() override { return -1; }
+   int read(char *buffer, size_t length) override { return read((unsigned char *)buffer, length); }
+   int peek() override { return -1; }
+   void flush() override { pending = false; }
+   IPAddress remoteIP() override { return IPAddress(200, 160, 7, 186); }
+   uint16_t remotePort() override { return 123; }
+
+   int read(unsigned char *buffer, size_t length) override {
+      if (!pending)
+         return 0;
+      memcpy(buffer, packet, min(length, sizeof(packet)));
+      pending = false;
+      return min(length, sizeof(packet));
+   }
+
+  private:
+   uint8_t packet[NTP_PACKET_SIZE];
+   bool pending = false;
+};
+
+// MongoDB Atlas: devolve o documento de cada bomba em pedaços, depois da latência da requisição
+class SimCloud {
+  public:
+   bool online = true;
+   uint32_t requests = 0;
+   uint32_t failures = 0;
+
+   void setDocument(size_t index, const char *body) {
+      HostUntracked untracked;
+      documents[index] = body;
+   }
+
+   // Retorna o status HTTP, ou -1 quando a requisição expira
+   int fetch(size_t index, ScheduleRequest &request) {
+      requests++;
+
+      if (!online) {
+         vTaskDelay(pdMS_TO_TICKS(HTTP_TIMEOUT));
+         failures++;
+         return -1;
+      }
+
+      vTaskDelay(pdMS_TO_TICKS(HTTP_LATENCY));
+
+      const std::string &body = documents[index];
+      request.begin(REQUEST_SCHEDULE);
+      for (size_t offset = 0; offset < body.size(); offset += HTTP_SEGMENT)
+         request.feed((const uint8_t *)body.data() + offset, min((size_t)HTTP_SEGMENT, body.size() - offset));
+
+      return request.finish() ? 200 : 400;
+   }
+
+  private:
+   std::map<size_t, std::string> documents;
+};
+
+struct SimReport {
+   uint32_t expected = 0;    // Horários alcançados pelo relógio local da placa
+   uint32_t triggers = 0;
+   uint32_t missed = 0;      // Horários alcançados e nunca disparados
+   uint32_t duplicates = 0;  // Disparos além do primeiro de um mesmo horário
+   std::vector<int64_t> latencies;  // Em us, do instante em que o relógio local alcança o horário ao disparo
+   PumpSchedulerStats scheduler;
+   FreeRTOSTimerStats timers;
+   uint32_t pulses = 0;
+   uint32_t pulseFailures = 0;
+   uint32_t maxPulseError = 0;  // Em us
+   uint32_t risingEdges = 0;
+   HostHeapStats heap;
+   uint32_t allocationsPerDay = 0;
+   size_t liveAfterWarmup = 0;  // Em bytes, ao fim do primeiro dia
+
+   int64_t percentile(double rank) const {
+      if (latencies.empty())
+         return 0;
+      std::vector<int64_t> sorted = latencies;
+      std::sort(sorted.begin(), sorted.end());
+      return sorted[std::min(sorted.size() - 1, (size_t)(rank * sorted.size()))];
+   }
+};
+
+// Placa simulada: as tasks vTaskPumpController, vTaskNTP e vTaskUpdate do firmware executadas no
+// relógio simulado. A task das bombas roda também enquanto as outras estão bloqueadas na rede.
+class Simulation {
+  public:
+   SimNtpServer ntpServer;
+   SimCloud cloud;
+
+   Simulation()
+       : ntp(ntpServer, "a.st1.ntp.br", TIME_OFFSET, NTP_INTERVAL),
+         scheduler(bank.pumps, ACTIVE_PUMPS, TURN_ON_PUMP_DELAY, LOW_POWER_MAX_SLEEP),
+         ntpTimer("ntp", NTP_DELAY, pdTRUE, this, &Simulation::onNtpTimer),
+         updateTimer("update", UPDATE_DELAY, pdTRUE, this, &Simulation::onUpdateTimer) {
+      HostUntracked untracked;
+
+      xTaskCreatePinnedToCore(NULL, "taskPumpController", 4096, NULL, 3, &pumpTask, APP_CPU_NUM);
+      scheduler.setTask(pumpTask);
+      scheduler.onDue([this](size_t index, int64_t expectedWake) { onDue(index, expectedWake); });
+
+      references.resize(ACTIVE_PUMPS);
+      HostSim::onGpio([this](uint8_t pin, bool level) {
+         if (level)
+            report.risingEdges++;
+      });
+      HostSim::onBlock([this]() { return runBackground(); });
+   }
+
+   ~Simulation() {
+      HostSim::onBlock(nullptr);
+      HostSim::onGpio(nullptr);
+   }
+
+   // Ação executada quando a simulação alcança o instante at
+   void at(int64_t time, std::function<void()> action) {
+      HostUntracked untracked;
+      script.push_back({time, action});
+      std::stable_sort(script.begin(), script.end(), [](const Step &first, const Step &second) { return first.time < second.time; });
+   }
+
+   void run(uint32_t days) {
+      int64_t end = (int64_t)days * 86400 * SECOND;
+      HostHeapStats start = HostSim::getHeapStats();
+
+      ntpTimer.start();
+      updateTimer.start();
+      ntpDue = updateDue = true;
+
+      while (HostSim::now() < end) {
+         runReady();
+
+         int64_t next = std::min({pumpWake, probeWake, end, HostSim::getNextTimer()});
+         if (nextStep < script.size())
+            next = std::min(next, script[nextStep].time);
+         HostSim::advanceTo(std::max(next, HostSim::now() + (next <= HostSim::now() ? 1 : 0)));
+
+         if (report.liveAfterWarmup == 0 && HostSim::now() >= 86400 * SECOND)
+            report.liveAfterWarmup = HostSim::getHeapStats().live;
+      }
+
+      finish(days, start);
+   }
+
+   void setTimeOffset(int offset) {
+      ntp.setTimeOffset(offset);
+      scheduler.reschedule();
+   }
+
+   FreeRTOSTimer &getNtpTimer() { return ntpTimer; }
+
+   const SimReport &getReport() const { return report; }
+
+  private:
+   struct Step {
+      int64_t time;
+      std::function<void()> action;
+   };
+
+   ActivePumpBank bank;
+   NTPClient ntp;
+   PumpScheduler scheduler;
+   FreeRTOSTimer ntpTimer;
+   FreeRTOSTimer updateTimer;
+   ScheduleRequest request;
+   TaskHandle_t pumpTask = NULL;
+
+   bool ntpDue = false;
+   bool updateDue = false;
+   int64_t pumpWake = 0;
+   int64_t probeWake = 0;
+   std::vector<Step> script;
+   size_t nextStep = 0;
+
+   // Referência para conferir os disparos: a agenda de cada bomba e os horários já alcançados
+   std::vector<DriveSchedule> references;
+   std::map<std::pair<size_t, uint32_t>, int64_t> reached;  // Instante em que o relógio local alcançou o horário
+   std::map<std::pair<size_t, uint32_t>, uint32_t> fired;
+   uint32_t lastLocal = 0;
+
+   SimReport report;
+
+   static void onNtpTimer(TimerHandle_t timer) { ((Simulation *)pvTimerGetTimerID(timer))->ntpDue = true; }
+   static void onUpdateTimer(TimerHandle_t timer) { ((Simulation *)pvTimerGetTimerID(timer))->updateDue = true; }
+
+   void runReady() {
+      runBackground();
+
+      while (nextStep < script.size() && script[nextStep].time <= HostSim::now())
+         script[nextStep++].action();
+
+      if (ntpDue) {
+         ntpDue = false;
+         runNtp();
+      }
+
+      if (updateDue) {
+         updateDue = false;
+         runUpdate();
+      }
+   }
+
+   // Amostragem do relógio local e task das bombas, que têm prioridade sobre as tasks de rede
+   int64_t runBackground() {
+      if (HostSim::now() >= probeWake)
+         probe();
+
+      if (HostSim::takeNotifications(pumpTask) > 0 || HostSim::now() >= pumpWake)
+         runPumpTask();
+
+      return std::min(pumpWake, probeWake);
+   }
+
+   // Corpo de vTaskPumpController
+   void runPumpTask() {
+      HostSim::setCurrentTask(pumpTask);
+
+      uint32_t taskDelay = NTP_WAIT_DELAY;
+      if (ntp.isTimeSet())
+         taskDelay = scheduler.process(ntp.getEpochTime());
+
+      pumpWake = HostSim::now() + (int64_t)taskDelay * 1000;
+      HostSim::setCurrentTask(NULL);
+   }
+
+   // Corpo de vTaskNTP
+   void runNtp() {
+      if (ntp.update())
+         scheduler.reschedule();
+      probe();
+   }
+
+   // Corpo de vTaskUpdate: a mesma sequência de updateConfiguration sobre o parser da API local
+   void runUpdate() {
+      for (size_t index = 0; index < ACTIVE_PUMPS; index++) {
+         if (cloud.fetch(index, request) != 200)
+            continue;
+
+         HydraulicPumpController &pump = bank.pumps[index];
+         DriveSchedule schedule = pump.getSchedule();
+
+         schedule.clear();
+         for (size_t rule = 0; rule < request.getRuleCount(); rule++)
+            schedule.addRule(request.getRules()[rule]);
+         schedule.compile(ntp.getEpochTime());
+
+         {
+            HostUntracked untracked;
+            references[index] = schedule;
+         }
+
+         pump.setSchedule(schedule);
+         if (request.getPulseDuration() > 0)
+            pump.setPulseDuration(request.getPulseDuration());
+      }
+
+      scheduler.reschedule();
+   }
+
+   void onDue(size_t index, int64_t expectedWake) {
+      probe();
+
+      HostUntracked untracked;
+      uint32_t local = ntp.getEpochTime();
+      uint32_t event = findEvent(index, local);
+
+      report.triggers++;
+      if (fired[{index, event}]++ == 0 && reached.count({index, event}))
+         report.latencies.push_back(HostSim::now() - reached[{index, event}]);
+
+      bank.pumps[index].startPump();
+   }
+
+   // Horário disparado: o mais recente dentro da janela de atraso aceita pelo DriveSchedule
+   uint32_t findEvent(size_t index, uint32_t local) {
+      uint32_t day = local / 86400;
+      uint32_t event = 0;
+
+      references[index].compile(day * 86400);
+      for (uint32_t second : references[index].getEvents())
+         if (day * 86400 + second <= local && day * 86400 + second + SCHEDULE_LATE_WINDOW >= local)
+            event = day * 86400 + second;
+
+      return event;
+   }
+
+   // Registra os horários que o relógio local alcançou desde a última amostra, inclusive por saltos
+   void probe() {
+      HostUntracked untracked;
+      bool near = false;
+
+      if (ntp.isTimeSet()) {
+         uint32_t local = ntp.getEpochTime();
+
+         for (size_t index = 0; index < ACTIVE_PUMPS; index++) {
+            if (lastLocal != 0 && local > lastLocal)
+               forEachEvent(index, lastLocal, local, [&](uint32_t event) { reached.insert({{index, event}, HostSim::now()}); });
+
+            int32_t toNext = references[index].getSecondsToNext(local);
+            near = near || (toNext >= 0 && toNext <= 2);
+         }
+
+         lastLocal = local;
+      }
+
+      probeWake = HostSim::now() + (near ? PROBE_FINE : PROBE_COARSE);
+   }
+
+   // Horários da bomba no intervalo (from, to] do relógio local
+   template <typename Callback>
+   void forEachEvent(size_t index, uint32_t from, uint32_t to, Callback callback) {
+      DriveSchedule &reference = references[index];
+
+      for (uint32_t day = from / 86400; day <= to / 86400; day++) {
+         reference.compile(day * 86400);
+         for (uint32_t second : reference.getEvents()) {
+            uint32_t event = day * 86400 + second;
+            if (event > from && event <= to)
+               callback(event);
+         }
+      }
+
+      reference.compile(to);
+   }
+
+   void finish(uint32_t days, HostHeapStats start) {
+      HostUntracked untracked;
+
+      // Os últimos segundos ainda podem ter horários a disparar
+      uint32_t horizon = lastLocal - SCHEDULE_LATE_WINDOW;
+
+      for (const auto &entry : reached) {
+         if (entry.first.second > horizon)
+            continue;
+         report.expected++;
+         uint32_t count = fired.count(entry.first) ? fired[entry.first] : 0;
+         if (count == 0)
+            report.missed++;
+      }
+
+      for (const auto &entry : fired)
+         report.duplicates += entry.second > 1 ? entry.second - 1 : 0;
+
+      report.scheduler = scheduler.getStats();
+      report.timers = FreeRTOSTimer::getGlobalStats();
+
+      for (size_t index = 0; index < ACTIVE_PUMPS; index++) {
+         PulseStats pulse = bank.pumps[index].getPulseStats();
+         report.pulses += pulse.pulses;
+         report.pulseFailures += pulse.failures;
+         report.maxPulseError = std::max(report.maxPulseError, pulse.maxError);
+      }
+
+      report.heap = HostSim::getHeapStats();
+      report.allocationsPerDay = (report.heap.allocations - start.allocations) / days;
+   }
+};
+
+static void printReport(const char *name, const SimReport &report) {
+   printf("[%s] %u dias: %u horários, %u disparos, %u perdidos (placa: %u), %u duplicados (placa: %u)\n", name, SIMULATED_DAYS,
+          (unsigned)report.expected, (unsigned)report.triggers, (unsigned)report.missed, (unsigned)report.scheduler.missed,
+          (unsigned)report.duplicates, (unsigned)report.scheduler.duplicates);
+   printf("[%s] latência p50 %lld ms, p99 %lld ms, máx %lld ms; pulsos %u, erro máx %u us\n", name, (long long)report.percentile(0.5) / 1000,
+          (long long)report.percentile(0.99) / 1000, (long long)report.percentile(1.0) / 1000, (unsigned)report.pulses,
+          (unsigned)report.maxPulseError);
+   printf("[%s] heap: pico %u B, em uso %u B (após o 1º dia: %u B), %u alocações (%u por dia); timers: %u comandos, %u repetições, %u falhas\n",
+          name, (unsigned)report.heap.peak, (unsigned)report.heap.live, (unsigned)report.liveAfterWarmup, (unsigned)report.heap.allocations,
+          (unsigned)report.allocationsPerDay, (unsigned)report.timers.commands, (unsigned)report.timers.retries,
+          (unsigned)report.timers.failures);
+}
+
+// Configuração do MongoDB Atlas ao longo do mês, no formato aceito por updateConfiguration
+static void scriptConfiguration(Simulation &simulation) {
+   simulation.cloud.setDocument(0, "{\"pulseDuration\":60000,\"driveTimes\":[{\"time\":\"19:45:00\",\"state\":true}],"
+                                   "\"rules\":[{\"days\":\"weekdays\",\"from\":\"06:00\",\"to\":\"18:00\",\"every\":900}]}");
+   simulation.cloud.setDocument(1, "{\"pulseDuration\":120000,\"driveTimes\":[\"07:00:00\",\"12:00:00\",\"17:30:00\"],"
+                                   "\"rules\":[{\"anchor\":\"sunset\",\"offset\":-1800}]}");
+
+   simulation.at(localAt(7, "12:02:00"), [&simulation]() {
+      simulation.cloud.setDocument(0, "{\"pulseDuration\":60000,\"rules\":[{\"days\":\"daily\",\"from\":\"05:00\",\"to\":\"19:00\",\"every\":1200}]}");
+      simulation.cloud.setDocument(1, "{\"pulseDuration\":120000,\"driveTimes\":[\"07:00:00\",\"12:00:00\",\"17:30:00\"],"
+                                      "\"rules\":[{\"anchor\":\"sunset\",\"offset\":-1800},{\"days\":[\"sat\",\"sun\"],\"at\":\"09:15\"}]}");
+   });
+
+   simulation.at(localAt(15, "10:31:00"), [&simulation]() {
+      simulation.cloud.setDocument(0, "{\"pulseDuration\":45000,\"rules\":[{\"days\":\"daily\",\"from\":\"05:00\",\"to\":\"19:00\",\"every\":1200}]}");
+   });
+
+   simulation.at(localAt(25, "16:47:00"), [&simulation]() {
+      simulation.cloud.setDocument(1, "{\"pulseDuration\":90000,\"rules\":[{\"days\":\"weekdays\",\"from\":\"06:30\",\"to\":\"17:30\",\"every\":3600},"
+                                      "{\"anchor\":\"sunrise\",\"offset\":900}]}");
+   });
+}
+
+void setUp() {
+   HostSim::reset();
+}
+
+void tearDown() {}
+
+// Sem saltos de relógio nem quedas: nenhum horário perdido ou duplicado e latência de no máximo um ciclo fino
+void test_calm_month_fires_every_drive_once() {
+   Simulation *simulation = new Simulation();
+   scriptConfiguration(*simulation);
+
+   simulation->run(SIMULATED_DAYS);
+   const SimReport &report = simulation->getReport();
+   printReport("calmo", report);
+
+   TEST_ASSERT_GREATER_THAN(1000, report.expected);
+   TEST_ASSERT_EQUAL_UINT32(0, report.missed);
+   TEST_ASSERT_EQUAL_UINT32(0, report.duplicates);
+   TEST_ASSERT_EQUAL_UINT32(0, report.scheduler.missed);
+   TEST_ASSERT_EQUAL_UINT32(0, report.scheduler.duplicates);
+   TEST_ASSERT_EQUAL_UINT32(report.expected, report.triggers);
+   TEST_ASSERT_LESS_OR_EQUAL(TURN_ON_PUMP_DELAY * 1000, report.percentile(1.0));
+   TEST_ASSERT_EQUAL_UINT32(report.triggers, report.pulses);
+   TEST_ASSERT_EQUAL_UINT32(report.pulses, report.risingEdges);
+   TEST_ASSERT_EQUAL_UINT32(0, report.pulseFailures);
+   TEST_ASSERT_EQUAL_UINT32(0, report.maxPulseError);
+
+   delete simulation;
+}
+
+// Passos do NTP para frente e para trás, mudança de fuso (horário de verão), queda de rede de seis
+// horas e fila do timer service cheia: a placa contabiliza exatamente o que o simulador observa
+void test_disturbed_month_accounts_for_every_clock_step() {
+   Simulation *simulation = new Simulation();
+   Simulation &sim = *simulation;
+   scriptConfiguration(sim);
+
+   sim.at(localAt(5, "09:02:00"), [&sim]() { sim.ntpServer.step += 1200; });
+   sim.at(localAt(8, "14:00:00"), [&sim]() { sim.ntpServer.step -= 900; });
+   sim.at(localAt(10, "03:00:00"), [&sim]() {
+      HostSim::failTimerCommands(2);
+      sim.getNtpTimer().changePeriod(NTP_DELAY / 2);
+   });
+   sim.at(localAt(12, "02:00:00"), [&sim]() { sim.setTimeOffset(TIME_OFFSET + 3600); });
+   sim.at(localAt(16, "08:00:00"), [&sim]() { sim.ntpServer.online = sim.cloud.online = false; });
+   sim.at(localAt(16, "14:00:00"), [&sim]() { sim.ntpServer.online = sim.cloud.online = true; });
+   sim.at(localAt(20, "02:00:00"), [&sim]() { sim.setTimeOffset(TIME_OFFSET); });
+
+   sim.run(SIMULATED_DAYS);
+   const SimReport &report = sim.getReport();
+   printReport("perturbado", report);
+
+   TEST_ASSERT_GREATER_THAN(1000, report.expected);
+   TEST_ASSERT_GREATER_THAN(0, report.missed);
+   TEST_ASSERT_GREATER_THAN(0, report.duplicates);
+   TEST_ASSERT_EQUAL_UINT32(report.missed, report.scheduler.missed);
+   TEST_ASSERT_EQUAL_UINT32(report.duplicates, report.scheduler.duplicates);
+   TEST_ASSERT_EQUAL_UINT32(report.expected - report.missed + report.duplicates, report.triggers);
+   TEST_ASSERT_LESS_OR_EQUAL(TURN_ON_PUMP_DELAY * 1000, report.percentile(0.99));
+   TEST_ASSERT_EQUAL_UINT32(0, report.pulseFailures);
+   TEST_ASSERT_GREATER_OR_EQUAL(2, report.timers.retries);
+   TEST_ASSERT_EQUAL_UINT32(0, report.timers.failures);
+   TEST_ASSERT_GREATER_THAN(0, sim.cloud.failures);
+
+   delete simulation;
+}
+
+// O laço de controle não pode vazar memória: depois do primeiro dia o heap em uso só varia com a
+// capacidade dos índices diários, nunca cresce com o número de dias
+void test_control_loop_does_not_leak() {
+   Simulation *simulation = new Simulation();
+   scriptConfiguration(*simulation);
+
+   simulation->run(SIMULATED_DAYS);
+   const SimReport &report = simulation->getReport();
+
+   TEST_ASSERT_GREATER_THAN(0, report.liveAfterWarmup);
+   TEST_ASSERT_LESS_OR_EQUAL(report.liveAfterWarmup + 1024, report.heap.live);
+   TEST_ASSERT_LESS_OR_EQUAL(16384, report.heap.peak);
+
+   delete simulation;
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_calm_month_fires_every_drive_once);
+   RUN_TEST(test_disturbed_month_accounts_for_every_clock_step);
+   RUN_TEST(test_control_loop_does_not_leak);
+   return UNITY_END();
+}
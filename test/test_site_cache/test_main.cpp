@@ -0,0 +1,338 @@
+// Site com N placas e uma placa de cache: a agenda de todas as bombas é buscada na nuvem em páginas
+// de SITE_CACHE_PAGE_SIZE códigos, lida elemento a elemento com o filtro dos campos da
+// configuração, e as demais placas recebem o documento por HTTP local apenas quando ele muda.
+// As placas compartilham o processo e o mDNS simulado; cada uma usa seu próprio IP nas requisições.
+#include <unity.h>
+
+#include <map>
+#include <vector>
+
+#include "hostNet.h"
+#include "hostSim.h"
+#include "pumpConfiguration.h"
+#include "siteConfigCache.h"
+
+#define UPDATE_DELAY 300000  // Em ms, mesmo valor de src/main.cpp
+#define BROWSE_DELAY 3100    // Em ms, uma busca mDNS completa
+#define PUMPS_PER_BOARD 2
+#define HISTORY_LENGTH 400  // Campo fora do filtro, maior que SITE_CACHE_DOCUMENT_SIZE
+#define FIND_URL "https://data.mongodb-api.com/app/data/endpoint/data/v1/action/find"
+
+static const IPAddress CACHE_IP(192, 168, 0, 10);
+
+static IPAddress boardIP(size_t index) {
+   return IPAddress(192, 168, 0, 20 + index);
+}
+
+static String pumperCode(size_t board, size_t pump) {
+   return "B" + String((unsigned)board) + "-P" + String((unsigned)pump);
+}
+
+// MongoDB Atlas: documentos completos, com campos que a configuração não usa
+class SimCloud {
+  public:
+   std::map<String, uint32_t> pulses;
+   std::vector<size_t> pages;  // Códigos pedidos em cada requisição
+   bool truncate = false;      // Corta a resposta no meio, como uma conexão perdida
+
+   String document(const String &code) {
+      String json = "{\"_id\":{\"$oid\":\"65a1\"},\"pumperCode\":\"" + code + "\",\"pulseDuration\":" + String(pulses[code]) +
+                    ",\"driveTimes\":[\"06:00\",\"12:00\",\"18:00\"],\"rules\":[],\"latitude\":-23.5,\"longitude\":-46.6,\"history\":[";
+
+      for (size_t index = 0; index < HISTORY_LENGTH; index++) {
+         if (index > 0)
+            json += ",";
+         json += String((unsigned)index);
+      }
+
+      return json + "]}";
+   }
+
+   void handle(const HostHttpRequest &request, HostHttpResponse &response) {
+      DynamicJsonDocument body(4096);
+      TEST_ASSERT_FALSE(deserializeJson(body, request.body));
+
+      String json = "{\"documents\":[";
+      size_t count = 0;
+
+      for (JsonVariant code : body["filter"]["pumperCode"]["$in"].as<JsonArray>()) {
+         if (!pulses.count(code.as<String>()))
+            continue;
+         if (count++ > 0)
+            json += ",";
+         json += document(code.as<String>());
+      }
+
+      json += "]}";
+      pages.push_back(body["filter"]["pumperCode"]["$in"].size());
+
+      response.status = 200;
+      response.body = truncate ? json.substring(0, json.length() / 2) : json;
+   }
+};
+
+// Placa de cache: refresh() a cada UPDATE_DELAY e o handler de SITE_CACHE_PATH
+struct CacheBoard {
+   SiteConfigCache cache{true};
+   StaticJsonDocument<SITE_CACHE_FILTER_SIZE> fields;
+
+   CacheBoard() {
+      cache.begin();
+
+      PumpConfiguration::setFields(fields.to<JsonObject>());
+   }
+
+   bool refresh() {
+      HostNet::setLocalIP(CACHE_IP);
+      return cache.refresh(FIND_URL, "key", "ca", fields.as<JsonVariantConst>());
+   }
+
+   void handle(const HostHttpRequest &request, HostHttpResponse &response) {
+      int query = request.url.indexOf('?');
+      TEST_ASSERT_EQUAL_STRING(SITE_CACHE_PATH, request.url.substring(0, query).c_str());
+
+      String code, document;
+      uint32_t version = 0, currentVersion = 0;
+
+      String parameters = request.url.substring(query + 1);
+      int separator = parameters.indexOf('&');
+      code = parameters.substring(5, separator);
+      version = strtoul(parameters.substring(separator + 9).c_str(), NULL, 10);
+
+      response.status = cache.serve(code, version, document, currentVersion, request.client);
+      response.body = document;
+      response.headers.push_back({"X-Config-Version", String(currentVersion)});
+   }
+};
+
+struct Board {
+   IPAddress ip;
+   std::vector<String> codes;
+   SiteConfigCache cache{false};
+};
+
+// Requisições, respostas e memória de uma simulação
+struct SiteReport {
+   uint32_t updated = 0;      // Fetches com 200
+   uint32_t notModified = 0;  // Fetches com 304
+   uint32_t fallbacks = 0;    // Fetches que recorreriam à nuvem
+   size_t refreshPeak = 0;    // Maior pico transitório do heap em um refresh(), em bytes
+};
+
+class Site {
+  public:
+   SimCloud cloud;
+   CacheBoard cacheBoard;
+   std::vector<Board *> boards;
+
+   explicit Site(size_t count) {
+      HostUntracked untracked;
+
+      for (size_t pump = 0; pump < PUMPS_PER_BOARD; pump++) {
+         String code = "C-P" + String((unsigned)pump);
+         cacheBoard.cache.registerCode(code);
+         cloud.pulses[code] = 60000;
+      }
+
+      HostNet::announce({"cache", CACHE_IP, 80, {{"cache", "1"}}, 120});
+
+      for (size_t index = 0; index < count; index++) {
+         Board *board = new Board();
+         board->ip = boardIP(index);
+         for (size_t pump = 0; pump < PUMPS_PER_BOARD; pump++) {
+            board->codes.push_back(pumperCode(index, pump));
+            cloud.pulses[pumperCode(index, pump)] = 30000 + index * 100 + pump;
+         }
+         boards.push_back(board);
+
+         HostNet::announce({"board" + String((unsigned)index), board->ip, 80, {{"pumps", String(PUMPS_PER_BOARD)}}, 120});
+      }
+
+      HostNet::onHttp([this](const HostHttpRequest &request, HostHttpResponse &response) {
+         if (request.secure)
+            cloud.handle(request, response);
+         else if (request.host == CACHE_IP.toString())
+            cacheBoard.handle(request, response);
+      });
+   }
+
+   ~Site() {
+      for (Board *board : boards)
+         delete board;
+   }
+
+   // Um ciclo de UPDATE_DELAY: o cache atualiza, a busca mDNS termina e cada placa lê suas bombas
+   SiteReport cycle(bool expectRefresh = true) {
+      SiteReport report;
+
+      // Descontado o que fica nas entradas do cache depois do refresh()
+      HostSim::resetHeapPeak();
+      TEST_ASSERT_EQUAL(expectRefresh, cacheBoard.refresh());
+      report.refreshPeak = HostSim::getHeapStats().peak - HostSim::getHeapStats().live;
+
+      HostSim::advance(BROWSE_DELAY * 1000LL);
+
+      for (Board *board : boards) {
+         HostNet::setLocalIP(board->ip);
+
+         for (const String &code : board->codes) {
+            DynamicJsonDocument document(SITE_CACHE_DOCUMENT_SIZE);
+            int status = board->cache.fetch(code.c_str(), document);
+
+            if (status == 200) {
+               report.updated++;
+               TEST_ASSERT_EQUAL_UINT32(cloud.pulses[code], document["pulseDuration"].as<uint32_t>());
+               TEST_ASSERT_EQUAL(3, document["driveTimes"].size());
+               TEST_ASSERT_TRUE(document["history"].isNull());
+            } else if (status == 304) {
+               report.notModified++;
+            } else {
+               report.fallbacks++;
+            }
+         }
+      }
+
+      HostSim::advance((UPDATE_DELAY - BROWSE_DELAY) * 1000LL);
+
+      return report;
+   }
+
+   size_t requested() {
+      size_t total = 0;
+      for (size_t page : cloud.pages)
+         total += page;
+      return total;
+   }
+};
+
+void setUp() {
+   HostSim::reset();
+}
+
+void tearDown() {}
+
+// Primeiro ciclo: o cache só conhece os próprios códigos e aprende os das placas anunciadas; no
+// segundo busca todos em páginas e entrega os documentos; a partir do terceiro nada muda
+void test_boards_converge_with_paged_cloud_requests() {
+   const size_t count = 24;
+   const size_t codes = (count + 1) * PUMPS_PER_BOARD;
+   Site site(count);
+
+   SiteReport first = site.cycle();
+   TEST_ASSERT_EQUAL_UINT32(count * PUMPS_PER_BOARD, first.fallbacks);
+   TEST_ASSERT_EQUAL(1, site.cloud.pages.size());
+
+   site.cloud.pages.clear();
+   SiteReport second = site.cycle();
+   TEST_ASSERT_EQUAL_UINT32(count * PUMPS_PER_BOARD, second.updated);
+   TEST_ASSERT_EQUAL((codes + SITE_CACHE_PAGE_SIZE - 1) / SITE_CACHE_PAGE_SIZE, site.cloud.pages.size());
+   TEST_ASSERT_EQUAL(codes, site.requested());
+   for (size_t page : site.cloud.pages)
+      TEST_ASSERT_LESS_OR_EQUAL(SITE_CACHE_PAGE_SIZE, page);
+
+   for (int cycle = 0; cycle < 5; cycle++) {
+      SiteReport steady = site.cycle();
+      TEST_ASSERT_EQUAL_UINT32(count * PUMPS_PER_BOARD, steady.notModified);
+      TEST_ASSERT_EQUAL_UINT32(0, steady.fallbacks);
+   }
+
+   SiteCacheStats stats = site.cacheBoard.cache.getStats();
+   printf("site de %u placas: %u requisições à nuvem em 7 ciclos, %u atendidas pelo cache, %u recusadas\n", (unsigned)count,
+          (unsigned)stats.cloudRequests, (unsigned)stats.served, (unsigned)stats.refused);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.refused);
+}
+
+// O pico de memória de um refresh() é o de um documento, não o do site inteiro
+void test_refresh_memory_does_not_grow_with_the_site() {
+   size_t peaks[2];
+   const size_t counts[2] = {4, 28};
+
+   for (int run = 0; run < 2; run++) {
+      HostSim::reset();
+      Site site(counts[run]);
+
+      site.cycle();
+      site.cycle();
+      peaks[run] = site.cycle().refreshPeak;
+      printf("%u placas: pico transitório do refresh() %u bytes\n", (unsigned)counts[run], (unsigned)peaks[run]);
+   }
+
+   TEST_ASSERT_LESS_OR_EQUAL(SITE_CACHE_DOCUMENT_SIZE * 3, peaks[1]);
+   TEST_ASSERT_INT_WITHIN(512, peaks[0], peaks[1]);
+}
+
+// Uma mudança na nuvem chega uma única vez, apenas à placa da bomba alterada
+void test_changed_document_is_delivered_once() {
+   Site site(6);
+
+   site.cycle();
+   site.cycle();
+
+   site.cloud.pulses[pumperCode(3, 1)] = 45000;
+
+   SiteReport changed = site.cycle();
+   TEST_ASSERT_EQUAL_UINT32(1, changed.updated);
+   TEST_ASSERT_EQUAL_UINT32(6 * PUMPS_PER_BOARD - 1, changed.notModified);
+
+   SiteReport after = site.cycle();
+   TEST_ASSERT_EQUAL_UINT32(0, after.updated);
+}
+
+// Resposta cortada no meio de um elemento: o refresh falha e as placas continuam com a versão atual
+void test_truncated_response_keeps_the_served_versions() {
+   Site site(6);
+
+   site.cycle();
+   site.cycle();
+
+   site.cloud.truncate = true;
+   site.cloud.pulses[pumperCode(0, 0)] = 1000;
+   SiteReport truncated = site.cycle(false);
+   TEST_ASSERT_EQUAL_UINT32(0, truncated.fallbacks);
+
+   site.cloud.truncate = false;
+   SiteReport recovered = site.cycle();
+   TEST_ASSERT_EQUAL_UINT32(0, recovered.fallbacks);
+   TEST_ASSERT_EQUAL_UINT32(1, recovered.updated + truncated.updated);
+}
+
+// Pedidos de IPs fora do mDNS não são aprendidos, e uma placa anunciada não passa do limite
+void test_unknown_codes_are_learned_only_from_announced_boards() {
+   Site site(2);
+
+   site.cycle();
+   site.cycle();
+
+   String document;
+   uint32_t currentVersion = 0;
+   HostNet::setLocalIP(IPAddress(10, 0, 0, 99));
+   for (int index = 0; index < 20; index++)
+      TEST_ASSERT_EQUAL(404, site.cacheBoard.cache.serve("X" + String(index), 0, document, currentVersion, IPAddress(10, 0, 0, 99)));
+
+   // Uma placa anunciada pedindo códigos demais
+   for (int index = 0; index < 2 * SITE_CACHE_MAX_ENTRIES; index++)
+      site.cacheBoard.cache.serve("F" + String(index), 0, document, currentVersion, boardIP(1));
+
+   // Códigos longos demais não são aprendidos
+   String longCode;
+   for (int index = 0; index <= SITE_CACHE_MAX_CODE; index++)
+      longCode += "x";
+   site.cacheBoard.cache.serve(longCode, 0, document, currentVersion, boardIP(1));
+
+   site.cloud.pages.clear();
+   site.cycle();
+   TEST_ASSERT_EQUAL(SITE_CACHE_MAX_ENTRIES, site.requested());
+
+   SiteCacheStats stats = site.cacheBoard.cache.getStats();
+   TEST_ASSERT_EQUAL_UINT32(20 + 2 * SITE_CACHE_MAX_ENTRIES - (SITE_CACHE_MAX_ENTRIES - 6) + 1, stats.refused);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_boards_converge_with_paged_cloud_requests);
+   RUN_TEST(test_refresh_memory_does_not_grow_with_the_site);
+   RUN_TEST(test_changed_document_is_delivered_once);
+   RUN_TEST(test_truncated_response_keeps_the_served_versions);
+   RUN_TEST(test_unknown_codes_are_learned_only_from_announced_boards);
+   return UNITY_END();
+}
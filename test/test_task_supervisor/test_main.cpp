@@ -0,0 +1,196 @@
+// Escalonamento da recuperação do TaskSupervisor: cancelar a task, reiniciar a rede e reiniciar a
+// placa são etapas separadas, e cada uma só dá lugar à seguinte depois de stableTime sem que a
+// task se recupere. Uma task que volta a enviar heartbeats durante esse período volta ao nível 0.
+#include <unity.h>
+
+#include <vector>
+
+#include "freertos/task.h"
+#include "hostSim.h"
+#include "taskSupervisor.h"
+
+#define CHECK_INTERVAL 1000  // Em ms
+#define STABLE_TIME 60000    // Em ms
+#define DEADLINE 10000       // Em ms
+#define NETWORK_RECOVERY (RECOVER_CANCEL_TASK | RECOVER_RESET_NETWORK | RECOVER_REBOOT)
+#define MS 1000LL
+
+struct Action {
+   uint32_t time;  // Em ms
+   RecoveryAction action;
+};
+
+// Laço da vTaskSupervisor, com as tasks supervisionadas enviando heartbeats enquanto alive
+struct Rig {
+   TaskSupervisor supervisor;
+   TaskHandle_t handles[2] = {};
+   bool alive[2] = {true, true};
+   std::vector<Action> actions;
+   uint32_t networkResets = 0;
+   uint32_t reboots = 0;
+
+   Rig() : supervisor(CHECK_INTERVAL, STABLE_TIME) {
+      supervisor.begin(10000);
+      supervisor.onRecovery([this](const char *name, RecoveryAction action, uint32_t gap) { actions.push_back({(uint32_t)millis(), action}); });
+      supervisor.onNetworkReset([this]() { networkResets++; });
+      supervisor.onReboot([this]() { reboots++; });
+   }
+
+   void start(size_t index, uint8_t recovery) {
+      TEST_ASSERT_TRUE(supervisor.start({NULL, index ? "taskEvents" : "taskTelemetry", 4096, 1, PRO_CPU_NUM, DEADLINE, recovery}, &handles[index]));
+   }
+
+   // Avança em passos de CHECK_INTERVAL até duration ou até o primeiro reinício da placa
+   void run(uint32_t duration) {
+      for (uint32_t elapsed = 0; elapsed < duration && reboots == 0; elapsed += CHECK_INTERVAL) {
+         HostSim::advance(CHECK_INTERVAL * MS);
+
+         for (size_t index = 0; index < 2; index++) {
+            if (alive[index] && handles[index] != NULL) {
+               HostSim::setCurrentTask(handles[index]);
+               supervisor.heartbeat();
+            }
+         }
+         HostSim::setCurrentTask(NULL);
+
+         supervisor.check();
+      }
+   }
+
+   bool isCancelled(size_t index) {
+      HostSim::setCurrentTask(handles[index]);
+      bool cancelled = supervisor.isCancelled();
+      HostSim::setCurrentTask(NULL);
+
+      return cancelled;
+   }
+};
+
+void setUp() {
+   HostSim::reset();
+}
+
+void tearDown() {}
+
+// Task presa: cancelamento, reinício da rede e reinício da placa, cada um um período estável depois
+void test_stuck_task_walks_every_level() {
+   Rig rig;
+
+   rig.start(0, NETWORK_RECOVERY);
+   rig.alive[0] = false;
+
+   rig.run(DEADLINE + 2 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(1, rig.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_CANCEL_TASK, rig.actions[0].action);
+   TEST_ASSERT_TRUE(rig.isCancelled(0));
+   TEST_ASSERT_EQUAL(1, rig.supervisor.getHealth(0).level);
+
+   // Os prazos perdidos durante o período estável não escalam
+   rig.run(STABLE_TIME - 3 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(1, rig.actions.size());
+   TEST_ASSERT_EQUAL(0, rig.networkResets);
+   TEST_ASSERT_GREATER_THAN_UINT32(1, rig.supervisor.getStats().missed);
+
+   rig.run(3 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(2, rig.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_RESET_NETWORK, rig.actions[1].action);
+   TEST_ASSERT_EQUAL(1, rig.networkResets);
+   TEST_ASSERT_TRUE(rig.isCancelled(0));
+   TEST_ASSERT_EQUAL(2, rig.supervisor.getHealth(0).level);
+   TEST_ASSERT_GREATER_OR_EQUAL_UINT32(STABLE_TIME, rig.actions[1].time - rig.actions[0].time);
+
+   rig.run(2 * STABLE_TIME);
+   TEST_ASSERT_EQUAL(3, rig.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_REBOOT, rig.actions[2].action);
+   TEST_ASSERT_EQUAL(1, rig.reboots);
+   TEST_ASSERT_GREATER_OR_EQUAL_UINT32(STABLE_TIME, rig.actions[2].time - rig.actions[1].time);
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(STABLE_TIME + CHECK_INTERVAL, rig.actions[2].time - rig.actions[1].time);
+
+   SupervisorStats stats = rig.supervisor.getStats();
+   TEST_ASSERT_EQUAL_UINT32(1, stats.cancels);
+   TEST_ASSERT_EQUAL_UINT32(1, stats.networkResets);
+   TEST_ASSERT_EQUAL_UINT32(1, stats.reboots);
+}
+
+// O cancelamento resolve: depois do período estável o nível volta a 0, e um novo travamento começa
+// de novo pelo cancelamento
+void test_cancel_that_holds_resets_the_level() {
+   Rig rig;
+
+   rig.start(0, NETWORK_RECOVERY);
+   rig.alive[0] = false;
+   rig.run(DEADLINE + 2 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(RECOVER_CANCEL_TASK, rig.actions.back().action);
+
+   rig.alive[0] = true;
+   rig.run(STABLE_TIME + 2 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(0, rig.supervisor.getHealth(0).level);
+
+   rig.alive[0] = false;
+   rig.run(DEADLINE + 2 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(2, rig.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_CANCEL_TASK, rig.actions[1].action);
+   TEST_ASSERT_EQUAL(0, rig.networkResets);
+}
+
+// A task volta depois do cancelamento mas perde o prazo de novo dentro do período estável: o
+// reinício da rede vem no fim do período, mesmo com a task em dia naquele instante. Depois dele a
+// task se mantém e a placa não é reiniciada.
+void test_relapse_moves_to_the_network_reset() {
+   Rig rig;
+
+   rig.start(0, NETWORK_RECOVERY);
+   rig.alive[0] = false;
+   rig.run(DEADLINE + 2 * CHECK_INTERVAL);
+
+   rig.alive[0] = true;
+   rig.run(10000);
+   rig.alive[0] = false;
+   rig.run(DEADLINE + 2 * CHECK_INTERVAL);
+   rig.alive[0] = true;
+   TEST_ASSERT_EQUAL(1, rig.actions.size());
+
+   rig.run(STABLE_TIME);
+   TEST_ASSERT_EQUAL(2, rig.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_RESET_NETWORK, rig.actions[1].action);
+   TEST_ASSERT_EQUAL(1, rig.networkResets);
+
+   rig.run(3 * STABLE_TIME);
+   TEST_ASSERT_EQUAL(2, rig.actions.size());
+   TEST_ASSERT_EQUAL(0, rig.reboots);
+   TEST_ASSERT_EQUAL(0, rig.supervisor.getHealth(0).level);
+}
+
+// Sem a etapa de rede o cancelamento leva direto ao reinício da placa, também depois do período
+// estável; com só o reinício registrado ele vem no primeiro prazo perdido
+void test_unregistered_levels_are_skipped() {
+   Rig rig;
+
+   rig.start(0, RECOVER_CANCEL_TASK | RECOVER_REBOOT);
+   rig.alive[0] = false;
+   rig.run(DEADLINE + 2 * CHECK_INTERVAL + STABLE_TIME + CHECK_INTERVAL);
+
+   TEST_ASSERT_EQUAL(2, rig.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_CANCEL_TASK, rig.actions[0].action);
+   TEST_ASSERT_EQUAL(RECOVER_REBOOT, rig.actions[1].action);
+   TEST_ASSERT_GREATER_OR_EQUAL_UINT32(STABLE_TIME, rig.actions[1].time - rig.actions[0].time);
+   TEST_ASSERT_EQUAL(0, rig.networkResets);
+
+   Rig rebootOnly;
+
+   rebootOnly.start(1, RECOVER_REBOOT);
+   rebootOnly.alive[1] = false;
+   rebootOnly.run(DEADLINE + 2 * CHECK_INTERVAL);
+   TEST_ASSERT_EQUAL(1, rebootOnly.actions.size());
+   TEST_ASSERT_EQUAL(RECOVER_REBOOT, rebootOnly.actions[0].action);
+   TEST_ASSERT_EQUAL(1, rebootOnly.reboots);
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_stuck_task_walks_every_level);
+   RUN_TEST(test_cancel_that_holds_resets_the_level);
+   RUN_TEST(test_relapse_moves_to_the_network_reset);
+   RUN_TEST(test_unregistered_levels_are_skipped);
+   return UNITY_END();
+}
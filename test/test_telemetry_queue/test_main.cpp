@@ -0,0 +1,274 @@
+// Quedas de conexão com a fila de telemetria na flash simulada: o ciclo do vTaskTelemetry de
+// src/main.cpp (TelemetryQueue::flush sobre o TelemetryUploader), com uma amostra por minuto e a
+// nuvem respondendo pelo HostNet. Verifica a ordem de entrega, a capacidade da partição, a
+// contagem de escritas na flash e a retomada da fila depois de um reset.
+#include <unity.h>
+
+#include <vector>
+
+#include "esp_system.h"
+#include "hostNet.h"
+#include "hostSim.h"
+#include "telemetryQueue.h"
+#include "telemetryUploader.h"
+
+// Mesmos valores de src/main.cpp e de partitions_telemetry.csv
+#define TELEMETRY_SAMPLE_DELAY 60000
+#define TELEMETRY_WINDOW 900000
+#define TELEMETRY_CAPACITY 128
+#define QUEUE_PARTITION_SIZE 0x10000
+
+#define QUEUE_CAPACITY 4080  // 16 setores de 255 registros
+#define RECORD_SIZE 16       // Registro e cabeçalho de setor
+#define INSERT_URL "https://data.mongodb-api.com/app/data/endpoint/data/v1/action/insertMany"
+#define MS 1000LL
+#define HOUR 60
+
+// Data API: guarda o valor de cada amostra recebida, na ordem de chegada
+class SimCloud {
+  public:
+   bool online = false;
+   std::vector<int32_t> received;
+
+   void handle(const HostHttpRequest &request, HostHttpResponse &response) {
+      if (!online)
+         return;
+
+      DynamicJsonDocument body(32768);
+      TEST_ASSERT_FALSE(deserializeJson(body, request.body));
+
+      for (JsonVariant document : body["documents"].as<JsonArray>())
+         received.push_back(document["v"].as<int32_t>());
+
+      response.status = 201;
+   }
+};
+
+// Uma placa: o buffer da RAM, a fila na flash e o ciclo do vTaskTelemetry
+struct Board {
+   TelemetryUploader telemetry;
+   TelemetryQueue queue;
+   TelemetrySample batch[TELEMETRY_CAPACITY];
+   SemaphoreHandle_t wifiMutex;
+
+   Board(TelemetryQueuePolicy policy) : telemetry(TELEMETRY_CAPACITY, TELEMETRY_WINDOW), queue(policy) {
+      telemetry.begin("A0B1C2D3", INSERT_URL, "key", "");
+      queue.begin("telemetry");
+      wifiMutex = xSemaphoreCreateMutex();
+   }
+
+   ~Board() {
+      vSemaphoreDelete(wifiMutex);
+   }
+
+   void cycle(bool online) {
+      queue.flush(telemetry, batch, TELEMETRY_CAPACITY, online, wifiMutex);
+      TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(wifiMutex, 0));
+      xSemaphoreGive(wifiMutex);
+   }
+
+   // Envia o primeiro lote da fila sem marcá-lo como consumido, como um reset entre o envio e o commit
+   size_t uploadWithoutCommit() {
+      size_t length = queue.read(batch, TELEMETRY_CAPACITY);
+
+      TEST_ASSERT_TRUE(telemetry.upload(batch, length));
+
+      return length;
+   }
+};
+
+static SimCloud cloud;
+static int32_t nextValue;
+
+// Uma iteração do vTaskTelemetry por minuto, com o valor da amostra igual à sua ordem
+static void run(Board *board, uint32_t minutes) {
+   for (uint32_t minute = 0; minute < minutes; minute++) {
+      board->telemetry.record(TELEMETRY_RSSI, 0, nextValue++, HostSim::now() / 1000000);
+      board->cycle(cloud.online);
+      HostSim::advance(TELEMETRY_SAMPLE_DELAY * MS);
+   }
+}
+
+// Avança até a janela seguinte ser gravada na flash, deixando o buffer da RAM vazio
+static void runUntilFlushed(Board *board) {
+   do {
+      run(board, 1);
+   } while (board->telemetry.getPending() > 0);
+}
+
+static Board *reboot(Board *board, TelemetryQueuePolicy policy) {
+   delete board;
+   HostSim::reboot(ESP_RST_PANIC);
+
+   return new Board(policy);
+}
+
+// Os valores recebidos formam a sequência first, first + 1, ...
+static void assertConsecutive(const std::vector<int32_t> &values, size_t from, size_t to, int32_t first) {
+   for (size_t index = from; index < to; index++)
+      TEST_ASSERT_EQUAL_INT32(first + (int32_t)(index - from), values[index]);
+}
+
+void setUp() {
+   HostSim::reset();
+   HostSim::addPartition("telemetry", QUEUE_PARTITION_SIZE);
+
+   cloud = SimCloud();
+   HostNet::onHttp([](const HostHttpRequest &request, HostHttpResponse &response) { cloud.handle(request, response); });
+   nextValue = 0;
+}
+
+void tearDown() {}
+
+// Queda de 10 h dentro da capacidade da partição: nada se perde, a nuvem recebe tudo na ordem
+// amostrada (inclusive a janela que fecha logo depois da volta da conexão) e cada janela custa
+// uma escrita na flash, não uma por amostra
+void test_outage_within_capacity_is_delivered_in_order() {
+   Board *board = new Board(QUEUE_DROP_OLDEST);
+
+   cloud.online = true;
+   run(board, HOUR);
+   cloud.online = false;
+   run(board, 10 * HOUR);
+   cloud.online = true;
+   run(board, HOUR);
+
+   TelemetryQueueStats stats = board->queue.getStats();
+   HostFlashStats flash = HostSim::getFlashStats("telemetry");
+
+   TEST_ASSERT_EQUAL_UINT32(0, board->queue.size());
+   TEST_ASSERT_EQUAL_UINT32(0, stats.dropped + stats.rejected + stats.corrupted);
+   TEST_ASSERT_EQUAL_UINT32(nextValue - board->telemetry.getPending(), cloud.received.size());
+   assertConsecutive(cloud.received, 0, cloud.received.size(), 0);
+
+   // Os contadores da fila batem com o que chegou à flash
+   TEST_ASSERT_EQUAL_UINT32(flash.writes, stats.flashWrites);
+   TEST_ASSERT_EQUAL_UINT32(flash.erases, stats.flashErases);
+
+   // Registros e cabeçalhos em escritas de RECORD_SIZE bytes e um byte por commit de lote
+   TEST_ASSERT_EQUAL_UINT32((stats.pushed + flash.erases) * RECORD_SIZE + stats.commits, flash.bytesWritten);
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 * stats.batches + flash.erases + stats.commits, flash.writes);
+   TEST_ASSERT_LESS_THAN_UINT32(stats.pushed / 10, flash.writes);
+   TEST_ASSERT_EQUAL_UINT32((stats.pushed + TELEMETRY_CAPACITY - 1) / TELEMETRY_CAPACITY, stats.commits);
+
+   delete board;
+}
+
+// Queda de 3 dias com DROP_OLDEST: a fila guarda as amostras mais novas, descarta as antigas em
+// setores inteiros e distribui os apagamentos por toda a partição
+void test_long_outage_keeps_the_newest_samples() {
+   Board *board = new Board(QUEUE_DROP_OLDEST);
+
+   run(board, 72 * HOUR);
+   cloud.online = true;
+   run(board, 1);
+
+   TelemetryQueueStats stats = board->queue.getStats();
+   HostFlashStats flash = HostSim::getFlashStats("telemetry");
+
+   TEST_ASSERT_GREATER_THAN_UINT32(0, stats.dropped);
+   TEST_ASSERT_EQUAL_UINT32(0, stats.rejected);
+   TEST_ASSERT_EQUAL_UINT32(stats.pushed - stats.dropped, cloud.received.size());
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(QUEUE_CAPACITY, cloud.received.size());
+   TEST_ASSERT_EQUAL_INT32(stats.dropped, cloud.received.front());
+   TEST_ASSERT_EQUAL_INT32(nextValue - 1 - board->telemetry.getPending(), cloud.received.back());
+   assertConsecutive(cloud.received, 0, cloud.received.size(), stats.dropped);
+
+   TEST_ASSERT_LESS_OR_EQUAL_UINT32(1, flash.maxSectorErases - flash.minSectorErases);
+   TEST_ASSERT_EQUAL_UINT32(flash.maxSectorErases, stats.maxEraseCount);
+
+   delete board;
+}
+
+// Com backpressure a fila cheia recusa novas janelas: as amostras mais antigas são preservadas e
+// o excesso é descartado no buffer da RAM, sem que a fila perca ou recuse registros
+void test_backpressure_keeps_the_oldest_samples() {
+   Board *board = new Board(QUEUE_BACKPRESSURE);
+
+   run(board, 72 * HOUR);
+
+   TelemetryQueueStats stats = board->queue.getStats();
+
+   TEST_ASSERT_EQUAL_UINT32(QUEUE_CAPACITY, board->queue.size());
+   TEST_ASSERT_EQUAL_UINT32(0, stats.dropped + stats.rejected);
+   TEST_ASSERT_EQUAL_UINT32(TELEMETRY_CAPACITY, board->telemetry.getPending());
+   TEST_ASSERT_EQUAL_UINT32(nextValue - QUEUE_CAPACITY - TELEMETRY_CAPACITY, board->telemetry.getStats().dropped);
+
+   cloud.online = true;
+   run(board, 1);
+
+   TEST_ASSERT_EQUAL_UINT32(0, board->queue.size());
+   TEST_ASSERT_EQUAL_UINT32(QUEUE_CAPACITY, cloud.received.size());
+   assertConsecutive(cloud.received, 0, QUEUE_CAPACITY, 0);
+
+   delete board;
+}
+
+// Resets durante a queda e entre o envio de um lote e o seu commit: a fila é reconstruída da
+// flash, nada do que foi gravado se perde e só o lote sem commit chega em duplicidade
+void test_reboot_rebuilds_the_queue() {
+   Board *board = new Board(QUEUE_DROP_OLDEST);
+
+   run(board, 2 * HOUR);
+   runUntilFlushed(board);
+   size_t queued = board->queue.size();
+
+   board = reboot(board, QUEUE_DROP_OLDEST);
+   TEST_ASSERT_EQUAL_UINT32(queued, board->queue.size());
+
+   run(board, 2 * HOUR);
+   runUntilFlushed(board);
+   int32_t flushed = nextValue;
+
+   cloud.online = true;
+   size_t duplicated = board->uploadWithoutCommit();
+
+   board = reboot(board, QUEUE_DROP_OLDEST);
+   TEST_ASSERT_EQUAL_UINT32(flushed, board->queue.size());
+
+   run(board, 1);
+
+   TEST_ASSERT_EQUAL_UINT32(0, board->queue.size());
+   TEST_ASSERT_EQUAL_UINT32(flushed + duplicated, cloud.received.size());
+   assertConsecutive(cloud.received, 0, duplicated, 0);
+   assertConsecutive(cloud.received, duplicated, cloud.received.size(), 0);
+   TEST_ASSERT_EQUAL_UINT32(0, board->queue.getStats().corrupted);
+
+   delete board;
+}
+
+// Placa atualizada por OTA sem a partição: a fila fica indisponível, a flash não é tocada e as
+// amostras esperam na RAM até o limite do buffer
+void test_missing_partition_falls_back_to_ram() {
+   HostSim::reset();
+   cloud = SimCloud();
+   HostNet::onHttp([](const HostHttpRequest &request, HostHttpResponse &response) { cloud.handle(request, response); });
+
+   Board *board = new Board(QUEUE_DROP_OLDEST);
+
+   TEST_ASSERT_FALSE(board->queue.isAvailable());
+   TEST_ASSERT_EQUAL_UINT32(0, board->queue.getCapacity());
+
+   run(board, 3 * HOUR);
+   TEST_ASSERT_EQUAL_UINT32(TELEMETRY_CAPACITY, board->telemetry.getPending());
+   TEST_ASSERT_EQUAL_UINT32(3 * HOUR - TELEMETRY_CAPACITY, board->telemetry.getStats().dropped);
+
+   cloud.online = true;
+   run(board, 1);
+
+   TEST_ASSERT_EQUAL_UINT32(TELEMETRY_CAPACITY, cloud.received.size());
+   assertConsecutive(cloud.received, 0, TELEMETRY_CAPACITY, 0);
+   TEST_ASSERT_EQUAL_UINT32(0, board->queue.getStats().pushed);
+
+   delete board;
+}
+
+int main(int argc, char **argv) {
+   UNITY_BEGIN();
+   RUN_TEST(test_outage_within_capacity_is_delivered_in_order);
+   RUN_TEST(test_long_outage_keeps_the_newest_samples);
+   RUN_TEST(test_backpressure_keeps_the_oldest_samples);
+   RUN_TEST(test_reboot_rebuilds_the_queue);
+   RUN_TEST(test_missing_partition_falls_back_to_ram);
+   return UNITY_END();
+}